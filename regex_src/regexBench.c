@@ -0,0 +1,1410 @@
+/*
+ *    Stack-less Just-In-Time compiler
+ *
+ *    Copyright Zoltan Herczeg (hzmester@freemail.hu). All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are
+ * permitted provided that the following conditions are met:
+ *
+ *   1. Redistributions of source code must retain the above copyright notice, this list of
+ *      conditions and the following disclaimer.
+ *
+ *   2. Redistributions in binary form must reproduce the above copyright notice, this list
+ *      of conditions and the following disclaimer in the documentation and/or other materials
+ *      provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDER(S) AND CONTRIBUTORS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDER(S) OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ * TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/* Log scanning benchmark of the regex matching modes, of the regex
+   sets, which scan the log once regardless of the rule count, of the
+   UTF-8 mode, which matches UTF-8 logs without transcoding them, of
+   a machine shared by several threads, of a log split into chunks,
+   which are scanned in parallel, of a log file, which is mapped or
+   read, and of many short subjects. A file larger than the memory can
+   be passed to the file scanning benchmark (a copy of the generated
+   log is scanned otherwise). The --csv option prints the results of
+   the pattern suite only, in a machine readable form.
+   Usage: regex_bench [--csv] [megabytes [file]] */
+
+/* Must be the first one. Must not depend on any other include. */
+#include "sljitLir.h"
+#include "regexJIT.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#ifdef REGEX_USE_8BIT_CHARS
+
+static const char *levels[] = { "INFO ", "INFO ", "INFO ", "INFO ", "DEBUG", "DEBUG", "WARN ", "ERROR" };
+static const char *paths[] = { "items", "users", "orders", "search", "login" };
+
+/* The machine code skips quickly to a rare first character, while the
+   lazy DFA is faster when many partial matches are active. */
+static const char *patterns[] = {
+	"ERROR.*timeout",
+	"status=5[0-9][0-9]",
+	"time=[0-9]{4,}ms",
+	"[a-z]+/[0-9]+ status=404",
+	"[a-z]+-[0-9]+. GET /api/v[0-9]/orders",
+	"[0-9]+:[0-9]+:[0-9]+ (WARN|ERROR).*v3",
+	/* Large character ranges are checked by a bitmap lookup. */
+	"[A-Za-z_.-]+-[0-9]+[^A-Za-z0-9 ] GET",
+	"[0-9a-fA-F:.-]{8,} [A-Z]{4} +[^A-Za-z0-9_ ]",
+	NULL
+};
+
+static sljit_u32 seed = 12345;
+
+static sljit_u32 next_random(void)
+{
+	seed = seed * 1103515245u + 12345u;
+	return seed >> 8;
+}
+
+static long generate_log(char *buffer, long size)
+{
+	long length = 0;
+	sljit_u32 level;
+	int written;
+
+	while (length < size - 256) {
+		level = next_random() % 8;
+		written = sprintf(buffer + length, "2024-05-%02u %02u:%02u:%02u %s [worker-%u] GET /api/v%u/%s/%u status=%u time=%ums%s\n",
+			next_random() % 28 + 1, next_random() % 24, next_random() % 60, next_random() % 60,
+			levels[level], next_random() % 32, next_random() % 3 + 1, paths[next_random() % 5],
+			next_random() % 100000, (level == 7) ? 500 + next_random() % 4 : 200 + (next_random() % 8 == 0) * 204,
+			(next_random() % 64 == 0) ? 1000 + next_random() % 9000 : next_random() % 400,
+			(level == 7 && next_random() % 4 == 0) ? " upstream timeout" : "");
+		if (written < 0)
+			break;
+		length += written;
+	}
+	return length;
+}
+
+/* Matches every line separately and returns the number of matching lines. */
+static long scan_lines(struct regex_match *match, const char *buffer, long length, long *checksum)
+{
+	const char *ptr = buffer;
+	const char *end = buffer + length;
+	const char *line;
+	long count = 0;
+	int begin, match_end, id;
+
+	*checksum = 0;
+	while (ptr < end) {
+		line = ptr;
+		while (ptr < end && *ptr != '\n')
+			ptr++;
+
+		regex_reset_match(match);
+		regex_continue_match(match, line, (int)(ptr - line));
+		begin = regex_get_result(match, &match_end, &id);
+		if (begin >= 0) {
+			count++;
+			*checksum += begin * 31 + match_end;
+		}
+		ptr++;
+	}
+	return count;
+}
+
+static void bench_pattern(const char *pattern, int flags, const char *buffer, long length, long *count, long *checksum)
+{
+	struct regex_machine *machine;
+	struct regex_match *match;
+	const char *ptr = pattern;
+	clock_t start;
+	double seconds;
+	int error;
+
+	while (*ptr)
+		ptr++;
+
+	machine = regex_compile(pattern, (int)(ptr - pattern), flags, &error);
+	if (!machine) {
+		printf("  %-10s compile error %d\n", (flags & REGEX_LAZY_DFA) ? "lazy dfa" : "machine", error);
+		return;
+	}
+
+	match = regex_begin_match(machine);
+	if (!match) {
+		printf("  %-10s not enough memory\n", (flags & REGEX_LAZY_DFA) ? "lazy dfa" : "machine");
+		regex_free_machine(machine);
+		return;
+	}
+
+	start = clock();
+	*count = scan_lines(match, buffer, length, checksum);
+	seconds = (double)(clock() - start) / CLOCKS_PER_SEC;
+
+	printf("  %-10s %8.3f s %8.1f MB/s %8ld lines\n", (flags & REGEX_LAZY_DFA) ? "lazy dfa" : "machine", seconds,
+		seconds > 0 ? (double)length / seconds / (1024.0 * 1024.0) : 0.0, *count);
+
+	regex_free_match(match);
+	regex_free_machine(machine);
+}
+
+/* Size of the log scanned by the rule benchmark (the rules are also matched one by one). */
+#define RULE_LOG_SIZE	(1024 * 1024)
+/* Largest thread count of the shared machine benchmark. */
+#define BENCH_MAX_THREADS	64
+
+static const char *statuses[] = { "200", "404", "500", "503" };
+
+static int generate_rule(char *buffer, int index)
+{
+	switch (index % 4) {
+	case 0:
+		return sprintf(buffer, "/%s/%u ", paths[next_random() % 5], next_random() % 100);
+	case 1:
+		return sprintf(buffer, "worker-%u\\] GET /api/v%u", next_random() % 32, next_random() % 3 + 1);
+	case 2:
+		return sprintf(buffer, "status=%s time=[0-9]{%u,}ms", statuses[next_random() % 4], next_random() % 3 + 2);
+	default:
+		return sprintf(buffer, "%s/[0-9]*%u status=%s", paths[next_random() % 5], next_random() % 10, statuses[next_random() % 4]);
+	}
+}
+
+/* Returns the number of (line, rule) pairs where the rule matches the line. */
+static long scan_lines_set(struct regex_match *match, int count, const char *buffer, long length)
+{
+	const char *ptr = buffer;
+	const char *end = buffer + length;
+	const char *line;
+	const regex_set_word_t *set_matches;
+	regex_set_word_t word;
+	long matches = 0;
+	int i;
+
+	while (ptr < end) {
+		line = ptr;
+		while (ptr < end && *ptr != '\n')
+			ptr++;
+
+		regex_reset_match(match);
+		regex_continue_match(match, line, (int)(ptr - line));
+		set_matches = regex_get_set_matches(match);
+		for (i = 0; i < count; i += REGEX_SET_WORD_BITS) {
+			for (word = set_matches[i / REGEX_SET_WORD_BITS]; word != 0; word &= word - 1)
+				matches++;
+		}
+		ptr++;
+	}
+	return matches;
+}
+
+static void bench_rule_set(const char **rules, int *lengths, int count, const char *buffer, long length)
+{
+	struct regex_machine *machine;
+	struct regex_match *match;
+	long matches = 0, set_matches, checksum;
+	double separate_seconds, set_seconds, compile_seconds;
+	clock_t start;
+	int i, error;
+
+	/* Every rule is matched separately. */
+	start = clock();
+	for (i = 0; i < count; i++) {
+		machine = regex_compile(rules[i], lengths[i], 0, &error);
+		match = machine ? regex_begin_match(machine) : NULL;
+		if (!match) {
+			printf("  rule %d: compile error %d\n", i, error);
+			if (machine)
+				regex_free_machine(machine);
+			return;
+		}
+		matches += scan_lines(match, buffer, length, &checksum);
+		regex_free_match(match);
+		regex_free_machine(machine);
+	}
+	separate_seconds = (double)(clock() - start) / CLOCKS_PER_SEC;
+
+	start = clock();
+	machine = regex_compile_set(rules, lengths, count, 0, &error);
+	compile_seconds = (double)(clock() - start) / CLOCKS_PER_SEC;
+	match = machine ? regex_begin_match(machine) : NULL;
+	if (!match) {
+		printf("  set compile error %d\n", error);
+		if (machine)
+			regex_free_machine(machine);
+		return;
+	}
+
+	start = clock();
+	set_matches = scan_lines_set(match, count, buffer, length);
+	set_seconds = (double)(clock() - start) / CLOCKS_PER_SEC;
+	regex_free_match(match);
+	regex_free_machine(machine);
+
+	printf("  %4d rules: separate %8.3f s   set %8.3f s (compile %6.3f s) %8.1f MB/s %8ld matches\n",
+		count, separate_seconds, set_seconds, compile_seconds,
+		set_seconds > 0 ? (double)length / set_seconds / (1024.0 * 1024.0) : 0.0, set_matches);
+	if (matches != set_matches)
+		printf("  results differ (%ld != %ld)\n", matches, set_matches);
+}
+
+static void bench_rules(int count, const char *buffer, long length)
+{
+	char *rule_buffer = (char*)malloc((size_t)count * 64);
+	const char **rules = (const char**)malloc((size_t)count * sizeof(const char*));
+	int *lengths = (int*)malloc((size_t)count * sizeof(int));
+	int i;
+
+	if (rule_buffer && rules && lengths) {
+		seed = 54321;
+		for (i = 0; i < count; i++) {
+			rules[i] = rule_buffer + i * 64;
+			lengths[i] = generate_rule(rule_buffer + i * 64, i);
+		}
+		bench_rule_set(rules, lengths, count, buffer, length);
+	}
+	else
+		printf("  not enough memory\n");
+
+	free(rule_buffer);
+	free((void*)rules);
+	free(lengths);
+}
+
+static const char *users[] = { "anna", "J\xc3\xbcrgen", "Zo\xc3\xab", "\xd0\x9e\xd0\xbb\xd1\x8f", "\xe5\xb0\x8f\xe6\x9e\x97" };
+static const char *cities[] = { "Berlin", "M\xc3\xbcnchen", "S\xc3\xa3o Paulo", "\xd0\x9c\xd0\xbe\xd1\x81\xd0\xba\xd0\xb2\xd0\xb0", "\xe6\x9d\xb1\xe4\xba\xac" };
+
+static const char *utf8_patterns[] = {
+	"city=\xe6\x9d\xb1\xe4\xba\xac.*status=5",
+	"user=[\xd0\x90-\xd1\x8f]+ ",
+	"city=[^ ]*\xc3\xbc[a-z]+ ",
+	"user=.{2} city",
+	NULL
+};
+
+static long generate_utf8_log(char *buffer, long size)
+{
+	long length = 0;
+	int written;
+
+	while (length < size - 256) {
+		written = sprintf(buffer + length, "2024-05-%02u %02u:%02u:%02u user=%s city=%s status=%u msg=\xe2\x80\x9c%s\xe2\x80\x9d\n",
+			next_random() % 28 + 1, next_random() % 24, next_random() % 60, next_random() % 60,
+			users[next_random() % 5], cities[next_random() % 5], (next_random() % 16 == 0) ? 500u : 200u,
+			paths[next_random() % 5]);
+		if (written < 0)
+			break;
+		length += written;
+	}
+	return length;
+}
+
+/* Converts a UTF-8 line to UTF-16 (the input is valid), and returns the number of code units. */
+static long transcode_line(const char *line, long length, sljit_u16 *output)
+{
+	const sljit_u8 *ptr = (const sljit_u8*)line;
+	const sljit_u8 *end = ptr + length;
+	sljit_u16 *output_start = output;
+	sljit_u32 chr;
+
+	while (ptr < end) {
+		chr = *ptr++;
+		if (chr >= 0xf0) {
+			chr = ((chr & 0x07) << 18) | ((sljit_u32)(ptr[0] & 0x3f) << 12) | ((sljit_u32)(ptr[1] & 0x3f) << 6) | (sljit_u32)(ptr[2] & 0x3f);
+			ptr += 3;
+			chr -= 0x10000;
+			*output++ = (sljit_u16)(0xd800 | (chr >> 10));
+			chr = 0xdc00 | (chr & 0x3ff);
+		}
+		else if (chr >= 0xe0) {
+			chr = ((chr & 0x0f) << 12) | ((sljit_u32)(ptr[0] & 0x3f) << 6) | (sljit_u32)(ptr[1] & 0x3f);
+			ptr += 2;
+		}
+		else if (chr >= 0xc0) {
+			chr = ((chr & 0x1f) << 6) | (sljit_u32)(ptr[0] & 0x3f);
+			ptr++;
+		}
+		*output++ = (sljit_u16)chr;
+	}
+	return (long)(output - output_start);
+}
+
+/* The wide character build converts every line to UTF-16 before matching:
+   this extra pass is measured against matching the UTF-8 bytes directly. */
+static void bench_utf8(const char *buffer, long length)
+{
+	sljit_u16 *wide_buffer = (sljit_u16*)malloc((size_t)length * sizeof(sljit_u16));
+	const char *ptr = buffer;
+	const char *end = buffer + length;
+	const char *line;
+	long wide_length = 0, count1, count2, checksum1, checksum2;
+	double seconds;
+	clock_t start;
+	int i;
+
+	if (!wide_buffer) {
+		printf("  not enough memory\n");
+		return;
+	}
+
+	start = clock();
+	while (ptr < end) {
+		line = ptr;
+		while (ptr < end && *ptr != '\n')
+			ptr++;
+		wide_length += transcode_line(line, (long)(ptr - line), wide_buffer + wide_length);
+		ptr++;
+	}
+	seconds = (double)(clock() - start) / CLOCKS_PER_SEC;
+	printf("  transcoding to UTF-16: %.3f s, %.1f MB written\n", seconds, (double)wide_length * 2 / (1024.0 * 1024.0));
+	free(wide_buffer);
+
+	for (i = 0; utf8_patterns[i]; i++) {
+		printf("'%s'\n", utf8_patterns[i]);
+		count1 = count2 = checksum1 = checksum2 = -1;
+		bench_pattern(utf8_patterns[i], REGEX_UTF8, buffer, length, &count1, &checksum1);
+		bench_pattern(utf8_patterns[i], REGEX_UTF8 | REGEX_LAZY_DFA, buffer, length, &count2, &checksum2);
+		if (count1 != count2 || checksum1 != checksum2)
+			printf("  results differ\n");
+	}
+}
+
+/* Every line is a separate request, which needs its own match structure. */
+struct thread_data {
+	pthread_t thread;
+	struct regex_machine *machine;
+	struct regex_match_pool *pool;
+	const char *buffer;
+	long length;
+	long count;
+};
+
+static void* scan_requests(void *arg)
+{
+	struct thread_data *data = (struct thread_data*)arg;
+	struct regex_match *match;
+	const char *ptr = data->buffer;
+	const char *end = ptr + data->length;
+	const char *line;
+	int match_end, id;
+
+	data->count = 0;
+	while (ptr < end) {
+		line = ptr;
+		while (ptr < end && *ptr != '\n')
+			ptr++;
+
+		match = data->pool ? regex_acquire_match(data->pool) : regex_begin_match(data->machine);
+		if (!match)
+			return NULL;
+		regex_continue_match(match, line, (int)(ptr - line));
+		if (regex_get_result(match, &match_end, &id) >= 0)
+			data->count++;
+		if (data->pool)
+			regex_release_match(data->pool, match);
+		else
+			regex_free_match(match);
+		ptr++;
+	}
+	return NULL;
+}
+
+static double wall_clock(void)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (double)now.tv_sec + (double)now.tv_nsec / 1e9;
+}
+
+/* Returns the number of requests processed in a second. */
+static double run_threads(struct regex_machine *machine, struct regex_match_pool *pool, int thread_count, const char *buffer, long length, long *count)
+{
+	struct thread_data data[BENCH_MAX_THREADS];
+	double start;
+	long lines = 0;
+	int i;
+
+	for (i = 0; i < length; i++)
+		if (buffer[i] == '\n')
+			lines++;
+
+	start = wall_clock();
+	for (i = 0; i < thread_count; i++) {
+		data[i].machine = machine;
+		data[i].pool = pool;
+		data[i].buffer = buffer;
+		data[i].length = length;
+		pthread_create(&data[i].thread, NULL, scan_requests, data + i);
+	}
+
+	*count = 0;
+	for (i = 0; i < thread_count; i++) {
+		pthread_join(data[i].thread, NULL);
+		*count += data[i].count;
+	}
+	return (double)(lines * thread_count) / (wall_clock() - start);
+}
+
+static void bench_threads(const char *pattern, const char *buffer, long length)
+{
+	struct regex_machine *machine;
+	struct regex_match_pool *pool;
+	double allocated, pooled;
+	long count1, count2;
+	int threads, error;
+	const char *ptr = pattern;
+
+	while (*ptr)
+		ptr++;
+
+	machine = regex_compile(pattern, (int)(ptr - pattern), 0, &error);
+	pool = machine ? regex_create_match_pool(machine, BENCH_MAX_THREADS) : NULL;
+	if (!pool) {
+		printf("  compile error %d\n", error);
+		if (machine)
+			regex_free_machine(machine);
+		return;
+	}
+
+	for (threads = 1; threads <= BENCH_MAX_THREADS; threads *= 2) {
+		allocated = run_threads(machine, NULL, threads, buffer, length, &count1);
+		pooled = run_threads(machine, pool, threads, buffer, length, &count2);
+		printf("  %2d threads: begin/free %8.2f M requests/s   pool %8.2f M requests/s\n",
+			threads, allocated / 1e6, pooled / 1e6);
+		if (count1 != count2)
+			printf("  results differ (%ld != %ld)\n", count1, count2);
+	}
+
+	regex_free_match_pool(pool);
+	regex_free_machine(machine);
+}
+
+/* Chunks of a parallel scan per thread: the threads take the next chunk
+   when they are finished, so slower chunks do not stall the scan. */
+#define PARALLEL_CHUNKS_PER_THREAD	4
+/* The speculative scan of a chunk continues after its end until a match
+   starting in the chunk is decided, but at most this many characters. */
+#define PARALLEL_OVERLAP	4096
+
+/* The chunks are scanned independently (by separate match structures), and
+   the results are merged in order by the main thread. In line mode, the
+   chunks end at newlines and every line is a separate subject. Otherwise
+   the chunks end anywhere, and each chunk is scanned speculatively from its
+   beginning: the scan finds the same matches as regex_find_all, after the
+   previous chunk is merged and the scan restarts at the same position.
+     Note: the matches must be shorter than PARALLEL_OVERLAP, and the
+       pattern must not be anchored by ^ or $ (the speculative scan). */
+struct parallel_chunk {
+	long begin;
+	long end;
+	/* Line mode: number of matching lines. */
+	long count;
+	long checksum;
+	/* Speculative mode: begin and end pairs of the matches starting in the chunk. */
+	long *matches;
+	long size;
+	int error;
+};
+
+struct parallel_scan {
+	struct regex_machine *machine;
+	const char *buffer;
+	long length;
+	int line_mode;
+	struct parallel_chunk *chunks;
+	int chunk_count;
+	int next_chunk;
+	pthread_mutex_t lock;
+};
+
+/* Finds the first match starting at offset or after it, before limit. */
+static int find_next(struct regex_match *match, const char *buffer, long offset, long limit, long *begin, long *end)
+{
+	int match_begin, match_end, id;
+
+	regex_reset_match(match);
+	regex_continue_match(match, buffer + offset, (int)(limit - offset));
+	match_begin = regex_get_result(match, &match_end, &id);
+	if (match_begin < 0)
+		return 0;
+
+	*begin = offset + match_begin;
+	*end = offset + match_end;
+	return 1;
+}
+
+/* Same as regex_find_all: the search continues from the next character after an empty match. */
+#define RESTART_OFFSET(begin, end) \
+	((begin) == (end) ? (end) + 1 : (end))
+
+static int add_chunk_match(struct parallel_chunk *chunk, long begin, long end)
+{
+	long *matches;
+
+	if ((chunk->count & 0xfff) == 0) {
+		matches = (long*)realloc(chunk->matches, (size_t)(chunk->count + 0x1000) * 2 * sizeof(long));
+		if (!matches)
+			return 0;
+		chunk->matches = matches;
+	}
+	chunk->matches[chunk->count * 2] = begin;
+	chunk->matches[chunk->count * 2 + 1] = end;
+	chunk->count++;
+	return 1;
+}
+
+static void scan_chunk(struct parallel_scan *scan, struct regex_match *match, struct parallel_chunk *chunk)
+{
+	/* The last chunk also accepts an empty match at the end of the buffer. */
+	long accept = (chunk->end < scan->length) ? chunk->end : scan->length + 1;
+	long limit = chunk->end + PARALLEL_OVERLAP;
+	long offset = chunk->begin;
+	long begin, end;
+
+	if (scan->line_mode) {
+		chunk->count = scan_lines(match, scan->buffer + chunk->begin, chunk->end - chunk->begin, &chunk->checksum);
+		return;
+	}
+
+	if (limit > scan->length)
+		limit = scan->length;
+
+	while (offset <= limit && find_next(match, scan->buffer, offset, limit, &begin, &end) && begin < accept) {
+		if (!add_chunk_match(chunk, begin, end)) {
+			chunk->error = 1;
+			return;
+		}
+		offset = RESTART_OFFSET(begin, end);
+	}
+}
+
+static void* scan_chunks(void *arg)
+{
+	struct parallel_scan *scan = (struct parallel_scan*)arg;
+	struct regex_match *match = regex_begin_match(scan->machine);
+	int index;
+
+	while (1) {
+		pthread_mutex_lock(&scan->lock);
+		index = scan->next_chunk++;
+		pthread_mutex_unlock(&scan->lock);
+
+		if (index >= scan->chunk_count)
+			break;
+		if (!match)
+			scan->chunks[index].error = 1;
+		else
+			scan_chunk(scan, match, scan->chunks + index);
+	}
+
+	if (match)
+		regex_free_match(match);
+	return NULL;
+}
+
+/* Merges the matches of the speculative scans. Returns with -1 on error. */
+static long merge_chunks(struct parallel_scan *scan, struct regex_match *match, long *checksum)
+{
+	struct parallel_chunk *chunk = scan->chunks;
+	struct parallel_chunk *chunks_end = chunk + scan->chunk_count;
+	long offset = 0, count = 0;
+	long accept, limit, begin, end, i;
+
+	*checksum = 0;
+	for (; chunk < chunks_end; chunk++) {
+		if (chunk->error)
+			return -1;
+		if (scan->line_mode) {
+			count += chunk->count;
+			*checksum += chunk->checksum;
+			continue;
+		}
+
+		accept = (chunk->end < scan->length) ? chunk->end : scan->length + 1;
+		limit = chunk->end + PARALLEL_OVERLAP;
+		if (limit > scan->length)
+			limit = scan->length;
+
+		/* The last match of the previous chunk ends inside this chunk. The
+		   chunk is rescanned until the scan restarts at the same position as
+		   the speculative scan (which usually happens after a few matches). */
+		i = 0;
+		while (offset != chunk->begin) {
+			while (i < chunk->count && RESTART_OFFSET(chunk->matches[i * 2], chunk->matches[i * 2 + 1]) < offset)
+				i++;
+			if (i < chunk->count && RESTART_OFFSET(chunk->matches[i * 2], chunk->matches[i * 2 + 1]) == offset) {
+				i++;
+				break;
+			}
+			if (offset > limit || !find_next(match, scan->buffer, offset, limit, &begin, &end) || begin >= accept) {
+				i = chunk->count;
+				break;
+			}
+			count++;
+			*checksum += begin * 31 + end;
+			offset = RESTART_OFFSET(begin, end);
+		}
+
+		for (; i < chunk->count; i++) {
+			begin = chunk->matches[i * 2];
+			end = chunk->matches[i * 2 + 1];
+			count++;
+			*checksum += begin * 31 + end;
+			offset = RESTART_OFFSET(begin, end);
+		}
+
+		if (offset < chunk->end)
+			offset = chunk->end;
+	}
+	return count;
+}
+
+/* Returns with the number of matches (or matching lines), or -1 on error. */
+static long parallel_scan(struct parallel_scan *scan, int thread_count, long *checksum)
+{
+	pthread_t threads[BENCH_MAX_THREADS];
+	struct regex_match *match;
+	long chunk_size = scan->length / scan->chunk_count + 1;
+	long begin = 0, end, count;
+	int i;
+
+	for (i = 0; i < scan->chunk_count; i++) {
+		end = begin + chunk_size;
+		if (end >= scan->length)
+			end = scan->length;
+		else if (scan->line_mode) {
+			while (end < scan->length && scan->buffer[end - 1] != '\n')
+				end++;
+		}
+
+		scan->chunks[i].begin = begin;
+		scan->chunks[i].end = end;
+		scan->chunks[i].count = 0;
+		scan->chunks[i].error = 0;
+		begin = end;
+	}
+
+	scan->next_chunk = 0;
+	for (i = 0; i < thread_count; i++)
+		pthread_create(threads + i, NULL, scan_chunks, scan);
+	for (i = 0; i < thread_count; i++)
+		pthread_join(threads[i], NULL);
+
+	match = regex_begin_match(scan->machine);
+	if (!match)
+		return -1;
+	count = merge_chunks(scan, match, checksum);
+	regex_free_match(match);
+	return count;
+}
+
+static void bench_parallel(const char *pattern, int line_mode, const char *buffer, long length)
+{
+	struct parallel_scan scan;
+	struct regex_find_result last;
+	double start, seconds;
+	long count, checksum, expected_count = -1, expected_checksum = -1;
+	int threads, i, error;
+	const char *ptr = pattern;
+
+	while (*ptr)
+		ptr++;
+
+	scan.machine = regex_compile(pattern, (int)(ptr - pattern), 0, &error);
+	if (!scan.machine) {
+		printf("  compile error %d\n", error);
+		return;
+	}
+
+	scan.buffer = buffer;
+	scan.length = length;
+	scan.line_mode = line_mode;
+	scan.chunks = (struct parallel_chunk*)calloc((size_t)BENCH_MAX_THREADS * PARALLEL_CHUNKS_PER_THREAD, sizeof(struct parallel_chunk));
+	pthread_mutex_init(&scan.lock, NULL);
+
+	if (!line_mode && regex_find_all(scan.machine, buffer, (int)length, &last, 1, &expected_count) != REGEX_NO_ERROR)
+		expected_count = -1;
+
+	for (threads = 1; scan.chunks && threads <= BENCH_MAX_THREADS; threads *= 2) {
+		scan.chunk_count = threads * PARALLEL_CHUNKS_PER_THREAD;
+
+		start = wall_clock();
+		count = parallel_scan(&scan, threads, &checksum);
+		seconds = wall_clock() - start;
+
+		for (i = 0; i < scan.chunk_count; i++) {
+			free(scan.chunks[i].matches);
+			scan.chunks[i].matches = NULL;
+		}
+
+		if (count < 0) {
+			printf("  not enough memory\n");
+			break;
+		}
+
+		printf("  %2d threads %8.3f s %8.2f GB/s %9ld %s\n", threads, seconds,
+			seconds > 0 ? (double)length / seconds / (1024.0 * 1024.0 * 1024.0) : 0.0,
+			count, line_mode ? "lines" : "matches");
+
+		/* The results must not depend on the number of chunks. */
+		if (threads == 1 && line_mode)
+			expected_count = count;
+		if (threads == 1)
+			expected_checksum = checksum;
+		if (count != expected_count || checksum != expected_checksum)
+			printf("  results differ (%ld != %ld)\n", count, expected_count);
+	}
+
+	if (!scan.chunks)
+		printf("  not enough memory\n");
+
+	pthread_mutex_destroy(&scan.lock);
+	free(scan.chunks);
+	regex_free_machine(scan.machine);
+}
+
+/* Removes the pages of the file from the cache (when the system supports it), so
+   the next scan reads the file from the disk, as if it was larger than the cache. */
+static int drop_file_cache(const char *path)
+{
+	int fd = open(path, O_RDONLY);
+	int result = 0;
+
+	if (fd < 0)
+		return 0;
+#ifdef POSIX_FADV_DONTNEED
+	result = fsync(fd) == 0 && posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED) == 0;
+#endif
+	close(fd);
+	return result;
+}
+
+static void bench_scan_file(const char *pattern, const char *path, long length)
+{
+	struct regex_machine *machine;
+	double start, seconds;
+	regex_offset_t count, expected = -1;
+	int mode, cold, error;
+	const char *ptr = pattern;
+
+	while (*ptr)
+		ptr++;
+
+	machine = regex_compile(pattern, (int)(ptr - pattern), 0, &error);
+	if (!machine) {
+		printf("  compile error %d\n", error);
+		return;
+	}
+
+	for (cold = 1; cold >= 0; cold--) {
+		for (mode = REGEX_SCAN_MMAP; mode <= REGEX_SCAN_READ; mode++) {
+			if (cold && !drop_file_cache(path)) {
+				printf("  %-6s cold: cannot drop the cached pages\n", mode == REGEX_SCAN_MMAP ? "mmap" : "read");
+				continue;
+			}
+
+			start = wall_clock();
+			error = regex_scan_file(machine, path, mode, NULL, NULL, &count);
+			seconds = wall_clock() - start;
+			if (error != REGEX_NO_ERROR) {
+				printf("  scan error %d\n", error);
+				regex_free_machine(machine);
+				return;
+			}
+
+			printf("  %-6s %s %8.3f s %8.1f MB/s %8lld lines\n", mode == REGEX_SCAN_MMAP ? "mmap" : "read",
+				cold ? "cold" : "warm", seconds, seconds > 0 ? (double)length / seconds / (1024.0 * 1024.0) : 0.0, (long long)count);
+			if (expected >= 0 && count != expected)
+				printf("  results differ (%lld != %lld)\n", (long long)count, (long long)expected);
+			expected = count;
+		}
+	}
+
+	regex_free_machine(machine);
+}
+
+/* Returns with the size of the file, or -1 on error. The log is written into
+   a temporary file, unless a file is passed on the command line. */
+static long prepare_scan_file(const char *buffer, long length, char *path)
+{
+	FILE *file;
+	int fd;
+
+	if (path[0] != '\0') {
+		file = fopen(path, "rb");
+		if (!file || fseek(file, 0, SEEK_END) != 0) {
+			if (file)
+				fclose(file);
+			return -1;
+		}
+		length = ftell(file);
+		fclose(file);
+		return length;
+	}
+
+	strcpy(path, "/tmp/regex_bench_XXXXXX");
+	fd = mkstemp(path);
+	if (fd < 0)
+		return -1;
+
+	file = fdopen(fd, "wb");
+	if (!file) {
+		close(fd);
+		remove(path);
+		return -1;
+	}
+	if (fwrite(buffer, 1, (size_t)length, file) != (size_t)length)
+		length = -1;
+	if (fclose(file) != 0)
+		length = -1;
+	if (length < 0)
+		remove(path);
+	return length;
+}
+
+/* Representative patterns of the suite, which is used to track the matching
+   speed, the compile time and the memory consumption across versions. */
+struct suite_pattern {
+	const char *category;
+	const char *pattern;
+};
+
+static const struct suite_pattern suite_patterns[] = {
+	{ "literal", "timeout" },
+	{ "literal", "status=503" },
+	{ "class", "[0-9]+ms" },
+	{ "class", "[A-Z]+ +[^ ]+ GET" },
+	{ "alternation", "WARN|ERROR" },
+	{ "alternation", "(items|users)/[0-9]+ status=(404|500)" },
+	{ "bounded", "time=[0-9]{3,4}ms" },
+	{ "bounded", "/[0-9]{1,20} status" },
+	{ "anchored", "^2024-05-1[0-9] 0" },
+	{ "anchored", "timeout$" },
+	{ "unanchored", "v[0-9]/[a-z]+/[0-9]+5 " },
+	{ "unanchored", "[a-z]+-[0-9]+. GET /api/v[0-9]/orders" },
+	{ NULL, NULL }
+};
+
+/* The compile and scan times are the best of these runs, which
+   are less affected by the other processes than the average. */
+#define SUITE_COMPILES	20
+#define SUITE_SCANS	3
+
+struct suite_result {
+	double compile_seconds;
+	double scan_seconds;
+	long machine_size;
+	long code_size;
+	long match_size;
+	long count;
+	long checksum;
+};
+
+static int run_suite_pattern(const char *pattern, int flags, const char *buffer, long length, struct suite_result *result)
+{
+	struct regex_machine *machine = NULL;
+	struct regex_match *match;
+	const char *ptr = pattern;
+	double start, seconds;
+	int i, error;
+
+	while (*ptr)
+		ptr++;
+
+	result->compile_seconds = -1;
+	for (i = 0; i < SUITE_COMPILES; i++) {
+		if (machine)
+			regex_free_machine(machine);
+
+		start = wall_clock();
+		machine = regex_compile(pattern, (int)(ptr - pattern), flags, &error);
+		seconds = wall_clock() - start;
+		if (!machine)
+			return 0;
+		if (result->compile_seconds < 0 || seconds < result->compile_seconds)
+			result->compile_seconds = seconds;
+	}
+	result->machine_size = regex_get_machine_size(machine, &result->code_size, &result->match_size);
+
+	match = regex_begin_match(machine);
+	if (!match) {
+		regex_free_machine(machine);
+		return 0;
+	}
+
+	result->scan_seconds = -1;
+	for (i = 0; i < SUITE_SCANS; i++) {
+		start = wall_clock();
+		result->count = scan_lines(match, buffer, length, &result->checksum);
+		seconds = wall_clock() - start;
+		if (result->scan_seconds < 0 || seconds < result->scan_seconds)
+			result->scan_seconds = seconds;
+	}
+
+	regex_free_match(match);
+	regex_free_machine(machine);
+	return 1;
+}
+
+/* The machine readable output is a CSV table with a header line. */
+static void bench_suite(const char *buffer, long length, int csv)
+{
+	const struct suite_pattern *suite;
+	struct suite_result results[2];
+	double speed;
+	int i;
+
+	if (csv)
+		printf("category,pattern,mode,compile_us,machine_bytes,code_bytes,match_bytes,mb_per_s,lines\n");
+
+	for (suite = suite_patterns; suite->pattern; suite++) {
+		if (!csv)
+			printf("'%s' (%s)\n", suite->pattern, suite->category);
+
+		for (i = 0; i < 2; i++) {
+			if (!run_suite_pattern(suite->pattern, i ? REGEX_LAZY_DFA : 0, buffer, length, results + i)) {
+				if (csv)
+					printf("%s,\"%s\",%s,error,,,,,\n", suite->category, suite->pattern, i ? "lazy dfa" : "machine");
+				else
+					printf("  %-10s compile error\n", i ? "lazy dfa" : "machine");
+				results[i].count = -1 - i;
+				continue;
+			}
+
+			speed = results[i].scan_seconds > 0 ? (double)length / results[i].scan_seconds / (1024.0 * 1024.0) : 0.0;
+			if (csv)
+				printf("%s,\"%s\",%s,%.2f,%ld,%ld,%ld,%.1f,%ld\n", suite->category, suite->pattern, i ? "lazy dfa" : "machine",
+					results[i].compile_seconds * 1e6, results[i].machine_size, results[i].code_size,
+					results[i].match_size, speed, results[i].count);
+			else
+				printf("  %-10s compile %8.2f us   machine %7ld B (code %7ld B)   match %6ld B %8.1f MB/s %8ld lines\n",
+					i ? "lazy dfa" : "machine", results[i].compile_seconds * 1e6, results[i].machine_size,
+					results[i].code_size, results[i].match_size, speed, results[i].count);
+		}
+
+		if (results[0].count != results[1].count || results[0].checksum != results[1].checksum)
+			printf(csv ? "# results differ: %s\n" : "  results differ\n", suite->pattern);
+	}
+}
+
+/* Number of subjects of the short subject benchmark. */
+#define SHORT_SUBJECTS	1000000
+/* Space reserved for a subject. */
+#define SHORT_SUBJECT_SIZE	64
+
+/* Compares allocating a match structure for each subject with resetting one. */
+static void bench_short_subjects(const char *pattern)
+{
+	char *subject_buffer = (char*)malloc((size_t)SHORT_SUBJECTS * SHORT_SUBJECT_SIZE);
+	const char **subjects = (const char**)malloc((size_t)SHORT_SUBJECTS * sizeof(const char*));
+	int *lengths = (int*)malloc((size_t)SHORT_SUBJECTS * sizeof(int));
+	struct regex_machine *machine = NULL;
+	struct regex_match *match;
+	const char *ptr = pattern;
+	long count1 = 0, count2 = 0;
+	double start, separate, reused;
+	int i, match_end, id, error;
+
+	while (*ptr)
+		ptr++;
+
+	if (subject_buffer && subjects && lengths)
+		machine = regex_compile(pattern, (int)(ptr - pattern), 0, &error);
+
+	if (machine) {
+		seed = 13579;
+		for (i = 0; i < SHORT_SUBJECTS; i++) {
+			subjects[i] = subject_buffer + (long)i * SHORT_SUBJECT_SIZE;
+			lengths[i] = sprintf(subject_buffer + (long)i * SHORT_SUBJECT_SIZE, "https://example.com/api/v%u/%s/%u?page=%u",
+				next_random() % 3 + 1, paths[next_random() % 5], next_random() % 100000, next_random() % 1000);
+		}
+
+		start = wall_clock();
+		for (i = 0; i < SHORT_SUBJECTS; i++) {
+			match = regex_begin_match(machine);
+			if (!match)
+				break;
+			regex_continue_match(match, subjects[i], lengths[i]);
+			if (regex_get_result(match, &match_end, &id) >= 0)
+				count1++;
+			regex_free_match(match);
+		}
+		separate = wall_clock() - start;
+
+		start = wall_clock();
+		match = regex_begin_match(machine);
+		for (i = 0; match && i < SHORT_SUBJECTS; i++) {
+			if (i > 0)
+				regex_reset_match(match);
+			regex_continue_match(match, subjects[i], lengths[i]);
+			if (regex_get_result(match, &match_end, &id) >= 0)
+				count2++;
+		}
+		if (match)
+			regex_free_match(match);
+		reused = wall_clock() - start;
+
+		printf("  begin/free %6.1f ns   reset %6.1f ns per subject %8ld matches\n",
+			separate * 1e9 / SHORT_SUBJECTS, reused * 1e9 / SHORT_SUBJECTS, count2);
+		if (count1 != count2)
+			printf("  results differ\n");
+		regex_free_machine(machine);
+	}
+	else
+		printf("  not enough memory\n");
+
+	free(subject_buffer);
+	free((void*)subjects);
+	free(lengths);
+}
+
+/* Size of the ring buffer of the find all benchmark. */
+#define FIND_ALL_RESULTS	256
+
+static void bench_find_all(const char *pattern, const char *buffer, long length)
+{
+	struct regex_find_result results[FIND_ALL_RESULTS];
+	struct regex_machine *machine;
+	const char *ptr = pattern;
+	long count1, count2;
+	double start, counted, stored;
+	int error;
+
+	while (*ptr)
+		ptr++;
+
+	machine = regex_compile(pattern, (int)(ptr - pattern), 0, &error);
+	if (!machine) {
+		printf("  compile error %d\n", error);
+		return;
+	}
+
+	start = wall_clock();
+	error = regex_find_all(machine, buffer, (int)length, NULL, 0, &count1);
+	counted = wall_clock() - start;
+
+	start = wall_clock();
+	if (error == REGEX_NO_ERROR)
+		error = regex_find_all(machine, buffer, (int)length, results, FIND_ALL_RESULTS, &count2);
+	stored = wall_clock() - start;
+
+	if (error == REGEX_NO_ERROR) {
+		printf("  count %8.3f s %8.1f MB/s   ring buffer %8.3f s %8.1f MB/s %9ld matches\n",
+			counted, counted > 0 ? (double)length / counted / (1024.0 * 1024.0) : 0.0,
+			stored, stored > 0 ? (double)length / stored / (1024.0 * 1024.0) : 0.0, count1);
+		if (count1 != count2)
+			printf("  results differ (%ld != %ld)\n", count1, count2);
+	}
+	else
+		printf("  not enough memory\n");
+
+	regex_free_machine(machine);
+}
+
+/* Bounded repetitions with large counts are matched by counters, which are
+   compared with the same repetition written out as copies of the atom. */
+struct counted_pattern {
+	const char *prefix;
+	const char *atom;
+	const char *suffix;
+	int min;
+	int max;
+};
+
+static const struct counted_pattern counted_patterns[] = {
+	{ "time=", "[0-9]", "ms", 1, 64 },
+	{ "GET ", "[^ ]", " status=5", 16, 48 },
+	{ "ERROR", ".", "timeout", 0, 100 },
+	{ NULL, NULL, NULL, 0, 0 }
+};
+
+static int build_counted(char *buffer, const struct counted_pattern *pattern, int expand)
+{
+	int length, i;
+
+	length = sprintf(buffer, "%s", pattern->prefix);
+	if (!expand)
+		length += sprintf(buffer + length, "%s{%d,%d}", pattern->atom, pattern->min, pattern->max);
+	else {
+		for (i = 0; i < pattern->max; i++)
+			length += sprintf(buffer + length, (i < pattern->min) ? "%s" : "%s?", pattern->atom);
+	}
+	length += sprintf(buffer + length, "%s", pattern->suffix);
+	return length;
+}
+
+static void bench_counted(const struct counted_pattern *pattern, char *pattern_buffer, const char *buffer, long length)
+{
+	struct regex_machine *machine;
+	struct regex_match *match;
+	double start, compiled, scanned;
+	long count[2], checksum[2];
+	int i, pattern_length, error;
+
+	for (i = 0; i < 2; i++) {
+		count[i] = checksum[i] = -1 - i;
+		pattern_length = build_counted(pattern_buffer, pattern, i);
+
+		start = wall_clock();
+		machine = regex_compile(pattern_buffer, pattern_length, 0, &error);
+		compiled = wall_clock() - start;
+		if (!machine) {
+			printf("  %-10s compile error %d\n", i ? "expanded" : "counted", error);
+			continue;
+		}
+
+		match = regex_begin_match(machine);
+		if (!match) {
+			printf("  %-10s not enough memory\n", i ? "expanded" : "counted");
+			regex_free_machine(machine);
+			continue;
+		}
+
+		start = wall_clock();
+		count[i] = scan_lines(match, buffer, length, &checksum[i]);
+		scanned = wall_clock() - start;
+
+		printf("  %-10s compile %8.3f ms   scan %8.3f s %8.1f MB/s %8ld lines\n", i ? "expanded" : "counted",
+			compiled * 1000.0, scanned, scanned > 0 ? (double)length / scanned / (1024.0 * 1024.0) : 0.0, count[i]);
+
+		regex_free_match(match);
+		regex_free_machine(machine);
+	}
+
+	if (count[0] != count[1] || checksum[0] != checksum[1])
+		printf("  results differ\n");
+}
+
+/* Number of patterns of the startup benchmark. */
+#define STARTUP_PATTERNS	1000
+
+/* The last cache entry is the set of all rules. */
+static struct regex_machine* compile_startup_rule(const char **rules, int *lengths, int index, int *error)
+{
+	if (index < STARTUP_PATTERNS)
+		return regex_compile(rules[index], lengths[index], REGEX_SERIALIZABLE, error);
+	return regex_compile_set(rules, lengths, STARTUP_PATTERNS, REGEX_SERIALIZABLE, error);
+}
+
+/* Compares compiling the rules with loading their serialized machines
+   (e.g. from a cache keyed by the pattern and the flags). */
+static void bench_startup_cache(const char **rules, int *lengths, void **cache, int *sizes, const char *buffer, long length)
+{
+	struct regex_machine *machine;
+	struct regex_match *match;
+	double start, compile_seconds, load_seconds;
+	long cache_size = 0, matches = -1, loaded_matches = -2;
+	int i, error;
+
+	start = wall_clock();
+	for (i = 0; i <= STARTUP_PATTERNS; i++) {
+		machine = compile_startup_rule(rules, lengths, i, &error);
+		if (!machine) {
+			printf("  compile error %d\n", error);
+			return;
+		}
+		cache[i] = regex_serialize_machine(machine, &sizes[i]);
+		regex_free_machine(machine);
+		if (!cache[i]) {
+			printf("  not enough memory\n");
+			return;
+		}
+		cache_size += sizes[i];
+	}
+	compile_seconds = wall_clock() - start;
+
+	start = wall_clock();
+	for (i = 0; i < STARTUP_PATTERNS; i++) {
+		machine = regex_deserialize_machine(cache[i], sizes[i], &error);
+		if (!machine) {
+			printf("  load error %d\n", error);
+			return;
+		}
+		regex_free_machine(machine);
+	}
+	machine = regex_deserialize_machine(cache[STARTUP_PATTERNS], sizes[STARTUP_PATTERNS], &error);
+	load_seconds = wall_clock() - start;
+	if (!machine) {
+		printf("  load error %d\n", error);
+		return;
+	}
+
+	match = regex_begin_match(machine);
+	if (match) {
+		loaded_matches = scan_lines_set(match, STARTUP_PATTERNS, buffer, length);
+		regex_free_match(match);
+	}
+	regex_free_machine(machine);
+
+	machine = compile_startup_rule(rules, lengths, STARTUP_PATTERNS, &error);
+	match = machine ? regex_begin_match(machine) : NULL;
+	if (match) {
+		matches = scan_lines_set(match, STARTUP_PATTERNS, buffer, length);
+		regex_free_match(match);
+	}
+	if (machine)
+		regex_free_machine(machine);
+
+	printf("  %d rules and their set: compile %8.3f s   load %8.3f s (%5.1fx) %8.1f KB serialized\n",
+		STARTUP_PATTERNS, compile_seconds, load_seconds, load_seconds > 0 ? compile_seconds / load_seconds : 0.0,
+		(double)cache_size / 1024.0);
+	if (matches != loaded_matches)
+		printf("  results differ (%ld != %ld)\n", matches, loaded_matches);
+}
+
+static void bench_startup(const char *buffer, long length)
+{
+	char *rule_buffer = (char*)malloc((size_t)STARTUP_PATTERNS * 64);
+	const char **rules = (const char**)malloc((size_t)STARTUP_PATTERNS * sizeof(const char*));
+	int *lengths = (int*)malloc((size_t)STARTUP_PATTERNS * sizeof(int));
+	void **cache = (void**)calloc((size_t)STARTUP_PATTERNS + 1, sizeof(void*));
+	int *sizes = (int*)malloc(((size_t)STARTUP_PATTERNS + 1) * sizeof(int));
+	int i;
+
+	if (rule_buffer && rules && lengths && cache && sizes) {
+		seed = 54321;
+		for (i = 0; i < STARTUP_PATTERNS; i++) {
+			rules[i] = rule_buffer + i * 64;
+			lengths[i] = generate_rule(rule_buffer + i * 64, i);
+		}
+		bench_startup_cache(rules, lengths, cache, sizes, buffer, length);
+	}
+	else
+		printf("  not enough memory\n");
+
+	if (cache) {
+		for (i = 0; i <= STARTUP_PATTERNS; i++)
+			free(cache[i]);
+	}
+	free(rule_buffer);
+	free((void*)rules);
+	free(lengths);
+	free((void*)cache);
+	free(sizes);
+}
+
+int main(int argc, char* argv[])
+{
+	int csv = (argc > 1 && strcmp(argv[1], "--csv") == 0);
+	long megabytes = (argc > 1 + csv) ? atol(argv[1 + csv]) : 16;
+	long size = megabytes * 1024 * 1024;
+	char *buffer = (char*)malloc((size_t)size);
+	char *pattern_buffer;
+	char path[256] = "";
+	long length, file_length, count1, count2, checksum1, checksum2;
+	int i;
+
+	if (!buffer || size <= 256) {
+		printf("Not enough memory\n");
+		return 1;
+	}
+
+	length = generate_log(buffer, size);
+
+	if (csv) {
+		printf("# %.1f MB of log lines on %s\n", (double)length / (1024.0 * 1024.0), regex_get_platform_name());
+		bench_suite(buffer, length, 1);
+		free(buffer);
+		return 0;
+	}
+
+	printf("Pattern suite on %.1f MB of log lines on %s\n", (double)length / (1024.0 * 1024.0), regex_get_platform_name());
+	bench_suite(buffer, length, 0);
+
+	printf("Scanning %.1f MB of log lines on %s\n", (double)length / (1024.0 * 1024.0), regex_get_platform_name());
+
+	for (i = 0; patterns[i]; i++) {
+		printf("'%s'\n", patterns[i]);
+		count1 = count2 = checksum1 = checksum2 = -1;
+		bench_pattern(patterns[i], 0, buffer, length, &count1, &checksum1);
+		bench_pattern(patterns[i], REGEX_LAZY_DFA, buffer, length, &count2, &checksum2);
+		if (count1 != count2 || checksum1 != checksum2)
+			printf("  results differ\n");
+	}
+
+	printf("Finding all matches on %.1f MB of log lines\n", (double)length / (1024.0 * 1024.0));
+	for (i = 0; i < 2; i++) {
+		printf("'%s'\n", i ? "[0-9]+" : "status=5[0-9][0-9]");
+		bench_find_all(i ? "[0-9]+" : "status=5[0-9][0-9]", buffer, length);
+	}
+
+	pattern_buffer = (char*)malloc(4096);
+	if (pattern_buffer) {
+		printf("Counted repetitions on %.1f MB of log lines\n", (double)length / (1024.0 * 1024.0));
+		for (i = 0; counted_patterns[i].prefix; i++) {
+			printf("'%s%s{%d,%d}%s'\n", counted_patterns[i].prefix, counted_patterns[i].atom,
+				counted_patterns[i].min, counted_patterns[i].max, counted_patterns[i].suffix);
+			bench_counted(counted_patterns + i, pattern_buffer, buffer, length);
+		}
+		free(pattern_buffer);
+	}
+
+	printf("Scanning %.1f MB of log lines in parallel chunks\n", (double)length / (1024.0 * 1024.0));
+	printf("'%s' (every line is a subject)\n", patterns[1]);
+	bench_parallel(patterns[1], 1, buffer, length);
+	printf("'[0-9]+' (speculative)\n");
+	bench_parallel("[0-9]+", 0, buffer, length);
+
+	if (argc > 2 && strlen(argv[2]) < sizeof(path))
+		strcpy(path, argv[2]);
+	file_length = prepare_scan_file(buffer, length, path);
+	if (file_length >= 0) {
+		printf("Scanning %.1f MB file (%s)\n", (double)file_length / (1024.0 * 1024.0), path);
+		printf("'%s'\n", patterns[0]);
+		bench_scan_file(patterns[0], path, file_length);
+		if (argc <= 2)
+			remove(path);
+	}
+	else
+		printf("Cannot prepare the scanned file\n");
+
+	if (length > RULE_LOG_SIZE) {
+		length = RULE_LOG_SIZE;
+		while (buffer[length - 1] != '\n')
+			length--;
+	}
+
+	printf("Matching rules on %.1f MB of log lines\n", (double)length / (1024.0 * 1024.0));
+	bench_rules(10, buffer, length);
+	bench_rules(100, buffer, length);
+	bench_rules(1000, buffer, length);
+
+	printf("Sharing a machine between threads (one match per line) on %.1f MB of log lines\n", (double)length / (1024.0 * 1024.0));
+	printf("'%s'\n", patterns[1]);
+	bench_threads(patterns[1], buffer, length);
+
+	printf("Compiling and loading serialized machines\n");
+	bench_startup(buffer, length);
+
+	printf("Matching %d short subjects\n", SHORT_SUBJECTS);
+	printf("'/v2/orders/[0-9]+\\?page=9'\n");
+	bench_short_subjects("/v2/orders/[0-9]+\\?page=9");
+
+	length = generate_utf8_log(buffer, size);
+	printf("Scanning %.1f MB of UTF-8 log lines\n", (double)length / (1024.0 * 1024.0));
+	bench_utf8(buffer, length);
+
+	free(buffer);
+	return 0;
+}
+
+#else /* !REGEX_USE_8BIT_CHARS */
+
+int main(void)
+{
+	printf("The lazy DFA requires 8 bit characters\n");
+	return 0;
+}
+
+#endif /* REGEX_USE_8BIT_CHARS */
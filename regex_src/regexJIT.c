@@ -24,10 +24,33 @@
  * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 
+/* Large files are opened with 64 bit offsets by regex_scan_file on 32 bit
+   hosts. Must be defined before any system header is included. */
+#ifndef _FILE_OFFSET_BITS
+#define _FILE_OFFSET_BITS 64
+#endif
+
 #include "sljitLir.h"
 #include "regexJIT.h"
 
 #include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+#ifdef REGEX_USE_8BIT_CHARS
+#include <errno.h>
+#include <fcntl.h>
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+#endif
 
 #ifdef REGEX_MATCH_VERBOSE
 #include <stdio.h>
@@ -35,13 +58,18 @@
 
 /* Extra, hidden flags:
    {id!} where id > 0 found in the code. */
-#define REGEX_ID_CHECK		0x100
+#define REGEX_ID_CHECK		0x1000
 /* When REGEX_NEWLINE && REGEX_MATCH_BEGIN defined, the pattern turn to a normal search,
    which starts with [\r\n] character range. */
-#define REGEX_FAKE_MATCH_BEGIN	0x200
+#define REGEX_FAKE_MATCH_BEGIN	0x2000
 /* When REGEX_NEWLINE && REGEX_MATCH_END defined, the pattern turn to a normal search,
    which ends with [\r\n] character range. */
-#define REGEX_FAKE_MATCH_END	0x400
+#define REGEX_FAKE_MATCH_END	0x4000
+/* The end term is not used by a set machine: the transitions to the
+   end term record the matched pattern instead. */
+#define REGEX_SET_MATCH		0x8000
+/* Bounded repetitions are always expanded to copies of the repeated expression. */
+#define REGEX_NO_COUNTERS	0x10000
 
 /* --------------------------------------------------------------------- */
 /*  Structures for JIT-ed pattern matching                               */
@@ -65,6 +93,26 @@ struct regex_machine
 #endif
 
 	void *continue_match;
+	sljit_uw code_size;
+	/* Lazy DFA tables (NULL if the lazy DFA is not used). */
+	struct regex_dfa *dfa;
+	/* Number of patterns of a set machine (0 otherwise). */
+	sljit_sw set_count;
+	/* Number of capture groups (0 without REGEX_CAPTURES). */
+	sljit_sw capture_count;
+	/* Number of words used by the counted repetitions (0 if there are none). */
+	sljit_sw counter_words;
+	/* Increase of the counter generation when a match is reset. */
+	sljit_sw counter_gap;
+	/* Addresses of the code inserting the start terms, which accept
+	   the next character, indexed by that character (can be NULL). */
+	sljit_uw *start_dispatch;
+	/* Character bitmaps of the large character ranges (can be NULL). */
+	sljit_u32 *range_bitmaps;
+	sljit_sw range_bitmap_count;
+	/* Serialized form of the machine (NULL without REGEX_SERIALIZABLE). */
+	sljit_uw *serialized;
+	sljit_uw serialized_size;
 
 	/* Variable sized array to contain the handler addresses. */
 	sljit_uw entry_addrs[1];
@@ -88,6 +136,8 @@ struct regex_match
 	sljit_sw fast_forward;
 	/* Machine. */
 	struct regex_machine *machine;
+	/* Lazy DFA states (NULL if the lazy DFA is not used). */
+	struct regex_dfa_cache *dfa_cache;
 
 	union {
 		void *continue_match;
@@ -98,11 +148,124 @@ struct regex_match
 	sljit_sw states[1];
 };
 
+/* Set machines store the matched pattern bitset and the (begin, end)
+   pair of the first match of each pattern after the state arrays. */
+
+/* Number of words occupied by the matched pattern bitset. */
+#define SET_BITSET_WORDS(count) \
+	(((count) + (sljit_sw)(8 * sizeof(sljit_sw)) - 1) / (sljit_sw)(8 * sizeof(sljit_sw)))
+/* Size of the extra data in words. */
+#define SET_DATA_WORDS(count) \
+	(SET_BITSET_WORDS(count) + 2 * (count))
+
+/* Machines with capture groups store the captures of the best match
+   (a begin and end pair for each group) after the state arrays. */
+#define CAPTURE_DATA_WORDS(count) \
+	(2 * (count))
+
+/* Counted repetitions
+     A repetition of a single term, which has a large repeat count, is not
+     expanded to copies. The term is followed by a type_counter transition
+     and the repetition is tracked by a counter stored after the captures.
+     The counters share a generation word, which is added to the character
+     index to get the stamp of a position. A stamp is never reused by the
+     same match, so the counters only need to be cleared when the generation
+     becomes too large.
+
+     Each time the term is entered, the stamp of the next character is
+     recorded in a ring (with the smallest begin of the entries), and a
+     sliding window of the entries whose repeat count is in the allowed
+     range is kept in a queue ordered by their begin. A character, which
+     is not accepted by the term kills all entries recorded before it. */
+
+/* Stamp of the character after the last mismatch. */
+#define COUNTER_KILL		0
+/* Stamp of the last entry. */
+#define COUNTER_LAST		1
+/* Ever increasing head and tail index of the queue. */
+#define COUNTER_HEAD		2
+#define COUNTER_TAIL		3
+/* (stamp, begin) pairs indexed by the stamp, followed by the queue. */
+#define COUNTER_RING		4
+
+/* Repetitions are counted when their repeat count reaches this value. */
+#define REGEX_COUNTER_MIN_REPEAT	16
+/* The counters are cleared when the generation exceeds this value. */
+#define REGEX_COUNTER_GEN_LIMIT		((sljit_sw)1 << (8 * sizeof(sljit_sw) - 3))
+
+/* Size of a match structure, including the state arrays and the extra data. */
+#define MATCH_SIZE(machine) \
+	(sizeof(struct regex_match) + (sljit_uw)((machine)->size * 2 + SET_DATA_WORDS((machine)->set_count) \
+		+ CAPTURE_DATA_WORDS((machine)->capture_count) + (machine)->counter_words - 1) * sizeof(sljit_sw))
+
 /* State vector
     ITEM[0] - pointer to the address inside the machine code
     ITEM[1] - next pointer
     ITEM[2] - string started from (optional)
-    ITEM[3] - max ID (optional) */
+    ITEM[3] - max ID (optional)
+    ITEM[no_states - 2 * capture_count ...] - begin and end of the capture groups (optional) */
+
+/* Lazy DFA
+     A DFA state represents the set of terms, which were started before the
+     current character. The terms started at the current character are the
+     same for every state (restart set), so the machine states can be
+     recreated from the DFA when only these terms are active. */
+
+/* Maximum number of cached DFA states of a match. */
+#define REGEX_DFA_MAX_STATES	512
+/* Number of hash buckets (must be a power of 2). */
+#define REGEX_DFA_HASH_SIZE	256
+
+#define REGEX_DFA_WORD_BITS	((sljit_sw)(8 * sizeof(sljit_uw)))
+
+/* No terms are active except the restart set. */
+#define REGEX_DFA_RESTART	0x1
+/* The end term is reached (a match is found). */
+#define REGEX_DFA_ACCEPT	0x2
+
+struct regex_dfa
+{
+	/* Number of words of a term set. */
+	sljit_sw set_size;
+	/* Number of (term, id) pairs in restart_list. */
+	sljit_sw restart_count;
+	/* Terms started at every character (size: set_size). */
+	sljit_uw *restart;
+	/* Terms active before the first character excluding the restart set (size: set_size). */
+	sljit_uw *initial;
+	/* Terms reached after a term is matched (size: terms_size * set_size). */
+	sljit_uw *follow;
+	/* Restart terms with their ids in the order of compile_uncond_tran. */
+	sljit_sw *restart_list;
+	/* Bitmap of accepted characters for each term (size: terms_size * 32). */
+	sljit_u8 *chars;
+};
+
+struct regex_dfa_state
+{
+	/* Next states indexed by the character (NULL if not computed yet). */
+	struct regex_dfa_state *next[256];
+	/* Next state in the same hash bucket. */
+	struct regex_dfa_state *hash_next;
+	sljit_uw hash;
+	/* REGEX_DFA_* flags. */
+	sljit_uw flags;
+	/* Variable sized term set. */
+	sljit_uw set[1];
+};
+
+struct regex_dfa_cache
+{
+	/* State before the next character (NULL if the machine code is used). */
+	struct regex_dfa_state *current;
+	struct regex_dfa_state *initial;
+	/* The machine states must be recreated with this index before they are used (0 if not needed). */
+	sljit_sw restart_index;
+	sljit_sw state_count;
+	/* Temporary term set (size: set_size). */
+	sljit_uw *work;
+	struct regex_dfa_state *buckets[REGEX_DFA_HASH_SIZE];
+};
 
 /* Register allocation. */
 /* Current state array (loaded & stored: regex_match->current). */
@@ -125,6 +288,10 @@ struct regex_match
 #define R_BEST_BEGIN	SLJIT_R3
 /* Current character index. */
 #define R_CURR_INDEX	SLJIT_R4
+/* Address of a character bitmap (only used when the machine has bitmaps). */
+#define R_RANGE_BITMAP	SLJIT_R5
+/* Temporary register of the counters (only used when the machine has counters). */
+#define R_COUNTER	SLJIT_R6
 
 /* --------------------------------------------------------------------- */
 /*  Stack management                                                     */
@@ -359,10 +526,12 @@ enum {
 	type_rng_char,
 	type_rng_left,
 	type_rng_right,
+	type_counter,
 
 	/* generator only. */
 	type_branch,
 	type_jump,
+	type_capture,
 
 	/* Parser only. */
 	type_open_br,
@@ -373,6 +542,22 @@ enum {
 	type_qestion_mark
 };
 
+/* Maximum number of first characters searched by the vectorized fast forward loop. */
+#define REGEX_SIMD_MAX_CHARS	3
+/* Simd registers used by the loop: data, result, temporary and one per character. */
+#define REGEX_SIMD_FSCRATCHES	(3 + REGEX_SIMD_MAX_CHARS)
+
+struct regex_counter {
+	/* Allowed repeat counts. */
+	sljit_sw min;
+	sljit_sw max;
+	/* Offset of the counter data in regex_match. */
+	sljit_sw offset;
+	/* Number of ring entries and queue items (powers of 2). */
+	sljit_sw ring_size;
+	sljit_sw queue_size;
+};
+
 struct compiler_common {
 	/* Temporary stacks. */
 	struct stack stack;
@@ -387,11 +572,26 @@ struct compiler_common {
 	sljit_sw no_states;
 	/* Number of type_rng_(char|left)-s in the longest character range. */
 	sljit_sw longest_range_size;
+	/* Number of capture groups. */
+	sljit_sw capture_count;
+	/* Minimum (type) and maximum (value) repeat count of the counted repetitions. */
+	struct stack counters;
+	/* Number of type_counter transitions. */
+	sljit_sw counter_count;
 
 	/* DFA linear representation (size: dfa_size). */
 	struct stack_item *dfa_transitions;
 	/* Term id and search state pairs (size: dfa_size). */
 	struct stack_item *search_states;
+	/* The position from where a position is first reached by trace_transitions
+	   (size: dfa_size, NULL without capture groups). */
+	sljit_sw *trace_parents;
+	/* Capture slots set by a transition (size: 2 * capture_count). */
+	sljit_u8 *capture_marks;
+	/* Data of the type_counter transitions (size: counter_count). */
+	struct regex_counter *counter_list;
+	/* Index of the counter of each term, or -1 (size: terms_size, NULL without counters). */
+	sljit_sw *term_counters;
 
 	/* sljit compiler */
 	struct sljit_compiler *compiler;
@@ -399,8 +599,36 @@ struct compiler_common {
 	struct regex_machine *machine;
 	/* Temporary space for jumps (size: longest_range_size). */
 	struct sljit_jump **range_jump_list;
+	/* Offset of the matched pattern bitset in regex_match (set machines only). */
+	sljit_sw set_offset;
+	/* Offset of the counter generation in regex_match (machines with counters only). */
+	sljit_sw counter_offset;
+	/* Non-zero, if machine->start_dispatch is generated. */
+	int start_dispatch;
+#ifdef REGEX_USE_8BIT_CHARS
+	/* The smallest character, which is accepted by the same start terms. */
+	sljit_s16 start_groups[256];
+	/* The next unused bitmap of machine->range_bitmaps. */
+	sljit_u32 *range_bitmaps;
+#endif
+
+	/* The characters which can start a match (size: simd_char_count). */
+	sljit_sw simd_chars[REGEX_SIMD_MAX_CHARS];
+	/* Zero, if the vectorized fast forward loop is not used. */
+	int simd_char_count;
+	/* Simd register and element size of the loop. */
+	sljit_s32 simd_type;
+	/* Number of characters checked by one iteration. */
+	sljit_sw simd_lanes;
 };
 
+/* The machine code compares the zero extended characters. */
+#ifdef REGEX_USE_8BIT_CHARS
+#define REGEX_CHAR_VALUE(chr)	((int)(sljit_u8)(chr))
+#else
+#define REGEX_CHAR_VALUE(chr)	((int)(chr))
+#endif
+
 static const regex_char_t* decode_number(const regex_char_t *regex_string, int length, int *result)
 {
 	int value = 0;
@@ -450,11 +678,16 @@ static int iterate(struct stack *stack, int min, int max)
 			break;
 
 		case type_close_br:
+			/* Capture groups are marked by a transition. */
+			if (item->value > 0)
+				len++;
 			depth++;
 			break;
 
 		case type_open_br:
 			SLJIT_ASSERT(depth > 0);
+			if (item->value > 0)
+				len++;
 			depth--;
 			if (depth == 0)
 				count = (int)it.count;
@@ -556,10 +789,88 @@ static int iterate(struct stack *stack, int min, int max)
 	return len;
 }
 
-static int parse_iterator(const regex_char_t *regex_string, int length, struct stack *stack, sljit_uw *dfa_size, int begin)
+/* Replaces a large repetition of a single term with a counted repetition.
+   Returns with 0 if the repetition must be expanded by iterate. */
+static int iterate_counter(struct compiler_common *compiler_common, int min, int max)
+{
+	struct stack *stack = &compiler_common->stack;
+	struct stack it;
+	struct stack_item *item;
+	int len = 1;
+	int count;
+
+	if ((compiler_common->flags & REGEX_NO_COUNTERS) || (max > 0 ? max : min) < REGEX_COUNTER_MIN_REPEAT)
+		return 0;
+
+	stack_clone(stack, &it);
+	item = stack_pop(&it);
+	if (item->type == type_rng_end) {
+		do {
+			item = stack_pop(&it);
+			len++;
+		} while (item->type != type_rng_start);
+	}
+	else if (item->type != type_char)
+		return 0;
+
+	/* The {n,} form is a counted {n} repetition followed by a star iterator. */
+	if (max == 0 && stack_push_copy(stack, len, len))
+		return -1;
+
+	/* Put an open bracket before the term. */
+	if (stack_push_copy(stack, 1, max > 0 ? len : 2 * len))
+		return -1;
+#if (defined SLJIT_DEBUG && SLJIT_DEBUG)
+	SLJIT_ASSERT(stack_push(&it, type_open_br, 0) == 0);
+#else
+	stack_push(&it, type_open_br, 0);
+#endif
+
+	if (max == 0) {
+		/* And the counter after the first copy. */
+		stack_clone(stack, &it);
+		for (count = len; count > 0; count--)
+			stack_pop(&it);
+		if (stack_push_copy(stack, 1, len))
+			return -1;
+#if (defined SLJIT_DEBUG && SLJIT_DEBUG)
+		SLJIT_ASSERT(stack_push(&it, type_counter, (int)compiler_common->counters.count) == 0);
+#else
+		stack_push(&it, type_counter, (int)compiler_common->counters.count);
+#endif
+		if (stack_push(stack, type_asterisk, 0))
+			return -1;
+		/* The counter, the copy and the star iterator. */
+		compiler_common->dfa_size += (sljit_uw)len + 3;
+		max = min;
+	}
+	else {
+		if (stack_push(stack, type_counter, (int)compiler_common->counters.count))
+			return -1;
+		compiler_common->dfa_size++;
+	}
+
+	/* The {0,n} form is an optional {1,n} repetition. */
+	if (min == 0) {
+		min = 1;
+		if (stack_push(stack, type_qestion_mark, 0))
+			return -1;
+		compiler_common->dfa_size++;
+	}
+
+	if (stack_push(&compiler_common->counters, min, max))
+		return -1;
+	if (stack_push(stack, type_close_br, 0))
+		return -1;
+	return 1;
+}
+
+static int parse_iterator(const regex_char_t *regex_string, int length, struct compiler_common *compiler_common, int begin)
 {
 	/* We only know that *regex_string == { . */
-	int val1, val2;
+	struct stack *stack = &compiler_common->stack;
+	sljit_uw *dfa_size = &compiler_common->dfa_size;
+	int val1, val2, counted;
 	const regex_char_t *base_from = regex_string;
 	const regex_char_t *from;
 
@@ -628,10 +939,15 @@ static int parse_iterator(const regex_char_t *regex_string, int length, struct s
 
 	/* Fast cases. */
 	if (val1 > 1 || val2 > 1) {
-		val1 = iterate(stack, val1, val2);
-		if (val1 < 0)
+		counted = iterate_counter(compiler_common, val1, val2);
+		if (counted < 0)
 			return -1;
-		*dfa_size += (sljit_uw)val1;
+		if (counted == 0) {
+			val1 = iterate(stack, val1, val2);
+			if (val1 < 0)
+				return -1;
+			*dfa_size += (sljit_uw)val1;
+		}
 	}
 	else if (val1 == 0 && val2 == 0) {
 		if (stack_push(stack, type_asterisk, 0))
@@ -666,7 +982,7 @@ static int parse_char_range(const regex_char_t *regex_string, int length, struct
 {
 	struct stack* stack = &compiler_common->stack;
 	const regex_char_t *base_from = regex_string;
-	regex_char_t left_char, right_char, tmp_char;
+	int left_char, right_char, tmp_char;
 
 	length--;
 	regex_string++;
@@ -708,13 +1024,13 @@ static int parse_char_range(const regex_char_t *regex_string, int length, struct
 			break;
 
 		if (*regex_string != '\\')
-			left_char = *regex_string;
+			left_char = REGEX_CHAR_VALUE(*regex_string);
 		else {
 			regex_string++;
 			length--;
 			if (length == 0)
 				return -2;
-			left_char = *regex_string;
+			left_char = REGEX_CHAR_VALUE(*regex_string);
 		}
 		regex_string++;
 		length--;
@@ -725,13 +1041,13 @@ static int parse_char_range(const regex_char_t *regex_string, int length, struct
 			length--;
 
 			if (*regex_string != '\\')
-				right_char = *regex_string;
+				right_char = REGEX_CHAR_VALUE(*regex_string);
 			else {
 				regex_string++;
 				length--;
 				if (length == 0)
 					return -2;
-				right_char = *regex_string;
+				right_char = REGEX_CHAR_VALUE(*regex_string);
 			}
 			regex_string++;
 			length--;
@@ -761,956 +1077,1291 @@ static int parse_char_range(const regex_char_t *regex_string, int length, struct
 	return (int)(regex_string - base_from);
 }
 
-static int parse(const regex_char_t *regex_string, int length, struct compiler_common *compiler_common)
-{
-	/* Depth of bracketed expressions. */
-	int depth = 0;
-	/* Have we already found a term? '1' if not yet. */
-	int begin = 1;
-	/* Cache stack pointer. */
-	struct stack* stack = &compiler_common->stack;
-	int tmp;
+#ifdef REGEX_USE_8BIT_CHARS
 
-	/* Type_begin and type_end. */
-	compiler_common->dfa_size = 2;
-	stack_init(stack);
-	if (stack_push(stack, type_begin, 0))
-		return REGEX_MEMORY_ERROR;
+/* Largest code point, which can be encoded by UTF-8. */
+#define REGEX_UTF8_MAX		0x10ffff
 
-	if (length > 0 && *regex_string == '^') {
-		compiler_common->flags |= REGEX_MATCH_BEGIN;
-		length--;
-		regex_string++;
+/* Decodes a UTF-8 character, and returns with its length,
+   or 0 if the byte sequence is not a valid (shortest) UTF-8 encoding. */
+static int decode_utf8(const regex_char_t *regex_string, int length, sljit_u32 *result)
+{
+	sljit_u32 chr = (sljit_u8)regex_string[0];
+	sljit_u32 min;
+	int size, i;
+
+	if (chr < 0x80) {
+		*result = chr;
+		return 1;
 	}
 
-	if ((compiler_common->flags & (REGEX_MATCH_BEGIN | REGEX_NEWLINE)) == (REGEX_MATCH_BEGIN | REGEX_NEWLINE)) {
-		/* Replace REGEX_MATCH_BEGIN flag to REGEX_FAKE_MATCH_BEGIN */
-		compiler_common->flags &= ~REGEX_MATCH_BEGIN;
-		compiler_common->flags |= REGEX_FAKE_MATCH_BEGIN;
-		/* and append a new-line search. */
-		if (stack_push(stack, type_newline, 0))
-			return REGEX_MEMORY_ERROR;
-		compiler_common->dfa_size++;
-		/* Begin intentionally kept as 1. */
+	if (chr >= 0xc2 && chr <= 0xdf) {
+		size = 2;
+		chr &= 0x1f;
+		min = 0x80;
 	}
+	else if (chr >= 0xe0 && chr <= 0xef) {
+		size = 3;
+		chr &= 0x0f;
+		min = 0x800;
+	}
+	else if (chr >= 0xf0 && chr <= 0xf4) {
+		size = 4;
+		chr &= 0x07;
+		min = 0x10000;
+	}
+	else
+		return 0;
 
-	while (length > 0) {
-		switch (*regex_string) {
-		case '\\' :
-			length--;
-			regex_string++;
-			if (length == 0)
-				return REGEX_INVALID_REGEX;
-			if (stack_push(stack, type_char, *regex_string))
-				return REGEX_MEMORY_ERROR;
-			begin = 0;
-			compiler_common->dfa_size++;
-			break;
+	if (length < size)
+		return 0;
 
-		case '.' :
-			if (stack_push(stack, type_rng_start, 1))
-				return REGEX_MEMORY_ERROR;
-			if (compiler_common->flags & REGEX_NEWLINE) {
-				if (stack_push(stack, type_rng_char, '\n'))
-					return REGEX_MEMORY_ERROR;
-				if (stack_push(stack, type_rng_char, '\r'))
-					return REGEX_MEMORY_ERROR;
-				compiler_common->dfa_size += 2;
-			}
-			if (stack_push(stack, type_rng_end, 1))
-				return REGEX_MEMORY_ERROR;
-			begin = 0;
-			compiler_common->dfa_size += 2;
-			break;
+	for (i = 1; i < size; i++) {
+		if ((regex_string[i] & 0xc0) != 0x80)
+			return 0;
+		chr = (chr << 6) | (sljit_u32)(regex_string[i] & 0x3f);
+	}
 
-		case '(' :
-			depth++;
-			if (stack_push(stack, type_open_br, 0))
-				return REGEX_MEMORY_ERROR;
-			begin = 1;
-			break;
+	if (chr < min || chr > REGEX_UTF8_MAX || (chr >= 0xd800 && chr <= 0xdfff))
+		return 0;
 
-		case ')' :
-			if (depth == 0)
-				return REGEX_INVALID_REGEX;
-			depth--;
-			if (stack_push(stack, type_close_br, 0))
-				return REGEX_MEMORY_ERROR;
-			begin = 0;
-			break;
+	*result = chr;
+	return size;
+}
 
-		case '|' :
-			if (stack_push(stack, type_select, 0))
-				return REGEX_MEMORY_ERROR;
-			begin = 1;
-			compiler_common->dfa_size += 2;
-			break;
+static int encode_utf8(sljit_u32 chr, int *bytes)
+{
+	if (chr < 0x80) {
+		bytes[0] = (int)chr;
+		return 1;
+	}
 
-		case '*' :
-			if (begin)
-				return REGEX_INVALID_REGEX;
-			if (stack_push(stack, type_asterisk, 0))
-				return REGEX_MEMORY_ERROR;
-			compiler_common->dfa_size += 2;
-			break;
+	if (chr < 0x800) {
+		bytes[0] = (int)(0xc0 | (chr >> 6));
+		bytes[1] = (int)(0x80 | (chr & 0x3f));
+		return 2;
+	}
 
-		case '?' :
-		case '+' :
-			if (begin)
-				return REGEX_INVALID_REGEX;
-			if (stack_push(stack, (*regex_string == '+') ? type_plus_sign : type_qestion_mark, 0))
-				return REGEX_MEMORY_ERROR;
-			compiler_common->dfa_size++;
-			break;
+	if (chr < 0x10000) {
+		bytes[0] = (int)(0xe0 | (chr >> 12));
+		bytes[1] = (int)(0x80 | ((chr >> 6) & 0x3f));
+		bytes[2] = (int)(0x80 | (chr & 0x3f));
+		return 3;
+	}
 
-		case '{' :
-			tmp = parse_iterator(regex_string, length, stack, &compiler_common->dfa_size, begin);
+	bytes[0] = (int)(0xf0 | (chr >> 18));
+	bytes[1] = (int)(0x80 | ((chr >> 12) & 0x3f));
+	bytes[2] = (int)(0x80 | ((chr >> 6) & 0x3f));
+	bytes[3] = (int)(0x80 | (chr & 0x3f));
+	return 4;
+}
 
-			if (tmp >= 0) {
-				length -= tmp;
-				regex_string += tmp;
-			}
-			else if (tmp == -1)
-				return REGEX_MEMORY_ERROR;
-			else {
-				/* Not a valid range expression. */
-				SLJIT_ASSERT(tmp == -2);
-				if (stack_push(stack, type_char, '{'))
-					return REGEX_MEMORY_ERROR;
-				compiler_common->dfa_size++;
-			}
-			break;
+/* Parses a UTF-8 character. Multi-byte characters are enclosed in brackets,
+   so the iterators are applied to the whole byte sequence. */
+static int parse_utf8_char(const regex_char_t *regex_string, int length, struct compiler_common *compiler_common)
+{
+	struct stack* stack = &compiler_common->stack;
+	sljit_u32 chr;
+	int size = decode_utf8(regex_string, length, &chr);
+	int i;
 
-		case '[' :
-			tmp = parse_char_range(regex_string, length, compiler_common);
-			if (tmp >= 0) {
-				length -= tmp;
-				regex_string += tmp;
-			}
-			else if (tmp == -1)
-				return REGEX_MEMORY_ERROR;
-			else {
-				SLJIT_ASSERT(tmp == -2);
-				return REGEX_INVALID_REGEX;
-			}
-			begin = 0;
-			break;
+	if (size == 0)
+		return -2;
 
-		default:
-			if (length == 1 && *regex_string == '$') {
-				compiler_common->flags |= REGEX_MATCH_END;
-				break;
-			}
-			if (stack_push(stack, type_char, *regex_string))
-				return REGEX_MEMORY_ERROR;
-			begin = 0;
-			compiler_common->dfa_size++;
-			break;
-		}
-		length--;
-		regex_string++;
+	if (size == 1) {
+		if (stack_push(stack, type_char, (int)chr))
+			return -1;
+		compiler_common->dfa_size++;
+		return 0;
 	}
 
-	if (depth != 0)
-		return REGEX_INVALID_REGEX;
+	if (stack_push(stack, type_open_br, 0))
+		return -1;
+	for (i = 0; i < size; i++) {
+		if (stack_push(stack, type_char, REGEX_CHAR_VALUE(regex_string[i])))
+			return -1;
+	}
+	if (stack_push(stack, type_close_br, 0))
+		return -1;
+	compiler_common->dfa_size += (sljit_uw)size;
+	return size - 1;
+}
 
-	if ((compiler_common->flags & (REGEX_MATCH_END | REGEX_NEWLINE)) == (REGEX_MATCH_END | REGEX_NEWLINE)) {
-		/* Replace REGEX_MATCH_END flag to REGEX_FAKE_MATCH_END */
-		compiler_common->flags &= ~REGEX_MATCH_END;
-		compiler_common->flags |= REGEX_FAKE_MATCH_END;
-		/* and append a new-line search. */
-		if (stack_push(stack, type_newline, 1))
-			return REGEX_MEMORY_ERROR;
+static int push_utf8_byte_range(struct compiler_common *compiler_common, int left_byte, int right_byte)
+{
+	struct stack* stack = &compiler_common->stack;
+
+	if (left_byte == right_byte) {
 		compiler_common->dfa_size++;
-		/* Begin intentionally kept as 1. */
+		return stack_push(stack, type_char, left_byte);
 	}
 
-	if (stack_push(stack, type_end, 0))
-		return REGEX_MEMORY_ERROR;
-
-	return REGEX_NO_ERROR;
+	compiler_common->dfa_size += 4;
+	if (stack_push(stack, type_rng_start, 0))
+		return 1;
+	if (stack_push(stack, type_rng_left, left_byte))
+		return 1;
+	if (stack_push(stack, type_rng_right, right_byte))
+		return 1;
+	return stack_push(stack, type_rng_end, 0);
 }
 
-/* --------------------------------------------------------------------- */
-/*  Generating machine state transitions                                 */
-/* --------------------------------------------------------------------- */
+/* Appends the byte sequences, which match the [left-right] code point range
+   (left >= 0x80), as alternatives. The range is split until the continuation
+   bytes of each sequence can be described by independent byte ranges. The
+   select argument is zero before the first alternative. */
+static int push_utf8_sequences(struct compiler_common *compiler_common, sljit_u32 left, sljit_u32 right, int *select)
+{
+	int left_bytes[4], right_bytes[4];
+	sljit_u32 mask;
+	int i, size;
+
+	/* Both ends must have the same length. */
+	if (left <= 0x7ff && right > 0x7ff)
+		return push_utf8_sequences(compiler_common, left, 0x7ff, select) || push_utf8_sequences(compiler_common, 0x800, right, select);
+	if (left <= 0xffff && right > 0xffff)
+		return push_utf8_sequences(compiler_common, left, 0xffff, select) || push_utf8_sequences(compiler_common, 0x10000, right, select);
+
+	size = encode_utf8(left, left_bytes);
+	for (i = 1; i < size; i++) {
+		mask = ((sljit_u32)1 << (6 * i)) - 1;
+		if ((left & ~mask) != (right & ~mask)) {
+			if (left & mask)
+				return push_utf8_sequences(compiler_common, left, left | mask, select) || push_utf8_sequences(compiler_common, (left | mask) + 1, right, select);
+			if ((right & mask) != mask)
+				return push_utf8_sequences(compiler_common, left, (right & ~mask) - 1, select) || push_utf8_sequences(compiler_common, right & ~mask, right, select);
+		}
+	}
 
-#define PUT_TRANSITION(typ, val) \
-	do { \
-		--transitions_ptr; \
-		transitions_ptr->type = typ; \
-		transitions_ptr->value = val; \
-	} while (0)
+	encode_utf8(right, right_bytes);
+	if (*select) {
+		if (stack_push(&compiler_common->stack, type_select, 0))
+			return 1;
+		compiler_common->dfa_size += 2;
+	}
+	*select = 1;
 
-static struct stack_item* handle_iteratives(struct stack_item *transitions_ptr, struct stack_item *transitions, struct stack *depth)
-{
-	struct stack_item *item;
+	for (i = 0; i < size; i++)
+		if (push_utf8_byte_range(compiler_common, left_bytes[i], right_bytes[i]))
+			return 1;
+	return 0;
+}
 
-	while (1) {
-		item = stack_top(depth);
+static int compare_utf8_ranges(const void *left, const void *right)
+{
+	sljit_u32 left_value = *(const sljit_u32*)left;
+	sljit_u32 right_value = *(const sljit_u32*)right;
 
-		switch (item->type) {
-		case type_asterisk:
-			SLJIT_ASSERT(transitions[item->value].type == type_branch);
-			transitions[item->value].value = (int)(transitions_ptr - transitions);
-			PUT_TRANSITION(type_branch, item->value + 1);
-			break;
+	return (left_value > right_value) - (left_value < right_value);
+}
 
-		case type_plus_sign:
-			SLJIT_ASSERT(transitions[item->value].type == type_branch);
-			transitions[item->value].value = (int)(transitions_ptr - transitions);
-			break;
+/* Compiles the list of code point ranges (pairs of left and right values) to an
+   alternation of byte sequences. The ASCII characters are matched by a single
+   character range. The ranges array must have space for count + 2 ranges. */
+static int push_utf8_ranges(struct compiler_common *compiler_common, sljit_u32 *ranges, int count, int invert)
+{
+	struct stack* stack = &compiler_common->stack;
+	sljit_u32 left, right;
+	int i, j, ascii, multi_byte, select;
 
-		case type_qestion_mark:
-			PUT_TRANSITION(type_branch, item->value);
-			break;
+	qsort(ranges, (size_t)count, 2 * sizeof(sljit_u32), compare_utf8_ranges);
 
-		default:
-			return transitions_ptr;
+	/* Merge the overlapping and adjacent ranges. */
+	j = 0;
+	for (i = 0; i < count; i++) {
+		if (j > 0 && ranges[i * 2] <= ranges[j * 2 - 1] + 1) {
+			if (ranges[i * 2 + 1] > ranges[j * 2 - 1])
+				ranges[j * 2 - 1] = ranges[i * 2 + 1];
+			continue;
 		}
-		stack_pop(depth);
+		ranges[j * 2] = ranges[i * 2];
+		ranges[j * 2 + 1] = ranges[i * 2 + 1];
+		j++;
+	}
+	count = j;
+
+	if (invert) {
+		/* The complement has at most one more range. */
+		left = 0;
+		j = 0;
+		for (i = 0; i < count; i++) {
+			right = ranges[i * 2 + 1];
+			if (ranges[i * 2] > left) {
+				ranges[j * 2 + 1] = ranges[i * 2] - 1;
+				ranges[j * 2] = left;
+				j++;
+			}
+			left = right + 1;
+		}
+		if (left <= REGEX_UTF8_MAX) {
+			ranges[j * 2] = left;
+			ranges[j * 2 + 1] = REGEX_UTF8_MAX;
+			j++;
+		}
+		count = j;
 	}
-}
-
-static int generate_transitions(struct compiler_common *compiler_common)
-{
-	struct stack *stack = &compiler_common->stack;
-	struct stack *depth = &compiler_common->depth;
-	struct stack_item *transitions_ptr;
-	struct stack_item *item;
 
-	stack_init(depth);
-	compiler_common->dfa_transitions = (struct stack_item *)SLJIT_MALLOC(sizeof(struct stack_item) * compiler_common->dfa_size, NULL);
-	if (!compiler_common->dfa_transitions)
-		return REGEX_MEMORY_ERROR;
+	if (count == 0)
+		return -2;
 
-	/* Go through the items of the stack and generate the necessary branches and jumps (edges of DFA). */
-	transitions_ptr = compiler_common->dfa_transitions + compiler_common->dfa_size;
-	while (stack->count > 0) {
-		item = stack_pop(stack);
-		switch (item->type) {
-		case type_begin:
-		case type_open_br:
-			item = stack_pop(depth);
-			if (item->type == type_select)
-				PUT_TRANSITION(type_branch, item->value + 1);
-			else
-				SLJIT_ASSERT(item->type == type_close_br);
-			if (stack->count == 0)
-				PUT_TRANSITION(type_begin, 0);
-			else
-				transitions_ptr = handle_iteratives(transitions_ptr, compiler_common->dfa_transitions, depth);
-			break;
+	ascii = ranges[0] < 0x80;
+	multi_byte = ranges[count * 2 - 1] >= 0x80;
+	if (multi_byte) {
+		if (stack_push(stack, type_open_br, 0))
+			return -1;
+	}
 
-		case type_end:
-		case type_close_br:
-			if (item->type == type_end)
-				*--transitions_ptr = *item;
-			if (stack_push(depth, type_close_br, (int)(transitions_ptr - compiler_common->dfa_transitions)))
-				return REGEX_MEMORY_ERROR;
-			break;
+	if (ascii) {
+		if (stack_push(stack, type_rng_start, 0))
+			return -1;
+		compiler_common->dfa_size += 2;
 
-		case type_select:
-			item = stack_top(depth);
-			if (item->type == type_select) {
-				SLJIT_ASSERT(compiler_common->dfa_transitions[item->value].type == type_jump);
-				PUT_TRANSITION(type_branch, item->value + 1);
-				PUT_TRANSITION(type_jump, item->value);
-				item->value = (int)(transitions_ptr - compiler_common->dfa_transitions);
-			}
-			else {
-				SLJIT_ASSERT(item->type == type_close_br);
-				item->type = type_select;
-				PUT_TRANSITION(type_jump, item->value);
-				item->value = (int)(transitions_ptr - compiler_common->dfa_transitions);
+		for (i = 0; i < count && ranges[i * 2] < 0x80; i++) {
+			right = ranges[i * 2 + 1] < 0x80 ? ranges[i * 2 + 1] : 0x7f;
+			if (ranges[i * 2] == right) {
+				if (stack_push(stack, type_rng_char, (int)right))
+					return -1;
+				compiler_common->dfa_size++;
+				continue;
 			}
-			break;
+			if (stack_push(stack, type_rng_left, (int)ranges[i * 2]))
+				return -1;
+			if (stack_push(stack, type_rng_right, (int)right))
+				return -1;
+			compiler_common->dfa_size += 2;
+		}
 
-		case type_asterisk:
-		case type_plus_sign:
-		case type_qestion_mark:
-			if (item->type != type_qestion_mark)
-				PUT_TRANSITION(type_branch, 0);
-			if (stack_push(depth, item->type, (int)(transitions_ptr - compiler_common->dfa_transitions)))
-				return REGEX_MEMORY_ERROR;
-			break;
+		if (stack_push(stack, type_rng_end, 0))
+			return -1;
+	}
 
-		case type_char:
-		case type_newline:
-		case type_rng_start:
-			/* Requires handle_iteratives. */
-			*--transitions_ptr = *item;
-			transitions_ptr = handle_iteratives(transitions_ptr, compiler_common->dfa_transitions, depth);
-			break;
+	select = ascii;
+	for (i = 0; i < count; i++) {
+		if (ranges[i * 2 + 1] < 0x80)
+			continue;
 
-		default:
-			*--transitions_ptr = *item;
-			break;
+		left = ranges[i * 2] < 0x80 ? 0x80 : ranges[i * 2];
+		right = ranges[i * 2 + 1] > REGEX_UTF8_MAX ? REGEX_UTF8_MAX : ranges[i * 2 + 1];
+
+		/* Surrogates are not valid characters. */
+		if (left < 0xd800 && right > 0xdfff) {
+			if (push_utf8_sequences(compiler_common, left, 0xd7ff, &select) || push_utf8_sequences(compiler_common, 0xe000, right, &select))
+				return -1;
+			continue;
 		}
+		if (left >= 0xd800 && left <= 0xdfff)
+			left = 0xe000;
+		if (right >= 0xd800 && right <= 0xdfff)
+			right = 0xd7ff;
+		if (left <= right && push_utf8_sequences(compiler_common, left, right, &select))
+			return -1;
 	}
 
-	SLJIT_ASSERT(compiler_common->dfa_transitions == transitions_ptr);
-	SLJIT_ASSERT(depth->count == 0);
-	return REGEX_NO_ERROR;
+	if (multi_byte) {
+		if (stack_push(stack, type_close_br, 0))
+			return -1;
+	}
+	return 0;
 }
 
-#undef PUT_TRANSITION
+static int parse_utf8_char_range(const regex_char_t *regex_string, int length, struct compiler_common *compiler_common)
+{
+	const regex_char_t *base_from = regex_string;
+	sljit_u32 *ranges;
+	sljit_u32 left_char, right_char, tmp_char;
+	int invert = 0, count = 0, size, result;
 
-#ifdef REGEX_MATCH_VERBOSE
+	length--;
+	regex_string++;
 
-static void verbose_transitions(struct compiler_common *compiler_common)
-{
-	struct stack_item *transitions_ptr = compiler_common->dfa_transitions;
-	struct stack_item *transitions_end = transitions_ptr + compiler_common->dfa_size;
-	struct stack_item *search_states_ptr = compiler_common->search_states;
-	int pos;
+	if (length == 0)
+		return -2;
 
-	printf("-----------------\nTransitions\n-----------------\n");
-	pos = 0;
-	while (transitions_ptr < transitions_end) {
-		printf("[%3d] ", pos++);
-		if (search_states_ptr->type >= 0)
-			printf("(%3d) ", search_states_ptr->type);
-		switch (transitions_ptr->type) {
-		case type_begin:
-			printf("type_begin\n");
-			break;
+	if (*regex_string == '^') {
+		length--;
+		regex_string++;
+		invert = 1;
 
-		case type_end:
-			printf("type_end\n");
-			break;
+		if (length == 0)
+			return -2;
+	}
 
-		case type_char:
-			if (transitions_ptr->value >= ' ')
-				printf("type_char '%c'\n", transitions_ptr->value);
-			else
-				printf("type_char 0x%x\n", transitions_ptr->value);
-			break;
+	/* Each character of the pattern adds at most one range. */
+	ranges = (sljit_u32*)SLJIT_MALLOC(sizeof(sljit_u32) * 2 * (sljit_uw)(length + 2), NULL);
+	if (!ranges)
+		return -1;
 
-		case type_newline:
-			printf("type_newline %s\n", transitions_ptr->value ? "(end)" : "(begin)");
-			break;
+	/* Range must be at least 1 character. */
+	if (*regex_string == ']') {
+		length--;
+		regex_string++;
+		ranges[0] = ']';
+		ranges[1] = ']';
+		count = 1;
+	}
 
-		case type_id:
-			printf("type_id %d\n", transitions_ptr->value);
+	result = -2;
+	while (length > 0) {
+		if (*regex_string == ']') {
+			result = 0;
 			break;
+		}
 
-		case type_rng_start:
-			printf("type_rng_start %s\n", transitions_ptr->value ? "(invert)" : "(normal)");
+		if (*regex_string == '\\') {
+			regex_string++;
+			length--;
+			if (length == 0)
+				break;
+		}
+		size = decode_utf8(regex_string, length, &left_char);
+		if (size == 0)
 			break;
+		regex_string += size;
+		length -= size;
+		right_char = left_char;
 
-		case type_rng_end:
-			printf("type_rng_end\n");
-			break;
+		/* Is a range here? */
+		if (length >= 3 && *regex_string == '-' && *(regex_string + 1) != ']') {
+			regex_string++;
+			length--;
 
-		case type_rng_char:
-			if (transitions_ptr->value >= ' ')
-				printf("type_rng_char '%c'\n", transitions_ptr->value);
-			else
-				printf("type_rng_char 0x%x\n", transitions_ptr->value);
-			break;
+			if (*regex_string == '\\') {
+				regex_string++;
+				length--;
+				if (length == 0)
+					break;
+			}
+			size = decode_utf8(regex_string, length, &right_char);
+			if (size == 0)
+				break;
+			regex_string += size;
+			length -= size;
 
-		case type_rng_left:
-			if (transitions_ptr->value >= ' ')
-				printf("type_rng_left '%c'\n", transitions_ptr->value);
-			else
-				printf("type_rng_left 0x%x\n", transitions_ptr->value);
-			break;
+			if (left_char > right_char) {
+				/* Swap if necessary. */
+				tmp_char = left_char;
+				left_char = right_char;
+				right_char = tmp_char;
+			}
+		}
 
-		case type_rng_right:
-			if (transitions_ptr->value >= ' ')
-				printf("type_rng_right '%c'\n", transitions_ptr->value);
-			else
-				printf("type_rng_right 0x%x\n", transitions_ptr->value);
-			break;
+		ranges[count * 2] = left_char;
+		ranges[count * 2 + 1] = right_char;
+		count++;
+	}
 
-		case type_branch:
-			printf("type_branch -> %d\n", transitions_ptr->value);
-			break;
+	if (result == 0)
+		result = push_utf8_ranges(compiler_common, ranges, count, invert);
 
-		case type_jump:
-			printf("type_jump -> %d\n", transitions_ptr->value);
-			break;
+	SLJIT_FREE(ranges, NULL);
+	return result == 0 ? (int)(regex_string - base_from) : result;
+}
 
-		default:
-			printf("UNEXPECTED TYPE\n");
-			break;
-		}
-		transitions_ptr++;
-		search_states_ptr++;
+/* The . matches any valid UTF-8 character. */
+static int parse_utf8_any(struct compiler_common *compiler_common)
+{
+	sljit_u32 ranges[2 * 4];
+	int count = 0;
+
+	if (compiler_common->flags & REGEX_NEWLINE) {
+		ranges[0] = '\n';
+		ranges[1] = '\n';
+		ranges[2] = '\r';
+		ranges[3] = '\r';
+		count = 2;
 	}
-	printf("flags: ");
-	if (!(compiler_common->flags & (REGEX_MATCH_BEGIN | REGEX_MATCH_END | REGEX_NEWLINE | REGEX_ID_CHECK | REGEX_FAKE_MATCH_BEGIN | REGEX_FAKE_MATCH_END)))
-		printf("none ");
-	if (compiler_common->flags & REGEX_MATCH_BEGIN)
-		printf("REGEX_MATCH_BEGIN ");
-	if (compiler_common->flags & REGEX_MATCH_END)
-		printf("REGEX_MATCH_END ");
-	if (compiler_common->flags & REGEX_NEWLINE)
-		printf("REGEX_NEWLINE ");
-	if (compiler_common->flags & REGEX_ID_CHECK)
-		printf("REGEX_ID_CHECK ");
-	if (compiler_common->flags & REGEX_FAKE_MATCH_BEGIN)
-		printf("REGEX_FAKE_MATCH_BEGIN ");
-	if (compiler_common->flags & REGEX_FAKE_MATCH_END)
-		printf("REGEX_FAKE_MATCH_END ");
-	if (compiler_common->longest_range_size > 0)
-		printf("(longest range: %ld) ", (long)compiler_common->longest_range_size);
-	printf("\n");
+	return push_utf8_ranges(compiler_common, ranges, count, 1);
 }
 
-#endif
-
-/* --------------------------------------------------------------------- */
-/*  Utilities                                                            */
-/* --------------------------------------------------------------------- */
+#endif /* REGEX_USE_8BIT_CHARS */
 
-static int generate_search_states(struct compiler_common *compiler_common)
+static int parse(const regex_char_t *regex_string, int length, struct compiler_common *compiler_common)
 {
-	struct stack_item *transitions_ptr = compiler_common->dfa_transitions;
-	struct stack_item *transitions_end = transitions_ptr + compiler_common->dfa_size;
-	struct stack_item *search_states_ptr;
-	struct stack_item *rng_start = NULL;
+	/* Depth of bracketed expressions. */
+	int depth = 0;
+	/* Have we already found a term? '1' if not yet. */
+	int begin = 1;
+	/* Cache stack pointer. */
+	struct stack* stack = &compiler_common->stack;
+	int tmp;
 
-	compiler_common->terms_size = !(compiler_common->flags & REGEX_FAKE_MATCH_END) ? 1 : 2;
-	compiler_common->longest_range_size = 0;
-	compiler_common->search_states = (struct stack_item *)SLJIT_MALLOC(sizeof(struct stack_item) * compiler_common->dfa_size, NULL);
-	if (!compiler_common->search_states)
+	/* Type_begin and type_end. */
+	compiler_common->dfa_size = 2;
+	compiler_common->capture_count = 0;
+	stack_init(stack);
+	/* Open capture groups. */
+	stack_init(&compiler_common->depth);
+	stack_init(&compiler_common->counters);
+	if (stack_push(stack, type_begin, 0))
 		return REGEX_MEMORY_ERROR;
 
-	search_states_ptr = compiler_common->search_states;
-	while (transitions_ptr < transitions_end) {
-		switch (transitions_ptr->type) {
-		case type_begin:
-		case type_end:
-			search_states_ptr->type = 0;
-			break;
+#ifndef REGEX_USE_8BIT_CHARS
+	if (compiler_common->flags & REGEX_UTF8)
+		return REGEX_INVALID_REGEX;
+#endif
 
-		case type_char:
-			search_states_ptr->type = (int)compiler_common->terms_size++;
-			break;
+	if (length > 0 && *regex_string == '^') {
+		compiler_common->flags |= REGEX_MATCH_BEGIN;
+		length--;
+		regex_string++;
+	}
 
-		case type_newline:
-			if (transitions_ptr->value)
-				search_states_ptr->type = 1;
-			else
-				search_states_ptr->type = (int)compiler_common->terms_size++;
-			SLJIT_ASSERT(search_states_ptr->type == 1 || search_states_ptr->type == 2);
-			break;
+	if ((compiler_common->flags & (REGEX_MATCH_BEGIN | REGEX_NEWLINE)) == (REGEX_MATCH_BEGIN | REGEX_NEWLINE)) {
+		/* Replace REGEX_MATCH_BEGIN flag to REGEX_FAKE_MATCH_BEGIN */
+		compiler_common->flags &= ~REGEX_MATCH_BEGIN;
+		compiler_common->flags |= REGEX_FAKE_MATCH_BEGIN;
+		/* and append a new-line search. */
+		if (stack_push(stack, type_newline, 0))
+			return REGEX_MEMORY_ERROR;
+		compiler_common->dfa_size++;
+		/* Begin intentionally kept as 1. */
+	}
 
-		case type_id:
-			if (transitions_ptr->value > 0)
-				compiler_common->flags |= REGEX_ID_CHECK;
-			search_states_ptr->type = -1;
+	while (length > 0) {
+		switch (*regex_string) {
+		case '\\' :
+			length--;
+			regex_string++;
+			if (length == 0)
+				return REGEX_INVALID_REGEX;
+#ifdef REGEX_USE_8BIT_CHARS
+			if (compiler_common->flags & REGEX_UTF8) {
+				tmp = parse_utf8_char(regex_string, length, compiler_common);
+				if (tmp < 0)
+					return (tmp == -1) ? REGEX_MEMORY_ERROR : REGEX_INVALID_REGEX;
+				length -= tmp;
+				regex_string += tmp;
+				begin = 0;
+				break;
+			}
+#endif
+			if (stack_push(stack, type_char, REGEX_CHAR_VALUE(*regex_string)))
+				return REGEX_MEMORY_ERROR;
+			begin = 0;
+			compiler_common->dfa_size++;
 			break;
 
-		case type_rng_start:
-			search_states_ptr->type = (int)compiler_common->terms_size;
-			rng_start = search_states_ptr;
+		case '.' :
+#ifdef REGEX_USE_8BIT_CHARS
+			if (compiler_common->flags & REGEX_UTF8) {
+				if (parse_utf8_any(compiler_common))
+					return REGEX_MEMORY_ERROR;
+				begin = 0;
+				break;
+			}
+#endif
+			if (stack_push(stack, type_rng_start, 1))
+				return REGEX_MEMORY_ERROR;
+			if (compiler_common->flags & REGEX_NEWLINE) {
+				if (stack_push(stack, type_rng_char, '\n'))
+					return REGEX_MEMORY_ERROR;
+				if (stack_push(stack, type_rng_char, '\r'))
+					return REGEX_MEMORY_ERROR;
+				compiler_common->dfa_size += 2;
+			}
+			if (stack_push(stack, type_rng_end, 1))
+				return REGEX_MEMORY_ERROR;
+			begin = 0;
+			compiler_common->dfa_size += 2;
 			break;
 
-		case type_rng_end:
-			search_states_ptr->type = (int)compiler_common->terms_size++;
-			/* This is an over estimation. */
-			if (compiler_common->longest_range_size < search_states_ptr - rng_start)
-				compiler_common->longest_range_size = search_states_ptr - rng_start;
+		case '(' :
+			depth++;
+			/* The value of the brackets is the number of the capture group (0 if not captured). */
+			tmp = 0;
+			if (compiler_common->flags & REGEX_CAPTURES) {
+				tmp = (int)++compiler_common->capture_count;
+				if (stack_push(&compiler_common->depth, type_open_br, tmp))
+					return REGEX_MEMORY_ERROR;
+				compiler_common->dfa_size++;
+			}
+			if (stack_push(stack, type_open_br, tmp))
+				return REGEX_MEMORY_ERROR;
+			begin = 1;
 			break;
 
-		default:
-			search_states_ptr->type = -1;
+		case ')' :
+			if (depth == 0)
+				return REGEX_INVALID_REGEX;
+			depth--;
+			tmp = 0;
+			if (compiler_common->flags & REGEX_CAPTURES) {
+				tmp = stack_pop(&compiler_common->depth)->value;
+				compiler_common->dfa_size++;
+			}
+			if (stack_push(stack, type_close_br, tmp))
+				return REGEX_MEMORY_ERROR;
+			begin = 0;
 			break;
-		}
-		search_states_ptr->value = -1;
-		search_states_ptr++;
-		transitions_ptr++;
-	}
-	return REGEX_NO_ERROR;
-}
 
-static int trace_transitions(int from, struct compiler_common *compiler_common)
-{
-	int id = 0;
-	struct stack *stack = &compiler_common->stack;
-	struct stack *depth = &compiler_common->depth;
-	struct stack_item *dfa_transitions = compiler_common->dfa_transitions;
-	struct stack_item *search_states = compiler_common->search_states;
-
-	SLJIT_ASSERT(search_states[from].type >= 0);
+		case '|' :
+			if (stack_push(stack, type_select, 0))
+				return REGEX_MEMORY_ERROR;
+			begin = 1;
+			compiler_common->dfa_size += 2;
+			break;
 
-	from++;
+		case '*' :
+			if (begin)
+				return REGEX_INVALID_REGEX;
+			if (stack_push(stack, type_asterisk, 0))
+				return REGEX_MEMORY_ERROR;
+			compiler_common->dfa_size += 2;
+			break;
 
-	/* Be prepared for any paths (loops, etc). */
-	while (1) {
-		if (dfa_transitions[from].type == type_id)
-			if (id < dfa_transitions[from].value)
-				id = dfa_transitions[from].value;
+		case '?' :
+		case '+' :
+			if (begin)
+				return REGEX_INVALID_REGEX;
+			if (stack_push(stack, (*regex_string == '+') ? type_plus_sign : type_qestion_mark, 0))
+				return REGEX_MEMORY_ERROR;
+			compiler_common->dfa_size++;
+			break;
 
-		if (search_states[from].value < id) {
-			/* Forward step. */
-			if (search_states[from].value == -1)
-				if (stack_push(stack, 0, from))
-					return REGEX_MEMORY_ERROR;
-			search_states[from].value = id;
+		case '{' :
+			tmp = parse_iterator(regex_string, length, compiler_common, begin);
 
-			if (dfa_transitions[from].type == type_branch) {
-				if (stack_push(depth, id, from))
+			if (tmp >= 0) {
+				length -= tmp;
+				regex_string += tmp;
+			}
+			else if (tmp == -1)
+				return REGEX_MEMORY_ERROR;
+			else {
+				/* Not a valid range expression. */
+				SLJIT_ASSERT(tmp == -2);
+				if (stack_push(stack, type_char, '{'))
 					return REGEX_MEMORY_ERROR;
-				from++;
-				continue;
+				compiler_common->dfa_size++;
 			}
-			else if (dfa_transitions[from].type == type_jump) {
-				from = dfa_transitions[from].value;
-				continue;
+			break;
+
+		case '[' :
+#ifdef REGEX_USE_8BIT_CHARS
+			if (compiler_common->flags & REGEX_UTF8)
+				tmp = parse_utf8_char_range(regex_string, length, compiler_common);
+			else
+#endif
+			tmp = parse_char_range(regex_string, length, compiler_common);
+			if (tmp >= 0) {
+				length -= tmp;
+				regex_string += tmp;
 			}
-			else if (search_states[from].type < 0) {
-				from++;
-				continue;
+			else if (tmp == -1)
+				return REGEX_MEMORY_ERROR;
+			else {
+				SLJIT_ASSERT(tmp == -2);
+				return REGEX_INVALID_REGEX;
 			}
-		}
+			begin = 0;
+			break;
 
-		/* Back tracking. */
-		if (depth->count > 0) {
-			id = stack_top(depth)->type;
-			from = dfa_transitions[stack_pop(depth)->value].value;
-			continue;
+		default:
+			if (length == 1 && *regex_string == '$') {
+				compiler_common->flags |= REGEX_MATCH_END;
+				break;
+			}
+#ifdef REGEX_USE_8BIT_CHARS
+			if (compiler_common->flags & REGEX_UTF8) {
+				tmp = parse_utf8_char(regex_string, length, compiler_common);
+				if (tmp < 0)
+					return (tmp == -1) ? REGEX_MEMORY_ERROR : REGEX_INVALID_REGEX;
+				length -= tmp;
+				regex_string += tmp;
+				begin = 0;
+				break;
+			}
+#endif
+			if (stack_push(stack, type_char, REGEX_CHAR_VALUE(*regex_string)))
+				return REGEX_MEMORY_ERROR;
+			begin = 0;
+			compiler_common->dfa_size++;
+			break;
 		}
-		return 0;
+		length--;
+		regex_string++;
 	}
-}
 
-/* --------------------------------------------------------------------- */
-/*  Code generator                                                       */
-/* --------------------------------------------------------------------- */
-
-#define TERM_OFFSET_OF(index, offs)	(((index) * no_states + (offs)) * (sljit_sw)sizeof(sljit_sw))
-#define TERM_REL_OFFSET_OF(base, offs)	((base) + ((offs) * (sljit_sw)sizeof(sljit_sw)))
+	if (depth != 0)
+		return REGEX_INVALID_REGEX;
 
-#define EMIT_OP1(type, arg1, arg2, arg3, arg4) \
-	CHECK(sljit_emit_op1(compiler, type, arg1, arg2, arg3, arg4))
+	if ((compiler_common->flags & (REGEX_MATCH_END | REGEX_NEWLINE)) == (REGEX_MATCH_END | REGEX_NEWLINE)) {
+		/* Replace REGEX_MATCH_END flag to REGEX_FAKE_MATCH_END */
+		compiler_common->flags &= ~REGEX_MATCH_END;
+		compiler_common->flags |= REGEX_FAKE_MATCH_END;
+		/* and append a new-line search. */
+		if (stack_push(stack, type_newline, 1))
+			return REGEX_MEMORY_ERROR;
+		compiler_common->dfa_size++;
+		/* Begin intentionally kept as 1. */
+	}
 
-#define EMIT_OP2(type, arg1, arg2, arg3, arg4, arg5, arg6) \
-	CHECK(sljit_emit_op2(compiler, type, arg1, arg2, arg3, arg4, arg5, arg6))
+	if (stack_push(stack, type_end, 0))
+		return REGEX_MEMORY_ERROR;
 
-#define EMIT_OP2U(type, arg1, arg2, arg3, arg4) \
-	CHECK(sljit_emit_op2u(compiler, type, arg1, arg2, arg3, arg4))
+	return REGEX_NO_ERROR;
+}
 
-#define EMIT_LABEL(label) \
-	label = sljit_emit_label(compiler); \
-	CHECK(!label)
+/* --------------------------------------------------------------------- */
+/*  Generating machine state transitions                                 */
+/* --------------------------------------------------------------------- */
 
-#define EMIT_JUMP(jump, type) \
-	jump = sljit_emit_jump(compiler, type); \
-	CHECK(!jump)
+#define PUT_TRANSITION(typ, val) \
+	do { \
+		--transitions_ptr; \
+		transitions_ptr->type = typ; \
+		transitions_ptr->value = val; \
+	} while (0)
 
-#define EMIT_CMP(jump, type, arg1, arg2, arg3, arg4) \
-	jump = sljit_emit_cmp(compiler, type, arg1, arg2, arg3, arg4); \
-	CHECK(!jump)
+static struct stack_item* handle_iteratives(struct stack_item *transitions_ptr, struct stack_item *transitions, struct stack *depth)
+{
+	struct stack_item *item;
 
-/* CHECK depends on the use case. */
+	while (1) {
+		item = stack_top(depth);
 
-#define CHECK(exp) \
-	if (SLJIT_UNLIKELY(exp)) \
-		return REGEX_MEMORY_ERROR
+		switch (item->type) {
+		case type_asterisk:
+			SLJIT_ASSERT(transitions[item->value].type == type_branch);
+			transitions[item->value].value = (int)(transitions_ptr - transitions);
+			PUT_TRANSITION(type_branch, item->value + 1);
+			break;
+
+		case type_plus_sign:
+			SLJIT_ASSERT(transitions[item->value].type == type_branch);
+			transitions[item->value].value = (int)(transitions_ptr - transitions);
+			break;
+
+		case type_qestion_mark:
+			PUT_TRANSITION(type_branch, item->value);
+			break;
+
+		default:
+			return transitions_ptr;
+		}
+		stack_pop(depth);
+	}
+}
 
-static int compile_uncond_tran(struct compiler_common *compiler_common, int reg)
+static int generate_transitions(struct compiler_common *compiler_common)
 {
-	struct sljit_compiler *compiler = compiler_common->compiler;
 	struct stack *stack = &compiler_common->stack;
-	struct stack_item *search_states = compiler_common->search_states;
-	int flags = compiler_common->flags;
-	sljit_sw no_states = compiler_common->no_states;
-	sljit_sw head = 0;
-	sljit_sw offset, value;
+	struct stack *depth = &compiler_common->depth;
+	struct stack_item *transitions_ptr;
+	struct stack_item *item;
+	int group;
 
-	if (reg != R_CURR_STATE || !(compiler_common->flags & REGEX_FAKE_MATCH_BEGIN)) {
-		CHECK(trace_transitions(0, compiler_common));
-	}
-	else {
-		CHECK(trace_transitions(1, compiler_common));
-	}
+	/* The depth stack is initialized by the parser. */
+	SLJIT_ASSERT(depth->count == 0);
+	compiler_common->dfa_transitions = (struct stack_item *)SLJIT_MALLOC(sizeof(struct stack_item) * compiler_common->dfa_size, NULL);
+	if (!compiler_common->dfa_transitions)
+		return REGEX_MEMORY_ERROR;
 
+	/* Go through the items of the stack and generate the necessary branches and jumps (edges of DFA). */
+	transitions_ptr = compiler_common->dfa_transitions + compiler_common->dfa_size;
 	while (stack->count > 0) {
-		value = stack_pop(stack)->value;
-		if (search_states[value].type >= 0) {
-			offset = TERM_OFFSET_OF(search_states[value].type, 0);
-			EMIT_OP1(SLJIT_MOV, SLJIT_MEM1(reg), TERM_REL_OFFSET_OF(offset, 1), SLJIT_IMM, head);
-			if (offset > 0)
-				head = offset;
+		item = stack_pop(stack);
+		switch (item->type) {
+		case type_begin:
+		case type_open_br:
+			group = item->value;
+			item = stack_pop(depth);
+			if (item->type == type_select)
+				PUT_TRANSITION(type_branch, item->value + 1);
+			else
+				SLJIT_ASSERT(item->type == type_close_br);
+			/* The slots of a group are set when it is entered and left. */
+			if (group > 0)
+				PUT_TRANSITION(type_capture, 2 * (group - 1));
+			if (stack->count == 0)
+				PUT_TRANSITION(type_begin, 0);
+			else
+				transitions_ptr = handle_iteratives(transitions_ptr, compiler_common->dfa_transitions, depth);
+			break;
 
-			if (!(flags & REGEX_MATCH_BEGIN)) {
-				EMIT_OP1(SLJIT_MOV, SLJIT_MEM1(reg), TERM_REL_OFFSET_OF(offset, 2), R_TEMP, 0);
-				if (flags & REGEX_ID_CHECK) {
-					EMIT_OP1(SLJIT_MOV, SLJIT_MEM1(reg), TERM_REL_OFFSET_OF(offset, 3), SLJIT_IMM, search_states[value].value);
-				}
+		case type_end:
+		case type_close_br:
+			if (item->type == type_end)
+				*--transitions_ptr = *item;
+			else if (item->value > 0)
+				PUT_TRANSITION(type_capture, 2 * item->value - 1);
+			if (stack_push(depth, type_close_br, (int)(transitions_ptr - compiler_common->dfa_transitions)))
+				return REGEX_MEMORY_ERROR;
+			break;
+
+		case type_select:
+			item = stack_top(depth);
+			if (item->type == type_select) {
+				SLJIT_ASSERT(compiler_common->dfa_transitions[item->value].type == type_jump);
+				PUT_TRANSITION(type_branch, item->value + 1);
+				PUT_TRANSITION(type_jump, item->value);
+				item->value = (int)(transitions_ptr - compiler_common->dfa_transitions);
 			}
-			else if (flags & REGEX_ID_CHECK) {
-				EMIT_OP1(SLJIT_MOV, SLJIT_MEM1(reg), TERM_REL_OFFSET_OF(offset, 2), SLJIT_IMM, search_states[value].value);
+			else {
+				SLJIT_ASSERT(item->type == type_close_br);
+				item->type = type_select;
+				PUT_TRANSITION(type_jump, item->value);
+				item->value = (int)(transitions_ptr - compiler_common->dfa_transitions);
 			}
-		}
-		search_states[value].value = -1;
-	}
-	if (reg == R_NEXT_STATE) {
-		EMIT_OP1(SLJIT_MOV, R_TEMP, 0, R_NEXT_HEAD, 0);
-	}
-	else if (flags & REGEX_FAKE_MATCH_BEGIN) {
-		SLJIT_ASSERT(compiler_common->dfa_transitions[1].type == type_newline && !compiler_common->dfa_transitions[1].value);
-		offset = TERM_OFFSET_OF(search_states[1].type, 0);
+			break;
 
-		SLJIT_ASSERT(!(flags & REGEX_MATCH_BEGIN));
+		case type_asterisk:
+		case type_plus_sign:
+		case type_qestion_mark:
+			if (item->type != type_qestion_mark)
+				PUT_TRANSITION(type_branch, 0);
+			if (stack_push(depth, item->type, (int)(transitions_ptr - compiler_common->dfa_transitions)))
+				return REGEX_MEMORY_ERROR;
+			break;
 
-		EMIT_OP1(SLJIT_MOV, SLJIT_MEM1(reg), TERM_REL_OFFSET_OF(offset, 1), SLJIT_IMM, head);
-		head = offset;
+		case type_char:
+		case type_newline:
+		case type_rng_start:
+			/* Requires handle_iteratives. */
+			*--transitions_ptr = *item;
+			transitions_ptr = handle_iteratives(transitions_ptr, compiler_common->dfa_transitions, depth);
+			break;
 
-		EMIT_OP1(SLJIT_MOV, SLJIT_MEM1(reg), TERM_REL_OFFSET_OF(offset, 2), SLJIT_IMM, 1);
-		if (flags & REGEX_ID_CHECK) {
-			EMIT_OP1(SLJIT_MOV, SLJIT_MEM1(reg), TERM_REL_OFFSET_OF(offset, 3), SLJIT_IMM, 0);
+		default:
+			*--transitions_ptr = *item;
+			break;
 		}
 	}
-	EMIT_OP1(SLJIT_MOV, R_NEXT_HEAD, 0, SLJIT_IMM, head);
+
+	SLJIT_ASSERT(compiler_common->dfa_transitions == transitions_ptr);
+	SLJIT_ASSERT(depth->count == 0);
 	return REGEX_NO_ERROR;
 }
 
-static int compile_cond_tran(struct compiler_common *compiler_common, sljit_sw curr_index)
-{
-	struct sljit_compiler *compiler = compiler_common->compiler;
-	struct stack *stack = &compiler_common->stack;
-	struct stack_item *search_states = compiler_common->search_states;
-	sljit_sw offset;
-	int flags;
-	sljit_sw no_states;
-	sljit_sw value;
-	struct sljit_jump *jump1;
-	struct sljit_jump *jump2;
-	struct sljit_jump *jump3;
-	struct sljit_jump *jump4;
-	struct sljit_jump *jump5;
-	struct sljit_label *label1;
+#undef PUT_TRANSITION
 
-	flags = compiler_common->flags;
-	no_states = compiler_common->no_states;
+#ifdef REGEX_MATCH_VERBOSE
 
-	EMIT_OP1(SLJIT_MOV, SLJIT_MEM1(R_REGEX_MATCH), SLJIT_OFFSETOF(struct regex_match, fast_forward), SLJIT_IMM, 0);
-	if (!(flags & (REGEX_ID_CHECK | REGEX_MATCH_BEGIN))) {
-		EMIT_OP1(SLJIT_MOV, R_TEMP, 0, SLJIT_MEM1(R_CURR_STATE), TERM_OFFSET_OF(curr_index, 2));
-	}
+static void verbose_transitions(struct compiler_common *compiler_common)
+{
+	struct stack_item *transitions_ptr = compiler_common->dfa_transitions;
+	struct stack_item *transitions_end = transitions_ptr + compiler_common->dfa_size;
+	struct stack_item *search_states_ptr = compiler_common->search_states;
+	int pos;
 
-	while (stack->count > 0) {
-		value = stack_pop(stack)->value;
-		if (search_states[value].type >= 0) {
-#ifdef REGEX_MATCH_VERBOSE
-			if (flags & REGEX_MATCH_VERBOSE)
-				printf("-> (%3d:%3d) ", search_states[value].type, search_states[value].value);
-#endif
-			offset = TERM_OFFSET_OF(search_states[value].type, 0);
+	printf("-----------------\nTransitions\n-----------------\n");
+	pos = 0;
+	while (transitions_ptr < transitions_end) {
+		printf("[%3d] ", pos++);
+		if (search_states_ptr->type >= 0)
+			printf("(%3d) ", search_states_ptr->type);
+		switch (transitions_ptr->type) {
+		case type_begin:
+			printf("type_begin\n");
+			break;
 
-			if (!(flags & REGEX_ID_CHECK)) {
-				if (!(flags & REGEX_MATCH_BEGIN)) {
-					/* Check whether item is inserted. */
-					EMIT_CMP(jump1, SLJIT_NOT_EQUAL, SLJIT_MEM1(R_NEXT_STATE), offset + (sljit_sw)sizeof(sljit_sw), SLJIT_IMM, -1);
-					EMIT_OP1(SLJIT_MOV, SLJIT_MEM1(R_NEXT_STATE), offset + (sljit_sw)sizeof(sljit_sw), R_NEXT_HEAD, 0);
-					if (offset > 0) {
-						EMIT_OP1(SLJIT_MOV, R_NEXT_HEAD, 0, SLJIT_IMM, offset);
-					}
-					EMIT_JUMP(jump2, SLJIT_JUMP);
+		case type_end:
+			printf("type_end\n");
+			break;
 
-					/* Check whether old index <= index. */
-					EMIT_LABEL(label1);
-					sljit_set_label(jump1, label1);
+		case type_char:
+			if (transitions_ptr->value >= ' ')
+				printf("type_char '%c'\n", transitions_ptr->value);
+			else
+				printf("type_char 0x%x\n", transitions_ptr->value);
+			break;
 
-					EMIT_CMP(jump1, SLJIT_LESS_EQUAL, SLJIT_MEM1(R_NEXT_STATE), offset + 2 * (sljit_sw)sizeof(sljit_sw), R_TEMP, 0);
+		case type_newline:
+			printf("type_newline %s\n", transitions_ptr->value ? "(end)" : "(begin)");
+			break;
 
-					EMIT_LABEL(label1);
-					sljit_set_label(jump2, label1);
-					EMIT_OP1(SLJIT_MOV, SLJIT_MEM1(R_NEXT_STATE), offset + 2 * (sljit_sw)sizeof(sljit_sw), R_TEMP, 0);
+		case type_id:
+			printf("type_id %d\n", transitions_ptr->value);
+			break;
 
-					EMIT_LABEL(label1);
-					sljit_set_label(jump1, label1);
-				}
-				else {
-					/* Check whether item is inserted. */
-					EMIT_CMP(jump1, SLJIT_NOT_EQUAL, SLJIT_MEM1(R_NEXT_STATE), offset + (sljit_sw)sizeof(sljit_sw), SLJIT_IMM, -1);
-					EMIT_OP1(SLJIT_MOV, SLJIT_MEM1(R_NEXT_STATE), offset + (sljit_sw)sizeof(sljit_sw), R_NEXT_HEAD, 0);
-					if (offset > 0) {
-						EMIT_OP1(SLJIT_MOV, R_NEXT_HEAD, 0, SLJIT_IMM, offset);
-					}
-					EMIT_LABEL(label1);
-					sljit_set_label(jump1, label1);
-				}
-			}
-			else {
-				if (!(flags & REGEX_MATCH_BEGIN)) {
-					EMIT_OP1(SLJIT_MOV, R_TEMP, 0, SLJIT_MEM1(R_CURR_STATE), TERM_OFFSET_OF(curr_index, 2));
+		case type_rng_start:
+			printf("type_rng_start %s\n", transitions_ptr->value ? "(invert)" : "(normal)");
+			break;
 
-					/* Check whether item is inserted. */
-					EMIT_CMP(jump1, SLJIT_NOT_EQUAL, SLJIT_MEM1(R_NEXT_STATE), offset + (sljit_sw)sizeof(sljit_sw), SLJIT_IMM, -1);
-					EMIT_OP1(SLJIT_MOV, SLJIT_MEM1(R_NEXT_STATE), offset + (sljit_sw)sizeof(sljit_sw), R_NEXT_HEAD, 0);
-					if (offset > 0) {
-						EMIT_OP1(SLJIT_MOV, R_NEXT_HEAD, 0, SLJIT_IMM, offset);
-					}
-					EMIT_JUMP(jump2, SLJIT_JUMP);
+		case type_rng_end:
+			printf("type_rng_end\n");
+			break;
 
-					/* Check whether old index != index. */
-					EMIT_LABEL(label1);
-					sljit_set_label(jump1, label1);
+		case type_rng_char:
+			if (transitions_ptr->value >= ' ')
+				printf("type_rng_char '%c'\n", transitions_ptr->value);
+			else
+				printf("type_rng_char 0x%x\n", transitions_ptr->value);
+			break;
 
-					EMIT_OP2U(SLJIT_SUB | SLJIT_SET_Z | SLJIT_SET_LESS, SLJIT_MEM1(R_NEXT_STATE), offset + 2 * (sljit_sw)sizeof(sljit_sw), R_TEMP, 0);
-					EMIT_JUMP(jump1, SLJIT_LESS);
-					EMIT_JUMP(jump3, SLJIT_NOT_EQUAL); /* Greater. */
+		case type_rng_left:
+			if (transitions_ptr->value >= ' ')
+				printf("type_rng_left '%c'\n", transitions_ptr->value);
+			else
+				printf("type_rng_left 0x%x\n", transitions_ptr->value);
+			break;
 
-					/* Old index == index. */
-					EMIT_OP1(SLJIT_MOV, R_TEMP, 0, SLJIT_MEM1(R_CURR_STATE), TERM_OFFSET_OF(curr_index, 3));
-					if (search_states[value].value > 0) {
-						EMIT_CMP(jump4, SLJIT_GREATER, R_TEMP, 0, SLJIT_IMM, search_states[value].value);
+		case type_rng_right:
+			if (transitions_ptr->value >= ' ')
+				printf("type_rng_right '%c'\n", transitions_ptr->value);
+			else
+				printf("type_rng_right 0x%x\n", transitions_ptr->value);
+			break;
 
-						EMIT_OP1(SLJIT_MOV, R_TEMP, 0, SLJIT_IMM, search_states[value].value);
-						EMIT_LABEL(label1);
-						sljit_set_label(jump4, label1);
-					}
+		case type_branch:
+			printf("type_branch -> %d\n", transitions_ptr->value);
+			break;
 
-					EMIT_OP2U(SLJIT_SUB | SLJIT_SET_GREATER_EQUAL, SLJIT_MEM1(R_NEXT_STATE), offset + 3 * (sljit_sw)sizeof(sljit_sw), R_TEMP, 0);
-					EMIT_JUMP(jump4, SLJIT_GREATER_EQUAL);
-					EMIT_JUMP(jump5, SLJIT_JUMP);
+		case type_jump:
+			printf("type_jump -> %d\n", transitions_ptr->value);
+			break;
 
-					/* Overwrite index & id. */
-					EMIT_LABEL(label1);
-					sljit_set_label(jump3, label1);
-					sljit_set_label(jump2, label1);
-					EMIT_OP1(SLJIT_MOV, SLJIT_MEM1(R_NEXT_STATE), offset + 2 * (sljit_sw)sizeof(sljit_sw), R_TEMP, 0);
+		case type_capture:
+			printf("type_capture %d (%s)\n", transitions_ptr->value / 2 + 1, (transitions_ptr->value & 0x1) ? "end" : "begin");
+			break;
 
-					EMIT_OP1(SLJIT_MOV, R_TEMP, 0, SLJIT_MEM1(R_CURR_STATE), TERM_OFFSET_OF(curr_index, 3));
-					if (search_states[value].value > 0) {
-						EMIT_CMP(jump3, SLJIT_GREATER, R_TEMP, 0, SLJIT_IMM, search_states[value].value);
+		case type_counter:
+			printf("type_counter %d\n", transitions_ptr->value);
+			break;
 
-						EMIT_OP1(SLJIT_MOV, R_TEMP, 0, SLJIT_IMM, search_states[value].value);
-						EMIT_LABEL(label1);
-						sljit_set_label(jump3, label1);
-					}
+		default:
+			printf("UNEXPECTED TYPE\n");
+			break;
+		}
+		transitions_ptr++;
+		search_states_ptr++;
+	}
+	printf("flags: ");
+	if (!(compiler_common->flags & (REGEX_MATCH_BEGIN | REGEX_MATCH_END | REGEX_NEWLINE | REGEX_ID_CHECK | REGEX_FAKE_MATCH_BEGIN | REGEX_FAKE_MATCH_END)))
+		printf("none ");
+	if (compiler_common->flags & REGEX_MATCH_BEGIN)
+		printf("REGEX_MATCH_BEGIN ");
+	if (compiler_common->flags & REGEX_MATCH_END)
+		printf("REGEX_MATCH_END ");
+	if (compiler_common->flags & REGEX_NEWLINE)
+		printf("REGEX_NEWLINE ");
+	if (compiler_common->flags & REGEX_ID_CHECK)
+		printf("REGEX_ID_CHECK ");
+	if (compiler_common->flags & REGEX_FAKE_MATCH_BEGIN)
+		printf("REGEX_FAKE_MATCH_BEGIN ");
+	if (compiler_common->flags & REGEX_FAKE_MATCH_END)
+		printf("REGEX_FAKE_MATCH_END ");
+	if (compiler_common->longest_range_size > 0)
+		printf("(longest range: %ld) ", (long)compiler_common->longest_range_size);
+	printf("\n");
+}
 
-					EMIT_LABEL(label1);
-					sljit_set_label(jump5, label1);
-					EMIT_OP1(SLJIT_MOV, SLJIT_MEM1(R_NEXT_STATE), offset + 3 * (sljit_sw)sizeof(sljit_sw), R_TEMP, 0);
+#endif
 
-					/* Exit. */
-					EMIT_LABEL(label1);
-					sljit_set_label(jump1, label1);
-					sljit_set_label(jump4, label1);
-				}
-				else {
-					EMIT_OP1(SLJIT_MOV, R_TEMP, 0, SLJIT_MEM1(R_CURR_STATE), TERM_OFFSET_OF(curr_index, 2));
+/* --------------------------------------------------------------------- */
+/*  Utilities                                                            */
+/* --------------------------------------------------------------------- */
 
-					if (search_states[value].value > 0) {
-						EMIT_CMP(jump1, SLJIT_GREATER, R_TEMP, 0, SLJIT_IMM, search_states[value].value);
+static int generate_search_states(struct compiler_common *compiler_common)
+{
+	struct stack_item *transitions_ptr = compiler_common->dfa_transitions;
+	struct stack_item *transitions_end = transitions_ptr + compiler_common->dfa_size;
+	struct stack_item *search_states_ptr;
+	struct stack_item *rng_start = NULL;
 
-						EMIT_OP1(SLJIT_MOV, R_TEMP, 0, SLJIT_IMM, search_states[value].value);
-						EMIT_LABEL(label1);
-						sljit_set_label(jump1, label1);
-					}
+	compiler_common->terms_size = !(compiler_common->flags & REGEX_FAKE_MATCH_END) ? 1 : 2;
+	compiler_common->longest_range_size = 0;
+	compiler_common->counter_count = 0;
+	compiler_common->search_states = (struct stack_item *)SLJIT_MALLOC(sizeof(struct stack_item) * compiler_common->dfa_size, NULL);
+	if (!compiler_common->search_states)
+		return REGEX_MEMORY_ERROR;
 
-					/* Check whether item is inserted. */
-					EMIT_CMP(jump1, SLJIT_NOT_EQUAL, SLJIT_MEM1(R_NEXT_STATE), offset + (sljit_sw)sizeof(sljit_sw), SLJIT_IMM, -1);
-					EMIT_OP1(SLJIT_MOV, SLJIT_MEM1(R_NEXT_STATE), offset + (sljit_sw)sizeof(sljit_sw), R_NEXT_HEAD, 0);
-					if (offset > 0) {
-						EMIT_OP1(SLJIT_MOV, R_NEXT_HEAD, 0, SLJIT_IMM, offset);
-					}
-					EMIT_JUMP(jump2, SLJIT_JUMP);
+	search_states_ptr = compiler_common->search_states;
+	while (transitions_ptr < transitions_end) {
+		switch (transitions_ptr->type) {
+		case type_begin:
+		case type_end:
+			search_states_ptr->type = 0;
+			break;
 
-					/* Check whether old id >= id. */
-					EMIT_LABEL(label1);
-					sljit_set_label(jump1, label1);
+		case type_char:
+			search_states_ptr->type = (int)compiler_common->terms_size++;
+			break;
 
-					EMIT_CMP(jump1, SLJIT_GREATER_EQUAL, SLJIT_MEM1(R_NEXT_STATE), offset + 2 * (sljit_sw)sizeof(sljit_sw), R_TEMP, 0);
+		case type_newline:
+			if (transitions_ptr->value)
+				search_states_ptr->type = 1;
+			else
+				search_states_ptr->type = (int)compiler_common->terms_size++;
+			SLJIT_ASSERT(search_states_ptr->type == 1 || search_states_ptr->type == 2);
+			break;
 
-					EMIT_LABEL(label1);
-					sljit_set_label(jump2, label1);
-					EMIT_OP1(SLJIT_MOV, SLJIT_MEM1(R_NEXT_STATE), offset + 2 * (sljit_sw)sizeof(sljit_sw), R_TEMP, 0);
+		case type_id:
+			if (transitions_ptr->value > 0)
+				compiler_common->flags |= REGEX_ID_CHECK;
+			search_states_ptr->type = -1;
+			break;
 
-					EMIT_LABEL(label1);
-					sljit_set_label(jump1, label1);
-				}
-			}
+		case type_rng_start:
+			search_states_ptr->type = (int)compiler_common->terms_size;
+			rng_start = search_states_ptr;
+			break;
+
+		case type_rng_end:
+			search_states_ptr->type = (int)compiler_common->terms_size++;
+			/* This is an over estimation. */
+			if (compiler_common->longest_range_size < search_states_ptr - rng_start)
+				compiler_common->longest_range_size = search_states_ptr - rng_start;
+			break;
+
+		case type_counter:
+			compiler_common->counter_count++;
+			search_states_ptr->type = -1;
+			break;
+
+		default:
+			search_states_ptr->type = -1;
+			break;
 		}
-		search_states[value].value = -1;
+		search_states_ptr->value = -1;
+		search_states_ptr++;
+		transitions_ptr++;
 	}
-
-#ifdef REGEX_MATCH_VERBOSE
-	if (flags & REGEX_MATCH_VERBOSE)
-		printf("\n");
-#endif
 	return REGEX_NO_ERROR;
 }
 
-static int compile_end_check(struct compiler_common *compiler_common, struct sljit_label *end_check_label)
+static int trace_transitions(int from, struct compiler_common *compiler_common)
 {
-	struct sljit_compiler *compiler = compiler_common->compiler;
-	struct sljit_jump *jump;
-	struct sljit_jump *clear_states_jump;
-	struct sljit_label *label;
-	struct sljit_label *leave_label;
-	struct sljit_label *begin_loop_label;
+	int id = 0;
+	int prev = from;
+	struct stack *stack = &compiler_common->stack;
+	struct stack *depth = &compiler_common->depth;
+	struct stack_item *dfa_transitions = compiler_common->dfa_transitions;
+	struct stack_item *search_states = compiler_common->search_states;
+	sljit_sw *trace_parents = compiler_common->trace_parents;
 
-	/* Priority order: best_begin > best_end > best_id.
-	   In other words:
-	       if (new best_begin > old test_begin) do nothing
-	       otherwise we know that new_end > old_end, since R_CURR_INDEX ever increasing
-	       therefore we must overwrite all best_* variables (new_id also contains the highest id for this turn). */
+	SLJIT_ASSERT(search_states[from].type >= 0);
 
-	/* Both R_CURR_CHAR and R_BEST_BEGIN used as temporary registers. */
+	from++;
 
-	if (!(compiler_common->flags & REGEX_MATCH_BEGIN)) {
-		EMIT_OP1(SLJIT_MOV, R_CURR_CHAR, 0, SLJIT_MEM1(R_CURR_STATE), TERM_REL_OFFSET_OF(0, 2));
-		EMIT_CMP(jump, !(compiler_common->flags & REGEX_MATCH_NON_GREEDY) ? SLJIT_LESS : SLJIT_LESS_EQUAL, SLJIT_MEM1(R_REGEX_MATCH), SLJIT_OFFSETOF(struct regex_match, best_begin), R_CURR_CHAR, 0);
-		sljit_set_label(jump, end_check_label);
+	/* Be prepared for any paths (loops, etc). */
+	while (1) {
+		if (dfa_transitions[from].type == type_id)
+			if (id < dfa_transitions[from].value)
+				id = dfa_transitions[from].value;
 
-		EMIT_OP1(SLJIT_MOV, SLJIT_MEM1(R_REGEX_MATCH), SLJIT_OFFSETOF(struct regex_match, best_begin), R_CURR_CHAR, 0);
-		if (!(compiler_common->flags & (REGEX_FAKE_MATCH_BEGIN | REGEX_FAKE_MATCH_END))) {
-			EMIT_OP1(SLJIT_MOV, SLJIT_MEM1(R_REGEX_MATCH), SLJIT_OFFSETOF(struct regex_match, best_end), R_CURR_INDEX, 0);
-		}
-		else {
-			if ((compiler_common->flags & (REGEX_FAKE_MATCH_BEGIN | REGEX_FAKE_MATCH_END)) == (REGEX_FAKE_MATCH_BEGIN | REGEX_FAKE_MATCH_END)) {
-				EMIT_OP2(SLJIT_SUB, SLJIT_MEM1(R_REGEX_MATCH), SLJIT_OFFSETOF(struct regex_match, best_end), R_CURR_INDEX, 0, SLJIT_IMM, 2);
-			}
-			else {
-				EMIT_OP2(SLJIT_SUB, SLJIT_MEM1(R_REGEX_MATCH), SLJIT_OFFSETOF(struct regex_match, best_end), R_CURR_INDEX, 0, SLJIT_IMM, 1);
+		if (search_states[from].value < id) {
+			/* Forward step. */
+			if (search_states[from].value == -1) {
+				if (stack_push(stack, 0, from))
+					return REGEX_MEMORY_ERROR;
+				/* The first path has the highest priority. */
+				if (trace_parents)
+					trace_parents[from] = prev;
 			}
-		}
-		if (compiler_common->flags & REGEX_ID_CHECK) {
-			EMIT_OP1(SLJIT_MOV, SLJIT_MEM1(R_REGEX_MATCH), SLJIT_OFFSETOF(struct regex_match, best_id), SLJIT_MEM1(R_CURR_STATE), TERM_REL_OFFSET_OF(0, 3));
-		}
+			search_states[from].value = id;
+			prev = from;
 
-		EMIT_CMP(clear_states_jump, SLJIT_LESS, R_CURR_CHAR, 0, R_BEST_BEGIN, 0);
-
-		EMIT_LABEL(leave_label);
-		EMIT_OP1(SLJIT_MOV, R_BEST_BEGIN, 0, R_CURR_CHAR, 0);
-		EMIT_JUMP(jump, SLJIT_JUMP);
-		sljit_set_label(jump, end_check_label);
-
-		/* A loop to clear all states, which are > (or >=) than R_CURR_CHAR. */
-		EMIT_LABEL(label);
-		sljit_set_label(clear_states_jump, label);
+			if (dfa_transitions[from].type == type_branch) {
+				if (stack_push(depth, id, from))
+					return REGEX_MEMORY_ERROR;
+				from++;
+				continue;
+			}
+			else if (dfa_transitions[from].type == type_jump) {
+				from = dfa_transitions[from].value;
+				continue;
+			}
+			else if (search_states[from].type < 0) {
+				from++;
+				continue;
+			}
+		}
 
-		EMIT_OP1(SLJIT_MOV, R_TEMP, 0, R_NEXT_HEAD, 0);
-		EMIT_OP1(SLJIT_MOV, R_NEXT_HEAD, 0, SLJIT_IMM, 0);
+		/* Back tracking. */
+		if (depth->count > 0) {
+			id = stack_top(depth)->type;
+			prev = stack_pop(depth)->value;
+			from = dfa_transitions[prev].value;
+			continue;
+		}
+		return 0;
+	}
+}
 
-		/* Begin of the loop. */
-		EMIT_LABEL(begin_loop_label);
-		EMIT_CMP(jump, SLJIT_EQUAL, R_TEMP, 0, SLJIT_IMM, 0);
-		sljit_set_label(jump, leave_label);
+#ifdef REGEX_USE_8BIT_CHARS
 
-		EMIT_OP2(SLJIT_ADD, R_TEMP, 0, R_TEMP, 0, R_CURR_STATE, 0);
-		EMIT_OP1(SLJIT_MOV, R_BEST_BEGIN, 0, SLJIT_MEM1(R_TEMP), sizeof(sljit_sw));
-		EMIT_CMP(clear_states_jump, !(compiler_common->flags & REGEX_MATCH_NON_GREEDY) ? SLJIT_GREATER : SLJIT_GREATER_EQUAL, SLJIT_MEM1(R_TEMP), 2 * sizeof(sljit_sw), R_CURR_CHAR, 0);
+#define DFA_SET_BIT(set, bit) \
+	(set)[(bit) / REGEX_DFA_WORD_BITS] |= (sljit_uw)1 << ((bit) % REGEX_DFA_WORD_BITS)
 
-		/* Case 1: keep this case. */
-		EMIT_OP1(SLJIT_MOV, SLJIT_MEM1(R_TEMP), sizeof(sljit_sw), R_NEXT_HEAD, 0);
-		EMIT_OP2(SLJIT_SUB, R_NEXT_HEAD, 0, R_TEMP, 0, R_CURR_STATE, 0);
+static int dfa_char_accepted(struct stack_item *dfa_transitions, sljit_sw ind, sljit_sw chr)
+{
+	int invert;
 
-		EMIT_OP1(SLJIT_MOV, R_TEMP, 0, R_BEST_BEGIN, 0);
-		EMIT_JUMP(jump, SLJIT_JUMP);
-		sljit_set_label(jump, begin_loop_label);
+	switch (dfa_transitions[ind].type) {
+	case type_char:
+		/* The machine code compares the zero extended character to the value. */
+		return chr == dfa_transitions[ind].value;
 
-		/* Case 2: remove this case. */
-		EMIT_LABEL(label);
-		sljit_set_label(clear_states_jump, label);
+	case type_newline:
+		return chr == '\n' || chr == '\r';
 
-		EMIT_OP1(SLJIT_MOV, SLJIT_MEM1(R_TEMP), sizeof(sljit_sw), SLJIT_IMM, -1);
+	default:
+		SLJIT_ASSERT(dfa_transitions[ind].type == type_rng_start);
+		invert = dfa_transitions[ind].value;
+		ind++;
 
-		EMIT_OP1(SLJIT_MOV, R_TEMP, 0, R_BEST_BEGIN, 0);
-		EMIT_JUMP(jump, SLJIT_JUMP);
-		sljit_set_label(jump, begin_loop_label);
-	}
-	else {
-		EMIT_OP1(SLJIT_MOV, R_BEST_BEGIN, 0, SLJIT_IMM, 0);
-		EMIT_OP1(SLJIT_MOV, SLJIT_MEM1(R_REGEX_MATCH), SLJIT_OFFSETOF(struct regex_match, best_begin), SLJIT_IMM, 0);
-		EMIT_OP1(SLJIT_MOV, SLJIT_MEM1(R_REGEX_MATCH), SLJIT_OFFSETOF(struct regex_match, best_end), R_CURR_INDEX, 0);
-		if (compiler_common->flags & REGEX_ID_CHECK) {
-			EMIT_OP1(SLJIT_MOV, SLJIT_MEM1(R_REGEX_MATCH), SLJIT_OFFSETOF(struct regex_match, best_id), SLJIT_MEM1(R_CURR_STATE), TERM_REL_OFFSET_OF(0, 2));
+		while (dfa_transitions[ind].type != type_rng_end) {
+			if (dfa_transitions[ind].type == type_rng_char) {
+				if (chr == dfa_transitions[ind].value)
+					return !invert;
+			}
+			else {
+				SLJIT_ASSERT(dfa_transitions[ind].type == type_rng_left);
+				if ((sljit_uw)(chr - dfa_transitions[ind].value) <= (sljit_uw)(dfa_transitions[ind + 1].value - dfa_transitions[ind].value))
+					return !invert;
+				ind++;
+			}
+			ind++;
 		}
-		EMIT_JUMP(jump, SLJIT_JUMP);
-		sljit_set_label(jump, end_check_label);
+		return invert;
 	}
-	return REGEX_NO_ERROR;
 }
 
-static int compile_leave_fast_forward(struct compiler_common *compiler_common, struct sljit_label *fast_forward_label)
+static int dfa_trace_set(sljit_sw from, sljit_uw *set, sljit_sw *list, struct compiler_common *compiler_common)
 {
-	struct sljit_compiler *compiler = compiler_common->compiler;
 	struct stack *stack = &compiler_common->stack;
-	struct stack_item *dfa_transitions = compiler_common->dfa_transitions;
 	struct stack_item *search_states = compiler_common->search_states;
-	int ind;
-	struct sljit_jump *jump;
-	int init_range = 1, prev_value = 0;
+	sljit_sw ind;
+	int count = 0;
+
+	if (trace_transitions((int)from, compiler_common))
+		return -1;
 
 	while (stack->count > 0) {
 		ind = stack_pop(stack)->value;
-		search_states[ind].value = -1;
 		if (search_states[ind].type >= 0) {
-			if (dfa_transitions[ind].type == type_char) {
-				EMIT_CMP(jump, SLJIT_EQUAL, R_CURR_CHAR, 0, SLJIT_IMM, dfa_transitions[ind].value);
-				sljit_set_label(jump, fast_forward_label);
+			DFA_SET_BIT(set, search_states[ind].type);
+			if (list) {
+				list[0] = search_states[ind].type;
+				list[1] = search_states[ind].value;
+				list += 2;
 			}
-			else if (dfa_transitions[ind].type == type_rng_start) {
-				SLJIT_ASSERT(!dfa_transitions[ind].value);
+			count++;
+		}
+		search_states[ind].value = -1;
+	}
+	return count;
+}
+
+/* The tables are allocated after the regex_dfa structure. */
+#define DFA_TABLES_SIZE(terms_size, set_size) \
+	((sljit_uw)((2 + (terms_size)) * (set_size) + 2 * (terms_size)) * sizeof(sljit_uw) + (sljit_uw)(terms_size) * 32)
+
+static void dfa_set_tables(struct regex_dfa *dfa, sljit_sw terms_size)
+{
+	dfa->restart = (sljit_uw*)(dfa + 1);
+	dfa->initial = dfa->restart + dfa->set_size;
+	dfa->follow = dfa->initial + dfa->set_size;
+	dfa->restart_list = (sljit_sw*)(dfa->follow + terms_size * dfa->set_size);
+	dfa->chars = (sljit_u8*)(dfa->restart_list + 2 * terms_size);
+}
+
+static int build_lazy_dfa(struct compiler_common *compiler_common)
+{
+	struct stack_item *dfa_transitions = compiler_common->dfa_transitions;
+	struct stack_item *search_states = compiler_common->search_states;
+	sljit_sw terms_size = compiler_common->terms_size;
+	sljit_sw set_size = (terms_size + REGEX_DFA_WORD_BITS - 1) / REGEX_DFA_WORD_BITS;
+	sljit_sw ind, term, chr;
+	sljit_uw *ptr;
+	sljit_uw *end;
+	sljit_u8 *chars;
+	struct regex_dfa *dfa;
+	int count;
+
+	/* Freed by regex_free_machine. */
+	dfa = (struct regex_dfa*)SLJIT_MALLOC(sizeof(struct regex_dfa) + DFA_TABLES_SIZE(terms_size, set_size), NULL);
+	if (!dfa)
+		return REGEX_MEMORY_ERROR;
+	compiler_common->machine->dfa = dfa;
+
+	dfa->set_size = set_size;
+	dfa_set_tables(dfa, terms_size);
+
+	ptr = dfa->restart;
+	end = (sljit_uw*)dfa->restart_list;
+	while (ptr < end)
+		*ptr++ = 0;
+
+	chars = dfa->chars;
+	for (ind = 0; ind < terms_size * 32; ind++)
+		chars[ind] = 0;
+
+	count = dfa_trace_set(0, dfa->restart, dfa->restart_list, compiler_common);
+	if (count < 0)
+		return REGEX_MEMORY_ERROR;
+	dfa->restart_count = count;
+
+	/* The initial terms of a fake begin are started before the restart set. */
+	if (compiler_common->flags & REGEX_FAKE_MATCH_BEGIN) {
+		if (dfa_trace_set(1, dfa->initial, NULL, compiler_common) < 0)
+			return REGEX_MEMORY_ERROR;
+	}
+
+	for (ind = 1; ind < (sljit_sw)compiler_common->dfa_size - 1; ind++) {
+		term = search_states[ind].type;
+		if (term < 0)
+			continue;
+
+		for (chr = 0; chr < 256; chr++)
+			if (dfa_char_accepted(dfa_transitions, ind, chr))
+				chars[term * 32 + (chr >> 3)] |= (sljit_u8)(1 << (chr & 0x7));
+
+		if (dfa_transitions[ind].type == type_rng_start) {
+			while (dfa_transitions[ind].type != type_rng_end)
 				ind++;
-				while (dfa_transitions[ind].type != type_rng_end) {
-					if (dfa_transitions[ind].type == type_rng_char) {
-						EMIT_CMP(jump, SLJIT_EQUAL, R_CURR_CHAR, 0, SLJIT_IMM, dfa_transitions[ind].value);
-						sljit_set_label(jump, fast_forward_label);
-					}
-					else {
-						SLJIT_ASSERT(dfa_transitions[ind].type == type_rng_left);
-						if (init_range) {
-							EMIT_OP1(SLJIT_MOV, R_TEMP, 0, R_CURR_CHAR, 0);
-							init_range = 0;
-						}
-						if (dfa_transitions[ind].value != prev_value) {
-							/* Best compatibility to all archs. */
-							prev_value -= dfa_transitions[ind].value;
-							if (prev_value < 0) {
-								EMIT_OP2(SLJIT_SUB, R_TEMP, 0, R_TEMP, 0, SLJIT_IMM, -prev_value);
-							}
-							else {
-								EMIT_OP2(SLJIT_ADD, R_TEMP, 0, R_TEMP, 0, SLJIT_IMM, prev_value);
-							}
-							prev_value = dfa_transitions[ind].value;
-						}
-						EMIT_CMP(jump, SLJIT_LESS_EQUAL, R_TEMP, 0, SLJIT_IMM, dfa_transitions[ind + 1].value - dfa_transitions[ind].value);
-						sljit_set_label(jump, fast_forward_label);
-						ind++;
-					}
-					ind++;
-				}
+		}
+
+		if (dfa_trace_set(ind, dfa->follow + term * set_size, NULL, compiler_common) < 0)
+			return REGEX_MEMORY_ERROR;
+	}
+	return REGEX_NO_ERROR;
+}
+
+#undef DFA_SET_BIT
+
+#endif /* REGEX_USE_8BIT_CHARS */
+
+/* --------------------------------------------------------------------- */
+/*  Code generator                                                       */
+/* --------------------------------------------------------------------- */
+
+#define TERM_OFFSET_OF(index, offs)	(((index) * no_states + (offs)) * (sljit_sw)sizeof(sljit_sw))
+#define TERM_REL_OFFSET_OF(base, offs)	((base) + ((offs) * (sljit_sw)sizeof(sljit_sw)))
+
+#define EMIT_OP1(type, arg1, arg2, arg3, arg4) \
+	CHECK(sljit_emit_op1(compiler, type, arg1, arg2, arg3, arg4))
+
+#define EMIT_OP2(type, arg1, arg2, arg3, arg4, arg5, arg6) \
+	CHECK(sljit_emit_op2(compiler, type, arg1, arg2, arg3, arg4, arg5, arg6))
+
+#define EMIT_OP2U(type, arg1, arg2, arg3, arg4) \
+	CHECK(sljit_emit_op2u(compiler, type, arg1, arg2, arg3, arg4))
+
+#define EMIT_LABEL(label) \
+	label = sljit_emit_label(compiler); \
+	CHECK(!label)
+
+#define EMIT_JUMP(jump, type) \
+	jump = sljit_emit_jump(compiler, type); \
+	CHECK(!jump)
+
+#define EMIT_CMP(jump, type, arg1, arg2, arg3, arg4) \
+	jump = sljit_emit_cmp(compiler, type, arg1, arg2, arg3, arg4); \
+	CHECK(!jump)
+
+/* CHECK depends on the use case. */
+
+#define CHECK(exp) \
+	if (SLJIT_UNLIKELY(exp)) \
+		return REGEX_MEMORY_ERROR
+
+/* Index of the first capture slot in the state vector. */
+#define CAPTURE_SLOT(compiler_common) \
+	((compiler_common)->no_states - 2 * (compiler_common)->capture_count)
+
+/* Sets the capture slots of the term at position ind after a trace_transitions call: the
+   slots of the groups which are entered or left on the path to the term are set to the
+   value of the pos register minus adjust, and the other slots are copied from src (or
+   set to -1 when src is 0). */
+static int compile_capture_tran(struct compiler_common *compiler_common, sljit_sw ind,
+	sljit_s32 dst, sljit_sw dstw, sljit_s32 src, sljit_sw srcw, sljit_s32 pos, sljit_sw adjust)
+{
+	struct sljit_compiler *compiler = compiler_common->compiler;
+	struct stack_item *dfa_transitions = compiler_common->dfa_transitions;
+	sljit_u8 *capture_marks = compiler_common->capture_marks;
+	sljit_sw slots = 2 * compiler_common->capture_count;
+	sljit_sw i;
+
+	for (i = 0; i < slots; i++)
+		capture_marks[i] = 0;
+
+	/* The path ends at the term where the trace is started. */
+	for (i = compiler_common->trace_parents[ind]; compiler_common->search_states[i].type < 0; i = compiler_common->trace_parents[i])
+		if (dfa_transitions[i].type == type_capture)
+			capture_marks[dfa_transitions[i].value] = 1;
+
+	for (i = 0; i < slots; i++) {
+		if (capture_marks[i]) {
+			if (adjust == 0) {
+				EMIT_OP1(SLJIT_MOV, dst, dstw, pos, 0);
 			}
 			else {
-				SLJIT_ASSERT(dfa_transitions[ind].type == type_newline);
-				EMIT_CMP(jump, SLJIT_EQUAL, R_CURR_CHAR, 0, SLJIT_IMM, '\n');
-				sljit_set_label(jump, fast_forward_label);
-				EMIT_CMP(jump, SLJIT_EQUAL, R_CURR_CHAR, 0, SLJIT_IMM, '\r');
-				sljit_set_label(jump, fast_forward_label);
+				EMIT_OP2(SLJIT_SUB, dst, dstw, pos, 0, SLJIT_IMM, adjust);
 			}
 		}
+		else if (src != 0) {
+			EMIT_OP1(SLJIT_MOV, dst, dstw, src, srcw);
+		}
+		else {
+			EMIT_OP1(SLJIT_MOV, dst, dstw, SLJIT_IMM, -1);
+		}
+		dstw += (sljit_sw)sizeof(sljit_sw);
+		srcw += (sljit_sw)sizeof(sljit_sw);
 	}
 	return REGEX_NO_ERROR;
 }
 
-static int compile_newline_check(struct compiler_common *compiler_common, sljit_sw ind)
+/* Offset of a word of the counter data. */
+#define COUNTER_OFFSET_OF(counter, word)	((counter)->offset + (word) * (sljit_sw)sizeof(sljit_sw))
+
+/* Returns with the counter of a term (NULL if the term is not counted). */
+static SLJIT_INLINE struct regex_counter* get_term_counter(struct compiler_common *compiler_common, sljit_sw term)
+{
+	if (!compiler_common->term_counters || compiler_common->term_counters[term] < 0)
+		return NULL;
+	return compiler_common->counter_list + compiler_common->term_counters[term];
+}
+
+/* Converts the stamp (or queue index) in reg to the address of its ring entry (or queue item). */
+static int compile_counter_slot(struct compiler_common *compiler_common, sljit_s32 reg, sljit_sw size, sljit_sw shift)
+{
+	struct sljit_compiler *compiler = compiler_common->compiler;
+
+	EMIT_OP2(SLJIT_AND, reg, 0, reg, 0, SLJIT_IMM, size - 1);
+	EMIT_OP2(SLJIT_SHL, reg, 0, reg, 0, SLJIT_IMM, shift);
+	EMIT_OP2(SLJIT_ADD, reg, 0, reg, 0, R_REGEX_MATCH, 0);
+	return REGEX_NO_ERROR;
+}
+
+/* Records an entry of a counted term. The stamp is computed from R_CURR_INDEX + 1
+   when index is 0, and the begin of the entry is in R_TEMP (without REGEX_MATCH_BEGIN). */
+static int compile_counter_entry(struct compiler_common *compiler_common, struct regex_counter *counter, sljit_sw index)
 {
 	struct sljit_compiler *compiler = compiler_common->compiler;
 	struct sljit_jump *jump1;
 	struct sljit_jump *jump2;
 	struct sljit_label *label;
-	sljit_sw no_states;
-	sljit_sw offset;
 
-	/* Check whether a new-line character is found. */
-	EMIT_CMP(jump1, SLJIT_EQUAL, R_CURR_CHAR, 0, SLJIT_IMM, '\n');
-	EMIT_CMP(jump2, SLJIT_EQUAL, R_CURR_CHAR, 0, SLJIT_IMM, '\r');
+	if (index == 0) {
+		EMIT_OP2(SLJIT_ADD, R_COUNTER, 0, SLJIT_MEM1(R_REGEX_MATCH), compiler_common->counter_offset, R_CURR_INDEX, 0);
+		EMIT_OP2(SLJIT_ADD, R_COUNTER, 0, R_COUNTER, 0, SLJIT_IMM, 1);
+	}
+	else {
+		EMIT_OP2(SLJIT_ADD, R_COUNTER, 0, SLJIT_MEM1(R_REGEX_MATCH), compiler_common->counter_offset, SLJIT_IMM, index);
+	}
 
-	no_states = compiler_common->no_states;
-	offset = TERM_OFFSET_OF(compiler_common->search_states[ind].type, 1);
-	EMIT_OP1(SLJIT_MOV, R_TEMP, 0, SLJIT_MEM1(R_CURR_STATE), offset);
-	EMIT_OP1(SLJIT_MOV, SLJIT_MEM1(R_CURR_STATE), offset, SLJIT_IMM, -1);
-	CHECK(sljit_emit_ijump(compiler, SLJIT_JUMP, SLJIT_MEM2(R_CURR_STATE, R_TEMP), 0));
+	/* Only the smallest begin is kept, when the term is entered more than once at a character. */
+	EMIT_CMP(jump1, SLJIT_EQUAL, SLJIT_MEM1(R_REGEX_MATCH), COUNTER_OFFSET_OF(counter, COUNTER_LAST), R_COUNTER, 0);
+	EMIT_OP1(SLJIT_MOV, SLJIT_MEM1(R_REGEX_MATCH), COUNTER_OFFSET_OF(counter, COUNTER_LAST), R_COUNTER, 0);
+	CHECK(compile_counter_slot(compiler_common, R_COUNTER, counter->ring_size, SLJIT_WORD_SHIFT + 1));
+	EMIT_OP1(SLJIT_MOV, SLJIT_MEM1(R_COUNTER), COUNTER_OFFSET_OF(counter, COUNTER_RING), SLJIT_MEM1(R_REGEX_MATCH), COUNTER_OFFSET_OF(counter, COUNTER_LAST));
+
+	if (compiler_common->flags & REGEX_MATCH_BEGIN) {
+		EMIT_LABEL(label);
+		sljit_set_label(jump1, label);
+		return REGEX_NO_ERROR;
+	}
+
+	EMIT_OP1(SLJIT_MOV, SLJIT_MEM1(R_COUNTER), COUNTER_OFFSET_OF(counter, COUNTER_RING + 1), R_TEMP, 0);
+	EMIT_JUMP(jump2, SLJIT_JUMP);
+
+	EMIT_LABEL(label);
+	sljit_set_label(jump1, label);
+	CHECK(compile_counter_slot(compiler_common, R_COUNTER, counter->ring_size, SLJIT_WORD_SHIFT + 1));
+	EMIT_CMP(jump1, SLJIT_LESS_EQUAL, SLJIT_MEM1(R_COUNTER), COUNTER_OFFSET_OF(counter, COUNTER_RING + 1), R_TEMP, 0);
+	EMIT_OP1(SLJIT_MOV, SLJIT_MEM1(R_COUNTER), COUNTER_OFFSET_OF(counter, COUNTER_RING + 1), R_TEMP, 0);
 
 	EMIT_LABEL(label);
 	sljit_set_label(jump1, label);
@@ -1718,623 +2369,2720 @@ static int compile_newline_check(struct compiler_common *compiler_common, sljit_
 	return REGEX_NO_ERROR;
 }
 
-#undef CHECK
-
-#define CHECK(exp) \
-	if (SLJIT_UNLIKELY(exp)) \
-		return 0
-
-static SLJIT_INLINE void range_set_label(struct sljit_jump **range_jump_list, struct sljit_label *label)
-{
-	while (*range_jump_list) {
-		sljit_set_label(*range_jump_list, label);
-		range_jump_list++;
-	}
-}
-
-static sljit_sw compile_range_check(struct compiler_common *compiler_common, sljit_sw ind)
+/* Updates the counter of a term, which accepts the current character. The no_exit
+   jump is taken when no entry has an allowed repeat count, otherwise the begin field
+   of the term is set to the smallest begin of these entries. */
+static int compile_counter_step(struct compiler_common *compiler_common, struct regex_counter *counter, sljit_sw term, struct sljit_jump **no_exit)
 {
 	struct sljit_compiler *compiler = compiler_common->compiler;
-	struct stack_item *dfa_transitions = compiler_common->dfa_transitions;
-	struct sljit_jump **range_jump_list = compiler_common->range_jump_list;
-	int invert = dfa_transitions[ind].value;
+	sljit_sw no_states = compiler_common->no_states;
+	sljit_sw gen = compiler_common->counter_offset;
+	sljit_sw queue = COUNTER_OFFSET_OF(counter, COUNTER_RING + 2 * counter->ring_size);
+	struct sljit_jump *jump1;
+	struct sljit_jump *jump2;
+	struct sljit_jump *jump3;
+	struct sljit_jump *jump4;
+	struct sljit_jump *jump5;
 	struct sljit_label *label;
-	sljit_sw no_states;
-	sljit_sw offset;
-	int init_range = 1, prev_value = 0;
+	struct sljit_label *loop_label;
+
+	/* Remove the entries from the queue, which are repeated max times. */
+	EMIT_LABEL(loop_label);
+	EMIT_OP1(SLJIT_MOV, R_TEMP, 0, SLJIT_MEM1(R_REGEX_MATCH), COUNTER_OFFSET_OF(counter, COUNTER_HEAD));
+	EMIT_CMP(jump1, SLJIT_EQUAL, R_TEMP, 0, SLJIT_MEM1(R_REGEX_MATCH), COUNTER_OFFSET_OF(counter, COUNTER_TAIL));
+	CHECK(compile_counter_slot(compiler_common, R_TEMP, counter->queue_size, SLJIT_WORD_SHIFT));
+	EMIT_OP2(SLJIT_SUB, R_COUNTER, 0, SLJIT_MEM1(R_TEMP), queue, SLJIT_MEM1(R_REGEX_MATCH), gen);
+	EMIT_OP2(SLJIT_ADD, R_COUNTER, 0, R_COUNTER, 0, SLJIT_IMM, counter->max - 1);
+	EMIT_CMP(jump2, SLJIT_SIG_GREATER_EQUAL, R_COUNTER, 0, R_CURR_INDEX, 0);
+	EMIT_OP2(SLJIT_ADD, SLJIT_MEM1(R_REGEX_MATCH), COUNTER_OFFSET_OF(counter, COUNTER_HEAD), SLJIT_MEM1(R_REGEX_MATCH), COUNTER_OFFSET_OF(counter, COUNTER_HEAD), SLJIT_IMM, 1);
+	EMIT_JUMP(jump3, SLJIT_JUMP);
+	sljit_set_label(jump3, loop_label);
+
+	EMIT_LABEL(label);
+	sljit_set_label(jump1, label);
+	sljit_set_label(jump2, label);
+
+	/* Append the entry, which is repeated min times, to the queue. */
+	EMIT_OP2(SLJIT_ADD, R_COUNTER, 0, SLJIT_MEM1(R_REGEX_MATCH), gen, R_CURR_INDEX, 0);
+	if (counter->min > 1) {
+		EMIT_OP2(SLJIT_SUB, R_COUNTER, 0, R_COUNTER, 0, SLJIT_IMM, counter->min - 1);
+	}
+	EMIT_CMP(jump1, SLJIT_SIG_LESS_EQUAL, R_COUNTER, 0, SLJIT_MEM1(R_REGEX_MATCH), COUNTER_OFFSET_OF(counter, COUNTER_KILL));
+	EMIT_OP1(SLJIT_MOV, R_TEMP, 0, R_COUNTER, 0);
+	CHECK(compile_counter_slot(compiler_common, R_TEMP, counter->ring_size, SLJIT_WORD_SHIFT + 1));
+	EMIT_CMP(jump2, SLJIT_NOT_EQUAL, SLJIT_MEM1(R_TEMP), COUNTER_OFFSET_OF(counter, COUNTER_RING), R_COUNTER, 0);
+
+	if (compiler_common->flags & REGEX_MATCH_BEGIN) {
+		/* All entries have the same begin, so only the last one is kept. */
+		EMIT_OP1(SLJIT_MOV, SLJIT_MEM1(R_REGEX_MATCH), COUNTER_OFFSET_OF(counter, COUNTER_HEAD), SLJIT_MEM1(R_REGEX_MATCH), COUNTER_OFFSET_OF(counter, COUNTER_TAIL));
+	}
+	else {
+		/* Remove the entries with greater or equal begin from the end of the queue. */
+		EMIT_OP1(SLJIT_MOV, SLJIT_MEM1(R_CURR_STATE), TERM_OFFSET_OF(term, 2), SLJIT_MEM1(R_TEMP), COUNTER_OFFSET_OF(counter, COUNTER_RING + 1));
+
+		EMIT_LABEL(loop_label);
+		EMIT_OP1(SLJIT_MOV, R_TEMP, 0, SLJIT_MEM1(R_REGEX_MATCH), COUNTER_OFFSET_OF(counter, COUNTER_TAIL));
+		EMIT_CMP(jump3, SLJIT_EQUAL, R_TEMP, 0, SLJIT_MEM1(R_REGEX_MATCH), COUNTER_OFFSET_OF(counter, COUNTER_HEAD));
+		EMIT_OP2(SLJIT_SUB, R_TEMP, 0, R_TEMP, 0, SLJIT_IMM, 1);
+		CHECK(compile_counter_slot(compiler_common, R_TEMP, counter->queue_size, SLJIT_WORD_SHIFT));
+		EMIT_OP1(SLJIT_MOV, R_COUNTER, 0, SLJIT_MEM1(R_TEMP), queue);
+		CHECK(compile_counter_slot(compiler_common, R_COUNTER, counter->ring_size, SLJIT_WORD_SHIFT + 1));
+		EMIT_OP1(SLJIT_MOV, R_COUNTER, 0, SLJIT_MEM1(R_COUNTER), COUNTER_OFFSET_OF(counter, COUNTER_RING + 1));
+		EMIT_CMP(jump4, SLJIT_SIG_LESS, R_COUNTER, 0, SLJIT_MEM1(R_CURR_STATE), TERM_OFFSET_OF(term, 2));
+		EMIT_OP2(SLJIT_SUB, SLJIT_MEM1(R_REGEX_MATCH), COUNTER_OFFSET_OF(counter, COUNTER_TAIL), SLJIT_MEM1(R_REGEX_MATCH), COUNTER_OFFSET_OF(counter, COUNTER_TAIL), SLJIT_IMM, 1);
+		EMIT_JUMP(jump5, SLJIT_JUMP);
+		sljit_set_label(jump5, loop_label);
+
+		EMIT_LABEL(label);
+		sljit_set_label(jump3, label);
+		sljit_set_label(jump4, label);
+	}
+
+	EMIT_OP1(SLJIT_MOV, R_TEMP, 0, SLJIT_MEM1(R_REGEX_MATCH), COUNTER_OFFSET_OF(counter, COUNTER_TAIL));
+	EMIT_OP2(SLJIT_ADD, SLJIT_MEM1(R_REGEX_MATCH), COUNTER_OFFSET_OF(counter, COUNTER_TAIL), R_TEMP, 0, SLJIT_IMM, 1);
+	CHECK(compile_counter_slot(compiler_common, R_TEMP, counter->queue_size, SLJIT_WORD_SHIFT));
+	EMIT_OP2(SLJIT_ADD, R_COUNTER, 0, SLJIT_MEM1(R_REGEX_MATCH), gen, R_CURR_INDEX, 0);
+	if (counter->min > 1) {
+		EMIT_OP2(SLJIT_SUB, R_COUNTER, 0, R_COUNTER, 0, SLJIT_IMM, counter->min - 1);
+	}
+	EMIT_OP1(SLJIT_MOV, SLJIT_MEM1(R_TEMP), queue, R_COUNTER, 0);
+
+	EMIT_LABEL(label);
+	sljit_set_label(jump1, label);
+	sljit_set_label(jump2, label);
+
+	/* The term is kept active while the last entry is repeated less than max times. */
+	EMIT_OP1(SLJIT_MOV, R_COUNTER, 0, SLJIT_MEM1(R_REGEX_MATCH), COUNTER_OFFSET_OF(counter, COUNTER_LAST));
+	EMIT_CMP(jump1, SLJIT_SIG_LESS_EQUAL, R_COUNTER, 0, SLJIT_MEM1(R_REGEX_MATCH), COUNTER_OFFSET_OF(counter, COUNTER_KILL));
+	EMIT_OP2(SLJIT_SUB, R_COUNTER, 0, R_COUNTER, 0, SLJIT_MEM1(R_REGEX_MATCH), gen);
+	EMIT_OP2(SLJIT_ADD, R_COUNTER, 0, R_COUNTER, 0, SLJIT_IMM, counter->max - 2);
+	EMIT_CMP(jump2, SLJIT_SIG_LESS, R_COUNTER, 0, R_CURR_INDEX, 0);
+
+	EMIT_OP1(SLJIT_MOV, SLJIT_MEM1(R_REGEX_MATCH), SLJIT_OFFSETOF(struct regex_match, fast_forward), SLJIT_IMM, 0);
+	if (!(compiler_common->flags & REGEX_MATCH_BEGIN)) {
+		/* The begin of the term is only compared by the end check, which must not drop it. */
+		EMIT_OP1(SLJIT_MOV, SLJIT_MEM1(R_NEXT_STATE), TERM_OFFSET_OF(term, 2), SLJIT_IMM, 0);
+	}
+	EMIT_CMP(jump3, SLJIT_NOT_EQUAL, SLJIT_MEM1(R_NEXT_STATE), TERM_OFFSET_OF(term, 1), SLJIT_IMM, -1);
+	EMIT_OP1(SLJIT_MOV, SLJIT_MEM1(R_NEXT_STATE), TERM_OFFSET_OF(term, 1), R_NEXT_HEAD, 0);
+	EMIT_OP1(SLJIT_MOV, R_NEXT_HEAD, 0, SLJIT_IMM, TERM_OFFSET_OF(term, 0));
+
+	EMIT_LABEL(label);
+	sljit_set_label(jump1, label);
+	sljit_set_label(jump2, label);
+	sljit_set_label(jump3, label);
+
+	/* Leave the term when the queue is empty. */
+	EMIT_OP1(SLJIT_MOV, R_TEMP, 0, SLJIT_MEM1(R_REGEX_MATCH), COUNTER_OFFSET_OF(counter, COUNTER_HEAD));
+	EMIT_CMP(*no_exit, SLJIT_EQUAL, R_TEMP, 0, SLJIT_MEM1(R_REGEX_MATCH), COUNTER_OFFSET_OF(counter, COUNTER_TAIL));
+
+	if (!(compiler_common->flags & REGEX_MATCH_BEGIN)) {
+		CHECK(compile_counter_slot(compiler_common, R_TEMP, counter->queue_size, SLJIT_WORD_SHIFT));
+		EMIT_OP1(SLJIT_MOV, R_TEMP, 0, SLJIT_MEM1(R_TEMP), queue);
+		CHECK(compile_counter_slot(compiler_common, R_TEMP, counter->ring_size, SLJIT_WORD_SHIFT + 1));
+		EMIT_OP1(SLJIT_MOV, SLJIT_MEM1(R_CURR_STATE), TERM_OFFSET_OF(term, 2), SLJIT_MEM1(R_TEMP), COUNTER_OFFSET_OF(counter, COUNTER_RING + 1));
+	}
+	return REGEX_NO_ERROR;
+}
+
+/* Kills all entries of a counted term, which does not accept the current character. */
+static int compile_counter_kill(struct compiler_common *compiler_common, struct regex_counter *counter)
+{
+	struct sljit_compiler *compiler = compiler_common->compiler;
+
+	EMIT_OP2(SLJIT_ADD, SLJIT_MEM1(R_REGEX_MATCH), COUNTER_OFFSET_OF(counter, COUNTER_KILL), SLJIT_MEM1(R_REGEX_MATCH), compiler_common->counter_offset, R_CURR_INDEX, 0);
+	EMIT_OP1(SLJIT_MOV, SLJIT_MEM1(R_REGEX_MATCH), COUNTER_OFFSET_OF(counter, COUNTER_HEAD), SLJIT_MEM1(R_REGEX_MATCH), COUNTER_OFFSET_OF(counter, COUNTER_TAIL));
+	return REGEX_NO_ERROR;
+}
+
+/* When chr is not negative, only those terms are inserted, which accept chr. */
+static int compile_uncond_tran(struct compiler_common *compiler_common, int reg, sljit_sw chr)
+{
+	struct sljit_compiler *compiler = compiler_common->compiler;
+	struct stack *stack = &compiler_common->stack;
+	struct stack_item *search_states = compiler_common->search_states;
+	int flags = compiler_common->flags;
+	sljit_sw no_states = compiler_common->no_states;
+	sljit_sw head = 0;
+	sljit_sw offset, value;
+	struct regex_counter *counter;
+
+#ifndef REGEX_USE_8BIT_CHARS
+	SLJIT_UNUSED_ARG(chr);
+#endif
+
+	/* The capture groups at the start of the pattern begin at the first character. */
+	if ((flags & (REGEX_MATCH_BEGIN | REGEX_CAPTURES)) == (REGEX_MATCH_BEGIN | REGEX_CAPTURES)) {
+		EMIT_OP1(SLJIT_MOV, R_TEMP, 0, SLJIT_IMM, 0);
+	}
+
+	if (reg != R_CURR_STATE || !(compiler_common->flags & REGEX_FAKE_MATCH_BEGIN)) {
+		CHECK(trace_transitions(0, compiler_common));
+	}
+	else {
+		CHECK(trace_transitions(1, compiler_common));
+	}
+
+	while (stack->count > 0) {
+		value = stack_pop(stack)->value;
+#ifdef REGEX_USE_8BIT_CHARS
+		if (chr >= 0 && search_states[value].type >= 0 && !dfa_char_accepted(compiler_common->dfa_transitions, value, chr)) {
+			search_states[value].value = -1;
+			continue;
+		}
+#endif
+		if (search_states[value].type >= 0) {
+			offset = TERM_OFFSET_OF(search_states[value].type, 0);
+			EMIT_OP1(SLJIT_MOV, SLJIT_MEM1(reg), TERM_REL_OFFSET_OF(offset, 1), SLJIT_IMM, head);
+			if (offset > 0)
+				head = offset;
+
+			if (!(flags & REGEX_MATCH_BEGIN)) {
+				EMIT_OP1(SLJIT_MOV, SLJIT_MEM1(reg), TERM_REL_OFFSET_OF(offset, 2), R_TEMP, 0);
+				if (flags & REGEX_ID_CHECK) {
+					EMIT_OP1(SLJIT_MOV, SLJIT_MEM1(reg), TERM_REL_OFFSET_OF(offset, 3), SLJIT_IMM, search_states[value].value);
+				}
+			}
+			else if (flags & REGEX_ID_CHECK) {
+				EMIT_OP1(SLJIT_MOV, SLJIT_MEM1(reg), TERM_REL_OFFSET_OF(offset, 2), SLJIT_IMM, search_states[value].value);
+			}
+
+			if (flags & REGEX_CAPTURES) {
+				CHECK(compile_capture_tran(compiler_common, value, SLJIT_MEM1(reg), TERM_REL_OFFSET_OF(offset, CAPTURE_SLOT(compiler_common)), 0, 0, R_TEMP, 0));
+			}
+
+			counter = get_term_counter(compiler_common, search_states[value].type);
+			if (counter) {
+				/* The init function starts at the index stored by it. */
+				CHECK(compile_counter_entry(compiler_common, counter, reg == R_NEXT_STATE ? 0 : ((flags & REGEX_FAKE_MATCH_BEGIN) ? 2 : 1)));
+			}
+		}
+		search_states[value].value = -1;
+	}
+	if (reg == R_NEXT_STATE) {
+		EMIT_OP1(SLJIT_MOV, R_TEMP, 0, R_NEXT_HEAD, 0);
+	}
+	else if (flags & REGEX_FAKE_MATCH_BEGIN) {
+		SLJIT_ASSERT(compiler_common->dfa_transitions[1].type == type_newline && !compiler_common->dfa_transitions[1].value);
+		offset = TERM_OFFSET_OF(search_states[1].type, 0);
+
+		SLJIT_ASSERT(!(flags & REGEX_MATCH_BEGIN));
+
+		EMIT_OP1(SLJIT_MOV, SLJIT_MEM1(reg), TERM_REL_OFFSET_OF(offset, 1), SLJIT_IMM, head);
+		head = offset;
+
+		EMIT_OP1(SLJIT_MOV, SLJIT_MEM1(reg), TERM_REL_OFFSET_OF(offset, 2), SLJIT_IMM, 1);
+		if (flags & REGEX_ID_CHECK) {
+			EMIT_OP1(SLJIT_MOV, SLJIT_MEM1(reg), TERM_REL_OFFSET_OF(offset, 3), SLJIT_IMM, 0);
+		}
+
+		/* No capture groups are entered before the newline. */
+		for (value = CAPTURE_SLOT(compiler_common); value < no_states; value++) {
+			EMIT_OP1(SLJIT_MOV, SLJIT_MEM1(reg), TERM_REL_OFFSET_OF(offset, value), SLJIT_IMM, -1);
+		}
+	}
+	EMIT_OP1(SLJIT_MOV, R_NEXT_HEAD, 0, SLJIT_IMM, head);
+	return REGEX_NO_ERROR;
+}
+
+/* Records the first match of a pattern of a set machine. */
+static int compile_set_match(struct compiler_common *compiler_common, sljit_sw curr_index, sljit_sw id)
+{
+	struct sljit_compiler *compiler = compiler_common->compiler;
+	sljit_sw no_states = compiler_common->no_states;
+	sljit_sw offset = compiler_common->set_offset + (id / REGEX_SET_WORD_BITS) * (sljit_sw)sizeof(regex_set_word_t);
+	sljit_sw bit = (sljit_sw)(sljit_s32)((sljit_u32)1 << (id % REGEX_SET_WORD_BITS));
+	sljit_sw bounds = compiler_common->set_offset + (SET_BITSET_WORDS(compiler_common->machine->set_count) + 2 * id) * (sljit_sw)sizeof(sljit_sw);
+	struct sljit_jump *jump;
+	struct sljit_label *label;
+
+	SLJIT_ASSERT(id >= 0 && id < compiler_common->machine->set_count);
+
+	EMIT_OP2U(SLJIT_AND32 | SLJIT_SET_Z, SLJIT_MEM1(R_REGEX_MATCH), offset, SLJIT_IMM, bit);
+	EMIT_JUMP(jump, SLJIT_NOT_ZERO);
+	EMIT_OP2(SLJIT_OR32, SLJIT_MEM1(R_REGEX_MATCH), offset, SLJIT_MEM1(R_REGEX_MATCH), offset, SLJIT_IMM, bit);
+
+	if (!(compiler_common->flags & REGEX_MATCH_BEGIN)) {
+		EMIT_OP1(SLJIT_MOV, SLJIT_MEM1(R_REGEX_MATCH), bounds, SLJIT_MEM1(R_CURR_STATE), TERM_OFFSET_OF(curr_index, 2));
+	}
+	else {
+		EMIT_OP1(SLJIT_MOV, SLJIT_MEM1(R_REGEX_MATCH), bounds, SLJIT_IMM, 0);
+	}
+
+	if (!(compiler_common->flags & REGEX_FAKE_MATCH_BEGIN)) {
+		EMIT_OP1(SLJIT_MOV, SLJIT_MEM1(R_REGEX_MATCH), bounds + (sljit_sw)sizeof(sljit_sw), R_CURR_INDEX, 0);
+	}
+	else {
+		EMIT_OP2(SLJIT_SUB, SLJIT_MEM1(R_REGEX_MATCH), bounds + (sljit_sw)sizeof(sljit_sw), R_CURR_INDEX, 0, SLJIT_IMM, 1);
+	}
+
+	EMIT_LABEL(label);
+	sljit_set_label(jump, label);
+	return REGEX_NO_ERROR;
+}
+
+static int compile_cond_tran(struct compiler_common *compiler_common, sljit_sw curr_index)
+{
+	struct sljit_compiler *compiler = compiler_common->compiler;
+	struct stack *stack = &compiler_common->stack;
+	struct stack_item *search_states = compiler_common->search_states;
+	sljit_sw offset;
+	int flags;
+	sljit_sw no_states;
+	sljit_sw value;
+	struct regex_counter *counter;
+	struct sljit_jump *jump1;
+	struct sljit_jump *jump2;
+	struct sljit_jump *jump3;
+	struct sljit_jump *jump4;
+	struct sljit_jump *jump5;
+	struct sljit_label *label1;
+
+	flags = compiler_common->flags;
+	no_states = compiler_common->no_states;
+
+	EMIT_OP1(SLJIT_MOV, SLJIT_MEM1(R_REGEX_MATCH), SLJIT_OFFSETOF(struct regex_match, fast_forward), SLJIT_IMM, 0);
+	if (!(flags & (REGEX_ID_CHECK | REGEX_MATCH_BEGIN))) {
+		EMIT_OP1(SLJIT_MOV, R_TEMP, 0, SLJIT_MEM1(R_CURR_STATE), TERM_OFFSET_OF(curr_index, 2));
+	}
+
+	while (stack->count > 0) {
+		value = stack_pop(stack)->value;
+		if (search_states[value].type == 0 && (flags & REGEX_SET_MATCH)) {
+			/* The id of the pattern is increased by one, since zero means no id. */
+			CHECK(compile_set_match(compiler_common, curr_index, search_states[value].value - 1));
+		}
+		else if (search_states[value].type >= 0) {
+#ifdef REGEX_MATCH_VERBOSE
+			if (flags & REGEX_MATCH_VERBOSE)
+				printf("-> (%3d:%3d) ", search_states[value].type, search_states[value].value);
+#endif
+			offset = TERM_OFFSET_OF(search_states[value].type, 0);
+
+			if (!(flags & REGEX_ID_CHECK)) {
+				if (!(flags & REGEX_MATCH_BEGIN)) {
+					/* Check whether item is inserted. */
+					EMIT_CMP(jump1, SLJIT_NOT_EQUAL, SLJIT_MEM1(R_NEXT_STATE), offset + (sljit_sw)sizeof(sljit_sw), SLJIT_IMM, -1);
+					EMIT_OP1(SLJIT_MOV, SLJIT_MEM1(R_NEXT_STATE), offset + (sljit_sw)sizeof(sljit_sw), R_NEXT_HEAD, 0);
+					if (offset > 0) {
+						EMIT_OP1(SLJIT_MOV, R_NEXT_HEAD, 0, SLJIT_IMM, offset);
+					}
+					EMIT_JUMP(jump2, SLJIT_JUMP);
+
+					/* Check whether old index <= index. */
+					EMIT_LABEL(label1);
+					sljit_set_label(jump1, label1);
+
+					EMIT_CMP(jump1, SLJIT_LESS_EQUAL, SLJIT_MEM1(R_NEXT_STATE), offset + 2 * (sljit_sw)sizeof(sljit_sw), R_TEMP, 0);
+
+					EMIT_LABEL(label1);
+					sljit_set_label(jump2, label1);
+					EMIT_OP1(SLJIT_MOV, SLJIT_MEM1(R_NEXT_STATE), offset + 2 * (sljit_sw)sizeof(sljit_sw), R_TEMP, 0);
+					if (flags & REGEX_CAPTURES) {
+						CHECK(compile_capture_tran(compiler_common, value, SLJIT_MEM1(R_NEXT_STATE), TERM_REL_OFFSET_OF(offset, CAPTURE_SLOT(compiler_common)),
+							SLJIT_MEM1(R_CURR_STATE), TERM_OFFSET_OF(curr_index, CAPTURE_SLOT(compiler_common)), R_CURR_INDEX, (flags & REGEX_FAKE_MATCH_BEGIN) ? 1 : 0));
+					}
+
+					EMIT_LABEL(label1);
+					sljit_set_label(jump1, label1);
+				}
+				else {
+					/* Check whether item is inserted. */
+					EMIT_CMP(jump1, SLJIT_NOT_EQUAL, SLJIT_MEM1(R_NEXT_STATE), offset + (sljit_sw)sizeof(sljit_sw), SLJIT_IMM, -1);
+					EMIT_OP1(SLJIT_MOV, SLJIT_MEM1(R_NEXT_STATE), offset + (sljit_sw)sizeof(sljit_sw), R_NEXT_HEAD, 0);
+					if (offset > 0) {
+						EMIT_OP1(SLJIT_MOV, R_NEXT_HEAD, 0, SLJIT_IMM, offset);
+					}
+					if (flags & REGEX_CAPTURES) {
+						CHECK(compile_capture_tran(compiler_common, value, SLJIT_MEM1(R_NEXT_STATE), TERM_REL_OFFSET_OF(offset, CAPTURE_SLOT(compiler_common)),
+							SLJIT_MEM1(R_CURR_STATE), TERM_OFFSET_OF(curr_index, CAPTURE_SLOT(compiler_common)), R_CURR_INDEX, 0));
+					}
+					EMIT_LABEL(label1);
+					sljit_set_label(jump1, label1);
+				}
+
+				/* The entry is recorded even if the term is already inserted. */
+				counter = get_term_counter(compiler_common, search_states[value].type);
+				if (counter) {
+					CHECK(compile_counter_entry(compiler_common, counter, 0));
+				}
+			}
+			else {
+				if (!(flags & REGEX_MATCH_BEGIN)) {
+					EMIT_OP1(SLJIT_MOV, R_TEMP, 0, SLJIT_MEM1(R_CURR_STATE), TERM_OFFSET_OF(curr_index, 2));
+
+					/* Check whether item is inserted. */
+					EMIT_CMP(jump1, SLJIT_NOT_EQUAL, SLJIT_MEM1(R_NEXT_STATE), offset + (sljit_sw)sizeof(sljit_sw), SLJIT_IMM, -1);
+					EMIT_OP1(SLJIT_MOV, SLJIT_MEM1(R_NEXT_STATE), offset + (sljit_sw)sizeof(sljit_sw), R_NEXT_HEAD, 0);
+					if (offset > 0) {
+						EMIT_OP1(SLJIT_MOV, R_NEXT_HEAD, 0, SLJIT_IMM, offset);
+					}
+					EMIT_JUMP(jump2, SLJIT_JUMP);
+
+					/* Check whether old index != index. */
+					EMIT_LABEL(label1);
+					sljit_set_label(jump1, label1);
+
+					EMIT_OP2U(SLJIT_SUB | SLJIT_SET_Z | SLJIT_SET_LESS, SLJIT_MEM1(R_NEXT_STATE), offset + 2 * (sljit_sw)sizeof(sljit_sw), R_TEMP, 0);
+					EMIT_JUMP(jump1, SLJIT_LESS);
+					EMIT_JUMP(jump3, SLJIT_NOT_EQUAL); /* Greater. */
+
+					/* Old index == index. */
+					EMIT_OP1(SLJIT_MOV, R_TEMP, 0, SLJIT_MEM1(R_CURR_STATE), TERM_OFFSET_OF(curr_index, 3));
+					if (search_states[value].value > 0) {
+						EMIT_CMP(jump4, SLJIT_GREATER, R_TEMP, 0, SLJIT_IMM, search_states[value].value);
+
+						EMIT_OP1(SLJIT_MOV, R_TEMP, 0, SLJIT_IMM, search_states[value].value);
+						EMIT_LABEL(label1);
+						sljit_set_label(jump4, label1);
+					}
+
+					EMIT_OP2U(SLJIT_SUB | SLJIT_SET_GREATER_EQUAL, SLJIT_MEM1(R_NEXT_STATE), offset + 3 * (sljit_sw)sizeof(sljit_sw), R_TEMP, 0);
+					EMIT_JUMP(jump4, SLJIT_GREATER_EQUAL);
+					EMIT_JUMP(jump5, SLJIT_JUMP);
+
+					/* Overwrite index & id. */
+					EMIT_LABEL(label1);
+					sljit_set_label(jump3, label1);
+					sljit_set_label(jump2, label1);
+					EMIT_OP1(SLJIT_MOV, SLJIT_MEM1(R_NEXT_STATE), offset + 2 * (sljit_sw)sizeof(sljit_sw), R_TEMP, 0);
+
+					EMIT_OP1(SLJIT_MOV, R_TEMP, 0, SLJIT_MEM1(R_CURR_STATE), TERM_OFFSET_OF(curr_index, 3));
+					if (search_states[value].value > 0) {
+						EMIT_CMP(jump3, SLJIT_GREATER, R_TEMP, 0, SLJIT_IMM, search_states[value].value);
+
+						EMIT_OP1(SLJIT_MOV, R_TEMP, 0, SLJIT_IMM, search_states[value].value);
+						EMIT_LABEL(label1);
+						sljit_set_label(jump3, label1);
+					}
+
+					EMIT_LABEL(label1);
+					sljit_set_label(jump5, label1);
+					EMIT_OP1(SLJIT_MOV, SLJIT_MEM1(R_NEXT_STATE), offset + 3 * (sljit_sw)sizeof(sljit_sw), R_TEMP, 0);
+
+					/* Exit. */
+					EMIT_LABEL(label1);
+					sljit_set_label(jump1, label1);
+					sljit_set_label(jump4, label1);
+				}
+				else {
+					EMIT_OP1(SLJIT_MOV, R_TEMP, 0, SLJIT_MEM1(R_CURR_STATE), TERM_OFFSET_OF(curr_index, 2));
+
+					if (search_states[value].value > 0) {
+						EMIT_CMP(jump1, SLJIT_GREATER, R_TEMP, 0, SLJIT_IMM, search_states[value].value);
+
+						EMIT_OP1(SLJIT_MOV, R_TEMP, 0, SLJIT_IMM, search_states[value].value);
+						EMIT_LABEL(label1);
+						sljit_set_label(jump1, label1);
+					}
+
+					/* Check whether item is inserted. */
+					EMIT_CMP(jump1, SLJIT_NOT_EQUAL, SLJIT_MEM1(R_NEXT_STATE), offset + (sljit_sw)sizeof(sljit_sw), SLJIT_IMM, -1);
+					EMIT_OP1(SLJIT_MOV, SLJIT_MEM1(R_NEXT_STATE), offset + (sljit_sw)sizeof(sljit_sw), R_NEXT_HEAD, 0);
+					if (offset > 0) {
+						EMIT_OP1(SLJIT_MOV, R_NEXT_HEAD, 0, SLJIT_IMM, offset);
+					}
+					EMIT_JUMP(jump2, SLJIT_JUMP);
+
+					/* Check whether old id >= id. */
+					EMIT_LABEL(label1);
+					sljit_set_label(jump1, label1);
+
+					EMIT_CMP(jump1, SLJIT_GREATER_EQUAL, SLJIT_MEM1(R_NEXT_STATE), offset + 2 * (sljit_sw)sizeof(sljit_sw), R_TEMP, 0);
+
+					EMIT_LABEL(label1);
+					sljit_set_label(jump2, label1);
+					EMIT_OP1(SLJIT_MOV, SLJIT_MEM1(R_NEXT_STATE), offset + 2 * (sljit_sw)sizeof(sljit_sw), R_TEMP, 0);
+
+					EMIT_LABEL(label1);
+					sljit_set_label(jump1, label1);
+				}
+			}
+		}
+		search_states[value].value = -1;
+	}
+
+#ifdef REGEX_MATCH_VERBOSE
+	if (flags & REGEX_MATCH_VERBOSE)
+		printf("\n");
+#endif
+	return REGEX_NO_ERROR;
+}
+
+/* Copies the capture slots of the end term to the best match. The captures
+   are stored in place of the set data (set machines have no capture groups). */
+static int compile_best_captures(struct compiler_common *compiler_common)
+{
+	struct sljit_compiler *compiler = compiler_common->compiler;
+	sljit_sw slot;
+
+	for (slot = CAPTURE_SLOT(compiler_common); slot < compiler_common->no_states; slot++) {
+		EMIT_OP1(SLJIT_MOV, SLJIT_MEM1(R_REGEX_MATCH), compiler_common->set_offset + (slot - CAPTURE_SLOT(compiler_common)) * (sljit_sw)sizeof(sljit_sw),
+			SLJIT_MEM1(R_CURR_STATE), TERM_REL_OFFSET_OF(0, slot));
+	}
+	return REGEX_NO_ERROR;
+}
+
+static int compile_end_check(struct compiler_common *compiler_common, struct sljit_label *end_check_label)
+{
+	struct sljit_compiler *compiler = compiler_common->compiler;
+	struct sljit_jump *jump;
+	struct sljit_jump *clear_states_jump;
+	struct sljit_label *label;
+	struct sljit_label *leave_label;
+	struct sljit_label *begin_loop_label;
+
+	/* Priority order: best_begin > best_end > best_id.
+	   In other words:
+	       if (new best_begin > old test_begin) do nothing
+	       otherwise we know that new_end > old_end, since R_CURR_INDEX ever increasing
+	       therefore we must overwrite all best_* variables (new_id also contains the highest id for this turn). */
+
+	/* Both R_CURR_CHAR and R_BEST_BEGIN used as temporary registers. */
+
+	if (!(compiler_common->flags & REGEX_MATCH_BEGIN)) {
+		EMIT_OP1(SLJIT_MOV, R_CURR_CHAR, 0, SLJIT_MEM1(R_CURR_STATE), TERM_REL_OFFSET_OF(0, 2));
+		EMIT_CMP(jump, !(compiler_common->flags & REGEX_MATCH_NON_GREEDY) ? SLJIT_LESS : SLJIT_LESS_EQUAL, SLJIT_MEM1(R_REGEX_MATCH), SLJIT_OFFSETOF(struct regex_match, best_begin), R_CURR_CHAR, 0);
+		sljit_set_label(jump, end_check_label);
+
+		EMIT_OP1(SLJIT_MOV, SLJIT_MEM1(R_REGEX_MATCH), SLJIT_OFFSETOF(struct regex_match, best_begin), R_CURR_CHAR, 0);
+		if (!(compiler_common->flags & (REGEX_FAKE_MATCH_BEGIN | REGEX_FAKE_MATCH_END))) {
+			EMIT_OP1(SLJIT_MOV, SLJIT_MEM1(R_REGEX_MATCH), SLJIT_OFFSETOF(struct regex_match, best_end), R_CURR_INDEX, 0);
+		}
+		else {
+			if ((compiler_common->flags & (REGEX_FAKE_MATCH_BEGIN | REGEX_FAKE_MATCH_END)) == (REGEX_FAKE_MATCH_BEGIN | REGEX_FAKE_MATCH_END)) {
+				EMIT_OP2(SLJIT_SUB, SLJIT_MEM1(R_REGEX_MATCH), SLJIT_OFFSETOF(struct regex_match, best_end), R_CURR_INDEX, 0, SLJIT_IMM, 2);
+			}
+			else {
+				EMIT_OP2(SLJIT_SUB, SLJIT_MEM1(R_REGEX_MATCH), SLJIT_OFFSETOF(struct regex_match, best_end), R_CURR_INDEX, 0, SLJIT_IMM, 1);
+			}
+		}
+		if (compiler_common->flags & REGEX_ID_CHECK) {
+			EMIT_OP1(SLJIT_MOV, SLJIT_MEM1(R_REGEX_MATCH), SLJIT_OFFSETOF(struct regex_match, best_id), SLJIT_MEM1(R_CURR_STATE), TERM_REL_OFFSET_OF(0, 3));
+		}
+		if (compiler_common->flags & REGEX_CAPTURES) {
+			CHECK(compile_best_captures(compiler_common));
+		}
+
+		EMIT_CMP(clear_states_jump, SLJIT_LESS, R_CURR_CHAR, 0, R_BEST_BEGIN, 0);
+
+		EMIT_LABEL(leave_label);
+		EMIT_OP1(SLJIT_MOV, R_BEST_BEGIN, 0, R_CURR_CHAR, 0);
+		EMIT_JUMP(jump, SLJIT_JUMP);
+		sljit_set_label(jump, end_check_label);
+
+		/* A loop to clear all states, which are > (or >=) than R_CURR_CHAR. */
+		EMIT_LABEL(label);
+		sljit_set_label(clear_states_jump, label);
+
+		EMIT_OP1(SLJIT_MOV, R_TEMP, 0, R_NEXT_HEAD, 0);
+		EMIT_OP1(SLJIT_MOV, R_NEXT_HEAD, 0, SLJIT_IMM, 0);
+
+		/* Begin of the loop. */
+		EMIT_LABEL(begin_loop_label);
+		EMIT_CMP(jump, SLJIT_EQUAL, R_TEMP, 0, SLJIT_IMM, 0);
+		sljit_set_label(jump, leave_label);
+
+		EMIT_OP2(SLJIT_ADD, R_TEMP, 0, R_TEMP, 0, R_CURR_STATE, 0);
+		EMIT_OP1(SLJIT_MOV, R_BEST_BEGIN, 0, SLJIT_MEM1(R_TEMP), sizeof(sljit_sw));
+		EMIT_CMP(clear_states_jump, !(compiler_common->flags & REGEX_MATCH_NON_GREEDY) ? SLJIT_GREATER : SLJIT_GREATER_EQUAL, SLJIT_MEM1(R_TEMP), 2 * sizeof(sljit_sw), R_CURR_CHAR, 0);
+
+		/* Case 1: keep this case. */
+		EMIT_OP1(SLJIT_MOV, SLJIT_MEM1(R_TEMP), sizeof(sljit_sw), R_NEXT_HEAD, 0);
+		EMIT_OP2(SLJIT_SUB, R_NEXT_HEAD, 0, R_TEMP, 0, R_CURR_STATE, 0);
+
+		EMIT_OP1(SLJIT_MOV, R_TEMP, 0, R_BEST_BEGIN, 0);
+		EMIT_JUMP(jump, SLJIT_JUMP);
+		sljit_set_label(jump, begin_loop_label);
+
+		/* Case 2: remove this case. */
+		EMIT_LABEL(label);
+		sljit_set_label(clear_states_jump, label);
+
+		EMIT_OP1(SLJIT_MOV, SLJIT_MEM1(R_TEMP), sizeof(sljit_sw), SLJIT_IMM, -1);
+
+		EMIT_OP1(SLJIT_MOV, R_TEMP, 0, R_BEST_BEGIN, 0);
+		EMIT_JUMP(jump, SLJIT_JUMP);
+		sljit_set_label(jump, begin_loop_label);
+	}
+	else {
+		EMIT_OP1(SLJIT_MOV, R_BEST_BEGIN, 0, SLJIT_IMM, 0);
+		EMIT_OP1(SLJIT_MOV, SLJIT_MEM1(R_REGEX_MATCH), SLJIT_OFFSETOF(struct regex_match, best_begin), SLJIT_IMM, 0);
+		EMIT_OP1(SLJIT_MOV, SLJIT_MEM1(R_REGEX_MATCH), SLJIT_OFFSETOF(struct regex_match, best_end), R_CURR_INDEX, 0);
+		if (compiler_common->flags & REGEX_ID_CHECK) {
+			EMIT_OP1(SLJIT_MOV, SLJIT_MEM1(R_REGEX_MATCH), SLJIT_OFFSETOF(struct regex_match, best_id), SLJIT_MEM1(R_CURR_STATE), TERM_REL_OFFSET_OF(0, 2));
+		}
+		if (compiler_common->flags & REGEX_CAPTURES) {
+			CHECK(compile_best_captures(compiler_common));
+		}
+		EMIT_JUMP(jump, SLJIT_JUMP);
+		sljit_set_label(jump, end_check_label);
+	}
+	return REGEX_NO_ERROR;
+}
+
+static int compile_leave_fast_forward(struct compiler_common *compiler_common, struct sljit_label *fast_forward_label)
+{
+	struct sljit_compiler *compiler = compiler_common->compiler;
+	struct stack *stack = &compiler_common->stack;
+	struct stack_item *dfa_transitions = compiler_common->dfa_transitions;
+	struct stack_item *search_states = compiler_common->search_states;
+	int ind;
+	struct sljit_jump *jump;
+	int init_range = 1, prev_value = 0;
+
+	while (stack->count > 0) {
+		ind = stack_pop(stack)->value;
+		search_states[ind].value = -1;
+		if (search_states[ind].type >= 0) {
+			if (dfa_transitions[ind].type == type_char) {
+				EMIT_CMP(jump, SLJIT_EQUAL, R_CURR_CHAR, 0, SLJIT_IMM, dfa_transitions[ind].value);
+				sljit_set_label(jump, fast_forward_label);
+			}
+			else if (dfa_transitions[ind].type == type_rng_start) {
+				SLJIT_ASSERT(!dfa_transitions[ind].value);
+				ind++;
+				while (dfa_transitions[ind].type != type_rng_end) {
+					if (dfa_transitions[ind].type == type_rng_char) {
+						EMIT_CMP(jump, SLJIT_EQUAL, R_CURR_CHAR, 0, SLJIT_IMM, dfa_transitions[ind].value);
+						sljit_set_label(jump, fast_forward_label);
+					}
+					else {
+						SLJIT_ASSERT(dfa_transitions[ind].type == type_rng_left);
+						if (init_range) {
+							EMIT_OP1(SLJIT_MOV, R_TEMP, 0, R_CURR_CHAR, 0);
+							init_range = 0;
+						}
+						if (dfa_transitions[ind].value != prev_value) {
+							/* Best compatibility to all archs. */
+							prev_value -= dfa_transitions[ind].value;
+							if (prev_value < 0) {
+								EMIT_OP2(SLJIT_SUB, R_TEMP, 0, R_TEMP, 0, SLJIT_IMM, -prev_value);
+							}
+							else {
+								EMIT_OP2(SLJIT_ADD, R_TEMP, 0, R_TEMP, 0, SLJIT_IMM, prev_value);
+							}
+							prev_value = dfa_transitions[ind].value;
+						}
+						EMIT_CMP(jump, SLJIT_LESS_EQUAL, R_TEMP, 0, SLJIT_IMM, dfa_transitions[ind + 1].value - dfa_transitions[ind].value);
+						sljit_set_label(jump, fast_forward_label);
+						ind++;
+					}
+					ind++;
+				}
+			}
+			else {
+				SLJIT_ASSERT(dfa_transitions[ind].type == type_newline);
+				EMIT_CMP(jump, SLJIT_EQUAL, R_CURR_CHAR, 0, SLJIT_IMM, '\n');
+				sljit_set_label(jump, fast_forward_label);
+				EMIT_CMP(jump, SLJIT_EQUAL, R_CURR_CHAR, 0, SLJIT_IMM, '\r');
+				sljit_set_label(jump, fast_forward_label);
+			}
+		}
+	}
+	return REGEX_NO_ERROR;
+}
+
+static void add_simd_char(struct compiler_common *compiler_common, sljit_sw chr)
+{
+	int i;
+
+	if (compiler_common->simd_char_count < 0)
+		return;
+
+	for (i = 0; i < compiler_common->simd_char_count; i++)
+		if (compiler_common->simd_chars[i] == chr)
+			return;
+
+	if (compiler_common->simd_char_count >= REGEX_SIMD_MAX_CHARS) {
+		compiler_common->simd_char_count = -1;
+		return;
+	}
+	compiler_common->simd_chars[compiler_common->simd_char_count++] = chr;
+}
+
+/* Collects the characters checked by compile_leave_fast_forward,
+   when their number is small enough for the vectorized loop. */
+static int collect_simd_chars(struct compiler_common *compiler_common)
+{
+	struct stack *stack = &compiler_common->stack;
+	struct stack_item *dfa_transitions = compiler_common->dfa_transitions;
+	struct stack_item *search_states = compiler_common->search_states;
+	int ind;
+	sljit_sw chr;
+
+	compiler_common->simd_char_count = 0;
+	CHECK(trace_transitions(0, compiler_common));
+
+	while (stack->count > 0) {
+		ind = stack_pop(stack)->value;
+		search_states[ind].value = -1;
+		if (search_states[ind].type < 0)
+			continue;
+
+		if (dfa_transitions[ind].type == type_char)
+			add_simd_char(compiler_common, dfa_transitions[ind].value);
+		else if (dfa_transitions[ind].type == type_rng_start) {
+			SLJIT_ASSERT(!dfa_transitions[ind].value);
+			ind++;
+			while (dfa_transitions[ind].type != type_rng_end) {
+				if (dfa_transitions[ind].type == type_rng_char)
+					add_simd_char(compiler_common, dfa_transitions[ind].value);
+				else {
+					SLJIT_ASSERT(dfa_transitions[ind].type == type_rng_left);
+					if (dfa_transitions[ind + 1].value - dfa_transitions[ind].value >= REGEX_SIMD_MAX_CHARS)
+						compiler_common->simd_char_count = -1;
+					for (chr = dfa_transitions[ind].value; chr <= dfa_transitions[ind + 1].value && compiler_common->simd_char_count >= 0; chr++)
+						add_simd_char(compiler_common, chr);
+					ind++;
+				}
+				ind++;
+			}
+		}
+		else {
+			SLJIT_ASSERT(dfa_transitions[ind].type == type_newline);
+			add_simd_char(compiler_common, '\n');
+			add_simd_char(compiler_common, '\r');
+		}
+	}
+
+	if (compiler_common->simd_char_count < 0)
+		compiler_common->simd_char_count = 0;
+	return REGEX_NO_ERROR;
+}
+
+/* Checks whether all operations of the vectorized loop are supported.
+   Wider registers are not used, since the upper halves of the 256 bit
+   x86 registers are not cleared before returning to the caller. */
+static void select_simd_type(struct compiler_common *compiler_common)
+{
+	struct sljit_compiler *compiler = compiler_common->compiler;
+#ifdef REGEX_USE_8BIT_CHARS
+	sljit_s32 type = SLJIT_SIMD_REG_128 | SLJIT_SIMD_ELEM_8;
+#else
+	sljit_s32 type = SLJIT_SIMD_REG_128 | SLJIT_SIMD_ELEM_16;
+#endif
+
+	if (sljit_emit_simd_mov(compiler, SLJIT_SIMD_LOAD | SLJIT_SIMD_TEST | type, SLJIT_FR0, SLJIT_MEM1(R_CURR_STATE), 0) != SLJIT_SUCCESS
+			|| sljit_emit_simd_replicate(compiler, SLJIT_SIMD_TEST | type, SLJIT_FR2, SLJIT_IMM, 0) != SLJIT_SUCCESS
+			|| sljit_emit_simd_op2(compiler, SLJIT_SIMD_OP2_CMP_EQ | SLJIT_SIMD_TEST | type, SLJIT_FR1, SLJIT_FR2, SLJIT_FR0, 0) != SLJIT_SUCCESS
+			|| sljit_emit_simd_op2(compiler, SLJIT_SIMD_OP2_OR | SLJIT_SIMD_TEST | type, SLJIT_FR1, SLJIT_FR1, SLJIT_FR5, 0) != SLJIT_SUCCESS
+			|| sljit_emit_simd_sign(compiler, SLJIT_SIMD_STORE | SLJIT_SIMD_TEST | type, SLJIT_FR1, R_CURR_CHAR, 0) != SLJIT_SUCCESS) {
+		compiler_common->simd_char_count = 0;
+		return;
+	}
+
+	compiler_common->simd_type = type;
+	compiler_common->simd_lanes = 16 / (sljit_sw)sizeof(regex_char_t);
+}
+
+/* Emits the replication of the characters and the head of the fast forward loop,
+   which skips simd_lanes characters at once, when none of them can start a match. */
+static int compile_simd_fast_forward(struct compiler_common *compiler_common, struct sljit_label **loop_label)
+{
+	struct sljit_compiler *compiler = compiler_common->compiler;
+	sljit_s32 type = compiler_common->simd_type;
+	sljit_sw lanes = compiler_common->simd_lanes;
+	struct sljit_jump *short_jump;
+	struct sljit_jump *found_jump;
+	struct sljit_jump *jump;
+	struct sljit_label *label;
+	int i;
+
+	for (i = 0; i < compiler_common->simd_char_count; i++)
+		CHECK(sljit_emit_simd_replicate(compiler, type, SLJIT_FR(2 + i), SLJIT_IMM, compiler_common->simd_chars[i]));
+
+	EMIT_LABEL(label);
+	*loop_label = label;
+
+	/* R_NEXT_STATE is one more than the number of remaining characters. */
+	EMIT_CMP(short_jump, SLJIT_LESS_EQUAL, R_NEXT_STATE, 0, SLJIT_IMM, lanes);
+
+	CHECK(sljit_emit_simd_mov(compiler, SLJIT_SIMD_LOAD | type, SLJIT_FR0, SLJIT_MEM1(R_CURR_STATE), 0));
+	CHECK(sljit_emit_simd_op2(compiler, SLJIT_SIMD_OP2_CMP_EQ | type, SLJIT_FR1, SLJIT_FR2, SLJIT_FR0, 0));
+	for (i = 1; i < compiler_common->simd_char_count; i++) {
+		CHECK(sljit_emit_simd_op2(compiler, SLJIT_SIMD_OP2_CMP_EQ | type, SLJIT_FR5, SLJIT_FR(2 + i), SLJIT_FR0, 0));
+		CHECK(sljit_emit_simd_op2(compiler, SLJIT_SIMD_OP2_OR | type, SLJIT_FR1, SLJIT_FR1, SLJIT_FR5, 0));
+	}
+	CHECK(sljit_emit_simd_sign(compiler, SLJIT_SIMD_STORE | type, SLJIT_FR1, R_CURR_CHAR, 0));
+	EMIT_CMP(found_jump, SLJIT_NOT_EQUAL, R_CURR_CHAR, 0, SLJIT_IMM, 0);
+
+	EMIT_OP2(SLJIT_ADD, R_CURR_STATE, 0, R_CURR_STATE, 0, SLJIT_IMM, lanes * (sljit_sw)sizeof(regex_char_t));
+	EMIT_OP2(SLJIT_SUB, R_NEXT_STATE, 0, R_NEXT_STATE, 0, SLJIT_IMM, lanes);
+	EMIT_OP2(SLJIT_ADD, R_NEXT_HEAD, 0, R_NEXT_HEAD, 0, SLJIT_IMM, lanes);
+	EMIT_JUMP(jump, SLJIT_JUMP);
+	sljit_set_label(jump, *loop_label);
+
+	/* Skip the characters before the first candidate, which is checked by the scalar loop. */
+	EMIT_LABEL(label);
+	sljit_set_label(found_jump, label);
+	EMIT_OP1(SLJIT_CTZ, R_CURR_CHAR, 0, R_CURR_CHAR, 0);
+	EMIT_OP2(SLJIT_SUB, R_NEXT_STATE, 0, R_NEXT_STATE, 0, R_CURR_CHAR, 0);
+	EMIT_OP2(SLJIT_ADD, R_NEXT_HEAD, 0, R_NEXT_HEAD, 0, R_CURR_CHAR, 0);
+#ifndef REGEX_USE_8BIT_CHARS
+	EMIT_OP2(SLJIT_SHL, R_CURR_CHAR, 0, R_CURR_CHAR, 0, SLJIT_IMM, 1);
+#endif
+	EMIT_OP2(SLJIT_ADD, R_CURR_STATE, 0, R_CURR_STATE, 0, R_CURR_CHAR, 0);
+
+	EMIT_LABEL(label);
+	sljit_set_label(short_jump, label);
+	return REGEX_NO_ERROR;
+}
+
+#ifdef REGEX_USE_8BIT_CHARS
+
+/* Upper limit of the term insertions generated for the start dispatch. */
+#define REGEX_START_DISPATCH_MAX_INSERTS	65536
+
+/* Groups the characters by the start terms accepting them. The start
+   dispatch is not used when the generated code would be too large. */
+static int group_start_chars(struct compiler_common *compiler_common)
+{
+	struct stack *stack = &compiler_common->stack;
+	struct stack_item *search_states = compiler_common->search_states;
+	sljit_s16 *start_groups = compiler_common->start_groups;
+	sljit_sw *starts;
+	sljit_uw *sets;
+	sljit_uw *set;
+	sljit_sw count = 0, set_size, inserts = 0;
+	sljit_sw chr, prev, ind;
+
+	compiler_common->start_dispatch = 0;
+	starts = (sljit_sw*)SLJIT_MALLOC(sizeof(sljit_sw) * (sljit_uw)compiler_common->terms_size, NULL);
+	CHECK(!starts);
+
+	if (trace_transitions(0, compiler_common)) {
+		SLJIT_FREE(starts, NULL);
+		return REGEX_MEMORY_ERROR;
+	}
+
+	while (stack->count > 0) {
+		ind = stack_pop(stack)->value;
+		search_states[ind].value = -1;
+		if (search_states[ind].type > 0)
+			starts[count++] = ind;
+	}
+
+	set_size = (count + REGEX_DFA_WORD_BITS - 1) / REGEX_DFA_WORD_BITS;
+	sets = (sljit_uw*)SLJIT_MALLOC(sizeof(sljit_uw) * (sljit_uw)(256 * set_size + 1), NULL);
+	if (!sets) {
+		SLJIT_FREE(starts, NULL);
+		return REGEX_MEMORY_ERROR;
+	}
+
+	for (chr = 0; chr < 256; chr++) {
+		set = sets + chr * set_size;
+		for (ind = 0; ind < set_size; ind++)
+			set[ind] = 0;
+
+		for (ind = 0; ind < count; ind++)
+			if (dfa_char_accepted(compiler_common->dfa_transitions, starts[ind], chr))
+				set[ind / REGEX_DFA_WORD_BITS] |= (sljit_uw)1 << (ind % REGEX_DFA_WORD_BITS);
+
+		start_groups[chr] = (sljit_s16)chr;
+		for (prev = 0; prev < chr; prev++) {
+			if (start_groups[prev] != prev)
+				continue;
+
+			for (ind = 0; ind < set_size; ind++)
+				if (sets[prev * set_size + ind] != set[ind])
+					break;
+
+			if (ind == set_size) {
+				start_groups[chr] = (sljit_s16)prev;
+				break;
+			}
+		}
+
+		if (start_groups[chr] == chr)
+			for (ind = 0; ind < count; ind++)
+				inserts += (sljit_sw)((set[ind / REGEX_DFA_WORD_BITS] >> (ind % REGEX_DFA_WORD_BITS)) & 0x1);
+	}
+
+	SLJIT_FREE(sets, NULL);
+	SLJIT_FREE(starts, NULL);
+
+	compiler_common->start_dispatch = inserts <= REGEX_START_DISPATCH_MAX_INSERTS;
+	return REGEX_NO_ERROR;
+}
+
+/* Emits the insertion of the start terms, which accept the next character.
+   The no_next_char jump is taken when the character is in the next fragment. */
+static int compile_start_dispatch(struct compiler_common *compiler_common, struct sljit_jump **no_next_char)
+{
+	struct sljit_compiler *compiler = compiler_common->compiler;
+	struct sljit_label *label;
+	sljit_sw chr;
+
+	EMIT_CMP(*no_next_char, SLJIT_EQUAL, R_LENGTH, 0, SLJIT_IMM, 1);
+
+	/* R_BEST_BEGIN is always -1 in set machines, so it is used as a temporary register. */
+	EMIT_OP1(SLJIT_MOV, R_TEMP, 0, SLJIT_MEM1(R_REGEX_MATCH), SLJIT_OFFSETOF(struct regex_match, machine));
+	EMIT_OP1(SLJIT_MOV, R_TEMP, 0, SLJIT_MEM1(R_TEMP), SLJIT_OFFSETOF(struct regex_machine, start_dispatch));
+	EMIT_OP1(SLJIT_MOV_U8, R_BEST_BEGIN, 0, SLJIT_MEM1(R_STRING), 0);
+	CHECK(sljit_emit_ijump(compiler, SLJIT_JUMP, SLJIT_MEM2(R_TEMP, R_BEST_BEGIN), SLJIT_WORD_SHIFT));
+
+	for (chr = 0; chr < 256; chr++) {
+		if (compiler_common->start_groups[chr] != chr)
+			continue;
+
+		EMIT_LABEL(label);
+		sljit_emit_op0(compiler, SLJIT_ENDBR);
+		compiler_common->machine->start_dispatch[chr] = (sljit_uw)label;
+
+		EMIT_OP1(SLJIT_MOV, R_BEST_BEGIN, 0, SLJIT_IMM, -1);
+		EMIT_OP1(SLJIT_MOV, R_TEMP, 0, R_CURR_INDEX, 0);
+		CHECK(compile_uncond_tran(compiler_common, R_NEXT_STATE, chr));
+		CHECK(sljit_emit_ijump(compiler, SLJIT_JUMP, SLJIT_MEM2(R_CURR_STATE, R_TEMP), 0));
+	}
+	return REGEX_NO_ERROR;
+}
+
+#endif /* REGEX_USE_8BIT_CHARS */
+
+static int compile_newline_check(struct compiler_common *compiler_common, sljit_sw ind)
+{
+	struct sljit_compiler *compiler = compiler_common->compiler;
+	struct sljit_jump *jump1;
+	struct sljit_jump *jump2;
+	struct sljit_label *label;
+	sljit_sw no_states;
+	sljit_sw offset;
+
+	/* Check whether a new-line character is found. */
+	EMIT_CMP(jump1, SLJIT_EQUAL, R_CURR_CHAR, 0, SLJIT_IMM, '\n');
+	EMIT_CMP(jump2, SLJIT_EQUAL, R_CURR_CHAR, 0, SLJIT_IMM, '\r');
+
+	no_states = compiler_common->no_states;
+	offset = TERM_OFFSET_OF(compiler_common->search_states[ind].type, 1);
+	EMIT_OP1(SLJIT_MOV, R_TEMP, 0, SLJIT_MEM1(R_CURR_STATE), offset);
+	EMIT_OP1(SLJIT_MOV, SLJIT_MEM1(R_CURR_STATE), offset, SLJIT_IMM, -1);
+	CHECK(sljit_emit_ijump(compiler, SLJIT_JUMP, SLJIT_MEM2(R_CURR_STATE, R_TEMP), 0));
+
+	EMIT_LABEL(label);
+	sljit_set_label(jump1, label);
+	sljit_set_label(jump2, label);
+	return REGEX_NO_ERROR;
+}
+
+#undef CHECK
+
+#define CHECK(exp) \
+	if (SLJIT_UNLIKELY(exp)) \
+		return 0
+
+static SLJIT_INLINE void range_set_label(struct sljit_jump **range_jump_list, struct sljit_label *label)
+{
+	while (*range_jump_list) {
+		sljit_set_label(*range_jump_list, label);
+		range_jump_list++;
+	}
+}
+
+#ifdef REGEX_USE_8BIT_CHARS
+
+/* Ranges with at least this many compares are checked by a bitmap lookup. */
+#define REGEX_RANGE_BITMAP_MIN_CHECKS	4
+/* Size of a bitmap, which has a bit for each character. */
+#define REGEX_RANGE_BITMAP_WORDS	(256 / 32)
+
+static sljit_sw range_check_count(struct stack_item *dfa_transitions, sljit_sw ind)
+{
+	sljit_sw count = 0;
+
+	SLJIT_ASSERT(dfa_transitions[ind].type == type_rng_start);
+	ind++;
+
+	while (dfa_transitions[ind].type != type_rng_end) {
+		if (dfa_transitions[ind].type == type_rng_left)
+			ind++;
+		count++;
+		ind++;
+	}
+	return count;
+}
+
+static sljit_sw range_bitmap_count(struct compiler_common *compiler_common)
+{
+	struct stack_item *dfa_transitions = compiler_common->dfa_transitions;
+	struct stack_item *search_states = compiler_common->search_states;
+	sljit_sw ind, count = 0;
+
+	for (ind = 1; ind < (sljit_sw)compiler_common->dfa_size - 1; ind++)
+		if (search_states[ind].type >= 0 && dfa_transitions[ind].type == type_rng_start
+				&& range_check_count(dfa_transitions, ind) >= REGEX_RANGE_BITMAP_MIN_CHECKS)
+			count++;
+	return count;
+}
+
+#endif /* REGEX_USE_8BIT_CHARS */
+
+/* The entries of the counter are killed when the character is not accepted (counter can be NULL). */
+static sljit_sw compile_range_check(struct compiler_common *compiler_common, sljit_sw ind, struct regex_counter *counter)
+{
+	struct sljit_compiler *compiler = compiler_common->compiler;
+	struct stack_item *dfa_transitions = compiler_common->dfa_transitions;
+	struct sljit_jump **range_jump_list = compiler_common->range_jump_list;
+	int invert = dfa_transitions[ind].value;
+	struct sljit_label *label;
+	sljit_sw no_states;
+	sljit_sw offset;
+	int init_range = 1, prev_value = 0;
+#ifdef REGEX_USE_8BIT_CHARS
+	sljit_u32 *bitmap;
+	sljit_sw chr;
+
+	if (compiler_common->range_bitmaps && range_check_count(dfa_transitions, ind) >= REGEX_RANGE_BITMAP_MIN_CHECKS) {
+		bitmap = compiler_common->range_bitmaps;
+		compiler_common->range_bitmaps += REGEX_RANGE_BITMAP_WORDS;
+
+		for (chr = 0; chr < REGEX_RANGE_BITMAP_WORDS; chr++)
+			bitmap[chr] = 0;
+		for (chr = 0; chr < 256; chr++)
+			if (dfa_char_accepted(dfa_transitions, ind, chr) != invert)
+				bitmap[chr >> 5] |= (sljit_u32)1 << (chr & 0x1f);
+
+		/* The address is a constant, so it can be updated when a serialized machine is
+		   loaded. Loads the 32 bit word containing the bit of the character. The shift
+		   amount of SLJIT_MLSHR32 is masked, so R_CURR_CHAR can be used directly. */
+		CHECK(!sljit_emit_const(compiler, R_RANGE_BITMAP, 0, (sljit_sw)bitmap));
+		EMIT_OP2(SLJIT_LSHR, R_TEMP, 0, R_CURR_CHAR, 0, SLJIT_IMM, 3);
+		EMIT_OP2(SLJIT_AND, R_TEMP, 0, R_TEMP, 0, SLJIT_IMM, ~(sljit_sw)(sizeof(sljit_u32) - 1));
+		EMIT_OP1(SLJIT_MOV_U32, R_TEMP, 0, SLJIT_MEM2(R_RANGE_BITMAP, R_TEMP), 0);
+		EMIT_OP2(SLJIT_MLSHR32, R_TEMP, 0, R_TEMP, 0, R_CURR_CHAR, 0);
+		EMIT_OP2U(SLJIT_AND32 | SLJIT_SET_Z, R_TEMP, 0, SLJIT_IMM, 1);
+		*range_jump_list = sljit_emit_jump(compiler, SLJIT_NOT_ZERO);
+		CHECK(!*range_jump_list);
+		range_jump_list++;
+
+		/* Skip the items: the next ind++ moves to type_rng_end. */
+		while (dfa_transitions[ind + 1].type != type_rng_end)
+			ind++;
+	}
+#endif
 
 	ind++;
 
-	while (dfa_transitions[ind].type != type_rng_end) {
-		if (dfa_transitions[ind].type == type_rng_char) {
-			EMIT_CMP(*range_jump_list, SLJIT_EQUAL, R_CURR_CHAR, 0, SLJIT_IMM, dfa_transitions[ind].value);
-			range_jump_list++;
+	while (dfa_transitions[ind].type != type_rng_end) {
+		if (dfa_transitions[ind].type == type_rng_char) {
+			EMIT_CMP(*range_jump_list, SLJIT_EQUAL, R_CURR_CHAR, 0, SLJIT_IMM, dfa_transitions[ind].value);
+			range_jump_list++;
+		}
+		else {
+			SLJIT_ASSERT(dfa_transitions[ind].type == type_rng_left);
+			if (init_range) {
+				EMIT_OP1(SLJIT_MOV, R_TEMP, 0, R_CURR_CHAR, 0);
+				init_range = 0;
+			}
+			if (dfa_transitions[ind].value != prev_value) {
+				/* Best compatibility to all archs. */
+				prev_value -= dfa_transitions[ind].value;
+				if (prev_value < 0) {
+					EMIT_OP2(SLJIT_SUB, R_TEMP, 0, R_TEMP, 0, SLJIT_IMM, -prev_value);
+				}
+				else {
+					EMIT_OP2(SLJIT_ADD, R_TEMP, 0, R_TEMP, 0, SLJIT_IMM, prev_value);
+				}
+				prev_value = dfa_transitions[ind].value;
+			}
+			EMIT_CMP(*range_jump_list, SLJIT_LESS_EQUAL, R_TEMP, 0, SLJIT_IMM, dfa_transitions[ind + 1].value - dfa_transitions[ind].value);
+			range_jump_list++;
+			ind++;
+		}
+		ind++;
+	}
+
+	*range_jump_list = NULL;
+
+	if (!invert) {
+		no_states = compiler_common->no_states;
+		offset = TERM_OFFSET_OF(compiler_common->search_states[ind].type, 1);
+		if (counter) {
+			CHECK(compile_counter_kill(compiler_common, counter));
+		}
+		EMIT_OP1(SLJIT_MOV, R_TEMP, 0, SLJIT_MEM1(R_CURR_STATE), offset);
+		EMIT_OP1(SLJIT_MOV, SLJIT_MEM1(R_CURR_STATE), offset, SLJIT_IMM, -1);
+		CHECK(sljit_emit_ijump(compiler, SLJIT_JUMP, SLJIT_MEM2(R_CURR_STATE, R_TEMP), 0));
+
+		EMIT_LABEL(label);
+		range_set_label(compiler_common->range_jump_list, label);
+		/* Clears the jump list. */
+		*compiler_common->range_jump_list = NULL;
+	}
+	return ind;
+}
+
+#undef TERM_OFFSET_OF
+#undef EMIT_OP1
+#undef EMIT_OP2
+#undef EMIT_LABEL
+#undef EMIT_JUMP
+#undef EMIT_CMP
+#undef CHECK
+
+/* --------------------------------------------------------------------- */
+/*  Serialization                                                        */
+/* --------------------------------------------------------------------- */
+
+#define REGEX_SERIALIZE_SIGNATURE	0x5247584d
+#define REGEX_SERIALIZE_VERSION		3
+
+#define SERIALIZE_TYPE_SIZES \
+	((sljit_u32)((sizeof(regex_char_t) << 8) | sizeof(sljit_sw)))
+
+/* The serialized machine starts with this header, followed by the label
+   indices of the entry addresses (terms_size words) and of the start
+   dispatch (256 words, if present), the range bitmaps, the lazy DFA
+   tables, and the serialized sljit compiler (compiler_size bytes). */
+struct regex_serialized_header
+{
+	sljit_u32 signature;
+	sljit_u32 version;
+	/* The generated code depends on the CPU profile. */
+	sljit_u32 cpu_features;
+	sljit_u32 type_sizes;
+	sljit_sw flags;
+	sljit_sw no_states;
+	sljit_sw terms_size;
+	sljit_sw set_count;
+	sljit_sw capture_count;
+	sljit_sw counter_words;
+	sljit_sw counter_gap;
+	/* Label index of the init function. */
+	sljit_sw init_label;
+	sljit_sw range_bitmap_count;
+	/* Zero if the lazy DFA is not used. */
+	sljit_sw dfa_set_size;
+	sljit_sw dfa_restart_count;
+	sljit_sw start_dispatch;
+	sljit_uw compiler_size;
+};
+
+/* Size of the data between the header and the serialized compiler. */
+static sljit_uw serialized_data_size(struct regex_serialized_header *header)
+{
+	sljit_uw size = (sljit_uw)header->terms_size * sizeof(sljit_uw);
+
+	if (header->start_dispatch)
+		size += 256 * sizeof(sljit_uw);
+	size += (sljit_uw)header->range_bitmap_count * REGEX_RANGE_BITMAP_WORDS * sizeof(sljit_u32);
+	if (header->dfa_set_size > 0)
+		size += DFA_TABLES_SIZE(header->terms_size, header->dfa_set_size);
+	/* Keep the compiler data word aligned. */
+	return (size + sizeof(sljit_uw) - 1) & ~(sizeof(sljit_uw) - 1);
+}
+
+/* Must be called before sljit_generate_code, since the labels are
+   replaced by their addresses afterwards. */
+static int serialize_machine(struct compiler_common *compiler_common, struct sljit_label *init_label)
+{
+	struct regex_machine *machine = compiler_common->machine;
+	struct regex_serialized_header header;
+	struct sljit_cpu_profile profile;
+	sljit_uw *compiler_buffer;
+	sljit_uw *ptr;
+	sljit_u8 *data;
+	sljit_sw ind;
+	sljit_uw size;
+
+	compiler_buffer = sljit_serialize_compiler(compiler_common->compiler, 0, &header.compiler_size);
+	if (!compiler_buffer)
+		return REGEX_MEMORY_ERROR;
+
+	sljit_get_cpu_profile(&profile);
+	header.signature = REGEX_SERIALIZE_SIGNATURE;
+	header.version = REGEX_SERIALIZE_VERSION;
+	header.cpu_features = profile.features;
+	header.type_sizes = SERIALIZE_TYPE_SIZES;
+	header.flags = machine->flags;
+	header.no_states = machine->no_states;
+	header.terms_size = compiler_common->terms_size;
+	header.set_count = machine->set_count;
+	header.capture_count = machine->capture_count;
+	header.counter_words = machine->counter_words;
+	header.counter_gap = machine->counter_gap;
+	header.init_label = (sljit_sw)sljit_get_label_index(init_label);
+	header.range_bitmap_count = machine->range_bitmap_count;
+	header.dfa_set_size = machine->dfa ? machine->dfa->set_size : 0;
+	header.dfa_restart_count = machine->dfa ? machine->dfa->restart_count : 0;
+	header.start_dispatch = machine->start_dispatch != NULL;
+
+	size = sizeof(struct regex_serialized_header) + serialized_data_size(&header) + header.compiler_size;
+	machine->serialized = (sljit_uw*)SLJIT_MALLOC(size, NULL);
+	if (!machine->serialized) {
+		SLJIT_FREE(compiler_buffer, NULL);
+		return REGEX_MEMORY_ERROR;
+	}
+	machine->serialized_size = size;
+	SLJIT_MEMCPY(machine->serialized, &header, sizeof(struct regex_serialized_header));
+
+	ptr = (sljit_uw*)((struct regex_serialized_header*)machine->serialized + 1);
+	for (ind = 0; ind < compiler_common->terms_size; ind++)
+		*ptr++ = sljit_get_label_index((struct sljit_label*)machine->entry_addrs[ind]);
+
+#ifdef REGEX_USE_8BIT_CHARS
+	if (machine->start_dispatch) {
+		/* Only the first character of each group has a label. */
+		for (ind = 0; ind < 256; ind++)
+			*ptr++ = sljit_get_label_index((struct sljit_label*)machine->start_dispatch[compiler_common->start_groups[ind]]);
+	}
+#endif
+
+	data = (sljit_u8*)ptr;
+	size = (sljit_uw)machine->range_bitmap_count * REGEX_RANGE_BITMAP_WORDS * sizeof(sljit_u32);
+	if (size > 0) {
+		SLJIT_MEMCPY(data, machine->range_bitmaps, size);
+		data += size;
+	}
+
+	if (machine->dfa)
+		SLJIT_MEMCPY(data, machine->dfa + 1, DFA_TABLES_SIZE(header.terms_size, header.dfa_set_size));
+
+	data = (sljit_u8*)((struct regex_serialized_header*)machine->serialized + 1) + serialized_data_size(&header);
+	SLJIT_MEMCPY(data, compiler_buffer, header.compiler_size);
+	SLJIT_FREE(compiler_buffer, NULL);
+	return REGEX_NO_ERROR;
+}
+
+/* --------------------------------------------------------------------- */
+/*  Main compiler                                                        */
+/* --------------------------------------------------------------------- */
+
+#define TERM_OFFSET_OF(ind, offs) (((ind) * compiler_common.no_states + (offs)) * (sljit_sw)sizeof(sljit_sw))
+
+#define EMIT_OP1(type, arg1, arg2, arg3, arg4) \
+	CHECK(sljit_emit_op1(compiler_common.compiler, type, arg1, arg2, arg3, arg4))
+
+#define EMIT_OP2(type, arg1, arg2, arg3, arg4, arg5, arg6) \
+	CHECK(sljit_emit_op2(compiler_common.compiler, type, arg1, arg2, arg3, arg4, arg5, arg6))
+
+#define EMIT_LABEL(label) \
+	label = sljit_emit_label(compiler_common.compiler); \
+	CHECK(!label)
+
+#define EMIT_JUMP(jump, type) \
+	jump = sljit_emit_jump(compiler_common.compiler, type); \
+	CHECK(!jump)
+
+#define EMIT_CMP(jump, type, arg1, arg2, arg3, arg4) \
+	jump = sljit_emit_cmp(compiler_common.compiler, type, arg1, arg2, arg3, arg4); \
+	CHECK(!jump)
+
+/* A do {} while(0) expression helps to avoid goto statements. */
+#define BEGIN_GUARD \
+	do {
+
+#define END_GUARD \
+	} while(0);
+
+#define CHECK(exp) \
+	if (SLJIT_UNLIKELY(exp)) \
+		break;
+
+/* Allocates the data of the counted repetitions after the other data of regex_match. */
+static int setup_counters(struct compiler_common *compiler_common)
+{
+	struct stack_item *dfa_transitions = compiler_common->dfa_transitions;
+	struct stack_item *params;
+	struct regex_counter *counter;
+	sljit_sw offset = compiler_common->counter_offset + (sljit_sw)sizeof(sljit_sw);
+	sljit_sw gap = 0;
+	sljit_sw ind;
+
+	ind = (sljit_sw)compiler_common->counters.count;
+	params = (struct stack_item*)SLJIT_MALLOC(sizeof(struct stack_item) * (sljit_uw)ind, NULL);
+	if (!params)
+		return REGEX_MEMORY_ERROR;
+	while (ind > 0)
+		params[--ind] = *stack_pop(&compiler_common->counters);
+
+	compiler_common->counter_list = (struct regex_counter*)SLJIT_MALLOC(sizeof(struct regex_counter) * (sljit_uw)compiler_common->counter_count, NULL);
+	compiler_common->term_counters = (sljit_sw*)SLJIT_MALLOC(sizeof(sljit_sw) * (sljit_uw)compiler_common->terms_size, NULL);
+	if (!compiler_common->counter_list || !compiler_common->term_counters) {
+		SLJIT_FREE(params, NULL);
+		return REGEX_MEMORY_ERROR;
+	}
+
+	for (ind = 0; ind < compiler_common->terms_size; ind++)
+		compiler_common->term_counters[ind] = -1;
+
+	/* The copies of a counted repetition have their own counters. */
+	counter = compiler_common->counter_list;
+	for (ind = 0; ind < (sljit_sw)compiler_common->dfa_size; ind++) {
+		if (dfa_transitions[ind].type != type_counter)
+			continue;
+
+		counter->min = params[dfa_transitions[ind].value].type;
+		counter->max = params[dfa_transitions[ind].value].value;
+		/* An entry is needed until it is repeated max times, and the
+		   queue contains the entries repeated between min and max times. */
+		counter->ring_size = 1;
+		while (counter->ring_size <= counter->max)
+			counter->ring_size <<= 1;
+		counter->queue_size = 1;
+		while (counter->queue_size <= counter->max - counter->min)
+			counter->queue_size <<= 1;
+		counter->offset = offset;
+		offset += (COUNTER_RING + 2 * counter->ring_size + counter->queue_size) * (sljit_sw)sizeof(sljit_sw);
+		if (gap < counter->max + 2)
+			gap = counter->max + 2;
+
+		SLJIT_ASSERT(compiler_common->search_states[ind - 1].type > 0);
+		compiler_common->term_counters[compiler_common->search_states[ind - 1].type] = (sljit_sw)(counter - compiler_common->counter_list);
+		counter++;
+	}
+
+	SLJIT_FREE(params, NULL);
+	compiler_common->machine->counter_words = (offset - compiler_common->counter_offset) / (sljit_sw)sizeof(sljit_sw);
+	compiler_common->machine->counter_gap = gap;
+	return REGEX_NO_ERROR;
+}
+
+/* Steps 1-3 of the compilation. The counters stack is kept on success. */
+static int build_transitions(const regex_char_t *regex_string, int length, struct compiler_common *compiler_common)
+{
+	int error_code;
+
+	/* Step 1: parsing (Left->Right).
+	   Syntax check and AST generator. */
+	error_code = parse(regex_string, length, compiler_common);
+	if (error_code) {
+		stack_destroy(&compiler_common->stack);
+		stack_destroy(&compiler_common->depth);
+		stack_destroy(&compiler_common->counters);
+		return error_code;
+	}
+
+	/* Step 2: generating branches (Right->Left). */
+	error_code = generate_transitions(compiler_common);
+	stack_destroy(&compiler_common->stack);
+	stack_destroy(&compiler_common->depth);
+	if (error_code) {
+		if (compiler_common->dfa_transitions)
+			SLJIT_FREE(compiler_common->dfa_transitions, NULL);
+		stack_destroy(&compiler_common->counters);
+		return error_code;
+	}
+
+	/* Step 3: Generate necessary data for depth-first search (Left->Right). */
+	error_code = generate_search_states(compiler_common);
+	if (error_code) {
+		SLJIT_FREE(compiler_common->dfa_transitions, NULL);
+		stack_destroy(&compiler_common->counters);
+	}
+	return error_code;
+}
+
+static struct regex_machine* compile_machine(const regex_char_t *regex_string, int length, int re_flags, sljit_sw set_count, int *error)
+{
+	struct compiler_common compiler_common;
+	sljit_sw ind;
+	int flags, error_code, done, suggest_fast_forward;
+	/* ID of an empty match (-1 if not reachable). */
+	int empty_match_id;
+
+	struct sljit_jump *jump;
+	struct sljit_jump *best_match_found_jump;
+	struct sljit_jump *fast_forward_jump = NULL;
+	struct sljit_jump *length_is_zero_jump;
+	struct sljit_jump *end_check_jump = NULL;
+	struct sljit_jump *best_match_check_jump = NULL;
+	struct sljit_jump *non_greedy_end_jump = NULL;
+	struct sljit_label *label;
+	struct sljit_label *end_check_label = NULL;
+	struct sljit_label *start_label;
+	struct sljit_label *fast_forward_label;
+	struct sljit_label *fast_forward_return_label;
+	struct sljit_jump *no_exit_jump;
+	struct regex_counter *counter;
+	struct regex_counter *kill_counter;
+#ifdef REGEX_USE_8BIT_CHARS
+	struct sljit_jump *no_next_char_jump;
+#endif
+
+	if (error)
+		*error = REGEX_NO_ERROR;
+#ifdef REGEX_MATCH_VERBOSE
+	compiler_common.flags = re_flags & (REGEX_MATCH_BEGIN | REGEX_MATCH_END | REGEX_MATCH_NON_GREEDY | REGEX_NEWLINE | REGEX_LAZY_DFA | REGEX_UTF8 | REGEX_SERIALIZABLE | REGEX_CAPTURES | REGEX_MATCH_VERBOSE);
+#else
+	compiler_common.flags = re_flags & (REGEX_MATCH_BEGIN | REGEX_MATCH_END | REGEX_MATCH_NON_GREEDY | REGEX_NEWLINE | REGEX_LAZY_DFA | REGEX_UTF8 | REGEX_SERIALIZABLE | REGEX_CAPTURES);
+#endif
+	if (set_count > 0)
+		compiler_common.flags = (compiler_common.flags & ~(REGEX_LAZY_DFA | REGEX_CAPTURES)) | REGEX_SET_MATCH;
+	/* The DFA states do not track the capture slots. */
+	if (compiler_common.flags & REGEX_CAPTURES)
+		compiler_common.flags &= ~REGEX_LAZY_DFA;
+	/* The counters do not track the capture slots. */
+	if (compiler_common.flags & REGEX_CAPTURES)
+		compiler_common.flags |= REGEX_NO_COUNTERS;
+	compiler_common.trace_parents = NULL;
+	compiler_common.capture_marks = NULL;
+	compiler_common.counter_list = NULL;
+	compiler_common.term_counters = NULL;
+
+	flags = compiler_common.flags;
+	error_code = build_transitions(regex_string, length, &compiler_common);
+
+	/* The terms of a set machine belong to one pattern, whose id is known
+	   when the code of the transitions to the end term is generated. */
+	if (compiler_common.flags & REGEX_SET_MATCH)
+		compiler_common.flags &= ~REGEX_ID_CHECK;
+
+	/* Only the smallest begin of the entries is kept by a counter, which is not enough for the ids. */
+	if (!error_code && (compiler_common.flags & REGEX_ID_CHECK) && compiler_common.counter_count > 0) {
+		SLJIT_FREE(compiler_common.dfa_transitions, NULL);
+		SLJIT_FREE(compiler_common.search_states, NULL);
+		stack_destroy(&compiler_common.counters);
+		compiler_common.flags = flags | REGEX_NO_COUNTERS;
+		error_code = build_transitions(regex_string, length, &compiler_common);
+	}
+
+	if (error_code) {
+		if (error)
+			*error = error_code;
+		return NULL;
+	}
+
+	/* Only one path is tracked for each term, which is not enough for the ids. */
+	if ((compiler_common.flags & (REGEX_CAPTURES | REGEX_ID_CHECK)) == (REGEX_CAPTURES | REGEX_ID_CHECK)) {
+		SLJIT_FREE(compiler_common.dfa_transitions, NULL);
+		SLJIT_FREE(compiler_common.search_states, NULL);
+		stack_destroy(&compiler_common.counters);
+		if (error)
+			*error = REGEX_INVALID_REGEX;
+		return NULL;
+	}
+	if (compiler_common.capture_count == 0)
+		compiler_common.flags &= ~REGEX_CAPTURES;
+	/* The DFA states do not track the counters. */
+	if (compiler_common.counter_count > 0)
+		compiler_common.flags &= ~REGEX_LAZY_DFA;
+
+#ifdef REGEX_MATCH_VERBOSE
+	if (compiler_common.flags & REGEX_MATCH_VERBOSE)
+		verbose_transitions(&compiler_common);
+#endif
+
+	/* Step 4: Left->Right generate code. */
+	stack_init(&compiler_common.stack);
+	stack_init(&compiler_common.depth);
+	done = 0;
+	error_code = REGEX_MEMORY_ERROR;
+	compiler_common.machine = NULL;
+	compiler_common.compiler = NULL;
+	compiler_common.range_jump_list = NULL;
+
+	BEGIN_GUARD
+
+	compiler_common.machine = (struct regex_machine*)SLJIT_MALLOC(sizeof(struct regex_machine) + (sljit_uw)(compiler_common.terms_size - 1) * sizeof(sljit_uw), NULL);
+	CHECK(!compiler_common.machine);
+	compiler_common.machine->dfa = NULL;
+	compiler_common.machine->set_count = set_count;
+	compiler_common.machine->start_dispatch = NULL;
+	compiler_common.machine->range_bitmaps = NULL;
+	compiler_common.machine->range_bitmap_count = 0;
+	compiler_common.machine->serialized = NULL;
+	compiler_common.machine->capture_count = compiler_common.capture_count;
+
+	compiler_common.compiler = sljit_create_compiler(NULL);
+	CHECK(!compiler_common.compiler);
+
+	if (compiler_common.flags & REGEX_CAPTURES) {
+		compiler_common.trace_parents = (sljit_sw*)SLJIT_MALLOC(sizeof(sljit_sw) * (sljit_uw)compiler_common.dfa_size, NULL);
+		CHECK(!compiler_common.trace_parents);
+		compiler_common.capture_marks = (sljit_u8*)SLJIT_MALLOC((sljit_uw)(2 * compiler_common.capture_count), NULL);
+		CHECK(!compiler_common.capture_marks);
+	}
+
+	if (compiler_common.longest_range_size > 0) {
+		compiler_common.range_jump_list = (struct sljit_jump**)SLJIT_MALLOC(sizeof(struct sljit_jump*) * (sljit_uw)compiler_common.longest_range_size, NULL);
+		CHECK(!compiler_common.range_jump_list);
+	}
+
+	if ((compiler_common.flags & REGEX_ID_CHECK) && !(compiler_common.flags & REGEX_MATCH_BEGIN))
+		compiler_common.no_states = 4;
+	else if (!(compiler_common.flags & REGEX_ID_CHECK) && (compiler_common.flags & REGEX_MATCH_BEGIN))
+		compiler_common.no_states = 2;
+	else
+		compiler_common.no_states = 3;
+	if (compiler_common.flags & REGEX_CAPTURES)
+		compiler_common.no_states += 2 * compiler_common.capture_count;
+
+	compiler_common.machine->flags = compiler_common.flags;
+	compiler_common.machine->no_states = compiler_common.no_states;
+	compiler_common.machine->size = compiler_common.machine->no_states * compiler_common.terms_size;
+	compiler_common.set_offset = (sljit_sw)SLJIT_OFFSETOF(struct regex_match, states) + 2 * compiler_common.machine->size * (sljit_sw)sizeof(sljit_sw);
+	compiler_common.counter_offset = compiler_common.set_offset + (SET_DATA_WORDS(set_count) + CAPTURE_DATA_WORDS(compiler_common.capture_count)) * (sljit_sw)sizeof(sljit_sw);
+	compiler_common.machine->counter_words = 0;
+	compiler_common.machine->counter_gap = 0;
+	if (compiler_common.counter_count > 0) {
+		CHECK(setup_counters(&compiler_common));
+	}
+
+	/* Study the regular expression. */
+	empty_match_id = -1;
+	suggest_fast_forward = 1;
+	if (!(compiler_common.flags & REGEX_FAKE_MATCH_BEGIN)) {
+		CHECK(trace_transitions(0, &compiler_common));
+		while (compiler_common.stack.count > 0) {
+			ind = stack_pop(&compiler_common.stack)->value;
+			if (compiler_common.search_states[ind].type == 0) {
+				SLJIT_ASSERT(compiler_common.dfa_transitions[ind].type == type_end);
+				suggest_fast_forward = 0;
+				empty_match_id = compiler_common.search_states[ind].value;
+			}
+			else if (compiler_common.search_states[ind].type > 0) {
+				SLJIT_ASSERT(compiler_common.dfa_transitions[ind].type != type_end);
+				if (compiler_common.dfa_transitions[ind].type == type_rng_start && compiler_common.dfa_transitions[ind].value)
+					suggest_fast_forward = 0;
+				/* The fast forward loop does not update the counters. */
+				if (get_term_counter(&compiler_common, compiler_common.search_states[ind].type))
+					suggest_fast_forward = 0;
+			}
+			compiler_common.search_states[ind].value = -1;
+		}
+	}
+	else {
+		SLJIT_ASSERT(compiler_common.dfa_transitions[1].type == type_newline);
+		CHECK(trace_transitions(1, &compiler_common));
+		while (compiler_common.stack.count > 0) {
+			ind = stack_pop(&compiler_common.stack)->value;
+			if (compiler_common.search_states[ind].type == 0) {
+				SLJIT_ASSERT(compiler_common.dfa_transitions[ind].type == type_end);
+				suggest_fast_forward = 0;
+				empty_match_id = compiler_common.search_states[ind].value;
+			}
+			else if (compiler_common.search_states[ind].type > 0 && get_term_counter(&compiler_common, compiler_common.search_states[ind].type))
+				suggest_fast_forward = 0;
+			compiler_common.search_states[ind].value = -1;
+		}
+	}
+
+	/* The matches of the set machines are recorded by the transitions. */
+	if ((compiler_common.flags & REGEX_SET_MATCH) && empty_match_id != -1) {
+		error_code = REGEX_INVALID_REGEX;
+		break;
+	}
+
+#ifdef REGEX_USE_8BIT_CHARS
+	/* Anchored patterns stop at the first mismatch, so the lazy DFA is only used for searching. */
+	if ((compiler_common.flags & REGEX_LAZY_DFA) && !(compiler_common.flags & REGEX_MATCH_BEGIN) && empty_match_id == -1) {
+		CHECK(build_lazy_dfa(&compiler_common));
+	}
+#endif
+
+	/* The first characters are searched by simd instructions when possible. */
+	compiler_common.simd_char_count = 0;
+	if (!(compiler_common.flags & REGEX_MATCH_BEGIN) && suggest_fast_forward && sljit_has_cpu_feature(SLJIT_HAS_SIMD)) {
+		CHECK(collect_simd_chars(&compiler_common));
+	}
+
+	/* The start terms of the sets are inserted by a dispatch on the next character. The
+	   fast forward loop expects that all start terms are inserted, so it is disabled. */
+	compiler_common.start_dispatch = 0;
+#ifdef REGEX_USE_8BIT_CHARS
+	if ((compiler_common.flags & REGEX_SET_MATCH) && !(compiler_common.flags & REGEX_MATCH_BEGIN) && compiler_common.simd_char_count == 0) {
+		CHECK(group_start_chars(&compiler_common));
+		if (compiler_common.start_dispatch) {
+			compiler_common.machine->start_dispatch = (sljit_uw*)SLJIT_MALLOC(256 * sizeof(sljit_uw), NULL);
+			CHECK(!compiler_common.machine->start_dispatch);
+			suggest_fast_forward = 0;
+		}
+	}
+#endif
+
+#ifdef REGEX_USE_8BIT_CHARS
+	/* The bitmaps are filled during code generation. */
+	compiler_common.range_bitmaps = NULL;
+	ind = range_bitmap_count(&compiler_common);
+	compiler_common.machine->range_bitmap_count = ind;
+	if (ind > 0) {
+		compiler_common.machine->range_bitmaps = (sljit_u32*)SLJIT_MALLOC((sljit_uw)ind * REGEX_RANGE_BITMAP_WORDS * sizeof(sljit_u32), NULL);
+		CHECK(!compiler_common.machine->range_bitmaps);
+		compiler_common.range_bitmaps = compiler_common.machine->range_bitmaps;
+	}
+#endif
+
+	/* Step 4.1: Generate entry. */
+	if (compiler_common.counter_count > 0)
+		ind = 7;
+	else
+		ind = compiler_common.machine->range_bitmap_count > 0 ? 6 : 5;
+	CHECK(sljit_emit_enter(compiler_common.compiler, 0, SLJIT_ARGS3V(P, P, 32), (sljit_s32)ind, 5, compiler_common.simd_char_count > 0 ? REGEX_SIMD_FSCRATCHES : 0, 0, 0));
+
+	if (compiler_common.simd_char_count > 0)
+		select_simd_type(&compiler_common);
+
+	/* Copy arguments to their place. */
+	EMIT_OP1(SLJIT_MOV, R_REGEX_MATCH, 0, SLJIT_S0, 0);
+	EMIT_OP1(SLJIT_MOV, R_STRING, 0, SLJIT_S1, 0);
+	EMIT_OP2(SLJIT_ADD, R_LENGTH, 0, SLJIT_S2, 0, SLJIT_IMM, 1);
+
+	/* Init global registers. */
+	EMIT_OP1(SLJIT_MOV, R_CURR_STATE, 0, SLJIT_MEM1(R_REGEX_MATCH), SLJIT_OFFSETOF(struct regex_match, current));
+	EMIT_OP1(SLJIT_MOV, R_NEXT_STATE, 0, SLJIT_MEM1(R_REGEX_MATCH), SLJIT_OFFSETOF(struct regex_match, next));
+	EMIT_OP1(SLJIT_MOV, R_NEXT_HEAD, 0, SLJIT_MEM1(R_REGEX_MATCH), SLJIT_OFFSETOF(struct regex_match, head));
+	EMIT_OP1(SLJIT_MOV, R_BEST_BEGIN, 0, SLJIT_MEM1(R_REGEX_MATCH), SLJIT_OFFSETOF(struct regex_match, best_begin));
+	EMIT_OP1(SLJIT_MOV, R_CURR_INDEX, 0, SLJIT_MEM1(R_REGEX_MATCH), SLJIT_OFFSETOF(struct regex_match, index));
+
+	/* Check whether the best match has already found in a previous frame. */
+	EMIT_CMP(jump, SLJIT_EQUAL, SLJIT_MEM1(R_REGEX_MATCH), SLJIT_OFFSETOF(struct regex_match, fast_quit), SLJIT_IMM, 0);
+	EMIT_JUMP(best_match_found_jump, SLJIT_JUMP);
+
+#ifdef REGEX_MATCH_VERBOSE
+	if (compiler_common.flags & REGEX_MATCH_VERBOSE)
+		printf("\n-----------------\nTrace\n-----------------\n");
+#endif
+
+	/* Step 4.2: Generate code for state 0. */
+	EMIT_LABEL(label);
+	sljit_emit_op0(compiler_common.compiler, SLJIT_ENDBR);
+	compiler_common.machine->entry_addrs[0] = (sljit_uw)label;
+
+	/* Swapping current and next. */
+	EMIT_OP1(SLJIT_MOV, R_TEMP, 0, R_CURR_STATE, 0);
+	EMIT_OP1(SLJIT_MOV, R_CURR_STATE, 0, R_NEXT_STATE, 0);
+	EMIT_OP1(SLJIT_MOV, R_NEXT_STATE, 0, R_TEMP, 0);
+
+	/* Checking whether the best case needs to be updated. */
+	if (!(compiler_common.flags & REGEX_MATCH_END)) {
+		EMIT_CMP(end_check_jump, SLJIT_NOT_EQUAL, SLJIT_MEM1(R_CURR_STATE), TERM_REL_OFFSET_OF(0, 1), SLJIT_IMM, -1);
+		EMIT_LABEL(end_check_label);
+	}
+	EMIT_OP1(SLJIT_MOV, SLJIT_MEM1(R_NEXT_STATE), TERM_REL_OFFSET_OF(0, 1), SLJIT_IMM, -1);
+	EMIT_OP2(SLJIT_ADD, R_CURR_INDEX, 0, R_CURR_INDEX, 0, SLJIT_IMM, 1);
+
+	/* Checking whether best case has already found. */
+	if (!(compiler_common.flags & REGEX_MATCH_END) || (compiler_common.flags & REGEX_MATCH_BEGIN)) {
+		if (!(compiler_common.flags & REGEX_MATCH_BEGIN)) {
+			/* We can bail out if no more active states remain and R_BEST_BEGIN != -1. */
+			EMIT_CMP(best_match_check_jump, SLJIT_NOT_EQUAL, R_BEST_BEGIN, 0, SLJIT_IMM, -1);
+		}
+		else {
+			/* We can bail out if no more active states remain (regardless of R_BEST_BEGIN). */
+			EMIT_CMP(best_match_check_jump, SLJIT_EQUAL, R_NEXT_HEAD, 0, SLJIT_IMM, 0);
+		}
+	}
+
+	EMIT_LABEL(start_label);
+	sljit_set_label(jump, start_label);
+
+	if (!(compiler_common.flags & REGEX_MATCH_BEGIN) && suggest_fast_forward) {
+		EMIT_CMP(fast_forward_jump, SLJIT_NOT_EQUAL, SLJIT_MEM1(R_REGEX_MATCH), SLJIT_OFFSETOF(struct regex_match, fast_forward), SLJIT_IMM, 0);
+	}
+
+	/* Loading the next character. */
+	EMIT_OP2(SLJIT_SUB | SLJIT_SET_Z, R_LENGTH, 0, R_LENGTH, 0, SLJIT_IMM, 1);
+	EMIT_JUMP(length_is_zero_jump, SLJIT_EQUAL);
+
+	EMIT_OP1(SLJIT_MOV, R_TEMP, 0, R_STRING, 0);
+#ifdef REGEX_USE_8BIT_CHARS
+	EMIT_OP1(SLJIT_MOV_U8, R_CURR_CHAR, 0, SLJIT_MEM1(R_TEMP), 0);
+	EMIT_OP2(SLJIT_ADD, R_TEMP, 0, R_TEMP, 0, SLJIT_IMM, 1);
+#else
+	EMIT_OP1(SLJIT_MOV_UH, R_CURR_CHAR, 0, SLJIT_MEM1(R_TEMP), 0);
+	EMIT_OP2(SLJIT_ADD, R_TEMP, 0, R_TEMP, 0, SLJIT_IMM, 2);
+#endif
+	EMIT_OP1(SLJIT_MOV, R_STRING, 0, R_TEMP, 0);
+
+#ifdef REGEX_MATCH_VERBOSE
+	if (compiler_common.flags & REGEX_MATCH_VERBOSE) {
+		printf("(%3d): ", 0);
+		CHECK(trace_transitions(0, &compiler_common));
+		while (compiler_common.stack.count > 0) {
+			ind = stack_pop(&compiler_common.stack)->value;
+			if (compiler_common.search_states[ind].type >= 0)
+				printf("-> (%3d:%3d) ", compiler_common.search_states[ind].type, compiler_common.search_states[ind].value);
+			compiler_common.search_states[ind].value = -1;
+		}
+		printf("\n");
+	}
+#endif
+
+	EMIT_LABEL(fast_forward_return_label);
+	if (!(compiler_common.flags & REGEX_MATCH_BEGIN)) {
+		EMIT_OP1(SLJIT_MOV, SLJIT_MEM1(R_REGEX_MATCH), SLJIT_OFFSETOF(struct regex_match, fast_forward), SLJIT_IMM, 1);
+		if (!(compiler_common.flags & REGEX_MATCH_END)) {
+			EMIT_CMP(jump, SLJIT_NOT_EQUAL, R_BEST_BEGIN, 0, SLJIT_IMM, -1);
+		}
+
+#ifdef REGEX_USE_8BIT_CHARS
+		if (compiler_common.start_dispatch) {
+			CHECK(compile_start_dispatch(&compiler_common, &no_next_char_jump));
+			EMIT_LABEL(label);
+			sljit_set_label(no_next_char_jump, label);
+		}
+#endif
+
+		EMIT_OP1(SLJIT_MOV, R_TEMP, 0, R_CURR_INDEX, 0);
+		CHECK(compile_uncond_tran(&compiler_common, R_NEXT_STATE, -1));
+		/* And branching to the first state. */
+		CHECK(sljit_emit_ijump(compiler_common.compiler, SLJIT_JUMP, SLJIT_MEM2(R_CURR_STATE, R_TEMP), 0));
+
+		if (!(compiler_common.flags & REGEX_MATCH_END)) {
+			EMIT_LABEL(label);
+			sljit_set_label(jump, label);
+		}
+	}
+	/* This is the case where we only have to reset the R_NEXT_HEAD. */
+	EMIT_OP1(SLJIT_MOV, R_TEMP, 0, R_NEXT_HEAD, 0);
+	EMIT_OP1(SLJIT_MOV, R_NEXT_HEAD, 0, SLJIT_IMM, 0);
+	CHECK(sljit_emit_ijump(compiler_common.compiler, SLJIT_JUMP, SLJIT_MEM2(R_CURR_STATE, R_TEMP), 0));
+
+	/* Fast-forward loop. */
+	if (fast_forward_jump) {
+		/* Quit from fast-forward loop. */
+		EMIT_LABEL(fast_forward_label);
+		EMIT_OP2(SLJIT_SUB, R_TEMP, 0, R_NEXT_HEAD, 0, SLJIT_IMM, 1);
+		EMIT_OP1(SLJIT_MOV, R_LENGTH, 0, R_NEXT_STATE, 0);
+		EMIT_OP1(SLJIT_MOV, R_STRING, 0, R_CURR_STATE, 0);
+		EMIT_OP1(SLJIT_MOV, R_CURR_INDEX, 0, R_NEXT_HEAD, 0);
+		EMIT_OP1(SLJIT_MOV, R_NEXT_STATE, 0, SLJIT_MEM1(R_REGEX_MATCH), SLJIT_OFFSETOF(struct regex_match, next));
+		EMIT_OP1(SLJIT_MOV, R_CURR_STATE, 0, SLJIT_MEM1(R_REGEX_MATCH), SLJIT_OFFSETOF(struct regex_match, current));
+		EMIT_OP1(SLJIT_MOV, R_NEXT_HEAD, 0, SLJIT_MEM1(R_REGEX_MATCH), SLJIT_OFFSETOF(struct regex_match, head));
+
+		/* Update the start field of the locations. */
+		CHECK(trace_transitions(0, &compiler_common));
+		while (compiler_common.stack.count > 0) {
+			ind = stack_pop(&compiler_common.stack)->value;
+			if (compiler_common.search_states[ind].type >= 0) {
+				EMIT_OP1(SLJIT_MOV, SLJIT_MEM1(R_CURR_STATE), TERM_OFFSET_OF(compiler_common.search_states[ind].type, 2), R_TEMP, 0);
+				if (compiler_common.flags & REGEX_CAPTURES) {
+					CHECK(compile_capture_tran(&compiler_common, ind, SLJIT_MEM1(R_CURR_STATE), TERM_OFFSET_OF(compiler_common.search_states[ind].type, CAPTURE_SLOT(&compiler_common)), 0, 0, R_TEMP, 0));
+				}
+			}
+			compiler_common.search_states[ind].value = -1;
+		}
+		EMIT_OP1(SLJIT_MOV, SLJIT_MEM1(R_REGEX_MATCH), SLJIT_OFFSETOF(struct regex_match, fast_forward), SLJIT_IMM, 0);
+		EMIT_JUMP(jump, SLJIT_JUMP);
+		sljit_set_label(jump, fast_forward_return_label);
+
+		/* Start fast-forward. */
+		EMIT_LABEL(label);
+		sljit_set_label(fast_forward_jump, label);
+
+		/* Moving everything to registers. */
+		EMIT_OP1(SLJIT_MOV, SLJIT_MEM1(R_REGEX_MATCH), SLJIT_OFFSETOF(struct regex_match, next), R_NEXT_STATE, 0);
+		EMIT_OP1(SLJIT_MOV, SLJIT_MEM1(R_REGEX_MATCH), SLJIT_OFFSETOF(struct regex_match, current), R_CURR_STATE, 0);
+		EMIT_OP1(SLJIT_MOV, SLJIT_MEM1(R_REGEX_MATCH), SLJIT_OFFSETOF(struct regex_match, head), R_NEXT_HEAD, 0);
+		EMIT_OP1(SLJIT_MOV, R_NEXT_STATE, 0, R_LENGTH, 0);
+		EMIT_OP1(SLJIT_MOV, R_CURR_STATE, 0, R_STRING, 0);
+		EMIT_OP1(SLJIT_MOV, R_NEXT_HEAD, 0, R_CURR_INDEX, 0);
+
+		/* Fast forward mainloop. */
+		if (compiler_common.simd_char_count > 0) {
+			CHECK(compile_simd_fast_forward(&compiler_common, &label));
+		}
+		else {
+			EMIT_LABEL(label);
+		}
+		EMIT_OP2(SLJIT_SUB | SLJIT_SET_Z, R_NEXT_STATE, 0, R_NEXT_STATE, 0, SLJIT_IMM, 1);
+		EMIT_JUMP(fast_forward_jump, SLJIT_EQUAL);
+
+#ifdef REGEX_USE_8BIT_CHARS
+		EMIT_OP1(SLJIT_MOV_U8, R_CURR_CHAR, 0, SLJIT_MEM1(R_CURR_STATE), 0);
+		EMIT_OP2(SLJIT_ADD, R_CURR_STATE, 0, R_CURR_STATE, 0, SLJIT_IMM, 1);
+#else
+		EMIT_OP1(SLJIT_MOV_UH, R_CURR_CHAR, 0, SLJIT_MEM1(R_CURR_STATE), 0);
+		EMIT_OP2(SLJIT_ADD, R_CURR_STATE, 0, R_CURR_STATE, 0, SLJIT_IMM, 2);
+#endif
+
+		CHECK(trace_transitions(0, &compiler_common));
+		CHECK(compile_leave_fast_forward(&compiler_common, fast_forward_label));
+
+		EMIT_OP2(SLJIT_ADD, R_NEXT_HEAD, 0, R_NEXT_HEAD, 0, SLJIT_IMM, 1);
+		EMIT_JUMP(jump, SLJIT_JUMP);
+		sljit_set_label(jump, label);
+
+		/* String is finished. */
+		EMIT_LABEL(label);
+		sljit_set_label(fast_forward_jump, label);
+		EMIT_OP1(SLJIT_MOV, SLJIT_MEM1(R_REGEX_MATCH), SLJIT_OFFSETOF(struct regex_match, index), R_NEXT_HEAD, 0);
+
+		if (compiler_common.flags & REGEX_FAKE_MATCH_END) {
+			/* The start field of the trailing new-line term is read by regex_get_result. */
+			EMIT_OP2(SLJIT_SUB, R_TEMP, 0, R_NEXT_HEAD, 0, SLJIT_IMM, 1);
+			EMIT_OP1(SLJIT_MOV, R_CURR_STATE, 0, SLJIT_MEM1(R_REGEX_MATCH), SLJIT_OFFSETOF(struct regex_match, current));
+			EMIT_OP1(SLJIT_MOV, SLJIT_MEM1(R_CURR_STATE), TERM_OFFSET_OF(1, 2), R_TEMP, 0);
+		}
+		EMIT_JUMP(fast_forward_jump, SLJIT_JUMP);
+	}
+
+	/* End check. */
+	if (end_check_jump) {
+		EMIT_LABEL(label);
+		sljit_set_label(end_check_jump, label);
+
+		if (!(compiler_common.flags & REGEX_MATCH_NON_GREEDY) || !(compiler_common.flags & REGEX_MATCH_BEGIN)) {
+			CHECK(compile_end_check(&compiler_common, end_check_label));
 		}
 		else {
-			SLJIT_ASSERT(dfa_transitions[ind].type == type_rng_left);
-			if (init_range) {
-				EMIT_OP1(SLJIT_MOV, R_TEMP, 0, R_CURR_CHAR, 0);
-				init_range = 0;
+			/* Since we leave, we do not need to update the R_BEST_BEGIN. */
+			EMIT_OP1(SLJIT_MOV, SLJIT_MEM1(R_REGEX_MATCH), SLJIT_OFFSETOF(struct regex_match, best_begin), SLJIT_IMM, 0);
+			EMIT_OP1(SLJIT_MOV, SLJIT_MEM1(R_REGEX_MATCH), SLJIT_OFFSETOF(struct regex_match, best_end), R_CURR_INDEX, 0);
+			if (compiler_common.flags & REGEX_ID_CHECK) {
+				EMIT_OP1(SLJIT_MOV, SLJIT_MEM1(R_REGEX_MATCH), SLJIT_OFFSETOF(struct regex_match, best_id), SLJIT_MEM1(R_CURR_STATE), TERM_REL_OFFSET_OF(0, 2));
 			}
-			if (dfa_transitions[ind].value != prev_value) {
-				/* Best compatibility to all archs. */
-				prev_value -= dfa_transitions[ind].value;
-				if (prev_value < 0) {
-					EMIT_OP2(SLJIT_SUB, R_TEMP, 0, R_TEMP, 0, SLJIT_IMM, -prev_value);
+			if (compiler_common.flags & REGEX_CAPTURES) {
+				CHECK(compile_best_captures(&compiler_common));
+			}
+			EMIT_OP1(SLJIT_MOV, SLJIT_MEM1(R_REGEX_MATCH), SLJIT_OFFSETOF(struct regex_match, fast_quit), SLJIT_IMM, 1);
+			EMIT_JUMP(non_greedy_end_jump, SLJIT_JUMP);
+		}
+	}
+
+	/* Finish check. */
+	if (best_match_check_jump) {
+		EMIT_LABEL(label);
+		sljit_set_label(best_match_check_jump, label);
+
+		if (!(compiler_common.flags & REGEX_MATCH_BEGIN)) {
+			EMIT_CMP(jump, SLJIT_NOT_EQUAL, R_NEXT_HEAD, 0, SLJIT_IMM, 0);
+			sljit_set_label(jump, start_label);
+		}
+		EMIT_OP1(SLJIT_MOV, SLJIT_MEM1(R_REGEX_MATCH), SLJIT_OFFSETOF(struct regex_match, fast_quit), SLJIT_IMM, 1);
+	}
+
+	/* Leaving matching and storing the necessary values. */
+	EMIT_LABEL(label);
+	sljit_set_label(length_is_zero_jump, label);
+	if (non_greedy_end_jump)
+		sljit_set_label(non_greedy_end_jump, label);
+
+	EMIT_OP1(SLJIT_MOV, SLJIT_MEM1(R_REGEX_MATCH), SLJIT_OFFSETOF(struct regex_match, index), R_CURR_INDEX, 0);
+	EMIT_OP1(SLJIT_MOV, SLJIT_MEM1(R_REGEX_MATCH), SLJIT_OFFSETOF(struct regex_match, head), R_NEXT_HEAD, 0);
+	EMIT_OP1(SLJIT_MOV, SLJIT_MEM1(R_REGEX_MATCH), SLJIT_OFFSETOF(struct regex_match, next), R_NEXT_STATE, 0);
+	EMIT_OP1(SLJIT_MOV, SLJIT_MEM1(R_REGEX_MATCH), SLJIT_OFFSETOF(struct regex_match, current), R_CURR_STATE, 0);
+
+	/* Exit from JIT. */
+	EMIT_LABEL(label);
+	sljit_set_label(best_match_found_jump, label);
+	if (fast_forward_jump)
+		sljit_set_label(fast_forward_jump, label);
+	CHECK(sljit_emit_return_void(compiler_common.compiler));
+
+	for (ind = 1; ind < (sljit_sw)compiler_common.dfa_size - 1; ind++) {
+		if (compiler_common.search_states[ind].type >= 0) {
+			SLJIT_ASSERT(compiler_common.search_states[ind].type < compiler_common.terms_size);
+			EMIT_LABEL(label);
+			sljit_emit_op0(compiler_common.compiler, SLJIT_ENDBR);
+			compiler_common.machine->entry_addrs[compiler_common.search_states[ind].type] = (sljit_uw)label;
+
+			counter = get_term_counter(&compiler_common, compiler_common.search_states[ind].type);
+			/* The mismatch code of the not inverted ranges is generated by compile_range_check. */
+			kill_counter = counter;
+
+			if (compiler_common.dfa_transitions[ind].type == type_char) {
+				EMIT_CMP(jump, SLJIT_NOT_EQUAL, R_CURR_CHAR, 0, SLJIT_IMM, compiler_common.dfa_transitions[ind].value);
+			}
+			else if (compiler_common.dfa_transitions[ind].type == type_rng_start) {
+				if (!compiler_common.dfa_transitions[ind].value)
+					kill_counter = NULL;
+				ind = compile_range_check(&compiler_common, ind, counter);
+				CHECK(!ind);
+			}
+			else {
+				SLJIT_ASSERT(compiler_common.dfa_transitions[ind].type == type_newline);
+				CHECK(compile_newline_check(&compiler_common, ind));
+			}
+
+			if (counter) {
+				CHECK(compile_counter_step(&compiler_common, counter, compiler_common.search_states[ind].type, &no_exit_jump));
+			}
+
+			CHECK(trace_transitions((int)ind, &compiler_common));
+#ifdef REGEX_MATCH_VERBOSE
+			if (compiler_common.flags & REGEX_MATCH_VERBOSE)
+				printf("(%3d): ", compiler_common.search_states[ind].type);
+#endif
+			CHECK(compile_cond_tran(&compiler_common, compiler_common.search_states[ind].type));
+
+			if (counter) {
+				EMIT_LABEL(label);
+				sljit_set_label(no_exit_jump, label);
+				EMIT_JUMP(no_exit_jump, SLJIT_JUMP);
+			}
+
+			if (compiler_common.dfa_transitions[ind].type == type_char) {
+				EMIT_LABEL(label);
+				sljit_set_label(jump, label);
+			}
+			else if (compiler_common.dfa_transitions[ind].type == type_rng_end) {
+				EMIT_LABEL(label);
+				range_set_label(compiler_common.range_jump_list, label);
+			}
+			else {
+				SLJIT_ASSERT(compiler_common.dfa_transitions[ind].type == type_newline);
+			}
+
+			if (kill_counter) {
+				CHECK(compile_counter_kill(&compiler_common, kill_counter));
+			}
+			if (counter) {
+				EMIT_LABEL(label);
+				sljit_set_label(no_exit_jump, label);
+			}
+
+			/* Branch to the next item in the list. */
+			EMIT_OP1(SLJIT_MOV, R_TEMP, 0, SLJIT_MEM1(R_CURR_STATE), TERM_OFFSET_OF(compiler_common.search_states[ind].type, 1));
+			EMIT_OP1(SLJIT_MOV, SLJIT_MEM1(R_CURR_STATE), TERM_OFFSET_OF(compiler_common.search_states[ind].type, 1), SLJIT_IMM, -1);
+			CHECK(sljit_emit_ijump(compiler_common.compiler, SLJIT_JUMP, SLJIT_MEM2(R_CURR_STATE, R_TEMP), 0));
+		}
+	}
+
+	if (ind == (sljit_sw)compiler_common.dfa_size - 1) {
+		/* Generate an init stub function. */
+		EMIT_LABEL(label);
+		CHECK(sljit_emit_enter(compiler_common.compiler, 0, SLJIT_ARGS2(W, P, P), compiler_common.counter_count > 0 ? 7 : 3, 3, 0, 0, 0));
+		if (compiler_common.counter_count > 0) {
+			/* The entries of the counted start terms are recorded. */
+			EMIT_OP1(SLJIT_MOV, R_REGEX_MATCH, 0, SLJIT_S1, 0);
+		}
+
+		if (empty_match_id == -1) {
+			EMIT_OP1(SLJIT_MOV, SLJIT_MEM1(SLJIT_S1), SLJIT_OFFSETOF(struct regex_match, best_begin), SLJIT_IMM, -1);
+			EMIT_OP1(SLJIT_MOV, SLJIT_MEM1(SLJIT_S1), SLJIT_OFFSETOF(struct regex_match, best_id), SLJIT_IMM, 0);
+		}
+		else {
+			EMIT_OP1(SLJIT_MOV, SLJIT_MEM1(SLJIT_S1), SLJIT_OFFSETOF(struct regex_match, best_begin), SLJIT_IMM, 0);
+			EMIT_OP1(SLJIT_MOV, SLJIT_MEM1(SLJIT_S1), SLJIT_OFFSETOF(struct regex_match, best_id), SLJIT_IMM, empty_match_id);
+
+			if (compiler_common.flags & REGEX_CAPTURES) {
+				/* The captures of the empty match are recorded on the path to the end term. */
+				EMIT_OP1(SLJIT_MOV, R_TEMP, 0, SLJIT_IMM, 0);
+				CHECK(trace_transitions(!(compiler_common.flags & REGEX_FAKE_MATCH_BEGIN) ? 0 : 1, &compiler_common));
+				while (compiler_common.stack.count > 0) {
+					ind = stack_pop(&compiler_common.stack)->value;
+					if (compiler_common.search_states[ind].type == 0) {
+						CHECK(compile_capture_tran(&compiler_common, ind, SLJIT_MEM1(SLJIT_S1), compiler_common.set_offset, 0, 0, R_TEMP, 0));
+					}
+					compiler_common.search_states[ind].value = -1;
 				}
-				else {
-					EMIT_OP2(SLJIT_ADD, R_TEMP, 0, R_TEMP, 0, SLJIT_IMM, prev_value);
+			}
+		}
+
+		EMIT_OP1(SLJIT_MOV, SLJIT_MEM1(SLJIT_S1), SLJIT_OFFSETOF(struct regex_match, index), SLJIT_IMM, !(compiler_common.flags & REGEX_FAKE_MATCH_BEGIN) ? 1 : 2);
+
+		if (!(compiler_common.flags & REGEX_MATCH_NON_GREEDY) || empty_match_id == -1) {
+			/* The else is a really rare event, so we still generate an empty function instead of a runtime pointer check. */
+			SLJIT_ASSERT(R_CURR_STATE == SLJIT_S0);
+			if (!(compiler_common.flags & REGEX_MATCH_BEGIN)) {
+				/* R_CURR_INDEX (put to R_TEMP) is zero. */
+				EMIT_OP1(SLJIT_MOV, R_TEMP, 0, SLJIT_IMM, 0);
+			}
+			CHECK(compile_uncond_tran(&compiler_common, R_CURR_STATE, -1));
+		}
+		else {
+			EMIT_OP1(SLJIT_MOV, R_NEXT_HEAD, 0, SLJIT_IMM, 0);
+		}
+		CHECK(sljit_emit_return(compiler_common.compiler, SLJIT_MOV, R_NEXT_HEAD, 0));
+
+		if (compiler_common.flags & REGEX_SERIALIZABLE)
+			CHECK(serialize_machine(&compiler_common, label));
+
+		compiler_common.machine->continue_match = sljit_generate_code(compiler_common.compiler, 0, NULL);
+		compiler_common.machine->code_size = sljit_get_generated_code_size(compiler_common.compiler);
+#ifndef SLJIT_INDIRECT_CALL
+		compiler_common.machine->u.init_match = (void*)(sljit_sw)sljit_get_label_addr(label);
+#else
+		sljit_set_function_context(&compiler_common.machine->u.init_match, &compiler_common.machine->context, sljit_get_label_addr(label), regex_compile);
+#endif
+#ifdef REGEX_MATCH_VERBOSE
+		if (compiler_common.flags & REGEX_MATCH_VERBOSE)
+			printf("Continue match: %p Init match: %p\n\n", compiler_common.machine->continue_match, compiler_common.machine->u.init_match);
+#endif
+		if (compiler_common.machine->continue_match) {
+			for (ind = 0; ind < compiler_common.terms_size; ++ind)
+				compiler_common.machine->entry_addrs[ind] = sljit_get_label_addr((struct sljit_label*)compiler_common.machine->entry_addrs[ind]);
+#ifdef REGEX_USE_8BIT_CHARS
+			if (compiler_common.machine->start_dispatch) {
+				for (ind = 0; ind < 256; ++ind) {
+					if (compiler_common.start_groups[ind] == ind)
+						compiler_common.machine->start_dispatch[ind] = sljit_get_label_addr((struct sljit_label*)compiler_common.machine->start_dispatch[ind]);
+					else
+						compiler_common.machine->start_dispatch[ind] = compiler_common.machine->start_dispatch[compiler_common.start_groups[ind]];
 				}
-				prev_value = dfa_transitions[ind].value;
 			}
-			EMIT_CMP(*range_jump_list, SLJIT_LESS_EQUAL, R_TEMP, 0, SLJIT_IMM, dfa_transitions[ind + 1].value - dfa_transitions[ind].value);
-			range_jump_list++;
-			ind++;
+#endif
+			done = 1;
 		}
-		ind++;
 	}
+	END_GUARD
 
-	*range_jump_list = NULL;
+	stack_destroy(&compiler_common.stack);
+	stack_destroy(&compiler_common.depth);
+	SLJIT_FREE(compiler_common.dfa_transitions, NULL);
+	SLJIT_FREE(compiler_common.search_states, NULL);
+	if (compiler_common.range_jump_list)
+		SLJIT_FREE(compiler_common.range_jump_list, NULL);
+	if (compiler_common.trace_parents)
+		SLJIT_FREE(compiler_common.trace_parents, NULL);
+	if (compiler_common.capture_marks)
+		SLJIT_FREE(compiler_common.capture_marks, NULL);
+	if (compiler_common.counter_list)
+		SLJIT_FREE(compiler_common.counter_list, NULL);
+	if (compiler_common.term_counters)
+		SLJIT_FREE(compiler_common.term_counters, NULL);
+	stack_destroy(&compiler_common.counters);
+	if (compiler_common.compiler)
+		sljit_free_compiler(compiler_common.compiler);
+	if (done)
+		return compiler_common.machine;
 
-	if (!invert) {
-		no_states = compiler_common->no_states;
-		offset = TERM_OFFSET_OF(compiler_common->search_states[ind].type, 1);
-		EMIT_OP1(SLJIT_MOV, R_TEMP, 0, SLJIT_MEM1(R_CURR_STATE), offset);
-		EMIT_OP1(SLJIT_MOV, SLJIT_MEM1(R_CURR_STATE), offset, SLJIT_IMM, -1);
-		CHECK(sljit_emit_ijump(compiler, SLJIT_JUMP, SLJIT_MEM2(R_CURR_STATE, R_TEMP), 0));
+	if (compiler_common.machine) {
+		if (compiler_common.machine->dfa)
+			SLJIT_FREE(compiler_common.machine->dfa, NULL);
+		if (compiler_common.machine->start_dispatch)
+			SLJIT_FREE(compiler_common.machine->start_dispatch, NULL);
+		if (compiler_common.machine->range_bitmaps)
+			SLJIT_FREE(compiler_common.machine->range_bitmaps, NULL);
+		if (compiler_common.machine->serialized)
+			SLJIT_FREE(compiler_common.machine->serialized, NULL);
+		SLJIT_FREE(compiler_common.machine, NULL);
+	}
+	if (error)
+		*error = error_code;
+	return NULL;
+}
 
-		EMIT_LABEL(label);
-		range_set_label(compiler_common->range_jump_list, label);
-		/* Clears the jump list. */
-		*compiler_common->range_jump_list = NULL;
+#undef TERM_OFFSET_OF
+#undef EMIT_OP1
+#undef EMIT_OP2
+#undef EMIT_LABEL
+#undef EMIT_JUMP
+#undef EMIT_CMP
+#undef BEGIN_GUARD
+#undef END_GUARD
+#undef CHECK
+
+struct regex_machine* regex_compile(const regex_char_t *regex_string, int length, int re_flags, int *error)
+{
+	return compile_machine(regex_string, length, re_flags, 0, error);
+}
+
+/* Longest literal prefix shared by the patterns of a set. */
+#define REGEX_SET_MAX_PREFIX	64
+
+struct set_pattern {
+	const regex_char_t *string;
+	int length;
+	/* Length of the prefix, which can be shared with other patterns. */
+	int prefix;
+	int id;
+};
+
+/* Returns non-zero if the pattern can be a member of a set. */
+static int check_set_pattern(struct set_pattern *pattern, int re_flags, int *error_code)
+{
+	struct compiler_common compiler_common;
+	struct stack_item *item;
+	const regex_char_t *regex_string = pattern->string;
+	int result = 1;
+	int depth = 0;
+	int prefix = 0;
+
+	/* Anchors change the flags, and the ids would overwrite the pattern ids.
+	   The repetitions are expanded, since the counters are not used by the check. */
+	compiler_common.flags = (re_flags & (REGEX_NEWLINE | REGEX_UTF8)) | REGEX_NO_COUNTERS;
+	*error_code = parse(regex_string, pattern->length, &compiler_common);
+	if (*error_code) {
+		stack_destroy(&compiler_common.stack);
+		return 0;
+	}
+
+	if (compiler_common.flags & (REGEX_MATCH_BEGIN | REGEX_MATCH_END | REGEX_FAKE_MATCH_BEGIN | REGEX_FAKE_MATCH_END))
+		result = 0;
+
+	/* The items are processed in reverse order. */
+	while (result && compiler_common.stack.count > 0) {
+		item = stack_pop(&compiler_common.stack);
+		if (item->type == type_id)
+			result = 0;
+		else if (item->type == type_close_br)
+			depth++;
+		else if (item->type == type_open_br)
+			depth--;
+		else if (item->type == type_select && depth == 0)
+			prefix = -1;
+	}
+
+	stack_destroy(&compiler_common.stack);
+	if (!result) {
+		*error_code = REGEX_INVALID_REGEX;
+		return 0;
+	}
+
+	/* Characters without special meaning, which are not followed by an iterator. */
+	if (prefix == 0) {
+		while (prefix < pattern->length && prefix <= REGEX_SET_MAX_PREFIX) {
+			switch (regex_string[prefix]) {
+			case '\\': case '[': case ']': case '(': case ')': case '{': case '}':
+			case '|': case '*': case '+': case '?': case '.': case '^': case '$':
+				break;
+			default:
+				/* The bytes of a UTF-8 character cannot be separated. */
+				if ((re_flags & REGEX_UTF8) && REGEX_CHAR_VALUE(regex_string[prefix]) >= 0x80)
+					break;
+				if (prefix + 1 < pattern->length && (regex_string[prefix + 1] == '*' || regex_string[prefix + 1] == '+'
+						|| regex_string[prefix + 1] == '?' || regex_string[prefix + 1] == '{'))
+					break;
+				prefix++;
+				continue;
+			}
+			break;
+		}
 	}
-	return ind;
-}
-
-#undef TERM_OFFSET_OF
-#undef EMIT_OP1
-#undef EMIT_OP2
-#undef EMIT_LABEL
-#undef EMIT_JUMP
-#undef EMIT_CMP
-#undef CHECK
 
-/* --------------------------------------------------------------------- */
-/*  Main compiler                                                        */
-/* --------------------------------------------------------------------- */
+	/* The last character is kept, so the patterns sharing a prefix cannot
+	   reach the end term from the same term (only one id could be recorded). */
+	pattern->prefix = prefix > 0 ? prefix - 1 : 0;
+	return 1;
+}
 
-#define TERM_OFFSET_OF(ind, offs) (((ind) * compiler_common.no_states + (offs)) * (sljit_sw)sizeof(sljit_sw))
+static int compare_set_patterns(const void *left, const void *right)
+{
+	const struct set_pattern *left_pattern = (const struct set_pattern*)left;
+	const struct set_pattern *right_pattern = (const struct set_pattern*)right;
+	int i;
 
-#define EMIT_OP1(type, arg1, arg2, arg3, arg4) \
-	CHECK(sljit_emit_op1(compiler_common.compiler, type, arg1, arg2, arg3, arg4))
+	for (i = 0; i < left_pattern->prefix && i < right_pattern->prefix; i++)
+		if (left_pattern->string[i] != right_pattern->string[i])
+			return left_pattern->string[i] < right_pattern->string[i] ? -1 : 1;
 
-#define EMIT_OP2(type, arg1, arg2, arg3, arg4, arg5, arg6) \
-	CHECK(sljit_emit_op2(compiler_common.compiler, type, arg1, arg2, arg3, arg4, arg5, arg6))
+	if (left_pattern->prefix != right_pattern->prefix)
+		return left_pattern->prefix - right_pattern->prefix;
+	return left_pattern->id - right_pattern->id;
+}
 
-#define EMIT_LABEL(label) \
-	label = sljit_emit_label(compiler_common.compiler); \
-	CHECK(!label)
+/* Writes the alternatives of the sorted patterns, which share their first depth characters.
+   The patterns with the same next character are grouped: ab|ac is written as a(b|c). */
+static regex_char_t* write_set_patterns(regex_char_t *ptr, struct set_pattern *patterns, int count, int depth)
+{
+	regex_char_t digits[12];
+	int i, j, value;
 
-#define EMIT_JUMP(jump, type) \
-	jump = sljit_emit_jump(compiler_common.compiler, type); \
-	CHECK(!jump)
+	for (i = 0; i < count; i = j) {
+		if (i > 0)
+			*ptr++ = '|';
 
-#define EMIT_CMP(jump, type, arg1, arg2, arg3, arg4) \
-	jump = sljit_emit_cmp(compiler_common.compiler, type, arg1, arg2, arg3, arg4); \
-	CHECK(!jump)
+		j = i + 1;
+		if (patterns[i].prefix > depth) {
+			while (j < count && patterns[j].string[depth] == patterns[i].string[depth])
+				j++;
+		}
 
-/* A do {} while(0) expression helps to avoid goto statements. */
-#define BEGIN_GUARD \
-	do {
+		if (j - i > 1) {
+			*ptr++ = patterns[i].string[depth];
+			*ptr++ = '(';
+			ptr = write_set_patterns(ptr, patterns + i, j - i, depth + 1);
+			*ptr++ = ')';
+			continue;
+		}
 
-#define END_GUARD \
-	} while(0);
+		*ptr++ = '(';
+		for (value = depth; value < patterns[i].length; value++)
+			*ptr++ = patterns[i].string[value];
+		*ptr++ = ')';
+		*ptr++ = '{';
 
-#define CHECK(exp) \
-	if (SLJIT_UNLIKELY(exp)) \
-		break;
+		/* The id of the pattern is increased by one, since zero means no id. */
+		value = patterns[i].id + 1;
+		j = 0;
+		do {
+			digits[j++] = (regex_char_t)('0' + value % 10);
+			value /= 10;
+		} while (value > 0);
+		while (j > 0)
+			*ptr++ = digits[--j];
+
+		*ptr++ = '!';
+		*ptr++ = '}';
+		j = i + 1;
+	}
+	return ptr;
+}
 
-struct regex_machine* regex_compile(const regex_char_t *regex_string, int length, int re_flags, int *error)
+struct regex_machine* regex_compile_set(const regex_char_t **regex_strings, const int *lengths, int count, int re_flags, int *error)
 {
-	struct compiler_common compiler_common;
-	sljit_sw ind;
-	int error_code, done, suggest_fast_forward;
-	/* ID of an empty match (-1 if not reachable). */
-	int empty_match_id;
-
-	struct sljit_jump *jump;
-	struct sljit_jump *best_match_found_jump;
-	struct sljit_jump *fast_forward_jump = NULL;
-	struct sljit_jump *length_is_zero_jump;
-	struct sljit_jump *end_check_jump = NULL;
-	struct sljit_jump *best_match_check_jump = NULL;
-	struct sljit_jump *non_greedy_end_jump = NULL;
-	struct sljit_label *label;
-	struct sljit_label *end_check_label = NULL;
-	struct sljit_label *start_label;
-	struct sljit_label *fast_forward_label;
-	struct sljit_label *fast_forward_return_label;
+	struct regex_machine *machine;
+	struct set_pattern *patterns;
+	regex_char_t *regex_string;
+	regex_char_t *ptr;
+	sljit_uw size = 0;
+	int i, error_code;
 
 	if (error)
 		*error = REGEX_NO_ERROR;
-#ifdef REGEX_MATCH_VERBOSE
-	compiler_common.flags = re_flags & (REGEX_MATCH_BEGIN | REGEX_MATCH_END | REGEX_MATCH_NON_GREEDY | REGEX_NEWLINE | REGEX_MATCH_VERBOSE);
-#else
-	compiler_common.flags = re_flags & (REGEX_MATCH_BEGIN | REGEX_MATCH_END | REGEX_MATCH_NON_GREEDY | REGEX_NEWLINE);
-#endif
 
-	/* Step 1: parsing (Left->Right).
-	   Syntax check and AST generator. */
-	error_code = parse(regex_string, length, &compiler_common);
-	if (error_code) {
-		stack_destroy(&compiler_common.stack);
+	if (count <= 0 || (re_flags & REGEX_MATCH_END)) {
 		if (error)
-			*error = error_code;
+			*error = REGEX_INVALID_REGEX;
 		return NULL;
 	}
 
-	/* Step 2: generating branches (Right->Left). */
-	error_code = generate_transitions(&compiler_common);
-	stack_destroy(&compiler_common.stack);
-	stack_destroy(&compiler_common.depth);
-	if (error_code) {
-		if (compiler_common.dfa_transitions)
-			SLJIT_FREE(compiler_common.dfa_transitions, NULL);
+	patterns = (struct set_pattern*)SLJIT_MALLOC(sizeof(struct set_pattern) * (sljit_uw)count, NULL);
+	if (!patterns) {
 		if (error)
-			*error = error_code;
+			*error = REGEX_MEMORY_ERROR;
 		return NULL;
 	}
 
-	/* Step 3: Generate necessary data for depth-first search (Left->Right). */
-	error_code = generate_search_states(&compiler_common);
-	if (error_code) {
-		SLJIT_FREE(compiler_common.dfa_transitions, NULL);
-		if (error)
-			*error = error_code;
-		return NULL;
+	for (i = 0; i < count; i++) {
+		patterns[i].string = regex_strings[i];
+		patterns[i].length = lengths[i];
+		patterns[i].id = i;
+		if (!check_set_pattern(patterns + i, re_flags, &error_code)) {
+			SLJIT_FREE(patterns, NULL);
+			if (error)
+				*error = error_code;
+			return NULL;
+		}
+		size += (sljit_uw)lengths[i];
 	}
 
-#ifdef REGEX_MATCH_VERBOSE
-	if (compiler_common.flags & REGEX_MATCH_VERBOSE)
-		verbose_transitions(&compiler_common);
-#endif
-
-	/* Step 4: Left->Right generate code. */
-	stack_init(&compiler_common.stack);
-	stack_init(&compiler_common.depth);
-	done = 0;
-	compiler_common.machine = NULL;
-	compiler_common.compiler = NULL;
-	compiler_common.range_jump_list = NULL;
-
-	BEGIN_GUARD
-
-	compiler_common.machine = (struct regex_machine*)SLJIT_MALLOC(sizeof(struct regex_machine) + (sljit_uw)(compiler_common.terms_size - 1) * sizeof(sljit_uw), NULL);
-	CHECK(!compiler_common.machine);
-
-	compiler_common.compiler = sljit_create_compiler(NULL);
-	CHECK(!compiler_common.compiler);
-
-	if (compiler_common.longest_range_size > 0) {
-		compiler_common.range_jump_list = (struct sljit_jump**)SLJIT_MALLOC(sizeof(struct sljit_jump*) * (sljit_uw)compiler_common.longest_range_size, NULL);
-		CHECK(!compiler_common.range_jump_list);
+	/* The patterns are combined to ((pattern0){1!}|(pattern1){2!}|...), where the
+	   outer bracket keeps the new-line search of REGEX_MATCH_BEGIN in front. Each
+	   shared character adds a bracket pair, and each pattern adds at most 18 characters. */
+	size = 3 * size + 2 + (sljit_uw)count * 18;
+	regex_string = (regex_char_t*)SLJIT_MALLOC(size * sizeof(regex_char_t), NULL);
+	if (!regex_string) {
+		SLJIT_FREE(patterns, NULL);
+		if (error)
+			*error = REGEX_MEMORY_ERROR;
+		return NULL;
 	}
 
-	if ((compiler_common.flags & REGEX_ID_CHECK) && !(compiler_common.flags & REGEX_MATCH_BEGIN))
-		compiler_common.no_states = 4;
-	else if (!(compiler_common.flags & REGEX_ID_CHECK) && (compiler_common.flags & REGEX_MATCH_BEGIN))
-		compiler_common.no_states = 2;
-	else
-		compiler_common.no_states = 3;
+	qsort(patterns, (size_t)count, sizeof(struct set_pattern), compare_set_patterns);
 
-	compiler_common.machine->flags = compiler_common.flags;
-	compiler_common.machine->no_states = compiler_common.no_states;
-	compiler_common.machine->size = compiler_common.machine->no_states * compiler_common.terms_size;
+	ptr = regex_string;
+	*ptr++ = '(';
+	ptr = write_set_patterns(ptr, patterns, count, 0);
+	*ptr++ = ')';
+	SLJIT_ASSERT((sljit_uw)(ptr - regex_string) <= size);
+	SLJIT_FREE(patterns, NULL);
 
-	/* Study the regular expression. */
-	empty_match_id = -1;
-	suggest_fast_forward = 1;
-	if (!(compiler_common.flags & REGEX_FAKE_MATCH_BEGIN)) {
-		CHECK(trace_transitions(0, &compiler_common));
-		while (compiler_common.stack.count > 0) {
-			ind = stack_pop(&compiler_common.stack)->value;
-			if (compiler_common.search_states[ind].type == 0) {
-				SLJIT_ASSERT(compiler_common.dfa_transitions[ind].type == type_end);
-				suggest_fast_forward = 0;
-				empty_match_id = compiler_common.search_states[ind].value;
-			}
-			else if (compiler_common.search_states[ind].type > 0) {
-				SLJIT_ASSERT(compiler_common.dfa_transitions[ind].type != type_end);
-				if (compiler_common.dfa_transitions[ind].type == type_rng_start && compiler_common.dfa_transitions[ind].value)
-					suggest_fast_forward = 0;
-			}
-			compiler_common.search_states[ind].value = -1;
-		}
-	}
-	else {
-		SLJIT_ASSERT(compiler_common.dfa_transitions[1].type == type_newline);
-		CHECK(trace_transitions(1, &compiler_common));
-		while (compiler_common.stack.count > 0) {
-			ind = stack_pop(&compiler_common.stack)->value;
-			if (compiler_common.search_states[ind].type == 0) {
-				SLJIT_ASSERT(compiler_common.dfa_transitions[ind].type == type_end);
-				suggest_fast_forward = 0;
-				empty_match_id = compiler_common.search_states[ind].value;
-			}
-			compiler_common.search_states[ind].value = -1;
-		}
-	}
+	machine = compile_machine(regex_string, (int)(ptr - regex_string), re_flags, count, error);
+	SLJIT_FREE(regex_string, NULL);
+	return machine;
+}
 
-	/* Step 4.1: Generate entry. */
-	CHECK(sljit_emit_enter(compiler_common.compiler, 0, SLJIT_ARGS3V(P, P, 32), 5, 5, 0, 0, 0));
+void regex_free_machine(struct regex_machine *machine)
+{
+	sljit_free_code(machine->continue_match, NULL);
+	if (machine->dfa)
+		SLJIT_FREE(machine->dfa, NULL);
+	if (machine->start_dispatch)
+		SLJIT_FREE(machine->start_dispatch, NULL);
+	if (machine->range_bitmaps)
+		SLJIT_FREE(machine->range_bitmaps, NULL);
+	if (machine->serialized)
+		SLJIT_FREE(machine->serialized, NULL);
+	SLJIT_FREE(machine, NULL);
+}
 
-	/* Copy arguments to their place. */
-	EMIT_OP1(SLJIT_MOV, R_REGEX_MATCH, 0, SLJIT_S0, 0);
-	EMIT_OP1(SLJIT_MOV, R_STRING, 0, SLJIT_S1, 0);
-	EMIT_OP2(SLJIT_ADD, R_LENGTH, 0, SLJIT_S2, 0, SLJIT_IMM, 1);
+long regex_get_machine_size(struct regex_machine *machine, long *code_size, long *match_size)
+{
+	sljit_sw terms_size = machine->size / machine->no_states;
+	sljit_uw size = sizeof(struct regex_machine) + (sljit_uw)(terms_size - 1) * sizeof(sljit_uw) + machine->code_size;
+
+	if (machine->dfa)
+		size += sizeof(struct regex_dfa) + DFA_TABLES_SIZE(terms_size, machine->dfa->set_size);
+	if (machine->start_dispatch)
+		size += 256 * sizeof(sljit_uw);
+	if (machine->range_bitmaps)
+		size += (sljit_uw)machine->range_bitmap_count * REGEX_RANGE_BITMAP_WORDS * sizeof(sljit_u32);
+	if (machine->serialized)
+		size += machine->serialized_size;
+
+	if (code_size)
+		*code_size = (long)machine->code_size;
+	if (match_size)
+		*match_size = (long)MATCH_SIZE(machine);
+	return (long)size;
+}
 
-	/* Init global registers. */
-	EMIT_OP1(SLJIT_MOV, R_CURR_STATE, 0, SLJIT_MEM1(R_REGEX_MATCH), SLJIT_OFFSETOF(struct regex_match, current));
-	EMIT_OP1(SLJIT_MOV, R_NEXT_STATE, 0, SLJIT_MEM1(R_REGEX_MATCH), SLJIT_OFFSETOF(struct regex_match, next));
-	EMIT_OP1(SLJIT_MOV, R_NEXT_HEAD, 0, SLJIT_MEM1(R_REGEX_MATCH), SLJIT_OFFSETOF(struct regex_match, head));
-	EMIT_OP1(SLJIT_MOV, R_BEST_BEGIN, 0, SLJIT_MEM1(R_REGEX_MATCH), SLJIT_OFFSETOF(struct regex_match, best_begin));
-	EMIT_OP1(SLJIT_MOV, R_CURR_INDEX, 0, SLJIT_MEM1(R_REGEX_MATCH), SLJIT_OFFSETOF(struct regex_match, index));
+void* regex_serialize_machine(struct regex_machine *machine, int *size)
+{
+	void *buffer;
 
-	/* Check whether the best match has already found in a previous frame. */
-	EMIT_CMP(jump, SLJIT_EQUAL, SLJIT_MEM1(R_REGEX_MATCH), SLJIT_OFFSETOF(struct regex_match, fast_quit), SLJIT_IMM, 0);
-	EMIT_JUMP(best_match_found_jump, SLJIT_JUMP);
+	if (!machine->serialized)
+		return NULL;
 
-#ifdef REGEX_MATCH_VERBOSE
-	if (compiler_common.flags & REGEX_MATCH_VERBOSE)
-		printf("\n-----------------\nTrace\n-----------------\n");
-#endif
+	buffer = SLJIT_MALLOC(machine->serialized_size, NULL);
+	if (!buffer)
+		return NULL;
 
-	/* Step 4.2: Generate code for state 0. */
-	EMIT_LABEL(label);
-	sljit_emit_op0(compiler_common.compiler, SLJIT_ENDBR);
-	compiler_common.machine->entry_addrs[0] = (sljit_uw)label;
+	SLJIT_MEMCPY(buffer, machine->serialized, machine->serialized_size);
+	if (size)
+		*size = (int)machine->serialized_size;
+	return buffer;
+}
 
-	/* Swapping current and next. */
-	EMIT_OP1(SLJIT_MOV, R_TEMP, 0, R_CURR_STATE, 0);
-	EMIT_OP1(SLJIT_MOV, R_CURR_STATE, 0, R_NEXT_STATE, 0);
-	EMIT_OP1(SLJIT_MOV, R_NEXT_STATE, 0, R_TEMP, 0);
+static int check_serialized_header(const struct regex_serialized_header *header, int size)
+{
+	struct sljit_cpu_profile profile;
+	sljit_sw max_items = size / (sljit_sw)sizeof(sljit_uw);
 
-	/* Checking whether the best case needs to be updated. */
-	if (!(compiler_common.flags & REGEX_MATCH_END)) {
-		EMIT_CMP(end_check_jump, SLJIT_NOT_EQUAL, SLJIT_MEM1(R_CURR_STATE), TERM_REL_OFFSET_OF(0, 1), SLJIT_IMM, -1);
-		EMIT_LABEL(end_check_label);
-	}
-	EMIT_OP1(SLJIT_MOV, SLJIT_MEM1(R_NEXT_STATE), TERM_REL_OFFSET_OF(0, 1), SLJIT_IMM, -1);
-	EMIT_OP2(SLJIT_ADD, R_CURR_INDEX, 0, R_CURR_INDEX, 0, SLJIT_IMM, 1);
+	if (size < (int)sizeof(struct regex_serialized_header))
+		return 0;
 
-	/* Checking whether best case has already found. */
-	if (!(compiler_common.flags & REGEX_MATCH_END) || (compiler_common.flags & REGEX_MATCH_BEGIN)) {
-		if (!(compiler_common.flags & REGEX_MATCH_BEGIN)) {
-			/* We can bail out if no more active states remain and R_BEST_BEGIN != -1. */
-			EMIT_CMP(best_match_check_jump, SLJIT_NOT_EQUAL, R_BEST_BEGIN, 0, SLJIT_IMM, -1);
-		}
-		else {
-			/* We can bail out if no more active states remain (regardless of R_BEST_BEGIN). */
-			EMIT_CMP(best_match_check_jump, SLJIT_EQUAL, R_NEXT_HEAD, 0, SLJIT_IMM, 0);
-		}
-	}
+	sljit_get_cpu_profile(&profile);
+	if (header->signature != REGEX_SERIALIZE_SIGNATURE || header->version != REGEX_SERIALIZE_VERSION
+			|| header->cpu_features != profile.features || header->type_sizes != SERIALIZE_TYPE_SIZES)
+		return 0;
 
-	EMIT_LABEL(start_label);
-	sljit_set_label(jump, start_label);
+	if (header->capture_count < 0 || header->capture_count > max_items
+			|| header->no_states < 2 + 2 * header->capture_count || header->no_states > 4 + 2 * header->capture_count
+			|| header->terms_size <= 0 || header->terms_size > max_items
+			|| header->set_count < 0 || header->set_count > max_items
+			|| header->counter_words < 0 || header->counter_gap < 0 || (header->counter_words == 0) != (header->counter_gap == 0)
+			|| header->range_bitmap_count < 0 || header->range_bitmap_count > max_items)
+		return 0;
 
-	if (!(compiler_common.flags & REGEX_MATCH_BEGIN) && suggest_fast_forward) {
-		EMIT_CMP(fast_forward_jump, SLJIT_NOT_EQUAL, SLJIT_MEM1(R_REGEX_MATCH), SLJIT_OFFSETOF(struct regex_match, fast_forward), SLJIT_IMM, 0);
+	if (header->dfa_set_size != 0) {
+		if (header->dfa_set_size != (header->terms_size + REGEX_DFA_WORD_BITS - 1) / REGEX_DFA_WORD_BITS
+				|| header->dfa_restart_count < 0 || header->dfa_restart_count > header->terms_size)
+			return 0;
 	}
 
-	/* Loading the next character. */
-	EMIT_OP2(SLJIT_SUB | SLJIT_SET_Z, R_LENGTH, 0, R_LENGTH, 0, SLJIT_IMM, 1);
-	EMIT_JUMP(length_is_zero_jump, SLJIT_EQUAL);
-
-	EMIT_OP1(SLJIT_MOV, R_TEMP, 0, R_STRING, 0);
 #ifdef REGEX_USE_8BIT_CHARS
-	EMIT_OP1(SLJIT_MOV_U8, R_CURR_CHAR, 0, SLJIT_MEM1(R_TEMP), 0);
-	EMIT_OP2(SLJIT_ADD, R_TEMP, 0, R_TEMP, 0, SLJIT_IMM, 1);
+	if (header->start_dispatch != 0 && header->start_dispatch != 1)
+		return 0;
 #else
-	EMIT_OP1(SLJIT_MOV_UH, R_CURR_CHAR, 0, SLJIT_MEM1(R_TEMP), 0);
-	EMIT_OP2(SLJIT_ADD, R_TEMP, 0, R_TEMP, 0, SLJIT_IMM, 2);
+	if (header->start_dispatch != 0)
+		return 0;
 #endif
-	EMIT_OP1(SLJIT_MOV, R_STRING, 0, R_TEMP, 0);
 
-#ifdef REGEX_MATCH_VERBOSE
-	if (compiler_common.flags & REGEX_MATCH_VERBOSE) {
-		printf("(%3d): ", 0);
-		CHECK(trace_transitions(0, &compiler_common));
-		while (compiler_common.stack.count > 0) {
-			ind = stack_pop(&compiler_common.stack)->value;
-			if (compiler_common.search_states[ind].type >= 0)
-				printf("-> (%3d:%3d) ", compiler_common.search_states[ind].type, compiler_common.search_states[ind].value);
-			compiler_common.search_states[ind].value = -1;
-		}
-		printf("\n");
+	return (sljit_uw)size == sizeof(struct regex_serialized_header) + serialized_data_size((struct regex_serialized_header*)header) + header->compiler_size;
+}
+
+struct regex_machine* regex_deserialize_machine(const void *buffer, int size, int *error)
+{
+	const struct regex_serialized_header *header = (const struct regex_serialized_header*)buffer;
+	struct regex_machine *machine;
+	struct sljit_compiler *compiler;
+	struct sljit_label **labels;
+	struct sljit_label *label;
+	struct sljit_const *const_;
+	const sljit_uw *label_indices;
+	const sljit_u8 *data;
+	sljit_uw label_count, bitmap_size;
+	sljit_sw executable_offset;
+	sljit_sw ind;
+	int error_code = REGEX_INVALID_DATA;
+	int done = 0;
+
+	if (((sljit_uw)buffer & (sizeof(sljit_uw) - 1)) != 0 || !check_serialized_header(header, size)) {
+		if (error)
+			*error = REGEX_INVALID_DATA;
+		return NULL;
+	}
+
+	machine = (struct regex_machine*)SLJIT_MALLOC(sizeof(struct regex_machine) + (sljit_uw)(header->terms_size - 1) * sizeof(sljit_uw), NULL);
+	if (!machine) {
+		if (error)
+			*error = REGEX_MEMORY_ERROR;
+		return NULL;
 	}
-#endif
 
-	EMIT_LABEL(fast_forward_return_label);
-	if (!(compiler_common.flags & REGEX_MATCH_BEGIN)) {
-		EMIT_OP1(SLJIT_MOV, SLJIT_MEM1(R_REGEX_MATCH), SLJIT_OFFSETOF(struct regex_match, fast_forward), SLJIT_IMM, 1);
-		if (!(compiler_common.flags & REGEX_MATCH_END)) {
-			EMIT_CMP(jump, SLJIT_NOT_EQUAL, R_BEST_BEGIN, 0, SLJIT_IMM, -1);
-		}
+	machine->flags = (int)header->flags;
+	machine->no_states = header->no_states;
+	machine->size = header->no_states * header->terms_size;
+	machine->continue_match = NULL;
+	machine->dfa = NULL;
+	machine->set_count = header->set_count;
+	machine->capture_count = header->capture_count;
+	machine->counter_words = header->counter_words;
+	machine->counter_gap = header->counter_gap;
+	machine->start_dispatch = NULL;
+	machine->range_bitmaps = NULL;
+	machine->range_bitmap_count = header->range_bitmap_count;
+	machine->serialized = NULL;
+	compiler = NULL;
+	labels = NULL;
+
+	label_indices = (const sljit_uw*)(header + 1);
+	data = (const sljit_u8*)(label_indices + header->terms_size + (header->start_dispatch ? 256 : 0));
 
-		EMIT_OP1(SLJIT_MOV, R_TEMP, 0, R_CURR_INDEX, 0);
-		CHECK(compile_uncond_tran(&compiler_common, R_NEXT_STATE));
-		/* And branching to the first state. */
-		CHECK(sljit_emit_ijump(compiler_common.compiler, SLJIT_JUMP, SLJIT_MEM2(R_CURR_STATE, R_TEMP), 0));
+	do {
+		error_code = REGEX_MEMORY_ERROR;
 
-		if (!(compiler_common.flags & REGEX_MATCH_END)) {
-			EMIT_LABEL(label);
-			sljit_set_label(jump, label);
+		bitmap_size = (sljit_uw)header->range_bitmap_count * REGEX_RANGE_BITMAP_WORDS * sizeof(sljit_u32);
+		if (bitmap_size > 0) {
+			machine->range_bitmaps = (sljit_u32*)SLJIT_MALLOC(bitmap_size, NULL);
+			if (!machine->range_bitmaps)
+				break;
+			SLJIT_MEMCPY(machine->range_bitmaps, data, bitmap_size);
+			data += bitmap_size;
 		}
-	}
-	/* This is the case where we only have to reset the R_NEXT_HEAD. */
-	EMIT_OP1(SLJIT_MOV, R_TEMP, 0, R_NEXT_HEAD, 0);
-	EMIT_OP1(SLJIT_MOV, R_NEXT_HEAD, 0, SLJIT_IMM, 0);
-	CHECK(sljit_emit_ijump(compiler_common.compiler, SLJIT_JUMP, SLJIT_MEM2(R_CURR_STATE, R_TEMP), 0));
 
-	/* Fast-forward loop. */
-	if (fast_forward_jump) {
-		/* Quit from fast-forward loop. */
-		EMIT_LABEL(fast_forward_label);
-		EMIT_OP2(SLJIT_SUB, R_TEMP, 0, R_NEXT_HEAD, 0, SLJIT_IMM, 1);
-		EMIT_OP1(SLJIT_MOV, R_LENGTH, 0, R_NEXT_STATE, 0);
-		EMIT_OP1(SLJIT_MOV, R_STRING, 0, R_CURR_STATE, 0);
-		EMIT_OP1(SLJIT_MOV, R_CURR_INDEX, 0, R_NEXT_HEAD, 0);
-		EMIT_OP1(SLJIT_MOV, R_NEXT_STATE, 0, SLJIT_MEM1(R_REGEX_MATCH), SLJIT_OFFSETOF(struct regex_match, next));
-		EMIT_OP1(SLJIT_MOV, R_CURR_STATE, 0, SLJIT_MEM1(R_REGEX_MATCH), SLJIT_OFFSETOF(struct regex_match, current));
-		EMIT_OP1(SLJIT_MOV, R_NEXT_HEAD, 0, SLJIT_MEM1(R_REGEX_MATCH), SLJIT_OFFSETOF(struct regex_match, head));
+		if (header->dfa_set_size > 0) {
+			machine->dfa = (struct regex_dfa*)SLJIT_MALLOC(sizeof(struct regex_dfa) + DFA_TABLES_SIZE(header->terms_size, header->dfa_set_size), NULL);
+			if (!machine->dfa)
+				break;
+			machine->dfa->set_size = header->dfa_set_size;
+			machine->dfa->restart_count = header->dfa_restart_count;
+			dfa_set_tables(machine->dfa, header->terms_size);
+			SLJIT_MEMCPY(machine->dfa + 1, data, DFA_TABLES_SIZE(header->terms_size, header->dfa_set_size));
+		}
 
-		/* Update the start field of the locations. */
-		CHECK(trace_transitions(0, &compiler_common));
-		while (compiler_common.stack.count > 0) {
-			ind = stack_pop(&compiler_common.stack)->value;
-			if (compiler_common.search_states[ind].type >= 0) {
-				EMIT_OP1(SLJIT_MOV, SLJIT_MEM1(R_CURR_STATE), TERM_OFFSET_OF(compiler_common.search_states[ind].type, 2), R_TEMP, 0);
-			}
-			compiler_common.search_states[ind].value = -1;
+		if (header->start_dispatch) {
+			machine->start_dispatch = (sljit_uw*)SLJIT_MALLOC(256 * sizeof(sljit_uw), NULL);
+			if (!machine->start_dispatch)
+				break;
 		}
-		EMIT_OP1(SLJIT_MOV, SLJIT_MEM1(R_REGEX_MATCH), SLJIT_OFFSETOF(struct regex_match, fast_forward), SLJIT_IMM, 0);
-		EMIT_JUMP(jump, SLJIT_JUMP);
-		sljit_set_label(jump, fast_forward_return_label);
 
-		/* Start fast-forward. */
-		EMIT_LABEL(label);
-		sljit_set_label(fast_forward_jump, label);
+		if (header->flags & REGEX_SERIALIZABLE) {
+			machine->serialized = (sljit_uw*)SLJIT_MALLOC((sljit_uw)size, NULL);
+			if (!machine->serialized)
+				break;
+			SLJIT_MEMCPY(machine->serialized, buffer, (sljit_uw)size);
+			machine->serialized_size = (sljit_uw)size;
+		}
 
-		/* Moving everything to registers. */
-		EMIT_OP1(SLJIT_MOV, SLJIT_MEM1(R_REGEX_MATCH), SLJIT_OFFSETOF(struct regex_match, next), R_NEXT_STATE, 0);
-		EMIT_OP1(SLJIT_MOV, SLJIT_MEM1(R_REGEX_MATCH), SLJIT_OFFSETOF(struct regex_match, current), R_CURR_STATE, 0);
-		EMIT_OP1(SLJIT_MOV, SLJIT_MEM1(R_REGEX_MATCH), SLJIT_OFFSETOF(struct regex_match, head), R_NEXT_HEAD, 0);
-		EMIT_OP1(SLJIT_MOV, R_NEXT_STATE, 0, R_LENGTH, 0);
-		EMIT_OP1(SLJIT_MOV, R_CURR_STATE, 0, R_STRING, 0);
-		EMIT_OP1(SLJIT_MOV, R_NEXT_HEAD, 0, R_CURR_INDEX, 0);
+		data = (const sljit_u8*)(header + 1) + serialized_data_size((struct regex_serialized_header*)header);
+		compiler = sljit_deserialize_compiler((sljit_uw*)data, header->compiler_size, 0, NULL);
+		if (!compiler)
+			break;
 
-		/* Fast forward mainloop. */
-		EMIT_LABEL(label);
-		EMIT_OP2(SLJIT_SUB | SLJIT_SET_Z, R_NEXT_STATE, 0, R_NEXT_STATE, 0, SLJIT_IMM, 1);
-		EMIT_JUMP(fast_forward_jump, SLJIT_EQUAL);
+		error_code = REGEX_INVALID_DATA;
 
-#ifdef REGEX_USE_8BIT_CHARS
-		EMIT_OP1(SLJIT_MOV_U8, R_CURR_CHAR, 0, SLJIT_MEM1(R_CURR_STATE), 0);
-		EMIT_OP2(SLJIT_ADD, R_CURR_STATE, 0, R_CURR_STATE, 0, SLJIT_IMM, 1);
-#else
-		EMIT_OP1(SLJIT_MOV_UH, R_CURR_CHAR, 0, SLJIT_MEM1(R_CURR_STATE), 0);
-		EMIT_OP2(SLJIT_ADD, R_CURR_STATE, 0, R_CURR_STATE, 0, SLJIT_IMM, 2);
-#endif
+		/* Each bitmap address is loaded by a constant. */
+		ind = 0;
+		for (const_ = sljit_get_first_const(compiler); const_; const_ = sljit_get_next_const(const_))
+			ind++;
+		if (ind != header->range_bitmap_count)
+			break;
 
-		CHECK(trace_transitions(0, &compiler_common));
-		CHECK(compile_leave_fast_forward(&compiler_common, fast_forward_label));
+		label_count = 0;
+		for (label = sljit_get_first_label(compiler); label; label = sljit_get_next_label(label))
+			label_count++;
 
-		EMIT_OP2(SLJIT_ADD, R_NEXT_HEAD, 0, R_NEXT_HEAD, 0, SLJIT_IMM, 1);
-		EMIT_JUMP(jump, SLJIT_JUMP);
-		sljit_set_label(jump, label);
+		for (ind = 0; ind < header->terms_size + (header->start_dispatch ? 256 : 0); ind++)
+			if (label_indices[ind] >= label_count)
+				break;
+		if (ind < header->terms_size + (header->start_dispatch ? 256 : 0) || (sljit_uw)header->init_label >= label_count)
+			break;
 
-		/* String is finished. */
-		EMIT_LABEL(label);
-		sljit_set_label(fast_forward_jump, label);
-		EMIT_OP1(SLJIT_MOV, SLJIT_MEM1(R_REGEX_MATCH), SLJIT_OFFSETOF(struct regex_match, index), R_NEXT_HEAD, 0);
-		EMIT_JUMP(fast_forward_jump, SLJIT_JUMP);
-	}
+		error_code = REGEX_MEMORY_ERROR;
+		labels = (struct sljit_label**)SLJIT_MALLOC(label_count * sizeof(struct sljit_label*), NULL);
+		if (!labels)
+			break;
 
-	/* End check. */
-	if (end_check_jump) {
-		EMIT_LABEL(label);
-		sljit_set_label(end_check_jump, label);
+		label_count = 0;
+		for (label = sljit_get_first_label(compiler); label; label = sljit_get_next_label(label))
+			labels[label_count++] = label;
 
-		if (!(compiler_common.flags & REGEX_MATCH_NON_GREEDY) || !(compiler_common.flags & REGEX_MATCH_BEGIN)) {
-			CHECK(compile_end_check(&compiler_common, end_check_label));
+		machine->continue_match = sljit_generate_code(compiler, 0, NULL);
+		if (!machine->continue_match)
+			break;
+		machine->code_size = sljit_get_generated_code_size(compiler);
+
+#ifndef SLJIT_INDIRECT_CALL
+		machine->u.init_match = (void*)(sljit_sw)sljit_get_label_addr(labels[header->init_label]);
+#else
+		sljit_set_function_context(&machine->u.init_match, &machine->context, sljit_get_label_addr(labels[header->init_label]), regex_compile);
+#endif
+
+		for (ind = 0; ind < header->terms_size; ind++)
+			machine->entry_addrs[ind] = sljit_get_label_addr(labels[label_indices[ind]]);
+		if (machine->start_dispatch) {
+			for (ind = 0; ind < 256; ind++)
+				machine->start_dispatch[ind] = sljit_get_label_addr(labels[label_indices[header->terms_size + ind]]);
 		}
-		else {
-			/* Since we leave, we do not need to update the R_BEST_BEGIN. */
-			EMIT_OP1(SLJIT_MOV, SLJIT_MEM1(R_REGEX_MATCH), SLJIT_OFFSETOF(struct regex_match, best_begin), SLJIT_IMM, 0);
-			EMIT_OP1(SLJIT_MOV, SLJIT_MEM1(R_REGEX_MATCH), SLJIT_OFFSETOF(struct regex_match, best_end), R_CURR_INDEX, 0);
-			if (compiler_common.flags & REGEX_ID_CHECK) {
-				EMIT_OP1(SLJIT_MOV, SLJIT_MEM1(R_REGEX_MATCH), SLJIT_OFFSETOF(struct regex_match, best_id), SLJIT_MEM1(R_CURR_STATE), TERM_REL_OFFSET_OF(0, 2));
-			}
-			EMIT_OP1(SLJIT_MOV, SLJIT_MEM1(R_REGEX_MATCH), SLJIT_OFFSETOF(struct regex_match, fast_quit), SLJIT_IMM, 1);
-			EMIT_JUMP(non_greedy_end_jump, SLJIT_JUMP);
+
+		executable_offset = sljit_get_executable_offset(compiler);
+		ind = 0;
+		for (const_ = sljit_get_first_const(compiler); const_; const_ = sljit_get_next_const(const_)) {
+			sljit_set_const(sljit_get_const_addr(const_), (sljit_sw)(machine->range_bitmaps + ind * REGEX_RANGE_BITMAP_WORDS), executable_offset);
+			ind++;
 		}
+
+		done = 1;
+	} while (0);
+
+	if (labels)
+		SLJIT_FREE(labels, NULL);
+	if (compiler)
+		sljit_free_compiler(compiler);
+	if (done)
+		return machine;
+
+	if (machine->continue_match)
+		sljit_free_code(machine->continue_match, NULL);
+	if (machine->dfa)
+		SLJIT_FREE(machine->dfa, NULL);
+	if (machine->start_dispatch)
+		SLJIT_FREE(machine->start_dispatch, NULL);
+	if (machine->range_bitmaps)
+		SLJIT_FREE(machine->range_bitmaps, NULL);
+	if (machine->serialized)
+		SLJIT_FREE(machine->serialized, NULL);
+	SLJIT_FREE(machine, NULL);
+	if (error)
+		*error = error_code;
+	return NULL;
+}
+
+const char* regex_get_platform_name(void)
+{
+	return sljit_get_platform_name();
+}
+
+/* --------------------------------------------------------------------- */
+/*  Mathching utilities                                                  */
+/* --------------------------------------------------------------------- */
+
+static void clear_current_states(struct regex_match *match)
+{
+	sljit_sw current, ind;
+	sljit_sw *current_ptr;
+
+	if (match->head != 0) {
+		current = match->head;
+		current_ptr = match->current;
+		do {
+			ind = (current / (sljit_sw)sizeof(sljit_sw)) + 1;
+			current = current_ptr[ind];
+			current_ptr[ind] = -1;
+		} while (current != 0);
 	}
+	/* The offset of the end term terminates the list, so it is not visited above. */
+	match->current[1] = -1;
+}
 
-	/* Finish check. */
-	if (best_match_check_jump) {
-		EMIT_LABEL(label);
-		sljit_set_label(best_match_check_jump, label);
+/* Counter data of a match (see the counted repetitions). */
+#define COUNTER_DATA(match) \
+	((match)->states + 2 * (match)->machine->size + SET_DATA_WORDS((match)->machine->set_count) + CAPTURE_DATA_WORDS((match)->machine->capture_count))
 
-		if (!(compiler_common.flags & REGEX_MATCH_BEGIN)) {
-			EMIT_CMP(jump, SLJIT_NOT_EQUAL, R_NEXT_HEAD, 0, SLJIT_IMM, 0);
-			sljit_set_label(jump, start_label);
-		}
-		EMIT_OP1(SLJIT_MOV, SLJIT_MEM1(R_REGEX_MATCH), SLJIT_OFFSETOF(struct regex_match, fast_quit), SLJIT_IMM, 1);
+static void clear_counters(struct regex_match *match)
+{
+	sljit_sw *counters = COUNTER_DATA(match);
+	sljit_sw i;
+
+	for (i = 0; i < match->machine->counter_words; i++)
+		counters[i] = 0;
+}
+
+static struct regex_dfa_state* dfa_get_state(struct regex_match *match, sljit_uw *set)
+{
+	struct regex_dfa_cache *cache = match->dfa_cache;
+	sljit_sw set_size = match->machine->dfa->set_size;
+	struct regex_dfa_state *state;
+	struct regex_dfa_state **bucket;
+	sljit_uw hash = 0;
+	sljit_sw i;
+
+	for (i = 0; i < set_size; i++)
+		hash = (hash ^ set[i]) * 0x9e3779b1;
+
+	bucket = cache->buckets + ((hash >> 16) & (REGEX_DFA_HASH_SIZE - 1));
+	for (state = *bucket; state; state = state->hash_next) {
+		if (state->hash != hash)
+			continue;
+
+		for (i = 0; i < set_size; i++)
+			if (state->set[i] != set[i])
+				break;
+		if (i == set_size)
+			return state;
 	}
 
-	/* Leaving matching and storing the necessary values. */
-	EMIT_LABEL(label);
-	sljit_set_label(length_is_zero_jump, label);
-	if (non_greedy_end_jump)
-		sljit_set_label(non_greedy_end_jump, label);
+	if (cache->state_count >= REGEX_DFA_MAX_STATES)
+		return NULL;
 
-	EMIT_OP1(SLJIT_MOV, SLJIT_MEM1(R_REGEX_MATCH), SLJIT_OFFSETOF(struct regex_match, index), R_CURR_INDEX, 0);
-	EMIT_OP1(SLJIT_MOV, SLJIT_MEM1(R_REGEX_MATCH), SLJIT_OFFSETOF(struct regex_match, head), R_NEXT_HEAD, 0);
-	EMIT_OP1(SLJIT_MOV, SLJIT_MEM1(R_REGEX_MATCH), SLJIT_OFFSETOF(struct regex_match, next), R_NEXT_STATE, 0);
-	EMIT_OP1(SLJIT_MOV, SLJIT_MEM1(R_REGEX_MATCH), SLJIT_OFFSETOF(struct regex_match, current), R_CURR_STATE, 0);
+	state = (struct regex_dfa_state*)SLJIT_MALLOC(sizeof(struct regex_dfa_state) + (sljit_uw)(set_size - 1) * sizeof(sljit_uw), NULL);
+	if (!state)
+		return NULL;
 
-	/* Exit from JIT. */
-	EMIT_LABEL(label);
-	sljit_set_label(best_match_found_jump, label);
-	if (fast_forward_jump)
-		sljit_set_label(fast_forward_jump, label);
-	CHECK(sljit_emit_return_void(compiler_common.compiler));
+	for (i = 0; i < 256; i++)
+		state->next[i] = NULL;
 
-	for (ind = 1; ind < (sljit_sw)compiler_common.dfa_size - 1; ind++) {
-		if (compiler_common.search_states[ind].type >= 0) {
-			SLJIT_ASSERT(compiler_common.search_states[ind].type < compiler_common.terms_size);
-			EMIT_LABEL(label);
-			sljit_emit_op0(compiler_common.compiler, SLJIT_ENDBR);
-			compiler_common.machine->entry_addrs[compiler_common.search_states[ind].type] = (sljit_uw)label;
+	state->hash = hash;
+	state->flags = REGEX_DFA_RESTART;
+	for (i = 0; i < set_size; i++) {
+		state->set[i] = set[i];
+		if (set[i] != 0)
+			state->flags = 0;
+	}
 
-			if (compiler_common.dfa_transitions[ind].type == type_char) {
-				EMIT_CMP(jump, SLJIT_NOT_EQUAL, R_CURR_CHAR, 0, SLJIT_IMM, compiler_common.dfa_transitions[ind].value);
-			}
-			else if (compiler_common.dfa_transitions[ind].type == type_rng_start) {
-				ind = compile_range_check(&compiler_common, ind);
-				CHECK(!ind);
-			}
-			else {
-				SLJIT_ASSERT(compiler_common.dfa_transitions[ind].type == type_newline);
-				CHECK(compile_newline_check(&compiler_common, ind));
-			}
+	/* The end term is only checked at the end of the input in this case. */
+	if (!(match->machine->flags & REGEX_MATCH_END) && (set[0] & 0x1))
+		state->flags |= REGEX_DFA_ACCEPT;
 
-			CHECK(trace_transitions((int)ind, &compiler_common));
-#ifdef REGEX_MATCH_VERBOSE
-			if (compiler_common.flags & REGEX_MATCH_VERBOSE)
-				printf("(%3d): ", compiler_common.search_states[ind].type);
-#endif
-			CHECK(compile_cond_tran(&compiler_common, compiler_common.search_states[ind].type));
+	state->hash_next = *bucket;
+	*bucket = state;
+	cache->state_count++;
+	return state;
+}
 
-			if (compiler_common.dfa_transitions[ind].type == type_char) {
-				EMIT_LABEL(label);
-				sljit_set_label(jump, label);
-			}
-			else if (compiler_common.dfa_transitions[ind].type == type_rng_end) {
-				EMIT_LABEL(label);
-				range_set_label(compiler_common.range_jump_list, label);
-			}
-			else {
-				SLJIT_ASSERT(compiler_common.dfa_transitions[ind].type == type_newline);
-			}
+static struct regex_dfa_state* dfa_next_state(struct regex_match *match, struct regex_dfa_state *state, sljit_uw chr)
+{
+	struct regex_dfa *dfa = match->machine->dfa;
+	sljit_uw *work = match->dfa_cache->work;
+	sljit_sw set_size = dfa->set_size;
+	sljit_u8 *chars = dfa->chars + (chr >> 3);
+	sljit_u8 mask = (sljit_u8)(1 << (chr & 0x7));
+	sljit_uw *follow;
+	sljit_uw bits;
+	sljit_sw i, j, term;
+
+	for (i = 0; i < set_size; i++)
+		work[i] = 0;
+
+	/* Same as a step of the machine code: the restart set is active before every character. */
+	for (i = 0; i < set_size; i++) {
+		bits = state->set[i] | dfa->restart[i];
+		for (term = i * REGEX_DFA_WORD_BITS; bits != 0; term++, bits >>= 1) {
+			if (!(bits & 0x1) || !(chars[term * 32] & mask))
+				continue;
 
-			/* Branch to the next item in the list. */
-			EMIT_OP1(SLJIT_MOV, R_TEMP, 0, SLJIT_MEM1(R_CURR_STATE), TERM_OFFSET_OF(compiler_common.search_states[ind].type, 1));
-			EMIT_OP1(SLJIT_MOV, SLJIT_MEM1(R_CURR_STATE), TERM_OFFSET_OF(compiler_common.search_states[ind].type, 1), SLJIT_IMM, -1);
-			CHECK(sljit_emit_ijump(compiler_common.compiler, SLJIT_JUMP, SLJIT_MEM2(R_CURR_STATE, R_TEMP), 0));
+			follow = dfa->follow + term * set_size;
+			for (j = 0; j < set_size; j++)
+				work[j] |= follow[j];
 		}
 	}
 
-	if (ind == (sljit_sw)compiler_common.dfa_size - 1) {
-		/* Generate an init stub function. */
-		EMIT_LABEL(label);
-		CHECK(sljit_emit_enter(compiler_common.compiler, 0, SLJIT_ARGS2(W, P, P), 3, 3, 0, 0, 0));
+	/* Remains NULL when the cache is full. */
+	state->next[chr] = dfa_get_state(match, work);
+	return state->next[chr];
+}
 
-		if (empty_match_id == -1) {
-			EMIT_OP1(SLJIT_MOV, SLJIT_MEM1(SLJIT_S1), SLJIT_OFFSETOF(struct regex_match, best_begin), SLJIT_IMM, -1);
-			EMIT_OP1(SLJIT_MOV, SLJIT_MEM1(SLJIT_S1), SLJIT_OFFSETOF(struct regex_match, best_id), SLJIT_IMM, 0);
-		}
-		else {
-			EMIT_OP1(SLJIT_MOV, SLJIT_MEM1(SLJIT_S1), SLJIT_OFFSETOF(struct regex_match, best_begin), SLJIT_IMM, 0);
-			EMIT_OP1(SLJIT_MOV, SLJIT_MEM1(SLJIT_S1), SLJIT_OFFSETOF(struct regex_match, best_id), SLJIT_IMM, empty_match_id);
-		}
+static int dfa_init_cache(struct regex_match *match)
+{
+	sljit_sw set_size = match->machine->dfa->set_size;
+	struct regex_dfa_cache *cache;
+	sljit_sw i;
 
-		EMIT_OP1(SLJIT_MOV, SLJIT_MEM1(SLJIT_S1), SLJIT_OFFSETOF(struct regex_match, index), SLJIT_IMM, !(compiler_common.flags & REGEX_FAKE_MATCH_BEGIN) ? 1 : 2);
+	cache = (struct regex_dfa_cache*)SLJIT_MALLOC(sizeof(struct regex_dfa_cache) + (sljit_uw)set_size * sizeof(sljit_uw), NULL);
+	match->dfa_cache = cache;
+	if (!cache)
+		return REGEX_MEMORY_ERROR;
 
-		if (!(compiler_common.flags & REGEX_MATCH_NON_GREEDY) || empty_match_id == -1) {
-			/* The else is a really rare event, so we still generate an empty function instead of a runtime pointer check. */
-			SLJIT_ASSERT(R_CURR_STATE == SLJIT_S0);
-			if (!(compiler_common.flags & REGEX_MATCH_BEGIN)) {
-				/* R_CURR_INDEX (put to R_TEMP) is zero. */
-				EMIT_OP1(SLJIT_MOV, R_TEMP, 0, SLJIT_IMM, 0);
-			}
-			CHECK(compile_uncond_tran(&compiler_common, R_CURR_STATE));
-		}
-		else {
-			EMIT_OP1(SLJIT_MOV, R_NEXT_HEAD, 0, SLJIT_IMM, 0);
-		}
-		CHECK(sljit_emit_return(compiler_common.compiler, SLJIT_MOV, R_NEXT_HEAD, 0));
+	cache->restart_index = 0;
+	cache->state_count = 0;
+	cache->work = (sljit_uw*)(cache + 1);
+	for (i = 0; i < REGEX_DFA_HASH_SIZE; i++)
+		cache->buckets[i] = NULL;
 
-		compiler_common.machine->continue_match = sljit_generate_code(compiler_common.compiler, 0, NULL);
-#ifndef SLJIT_INDIRECT_CALL
-		compiler_common.machine->u.init_match = (void*)(sljit_sw)sljit_get_label_addr(label);
-#else
-		sljit_set_function_context(&compiler_common.machine->u.init_match, &compiler_common.machine->context, sljit_get_label_addr(label), regex_compile);
-#endif
-#ifdef REGEX_MATCH_VERBOSE
-		if (compiler_common.flags & REGEX_MATCH_VERBOSE)
-			printf("Continue match: %p Init match: %p\n\n", compiler_common.machine->continue_match, compiler_common.machine->u.init_match);
-#endif
-		if (compiler_common.machine->continue_match) {
-			for (ind = 0; ind < compiler_common.terms_size; ++ind)
-				compiler_common.machine->entry_addrs[ind] = sljit_get_label_addr((struct sljit_label*)compiler_common.machine->entry_addrs[ind]);
-			done = 1;
+	cache->initial = dfa_get_state(match, match->machine->dfa->initial);
+	cache->current = cache->initial;
+	return cache->initial ? REGEX_NO_ERROR : REGEX_MEMORY_ERROR;
+}
+
+static void dfa_free_cache(struct regex_dfa_cache *cache)
+{
+	struct regex_dfa_state *state;
+	struct regex_dfa_state *next_state;
+	sljit_sw i;
+
+	for (i = 0; i < REGEX_DFA_HASH_SIZE; i++) {
+		state = cache->buckets[i];
+		while (state) {
+			next_state = state->hash_next;
+			SLJIT_FREE(state, NULL);
+			state = next_state;
 		}
 	}
-	END_GUARD
+	SLJIT_FREE(cache, NULL);
+}
 
-	stack_destroy(&compiler_common.stack);
-	stack_destroy(&compiler_common.depth);
-	SLJIT_FREE(compiler_common.dfa_transitions, NULL);
-	SLJIT_FREE(compiler_common.search_states, NULL);
-	if (compiler_common.range_jump_list)
-		SLJIT_FREE(compiler_common.range_jump_list, NULL);
-	if (compiler_common.compiler)
-		sljit_free_compiler(compiler_common.compiler);
-	if (done)
-		return compiler_common.machine;
+/* Recreates the machine states, when only the restart set is active. */
+static void dfa_restart_machine(struct regex_match *match, sljit_sw index)
+{
+	struct regex_machine *machine = match->machine;
+	sljit_sw no_states = machine->no_states;
+	sljit_sw *current_ptr = match->current;
+	sljit_sw *restart = machine->dfa->restart_list;
+	sljit_sw *end = restart + 2 * machine->dfa->restart_count;
+	sljit_sw head = 0;
+	sljit_sw ind;
 
-	if (compiler_common.machine) {
-		SLJIT_FREE(compiler_common.machine, NULL);
+	SLJIT_ASSERT(!(machine->flags & REGEX_MATCH_BEGIN) && no_states >= 3);
+
+	clear_current_states(match);
+	current_ptr[1] = -1;
+
+	/* Same as compile_uncond_tran. */
+	while (restart < end) {
+		SLJIT_ASSERT(restart[0] > 0);
+		ind = restart[0] * no_states;
+		current_ptr[ind + 1] = head;
+		current_ptr[ind + 2] = index - 1;
+		if (no_states == 4)
+			current_ptr[ind + 3] = restart[1];
+		head = ind * (sljit_sw)sizeof(sljit_sw);
+		restart += 2;
 	}
-	if (error)
-		*error = REGEX_MEMORY_ERROR;
-	return NULL;
-}
 
-#undef TERM_OFFSET_OF
-#undef EMIT_OP1
-#undef EMIT_OP2
-#undef EMIT_LABEL
-#undef EMIT_JUMP
-#undef EMIT_CMP
-#undef BEGIN_GUARD
-#undef END_GUARD
-#undef CHECK
+	match->head = head;
+	match->index = index;
+	match->fast_forward = 0;
+}
 
-void regex_free_machine(struct regex_machine *machine)
+static SLJIT_INLINE void dfa_sync_machine(struct regex_match *match)
 {
-	sljit_free_code(machine->continue_match, NULL);
-	SLJIT_FREE(machine, NULL);
+	if (match->dfa_cache && match->dfa_cache->restart_index != 0) {
+		dfa_restart_machine(match, match->dfa_cache->restart_index);
+		match->dfa_cache->restart_index = 0;
+	}
 }
 
-const char* regex_get_platform_name(void)
+static void dfa_continue_match(struct regex_match *match, const regex_char_t *input_string, int length)
 {
-	return sljit_get_platform_name();
-}
+	struct regex_dfa_cache *cache = match->dfa_cache;
+	struct regex_dfa_state *state = cache->current;
+	struct regex_dfa_state *next_state;
+	const regex_char_t *ptr = input_string;
+	const regex_char_t *end = input_string + length;
+	/* The machine states are valid at this position. */
+	const regex_char_t *sync = input_string;
+	sljit_sw index = cache->restart_index != 0 ? cache->restart_index : match->index;
+
+	while (ptr < end) {
+		next_state = state->next[(sljit_u8)*ptr];
+		if (SLJIT_UNLIKELY(!next_state)) {
+			next_state = dfa_next_state(match, state, (sljit_u8)*ptr);
+			if (!next_state) {
+				/* The cache is full: the machine code is used until the next reset. */
+				state = NULL;
+				break;
+			}
+		}
 
-/* --------------------------------------------------------------------- */
-/*  Mathching utilities                                                  */
-/* --------------------------------------------------------------------- */
+		state = next_state;
+		ptr++;
+
+		if (state->flags & REGEX_DFA_RESTART)
+			sync = ptr;
+		else if (state->flags & REGEX_DFA_ACCEPT) {
+			/* The machine code computes the exact result. */
+			state = NULL;
+			break;
+		}
+	}
+
+	cache->current = state;
+
+	/* Recreating the machine states is delayed, since they are often not needed. */
+	if (sync > input_string)
+		cache->restart_index = index + (sync - input_string);
+
+	if (sync < end) {
+		dfa_sync_machine(match);
+		match->u.call_continue(match, sync, (int)(end - sync));
+	}
+}
 
 struct regex_match* regex_begin_match(struct regex_machine *machine)
 {
+	sljit_sw ind;
 	sljit_sw *ptr1;
 	sljit_sw *ptr2;
 	sljit_sw *end;
 	sljit_sw *entry_addrs;
 
-	struct regex_match *match = (struct regex_match*)SLJIT_MALLOC(sizeof(struct regex_match) + (sljit_uw)(machine->size * 2 - 1) * sizeof(sljit_sw), NULL);
+	struct regex_match *match = (struct regex_match*)SLJIT_MALLOC(MATCH_SIZE(machine), NULL);
 	if (!match)
 		return NULL;
 
@@ -2384,7 +5132,18 @@ struct regex_match* regex_begin_match(struct regex_machine *machine)
 		break;
 
 	default:
-		SLJIT_UNREACHABLE();
+		/* Terms with capture slots. */
+		SLJIT_ASSERT(machine->capture_count > 0);
+		while (ptr1 < end) {
+			*ptr1++ = *entry_addrs;
+			*ptr2++ = *entry_addrs++;
+			*ptr1++ = -1;
+			*ptr2++ = -1;
+			for (ind = 2; ind < machine->no_states; ind++) {
+				*ptr1++ = 0;
+				*ptr2++ = 0;
+			}
+		}
 		break;
 	}
 
@@ -2392,40 +5151,204 @@ struct regex_match* regex_begin_match(struct regex_machine *machine)
 
 	match->u.continue_match = machine->continue_match;
 
+	match->dfa_cache = NULL;
+	if (machine->dfa && dfa_init_cache(match)) {
+		regex_free_match(match);
+		return NULL;
+	}
+
+	/* The generation is increased by the reset below. */
+	if (machine->counter_words > 0) {
+		match->index = 0;
+		clear_counters(match);
+	}
+
 	regex_reset_match(match);
 	return match;
 }
 
 void regex_reset_match(struct regex_match *match)
 {
-	struct regex_machine *machine = match->machine;
-	sljit_sw current, ind;
-	sljit_sw *current_ptr;
+	sljit_sw *set_bitset;
+	sljit_sw *counters;
+	sljit_sw i;
 
 	match->best_end = 0;
 	match->fast_quit = 0;
 	match->fast_forward = 0;
 
-	if (match->head != 0) {
-		/* Clear the current state. */
-		current = match->head;
-		current_ptr = match->current;
-		do {
-			ind = (current / (sljit_sw)sizeof(sljit_sw)) + 1;
-			current = current_ptr[ind];
-			current_ptr[ind] = -1;
-		} while (current != 0);
+	if (match->machine->set_count > 0) {
+		set_bitset = match->states + 2 * match->machine->size;
+		for (i = SET_BITSET_WORDS(match->machine->set_count); i > 0; i--)
+			*set_bitset++ = 0;
+	}
+
+	clear_current_states(match);
+
+	if (match->machine->counter_words > 0) {
+		/* The stamps of the previous match must be smaller than the new ones. */
+		counters = COUNTER_DATA(match);
+		counters[0] += match->index + match->machine->counter_gap;
+		if (counters[0] > REGEX_COUNTER_GEN_LIMIT) {
+			clear_counters(match);
+			counters[0] = match->machine->counter_gap;
+		}
+	}
+
+	match->head = match->machine->u.call_init(match->current, match);
+
+	if (match->dfa_cache) {
+		match->dfa_cache->current = match->dfa_cache->initial;
+		match->dfa_cache->restart_index = 0;
 	}
-	match->head = machine->u.call_init(match->current, match);
 }
 
 void regex_free_match(struct regex_match *match)
 {
+	if (match->dfa_cache)
+		dfa_free_cache(match->dfa_cache);
 	SLJIT_FREE(match, NULL);
 }
 
+/* --------------------------------------------------------------------- */
+/*  Match pool                                                           */
+/* --------------------------------------------------------------------- */
+
+/* The slots are exchanged atomically, so the pool needs no locks. Without
+   atomic operations the pool is disabled: the matches are always allocated. */
+#if (defined _WIN32)
+#define REGEX_POOL_PEEK(slot) \
+	(*(struct regex_match * volatile *)(slot))
+#define REGEX_POOL_EXCHANGE(slot, value) \
+	((struct regex_match*)InterlockedExchangePointer((PVOID volatile*)(slot), (value)))
+#define REGEX_POOL_SET_IF_EMPTY(slot, value) \
+	(InterlockedCompareExchangePointer((PVOID volatile*)(slot), (value), NULL) == NULL)
+#elif (defined __GNUC__ && (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 7))) || (defined __clang__)
+#define REGEX_POOL_PEEK(slot) \
+	__atomic_load_n((slot), __ATOMIC_RELAXED)
+#define REGEX_POOL_EXCHANGE(slot, value) \
+	__atomic_exchange_n((slot), (value), __ATOMIC_ACQ_REL)
+#define REGEX_POOL_SET_IF_EMPTY(slot, value) \
+	regex_pool_set_if_empty((slot), (value))
+
+static SLJIT_INLINE int regex_pool_set_if_empty(struct regex_match **slot, struct regex_match *match)
+{
+	struct regex_match *expected = NULL;
+	return __atomic_compare_exchange_n(slot, &expected, match, 0, __ATOMIC_RELEASE, __ATOMIC_RELAXED);
+}
+#else
+#define REGEX_POOL_DISABLED
+#endif
+
+/* Each slot is stored in its own cache line: the slots are padded
+   to the line size, and the slot array is aligned to it. */
+#define REGEX_POOL_SLOT_SIZE	64
+
+struct regex_match_pool_slot {
+	struct regex_match *match;
+	sljit_u8 padding[REGEX_POOL_SLOT_SIZE - sizeof(struct regex_match*)];
+};
+
+struct regex_match_pool {
+	struct regex_machine *machine;
+	sljit_uw size;
+	/* Points into the same allocation after the pool. */
+	struct regex_match_pool_slot *slots;
+};
+
+/* The threads have different stacks, so the address of a local variable
+   spreads the threads over the slots without any thread local storage. */
+static SLJIT_INLINE sljit_uw regex_pool_first_slot(struct regex_match_pool *pool, void *local)
+{
+	sljit_uw hash = (sljit_uw)local >> 12;
+
+	hash ^= hash >> 7;
+	return (hash * 0x9e3779b1u) % pool->size;
+}
+
+struct regex_match_pool* regex_create_match_pool(struct regex_machine *machine, int size)
+{
+	struct regex_match_pool *pool;
+	int i;
+
+	SLJIT_COMPILE_ASSERT(sizeof(struct regex_match_pool_slot) == REGEX_POOL_SLOT_SIZE, regex_pool_slot_size_must_match);
+
+	if (size <= 0)
+		return NULL;
+
+	pool = (struct regex_match_pool*)SLJIT_MALLOC(sizeof(struct regex_match_pool) + (sljit_uw)size * sizeof(struct regex_match_pool_slot) + REGEX_POOL_SLOT_SIZE - 1, NULL);
+	if (!pool)
+		return NULL;
+
+	pool->machine = machine;
+	pool->size = (sljit_uw)size;
+	pool->slots = (struct regex_match_pool_slot*)(((sljit_uw)(pool + 1) + REGEX_POOL_SLOT_SIZE - 1) & ~(sljit_uw)(REGEX_POOL_SLOT_SIZE - 1));
+	for (i = 0; i < size; i++)
+		pool->slots[i].match = NULL;
+	return pool;
+}
+
+void regex_free_match_pool(struct regex_match_pool *pool)
+{
+	sljit_uw i;
+
+	for (i = 0; i < pool->size; i++)
+		if (pool->slots[i].match)
+			regex_free_match(pool->slots[i].match);
+	SLJIT_FREE(pool, NULL);
+}
+
+struct regex_match* regex_acquire_match(struct regex_match_pool *pool)
+{
+#ifndef REGEX_POOL_DISABLED
+	struct regex_match *match;
+	sljit_uw first, i;
+
+	first = regex_pool_first_slot(pool, &match);
+	i = first;
+	do {
+		/* The slot is read first to avoid writing the cache lines of the empty slots. */
+		if (REGEX_POOL_PEEK(&pool->slots[i].match)) {
+			match = REGEX_POOL_EXCHANGE(&pool->slots[i].match, NULL);
+			if (match) {
+				regex_reset_match(match);
+				return match;
+			}
+		}
+		if (++i >= pool->size)
+			i = 0;
+	} while (i != first);
+#endif
+
+	return regex_begin_match(pool->machine);
+}
+
+void regex_release_match(struct regex_match_pool *pool, struct regex_match *match)
+{
+#ifndef REGEX_POOL_DISABLED
+	sljit_uw first, i;
+
+	SLJIT_ASSERT(match->machine == pool->machine);
+
+	first = regex_pool_first_slot(pool, &first);
+	i = first;
+	do {
+		if (!REGEX_POOL_PEEK(&pool->slots[i].match) && REGEX_POOL_SET_IF_EMPTY(&pool->slots[i].match, match))
+			return;
+		if (++i >= pool->size)
+			i = 0;
+	} while (i != first);
+#endif
+
+	regex_free_match(match);
+}
+
 void regex_continue_match(struct regex_match *match, const regex_char_t *input_string, int length)
 {
+	if (match->dfa_cache && match->dfa_cache->current) {
+		dfa_continue_match(match, input_string, length);
+		return;
+	}
 	match->u.call_continue(match, input_string, length);
 }
 
@@ -2434,6 +5357,9 @@ int regex_get_result(struct regex_match *match, int *end, int *id)
 	int flags = match->machine->flags;
 	sljit_sw no_states;
 
+	if (flags & (REGEX_MATCH_END | REGEX_FAKE_MATCH_END))
+		dfa_sync_machine(match);
+
 	*end = (int)match->best_end;
 	*id = (int)match->best_id;
 	if (!(flags & (REGEX_MATCH_END | REGEX_FAKE_MATCH_END)))
@@ -2489,11 +5415,329 @@ int regex_get_result(struct regex_match *match, int *end, int *id)
 	}
 }
 
+int regex_get_capture_count(struct regex_machine *machine)
+{
+	return (int)machine->capture_count;
+}
+
+int regex_get_captures(struct regex_match *match, int *captures, int count)
+{
+	struct regex_machine *machine = match->machine;
+	sljit_sw *slots;
+	int begin, end, id, i;
+
+	begin = regex_get_result(match, &end, &id);
+	if (begin == -1)
+		return -1;
+
+	/* The slots are copied when a best match is found, except for the
+	   matches, which are only known when the input is finished. */
+	if (!(machine->flags & (REGEX_MATCH_END | REGEX_FAKE_MATCH_END))
+			|| ((machine->flags & REGEX_FAKE_MATCH_END) && match->best_begin != -1))
+		slots = match->states + 2 * machine->size + SET_DATA_WORDS(machine->set_count);
+	else if (machine->flags & REGEX_FAKE_MATCH_END)
+		slots = match->current + 2 * machine->no_states - CAPTURE_DATA_WORDS(machine->capture_count);
+	else
+		slots = match->current + machine->no_states - CAPTURE_DATA_WORDS(machine->capture_count);
+
+	if (count > 0) {
+		captures[0] = begin;
+		captures[1] = end;
+	}
+	for (i = 1; i < count; i++) {
+		if (i <= machine->capture_count && slots[2 * i - 1] != -1) {
+			captures[2 * i] = (int)slots[2 * i - 2];
+			captures[2 * i + 1] = (int)slots[2 * i - 1];
+		}
+		else {
+			captures[2 * i] = -1;
+			captures[2 * i + 1] = -1;
+		}
+	}
+	return begin;
+}
+
 int regex_is_match_finished(struct regex_match *match)
 {
 	return (int)match->fast_quit;
 }
 
+int regex_find_all(struct regex_machine *machine, const regex_char_t *string, int length,
+	struct regex_find_result *results, int size, long *count)
+{
+	struct regex_match *match;
+	int offset = 0;
+	int begin, end, id;
+
+	SLJIT_ASSERT(machine->set_count == 0 && (results == NULL || size > 0));
+
+	*count = 0;
+	match = regex_begin_match(machine);
+	if (!match)
+		return REGEX_MEMORY_ERROR;
+
+	while (1) {
+		regex_continue_match(match, string + offset, length - offset);
+		begin = regex_get_result(match, &end, &id);
+		if (begin == -1)
+			break;
+
+		if (results) {
+			results[*count % size].begin = offset + begin;
+			results[*count % size].end = offset + end;
+			results[*count % size].id = id;
+		}
+		(*count)++;
+
+		/* The match must be at the beginning of the subject. */
+		if (machine->flags & REGEX_MATCH_BEGIN)
+			break;
+
+		if (begin == end) {
+			if (offset + end >= length)
+				break;
+			end++;
+#ifdef REGEX_USE_8BIT_CHARS
+			if (machine->flags & REGEX_UTF8) {
+				while (offset + end < length && (REGEX_CHAR_VALUE(string[offset + end]) & 0xc0) == 0x80)
+					end++;
+			}
+#endif
+		}
+		offset += end;
+
+		/* A new match can only start at the beginning of a line. */
+		if ((machine->flags & REGEX_FAKE_MATCH_BEGIN) && string[offset - 1] != '\n' && string[offset - 1] != '\r') {
+			while (offset < length && string[offset] != '\n' && string[offset] != '\r')
+				offset++;
+			if (offset >= length)
+				break;
+			offset++;
+		}
+
+		regex_reset_match(match);
+	}
+
+	regex_free_match(match);
+	return REGEX_NO_ERROR;
+}
+
+#ifdef REGEX_USE_8BIT_CHARS
+
+/* Largest part of a line passed to regex_continue_match at once. */
+#define SCAN_MAX_PART	(1 << 30)
+/* Size and alignment of the buffer of REGEX_SCAN_READ. */
+#define SCAN_READ_SIZE	(1 << 20)
+#define SCAN_READ_ALIGN	4096
+
+#ifdef _WIN32
+#define SCAN_OPEN(path) \
+	_open((path), _O_RDONLY | _O_BINARY)
+#define SCAN_READ(fd, buffer, size) \
+	_read((fd), (buffer), (unsigned int)(size))
+#define SCAN_CLOSE(fd) \
+	_close(fd)
+#else
+#define SCAN_OPEN(path) \
+	open((path), O_RDONLY)
+#define SCAN_READ(fd, buffer, size) \
+	read((fd), (buffer), (size))
+#define SCAN_CLOSE(fd) \
+	close(fd)
+#define SCAN_HAS_MMAP 1
+#endif
+
+struct scan_state {
+	struct regex_match *match;
+	regex_scan_callback callback;
+	void *data;
+	regex_offset_t count;
+	/* File offset of the current line and of the next character. */
+	regex_offset_t line_offset;
+	regex_offset_t offset;
+	/* The result of the current line does not depend on its remaining characters. */
+	int decided;
+	int stopped;
+};
+
+static void scan_end_line(struct scan_state *state)
+{
+	int begin, end, id;
+
+	begin = regex_get_result(state->match, &end, &id);
+	if (begin >= 0) {
+		state->count++;
+		if (state->callback && state->callback(state->data, state->line_offset, begin, end, id))
+			state->stopped = 1;
+	}
+
+	regex_reset_match(state->match);
+	state->decided = 0;
+}
+
+/* The last line of the block may continue in the next block: the match
+   structure keeps its state, so the lines are never copied. */
+static void scan_block(struct scan_state *state, const regex_char_t *ptr, const regex_char_t *end)
+{
+	const regex_char_t *line_end;
+	sljit_uw part;
+
+	while (!state->stopped) {
+		line_end = (const regex_char_t*)memchr(ptr, '\n', (size_t)(end - ptr));
+		if (!line_end)
+			line_end = end;
+
+		state->offset += (regex_offset_t)(line_end - ptr);
+		if (!state->decided) {
+			part = (sljit_uw)(line_end - ptr);
+			do {
+				if (part > SCAN_MAX_PART)
+					part = SCAN_MAX_PART;
+				regex_continue_match(state->match, ptr, (int)part);
+				ptr += part;
+				part = (sljit_uw)(line_end - ptr);
+			} while (part > 0);
+			state->decided = regex_is_match_finished(state->match);
+		}
+
+		if (line_end == end)
+			return;
+
+		scan_end_line(state);
+		state->offset++;
+		state->line_offset = state->offset;
+		ptr = line_end + 1;
+	}
+}
+
+static int scan_read(struct scan_state *state, int fd)
+{
+	void *allocated = SLJIT_MALLOC(SCAN_READ_SIZE + SCAN_READ_ALIGN, NULL);
+	regex_char_t *buffer;
+	long size = 0;
+
+	if (!allocated)
+		return REGEX_MEMORY_ERROR;
+
+	/* Page aligned reads can be served without splitting the pages of the cache. */
+	buffer = (regex_char_t*)(((sljit_uw)allocated + SCAN_READ_ALIGN - 1) & ~(sljit_uw)(SCAN_READ_ALIGN - 1));
+
+#ifdef POSIX_FADV_SEQUENTIAL
+	posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+
+	while (!state->stopped) {
+		size = (long)SCAN_READ(fd, buffer, SCAN_READ_SIZE);
+		if (size < 0 && errno == EINTR)
+			continue;
+		if (size <= 0)
+			break;
+		scan_block(state, buffer, buffer + size);
+	}
+
+	SLJIT_FREE(allocated, NULL);
+	return (size < 0) ? REGEX_FILE_ERROR : REGEX_NO_ERROR;
+}
+
+#ifdef SCAN_HAS_MMAP
+
+/* Returns with -1, if the file cannot be mapped. */
+static int scan_mapped(struct scan_state *state, int fd)
+{
+	struct stat file_stat;
+	size_t size;
+	void *mapped;
+
+	if (fstat(fd, &file_stat) != 0 || !S_ISREG(file_stat.st_mode) || file_stat.st_size <= 0)
+		return -1;
+
+	size = (size_t)file_stat.st_size;
+	if ((off_t)size != file_stat.st_size)
+		return -1;
+
+	mapped = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+	if (mapped == MAP_FAILED)
+		return -1;
+
+#ifdef POSIX_MADV_SEQUENTIAL
+	posix_madvise(mapped, size, POSIX_MADV_SEQUENTIAL);
+#endif
+
+	scan_block(state, (const regex_char_t*)mapped, (const regex_char_t*)mapped + size);
+	munmap(mapped, size);
+	return REGEX_NO_ERROR;
+}
+
+#endif /* SCAN_HAS_MMAP */
+
+int regex_scan_file(struct regex_machine *machine, const char *path, int mode,
+	regex_scan_callback callback, void *data, regex_offset_t *count)
+{
+	struct scan_state state;
+	int fd, result = -1;
+
+	SLJIT_ASSERT(machine->set_count == 0 && (mode == REGEX_SCAN_MMAP || mode == REGEX_SCAN_READ));
+
+	*count = 0;
+	state.match = regex_begin_match(machine);
+	if (!state.match)
+		return REGEX_MEMORY_ERROR;
+
+	state.callback = callback;
+	state.data = data;
+	state.count = 0;
+	state.line_offset = 0;
+	state.offset = 0;
+	state.decided = 0;
+	state.stopped = 0;
+
+	fd = SCAN_OPEN(path);
+	if (fd < 0) {
+		regex_free_match(state.match);
+		return REGEX_FILE_ERROR;
+	}
+
+#ifdef SCAN_HAS_MMAP
+	if (mode == REGEX_SCAN_MMAP)
+		result = scan_mapped(&state, fd);
+#endif
+	/* Pipes, empty files, etc. are read. */
+	if (result < 0)
+		result = scan_read(&state, fd);
+	SCAN_CLOSE(fd);
+
+	/* The last line is not terminated by a newline. */
+	if (result == REGEX_NO_ERROR && !state.stopped && state.offset > state.line_offset)
+		scan_end_line(&state);
+
+	*count = state.count;
+	regex_free_match(state.match);
+	return result;
+}
+
+#endif /* REGEX_USE_8BIT_CHARS */
+
+const regex_set_word_t* regex_get_set_matches(struct regex_match *match)
+{
+	SLJIT_ASSERT(match->machine->set_count > 0);
+	return (const regex_set_word_t*)(match->states + 2 * match->machine->size);
+}
+
+int regex_get_set_result(struct regex_match *match, int id, int *end)
+{
+	const regex_set_word_t *set_bitset = regex_get_set_matches(match);
+	sljit_sw *bounds;
+
+	SLJIT_ASSERT(id >= 0 && id < match->machine->set_count);
+
+	if (!(set_bitset[id / REGEX_SET_WORD_BITS] & ((regex_set_word_t)1 << (id % REGEX_SET_WORD_BITS))))
+		return -1;
+
+	bounds = match->states + 2 * match->machine->size + SET_BITSET_WORDS(match->machine->set_count) + 2 * id;
+	*end = (int)bounds[1];
+	return (int)bounds[0];
+}
+
 #ifdef REGEX_MATCH_VERBOSE
 void regex_continue_match_debug(struct regex_match *match, const regex_char_t *input_string, int length)
 {
@@ -2506,6 +5750,11 @@ void regex_continue_match_debug(struct regex_match *match, const regex_char_t *i
 	sljit_sw no_states = match->machine->no_states;
 	sljit_sw len = match->machine->size;
 
+	/* The machine states are checked after every character. */
+	dfa_sync_machine(match);
+	if (match->dfa_cache)
+		match->dfa_cache->current = NULL;
+
 	while (length > 0) {
 		match->u.call_continue(match, input_string, 1);
 
@@ -2543,6 +5792,13 @@ void regex_continue_match_debug(struct regex_match *match, const regex_char_t *i
 					else
 						printf(" ,XXX,XXX] ");
 					break;
+
+				default:
+					if (ptr[1] != -1)
+						printf("+,%3ld,...] ", (long)ptr[2]);
+					else
+						printf(" ,XXX,...] ");
+					break;
 				}
 				ptr += no_states;
 			}
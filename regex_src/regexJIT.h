@@ -44,13 +44,20 @@ typedef wchar_t regex_char_t;
 #define REGEX_NO_ERROR		0
 #define REGEX_MEMORY_ERROR	1
 #define REGEX_INVALID_REGEX	2
+/* The serialized data is corrupted, or it was created by an incompatible build. */
+#define REGEX_INVALID_DATA	3
+/* The file cannot be opened or read. */
+#define REGEX_FILE_ERROR	4
 
 /* Note: large, nested {a,b} iterations can blow up the memory consumption
    a{n,m} is replaced by aa...aaa?a?a?a?a? (n >= 0, m > 0)
                          \__n__/\____m___/
    a{n,}  is replaced by aa...aaa+ (n > 0)
                          \_n-1_/
-*/
+   Except when a is a single character or character class and the larger
+   count is at least 16: such repetitions are matched by a counter, which
+   needs memory proportional to the count in each regex_match only. The
+   copies are still used with REGEX_CAPTURES, and when ids are present. */
 
 /* The value returned by regex_compile. Can be used for multiple matching. */
 struct regex_machine;
@@ -72,18 +79,94 @@ struct regex_match;
 #define REGEX_MATCH_NON_GREEDY	0x08
 /* Verbose. This define can be commented out, which disables all verbose features. */
 #define REGEX_MATCH_VERBOSE	0x10
+/* Lazy DFA mode. The machine code is only executed around the possible matches:
+   the rest of the input is scanned by a DFA, whose states are computed on demand
+   and cached by the match structure. The results are the same as without this flag.
+     Note: ignored when REGEX_MATCH_BEGIN is passed, or the pattern matches the empty string.
+     Note: when the cache is full, the current match falls back to the machine code. */
+#define REGEX_LAZY_DFA		0x20
+/* The pattern and the input are UTF-8 encoded byte strings. Characters, . and
+   character ranges match whole UTF-8 sequences, so the input can be matched
+   without converting it to wide characters. The results are byte offsets.
+     Note: . and [^...] never match bytes which are not part of a valid UTF-8 sequence.
+     Note: invalid UTF-8 sequences in the pattern are rejected (REGEX_INVALID_REGEX).
+     Note: only supported with 8 bit characters. */
+#define REGEX_UTF8		0x40
+/* The machine keeps a copy of its intermediate code, which can be
+   saved by regex_serialize_machine. */
+#define REGEX_SERIALIZABLE	0x80
+/* Bracketed subexpressions are capture groups: every state tracks the positions
+   where the groups were entered and left on its path, so the begin and end of the
+   groups are known after a single scan (see regex_get_captures). The matching
+   remains linear, but each transition copies the positions of all groups.
+     Note: cannot be combined with the {id!} extension (REGEX_INVALID_REGEX).
+     Note: REGEX_LAZY_DFA is ignored. */
+#define REGEX_CAPTURES		0x100
 
 /* If error occures the function returns NULL, and the error code returned in error variable.
    You can pass NULL to error if you don't care about the error code.
    The re_flags argument contains the default REGEX_MATCH flags. See above. */
 struct regex_machine* regex_compile(const regex_char_t *regex_string, int length, int re_flags, int *error);
 void regex_free_machine(struct regex_machine *machine);
+/* Returns with the number of bytes allocated for the machine (including its machine
+   code), and stores the size of the machine code into code_size, and the size of a
+   match structure into match_size. Both arguments can be NULL.
+     Note: the states of the lazy DFA are allocated by the matches when they are
+       needed, and they are not included in match_size. */
+long regex_get_machine_size(struct regex_machine *machine, long *code_size, long *match_size);
+
+/* Compiles count patterns into a single machine, which reports every pattern
+   matching the input after one scan. The id of a pattern is its index in the
+   regex_strings array. The re_flags are applied to all patterns.
+     Note: ^, $ and the {id!} extension cannot be used by the patterns, and
+       patterns matching the empty string are rejected (REGEX_INVALID_REGEX).
+     Note: REGEX_MATCH_END is not supported, REGEX_LAZY_DFA and REGEX_CAPTURES are ignored.
+     Note: regex_get_result always returns with -1 for these machines. */
+struct regex_machine* regex_compile_set(const regex_char_t **regex_strings, const int *lengths, int count, int re_flags, int *error);
+
+/* Returns with a copy of the serialized machine (which must be freed by free()),
+   or NULL, if the machine was not compiled with REGEX_SERIALIZABLE or on failure.
+   The data can be saved to disk (e.g. cached by pattern and flags) and loaded by
+   regex_deserialize_machine later, which is faster than compiling the pattern.
+     Note: the data can only be loaded by the same build of this library running
+       on a CPU with the same capabilities (REGEX_INVALID_DATA is returned otherwise).
+     Note: only the parsing and the code emission are skipped, the machine code
+       is still generated when the data is loaded. */
+void* regex_serialize_machine(struct regex_machine *machine, int *size);
+/* The buffer must be word aligned (e.g. allocated by malloc()), and it is not
+   modified. The REGEX_SERIALIZABLE flag of the original machine is preserved.
+   Returns with NULL on failure, and the error code is returned in error. */
+struct regex_machine* regex_deserialize_machine(const void *buffer, int size, int *error);
 
 /* Create and init match structure for a given machine. */
 struct regex_match* regex_begin_match(struct regex_machine *machine);
 void regex_reset_match(struct regex_match *match);
 void regex_free_match(struct regex_match *match);
 
+/* Thread safety: a machine is never modified by the matching functions, so it
+   can be used by any number of threads at the same time, as long as each thread
+   uses its own match structure. A match structure must not be used by more than
+   one thread at the same time. A machine must not be freed while its match
+   structures (or pools) exist. */
+
+/* A pool of match structures, which can be shared by threads. The matches of
+   a machine are recycled instead of being allocated for each request. */
+struct regex_match_pool;
+
+/* The pool keeps at most size unused match structures. Returns NULL on failure. */
+struct regex_match_pool* regex_create_match_pool(struct regex_machine *machine, int size);
+/* Frees the unused match structures of the pool. Must not be called while
+   other threads use the pool. The acquired matches must be freed by
+   regex_free_match after the pool is freed. */
+void regex_free_match_pool(struct regex_match_pool *pool);
+
+/* Returns with a reset match structure (same as regex_begin_match, when the pool is empty).
+   Both functions are lock free: the unused matches are stored in slots, which are
+   exchanged by atomic operations. Returns NULL on failure. */
+struct regex_match* regex_acquire_match(struct regex_match_pool *pool);
+/* Puts back the match into the pool, or frees it when the pool is full. */
+void regex_release_match(struct regex_match_pool *pool, struct regex_match *match);
+
 /* Pattern matching.
    regex_continue_match does not support REGEX_MATCH_VERBOSE flag. */
 void regex_continue_match(struct regex_match *match, const regex_char_t *input_string, int length);
@@ -91,6 +174,83 @@ int regex_get_result(struct regex_match *match, int *end, int *id);
 /* Returns true, if the best match has already found. */
 int regex_is_match_finished(struct regex_match *match);
 
+/* Number of capture groups (zero, if the machine was compiled without REGEX_CAPTURES). */
+int regex_get_capture_count(struct regex_machine *machine);
+/* Stores the begin and end of the best match into captures[0] and captures[1], and the
+   begin and end of the n-th capture group into captures[2 * n] and captures[2 * n + 1]
+   (-1, if the group is not part of the match). The size of the captures array is
+   2 * count, and the groups above the capture count are set to -1. Returns with
+   the begin of the best match, or -1 if no match is found (captures is not changed).
+     Note: when several paths match the same characters, the captures of one of
+       these paths are returned, which is not necessarily the leftmost path. */
+int regex_get_captures(struct regex_match *match, int *captures, int count);
+
+/* Match found by regex_find_all: the begin, end and id values
+   returned by regex_get_result. */
+struct regex_find_result {
+	int begin;
+	int end;
+	int id;
+};
+
+/* Finds all non-overlapping matches of the subject from left to right, and
+   stores the total number of matches into count. The n-th match is stored
+   into results[n % size], so the results array is a ring buffer, which keeps
+   the last size matches. When results is NULL, the matches are only counted.
+   After an empty match the search continues from the next character.
+   Returns REGEX_NO_ERROR, or REGEX_MEMORY_ERROR if the allocation fails.
+     Note: the matching stops at the end of each match when the best match is
+       finished, and only the characters after the match end, which were
+       needed to decide the best match, are scanned again.
+     Note: set machines are not supported. */
+int regex_find_all(struct regex_machine *machine, const regex_char_t *string, int length,
+	struct regex_find_result *results, int size, long *count);
+
+#ifdef REGEX_USE_8BIT_CHARS
+
+/* Reading modes of regex_scan_file. */
+#define REGEX_SCAN_MMAP		0
+#define REGEX_SCAN_READ		1
+
+/* File offsets and line counts of regex_scan_file, which are 64 bit wide
+   even if long is 32 bit (e.g. on Windows or 32 bit hosts). */
+#if defined(_WIN32) && !defined(__GNUC__)
+typedef __int64 regex_offset_t;
+#else
+typedef long long regex_offset_t;
+#endif
+
+/* Called for every matching line by regex_scan_file: offset is the file offset
+   of the line, and begin, end and id are the values returned by regex_get_result
+   (relative to the line). Returning with non-zero stops the scan. */
+typedef int (*regex_scan_callback)(void *data, regex_offset_t offset, int begin, int end, int id);
+
+/* Matches every line of a file (terminated by \n) separately, and stores the
+   number of matching lines into count. The file is mapped into the memory by
+   REGEX_SCAN_MMAP (files which cannot be mapped, e.g. pipes, are read instead),
+   or read into a large, page aligned buffer by REGEX_SCAN_READ. The lines are
+   passed to regex_continue_match without copying them: a line split by two
+   reads is matched in two parts. The callback can be NULL. Returns REGEX_NO_ERROR,
+   REGEX_MEMORY_ERROR, or REGEX_FILE_ERROR.
+     Note: the matching of a line stops when its best match is found.
+     Note: files larger than 2GB are supported on 32 bit hosts as well.
+     Note: set machines are not supported. */
+int regex_scan_file(struct regex_machine *machine, const char *path, int mode,
+	regex_scan_callback callback, void *data, regex_offset_t *count);
+
+#endif /* REGEX_USE_8BIT_CHARS */
+
+/* Bitset of the matched patterns of a set machine: bit (id % REGEX_SET_WORD_BITS)
+   of word (id / REGEX_SET_WORD_BITS) is set, if the pattern has matched. The
+   bitset is valid until the next regex_reset_match or regex_free_match call. */
+typedef unsigned int regex_set_word_t;
+#define REGEX_SET_WORD_BITS	(8 * (int)sizeof(regex_set_word_t))
+
+const regex_set_word_t* regex_get_set_matches(struct regex_match *match);
+/* Returns with the begin of the first match of the pattern (the one which ends first),
+   or -1 if the pattern has not matched. The end is stored into the end argument. */
+int regex_get_set_result(struct regex_match *match, int id, int *end);
+
 /* Only exists if VERBOSE is defined in regexJIT.c
    Do both sanity check and verbose.
    (The latter only if REGEX_MATCH_VERBOSE was passed to regex_compile) */
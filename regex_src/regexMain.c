@@ -29,6 +29,8 @@
 #include "regexJIT.h"
 
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 
 #if defined _WIN32 || defined _WIN64
 #define COLOR_RED
@@ -104,13 +106,672 @@ struct test_case {
 	const regex_char_t *string;	/* NULL : end of tests. */
 };
 
+struct set_test_case {
+	int flags;	/* REGEX_MATCH_* */
+	int error;	/* Expected error code. */
+	const regex_char_t *patterns[5];	/* NULL terminated. */
+	const regex_char_t *string;	/* NULL : end of tests. */
+	int results[4][2];	/* Expected begin and end for each pattern. */
+};
+
+static int check_set_match(struct regex_match *match, struct set_test_case *test, int count)
+{
+	const regex_set_word_t *set_matches = regex_get_set_matches(match);
+	int i, begin, end;
+
+	for (i = 0; i < count; i++) {
+		end = -1;
+		begin = regex_get_set_result(match, i, &end);
+		if (begin != test->results[i][0] || (begin >= 0 && end != test->results[i][1]))
+			return 0;
+		if (!(set_matches[0] & ((regex_set_word_t)1 << i)) != (begin < 0))
+			return 0;
+	}
+	return 1;
+}
+
+static int run_set_test(struct set_test_case *test)
+{
+	struct regex_machine *machine;
+	struct regex_match *match;
+	int lengths[4];
+	const regex_char_t *ptr;
+	int i, count, error, length, result;
+
+	for (count = 0; test->patterns[count]; count++) {
+		ptr = test->patterns[count];
+		while (*ptr)
+			ptr++;
+		lengths[count] = (int)(ptr - test->patterns[count]);
+	}
+
+	machine = regex_compile_set(test->patterns, lengths, count, test->flags, &error);
+	if (error != test->error || !machine != !!test->error)
+		return 0;
+	if (!machine)
+		return 1;
+
+	match = regex_begin_match(machine);
+	if (!match) {
+		regex_free_machine(machine);
+		return 0;
+	}
+
+	ptr = test->string;
+	while (*ptr)
+		ptr++;
+	length = (int)(ptr - test->string);
+
+	regex_continue_match(match, test->string, length);
+	result = check_set_match(match, test, count);
+
+	/* The input is passed character by character. */
+	regex_reset_match(match);
+	for (i = 0; i < length; i++)
+		regex_continue_match(match, test->string + i, 1);
+	if (!check_set_match(match, test, count))
+		result = 0;
+
+	regex_free_match(match);
+	regex_free_machine(machine);
+	return result;
+}
+
+/* Matches the decimal numbers followed by a semicolon, which requires more than one bitset word. */
+static int run_large_set_test(void)
+{
+	regex_char_t patterns[70][4];
+	const regex_char_t *pattern_ptrs[70];
+	int lengths[70];
+	const regex_char_t *string = S("1;12;69;");
+	struct regex_machine *machine;
+	struct regex_match *match;
+	const regex_set_word_t *set_matches;
+	int i, word, error, begin, end, result;
+
+	for (i = 0; i < 70; i++) {
+		lengths[i] = 0;
+		if (i >= 10)
+			patterns[i][lengths[i]++] = (regex_char_t)('0' + i / 10);
+		patterns[i][lengths[i]++] = (regex_char_t)('0' + i % 10);
+		patterns[i][lengths[i]++] = ';';
+		pattern_ptrs[i] = patterns[i];
+	}
+
+	machine = regex_compile_set(pattern_ptrs, lengths, 70, 0, &error);
+	if (!machine)
+		return 0;
+
+	match = regex_begin_match(machine);
+	if (!match) {
+		regex_free_machine(machine);
+		return 0;
+	}
+
+	regex_continue_match(match, string, 8);
+	set_matches = regex_get_set_matches(match);
+
+	result = 1;
+	for (i = 0; i < 70; i++) {
+		word = (set_matches[i / REGEX_SET_WORD_BITS] >> (i % REGEX_SET_WORD_BITS)) & 0x1;
+		if (word != (i == 1 || i == 2 || i == 9 || i == 12 || i == 69))
+			result = 0;
+	}
+
+	begin = regex_get_set_result(match, 69, &end);
+	if (begin != 5 || end != 8)
+		result = 0;
+	begin = regex_get_set_result(match, 2, &end);
+	if (begin != 3 || end != 5)
+		result = 0;
+
+	regex_free_match(match);
+	regex_free_machine(machine);
+	return result;
+}
+
+static struct set_test_case set_tests[];
+
+static void run_set_tests(int verbose, int *success, int *fail)
+{
+	struct set_test_case *test;
+
+	for (test = set_tests; test->string; test++) {
+		if (verbose)
+			printf("set test: '%s' ... '%s': ", test->patterns[0], test->string);
+		if (run_set_test(test)) {
+			if (verbose)
+				printf("SUCCESS\n");
+			(*success)++;
+			continue;
+		}
+		if (!verbose)
+			printf("set test: '%s' ... '%s': ", test->patterns[0], test->string);
+		printf("FAIL\n");
+		(*fail)++;
+	}
+
+	if (verbose)
+		printf("large set test: ");
+	if (run_large_set_test()) {
+		if (verbose)
+			printf("SUCCESS\n");
+		(*success)++;
+		return;
+	}
+	if (!verbose)
+		printf("large set test: ");
+	printf("FAIL\n");
+	(*fail)++;
+}
+
+static int check_pool_match(struct regex_match *match, const regex_char_t *string, int length, int expected_begin)
+{
+	int begin, end, id;
+
+	if (!match)
+		return 0;
+	/* The acquired match must be reset. */
+	if (regex_get_result(match, &end, &id) != -1)
+		return 0;
+	regex_continue_match(match, string, length);
+	begin = regex_get_result(match, &end, &id);
+	return begin == expected_begin && (begin == -1 || end == begin + 2);
+}
+
+static int run_pool_test(void)
+{
+	struct regex_machine *machine;
+	struct regex_match_pool *pool;
+	struct regex_match *matches[3];
+	int i, error, result = 1;
+
+	machine = regex_compile(S("ab"), 2, 0, &error);
+	if (!machine)
+		return 0;
+
+	pool = regex_create_match_pool(machine, 2);
+	if (!pool) {
+		regex_free_machine(machine);
+		return 0;
+	}
+
+	for (i = 0; i < 3; i++) {
+		matches[i] = regex_acquire_match(pool);
+		if (!check_pool_match(matches[i], S("xxab"), 4, 2))
+			result = 0;
+	}
+
+	/* The third match does not fit into the pool. */
+	for (i = 0; i < 3; i++)
+		if (matches[i])
+			regex_release_match(pool, matches[i]);
+
+	for (i = 0; i < 2; i++) {
+		matches[i] = regex_acquire_match(pool);
+		if (!check_pool_match(matches[i], S("bbba"), 4, -1))
+			result = 0;
+	}
+
+	if (matches[0])
+		regex_release_match(pool, matches[0]);
+	regex_free_match_pool(pool);
+	/* Acquired matches are not owned by the pool. */
+	if (matches[1])
+		regex_free_match(matches[1]);
+	regex_free_machine(machine);
+	return result;
+}
+
+/* Matches the subjects with one match structure, which is reset before each subject. */
+static int match_subjects(struct regex_machine *machine, const regex_char_t **subjects, const int *lengths,
+	int count, struct regex_find_result *results)
+{
+	struct regex_match *match = regex_begin_match(machine);
+	int i;
+
+	if (!match)
+		return 0;
+
+	for (i = 0; i < count; i++) {
+		if (i > 0)
+			regex_reset_match(match);
+		regex_continue_match(match, subjects[i], lengths[i]);
+		results[i].begin = regex_get_result(match, &results[i].end, &results[i].id);
+	}
+
+	regex_free_match(match);
+	return 1;
+}
+
+static int run_reset_test(int flags)
+{
+	static const regex_char_t *subjects[] = { S("xabbc"), S(""), S("abd"), S("abbbbc abc"), S("ac") };
+	static const int lengths[] = { 5, 0, 3, 10, 2 };
+	static const int expected[][2] = { { 1, 5 }, { -1, 0 }, { -1, 0 }, { 0, 6 }, { 0, 2 } };
+	struct regex_machine *machine;
+	struct regex_find_result results[5];
+	int i, error, result = 1;
+
+	machine = regex_compile(S("ab*c"), 4, flags, &error);
+	if (!machine)
+		return 0;
+
+	if (!match_subjects(machine, subjects, lengths, 5, results))
+		result = 0;
+
+	for (i = 0; i < 5 && result; i++) {
+		if (results[i].begin != expected[i][0] || (results[i].begin >= 0 && results[i].end != expected[i][1]))
+			result = 0;
+	}
+
+	regex_free_machine(machine);
+	return result;
+}
+
+static struct regex_machine* reload_machine(struct regex_machine *machine)
+{
+	struct regex_machine *result;
+	void *buffer;
+	int size, error;
+
+	buffer = regex_serialize_machine(machine, &size);
+	if (!buffer)
+		return NULL;
+	result = regex_deserialize_machine(buffer, size, &error);
+	free(buffer);
+	return result;
+}
+
+static int compare_results(struct regex_machine *machine, struct regex_machine *loaded,
+	const regex_char_t **subjects, const int *lengths, int count)
+{
+	struct regex_find_result results[2][5];
+	int i;
+
+	if (!match_subjects(machine, subjects, lengths, count, results[0])
+			|| !match_subjects(loaded, subjects, lengths, count, results[1]))
+		return 0;
+
+	for (i = 0; i < count; i++) {
+		if (results[0][i].begin != results[1][i].begin || results[0][i].end != results[1][i].end
+				|| results[0][i].id != results[1][i].id)
+			return 0;
+	}
+	return 1;
+}
+
+static int run_serialize_test(void)
+{
+	static const regex_char_t *patterns[] = { S("[a-fkmx-z0-9_]+q"), S("(ab|cd)*e"), S("x[0-9]+y{5!}"), S("^a.c$"), S("[a-z0-9_-]{0,16}q") };
+	static const int pattern_flags[] = { 0, REGEX_LAZY_DFA, REGEX_MATCH_NON_GREEDY, 0, 0 };
+	static const regex_char_t *subjects[] = { S("--0_aq-"), S("cdabe"), S("ax12yb"), S("abc"), S("zzzq") };
+	static const int lengths[] = { 7, 5, 6, 3, 4 };
+	/* A start dispatch is generated for this set. */
+	static const regex_char_t *set_patterns[] = { S("abc"), S("b[a-z0-9_.]+d"), S("cd"), S("[e-k]x") };
+	static const int set_lengths[] = { 3, 13, 2, 6 };
+	struct regex_machine *machine, *loaded;
+	struct regex_match *matches[2];
+	int i, j, length, error, begin, end[2], result = 1;
+	long code_size[2], match_size[2];
+	unsigned char *buffer;
+
+	for (i = 0; i < 5 && result; i++) {
+		length = 0;
+		while (patterns[i][length])
+			length++;
+
+		machine = regex_compile(patterns[i], length, pattern_flags[i] | REGEX_SERIALIZABLE, &error);
+		if (!machine)
+			return 0;
+
+		loaded = reload_machine(machine);
+		if (!loaded || !compare_results(machine, loaded, subjects, lengths, 5))
+			result = 0;
+
+		/* The same machine code is generated for the loaded machine. */
+		if (loaded && (regex_get_machine_size(machine, &code_size[0], &match_size[0]) <= code_size[0]
+				|| regex_get_machine_size(loaded, &code_size[1], &match_size[1]) <= code_size[1]
+				|| code_size[0] <= 0 || code_size[0] != code_size[1] || match_size[0] != match_size[1]))
+			result = 0;
+
+		if (loaded)
+			regex_free_machine(loaded);
+		regex_free_machine(machine);
+	}
+
+	machine = regex_compile_set(set_patterns, set_lengths, 4, REGEX_SERIALIZABLE, &error);
+	if (!machine)
+		return 0;
+
+	loaded = reload_machine(machine);
+	if (!loaded) {
+		regex_free_machine(machine);
+		return 0;
+	}
+
+	matches[0] = regex_begin_match(machine);
+	matches[1] = regex_begin_match(loaded);
+	if (matches[0] && matches[1]) {
+		regex_continue_match(matches[0], S("xabcd b_x.d gx"), 14);
+		regex_continue_match(matches[1], S("xabcd b_x.d gx"), 14);
+		for (i = 0; i < 4; i++) {
+			begin = regex_get_set_result(matches[0], i, &end[0]);
+			if (begin < 0 || regex_get_set_result(matches[1], i, &end[1]) != begin || end[0] != end[1])
+				result = 0;
+		}
+	}
+	else
+		result = 0;
+
+	for (i = 0; i < 2; i++)
+		if (matches[i])
+			regex_free_match(matches[i]);
+
+	/* Corrupted data is rejected. */
+	buffer = (unsigned char*)regex_serialize_machine(loaded, &length);
+	if (buffer) {
+		for (i = 0; i < 2; i++) {
+			buffer[0] = (unsigned char)(buffer[0] ^ 0x1);
+			j = i ? length - (int)sizeof(sljit_uw) : length;
+			error = REGEX_NO_ERROR;
+			if (regex_deserialize_machine(buffer, j, &error) || error != REGEX_INVALID_DATA)
+				result = 0;
+		}
+		free(buffer);
+	}
+	else
+		result = 0;
+
+	regex_free_machine(loaded);
+	regex_free_machine(machine);
+
+	/* Only serializable machines can be saved. */
+	machine = regex_compile(S("ab"), 2, 0, &error);
+	if (!machine)
+		return 0;
+	if (regex_serialize_machine(machine, &length))
+		result = 0;
+	regex_free_machine(machine);
+	return result;
+}
+
+struct find_all_test_case {
+	const regex_char_t *pattern;
+	int flags;
+	const regex_char_t *string;
+	long count;
+	/* The bounds of the first four matches. */
+	int bounds[8];
+};
+
+static struct find_all_test_case find_all_tests[] = {
+	{ S("ab"), 0, S("abxabab"), 3, { 0, 2, 3, 5, 5, 7, -1, -1 } },
+	{ S("a*"), 0, S("baac"), 4, { 0, 0, 1, 3, 3, 3, 4, 4 } },
+	{ S("^a"), 0, S("aaa"), 1, { 0, 1, -1, -1, -1, -1, -1, -1 } },
+	{ S("^a+"), REGEX_NEWLINE, S("aa\nba\naa"), 2, { 0, 2, 6, 8, -1, -1, -1, -1 } },
+	{ S("a$"), REGEX_NEWLINE, S("a\nba\nab"), 2, { 0, 1, 3, 4, -1, -1, -1, -1 } },
+	{ S("a+$"), 0, S("aabaa"), 1, { 3, 5, -1, -1, -1, -1, -1, -1 } },
+	{ S("a|a.*c"), 0, S("aaaa"), 4, { 0, 1, 1, 2, 2, 3, 3, 4 } },
+	{ NULL, 0, NULL, 0, { 0, 0, 0, 0, 0, 0, 0, 0 } }
+};
+
+static int run_find_all_test(void)
+{
+	struct find_all_test_case *test;
+	struct regex_machine *machine;
+	struct regex_find_result results[4];
+	int i, length, error, result = 1;
+	long count;
+
+	for (test = find_all_tests; test->pattern && result; test++) {
+		length = 0;
+		while (test->pattern[length])
+			length++;
+
+		machine = regex_compile(test->pattern, length, test->flags, &error);
+		if (!machine)
+			return 0;
+
+		length = 0;
+		while (test->string[length])
+			length++;
+
+		if (regex_find_all(machine, test->string, length, results, 4, &count) != REGEX_NO_ERROR || count != test->count)
+			result = 0;
+		for (i = 0; i < count && result; i++)
+			if (results[i].begin != test->bounds[2 * i] || results[i].end != test->bounds[2 * i + 1])
+				result = 0;
+
+		/* Counting only. */
+		if (regex_find_all(machine, test->string, length, NULL, 0, &count) != REGEX_NO_ERROR || count != test->count)
+			result = 0;
+
+		regex_free_machine(machine);
+	}
+
+	/* The ring buffer keeps the last matches. */
+	machine = regex_compile(S("[0-9]+"), 6, 0, &error);
+	if (!machine)
+		return 0;
+	if (regex_find_all(machine, S("1 22 333 4444"), 13, results, 3, &count) != REGEX_NO_ERROR || count != 4
+			|| results[0].begin != 9 || results[0].end != 13 || results[1].begin != 2 || results[2].begin != 5)
+		result = 0;
+	regex_free_machine(machine);
+	return result;
+}
+
+struct capture_test_case {
+	const regex_char_t *pattern;
+	int flags;
+	const regex_char_t *string;
+	/* The whole match and the first two groups. */
+	int captures[6];
+};
+
+static struct capture_test_case capture_tests[] = {
+	{ S("(a)"), 0, S("xab"), { 1, 2, 1, 2, -1, -1 } },
+	{ S("(a)|(b)"), 0, S("xb"), { 1, 2, -1, -1, 1, 2 } },
+	{ S("(a)(b)?c"), 0, S("xacd"), { 1, 3, 1, 2, -1, -1 } },
+	{ S("x(ab)*y"), 0, S("xababy"), { 0, 6, 3, 5, -1, -1 } },
+	{ S("((a)|b)+"), 0, S("ab"), { 0, 2, 1, 2, 0, 1 } },
+	{ S("([a-z]+)@([a-z]+)"), 0, S("to bob@host!"), { 3, 11, 3, 6, 7, 11 } },
+	{ S("^(a)(b)"), REGEX_MATCH_BEGIN, S("abc"), { 0, 2, 0, 1, 1, 2 } },
+	{ S("^(a)(b)"), REGEX_NEWLINE, S("x\nabc"), { 2, 4, 2, 3, 3, 4 } },
+	{ S("(b)$"), REGEX_MATCH_END, S("abab"), { 3, 4, 3, 4, -1, -1 } },
+	{ S("(b)$"), REGEX_NEWLINE, S("ab\nc"), { 1, 2, 1, 2, -1, -1 } },
+	{ S("(a+)"), REGEX_MATCH_NON_GREEDY, S("aaa"), { 0, 1, 0, 1, -1, -1 } },
+	{ S("(a*)b"), 0, S("b"), { 0, 1, 0, 0, -1, -1 } },
+	{ S("(a*)"), 0, S(""), { 0, 0, 0, 0, -1, -1 } },
+	{ NULL, 0, NULL, { 0, 0, 0, 0, 0, 0 } }
+};
+
+static int check_captures(struct regex_machine *machine, struct capture_test_case *test)
+{
+	struct regex_match *match;
+	int captures[6];
+	int i, length = 0, result = 1;
+
+	while (test->string[length])
+		length++;
+
+	match = regex_begin_match(machine);
+	if (!match)
+		return 0;
+
+	regex_continue_match(match, test->string, length);
+	if (regex_get_captures(match, captures, 3) != test->captures[0])
+		result = 0;
+	for (i = 0; i < 6 && result; i++)
+		if (captures[i] != test->captures[i])
+			result = 0;
+
+	regex_free_match(match);
+	return result;
+}
+
+static int run_capture_test(void)
+{
+	struct capture_test_case *test;
+	struct regex_machine *machine, *loaded;
+	int length, error, result = 1;
+
+	for (test = capture_tests; test->pattern && result; test++) {
+		length = 0;
+		while (test->pattern[length])
+			length++;
+
+		machine = regex_compile(test->pattern, length, test->flags | REGEX_CAPTURES | REGEX_SERIALIZABLE, &error);
+		if (!machine)
+			return 0;
+
+		result = check_captures(machine, test);
+
+		/* The capture slots are part of the serialized machine. */
+		loaded = reload_machine(machine);
+		if (!loaded || regex_get_capture_count(loaded) != regex_get_capture_count(machine) || !check_captures(loaded, test))
+			result = 0;
+
+		if (loaded)
+			regex_free_machine(loaded);
+		regex_free_machine(machine);
+	}
+
+	/* The ids cannot be tracked with the captures. */
+	machine = regex_compile(S("(a){1!}"), 7, REGEX_CAPTURES, &error);
+	if (machine || error != REGEX_INVALID_REGEX)
+		result = 0;
+	if (machine)
+		regex_free_machine(machine);
+	return result;
+}
+
+#ifdef REGEX_USE_8BIT_CHARS
+
+#define SCAN_TEST_FILE		"regex_scan_test.tmp"
+/* Larger than the read buffer, so some lines are split by two reads. */
+#define SCAN_TEST_SIZE		(3 * 1024 * 1024 / 2)
+#define SCAN_TEST_MAX_LINES	64
+
+struct scan_test_lines {
+	regex_offset_t count;
+	regex_offset_t limit;
+	regex_offset_t offsets[SCAN_TEST_MAX_LINES];
+	int bounds[2 * SCAN_TEST_MAX_LINES];
+};
+
+static int store_scan_line(void *data, regex_offset_t offset, int begin, int end, int id)
+{
+	struct scan_test_lines *lines = (struct scan_test_lines*)data;
+
+	(void)id;
+	if (lines->count < SCAN_TEST_MAX_LINES) {
+		lines->offsets[lines->count] = offset;
+		lines->bounds[2 * lines->count] = begin;
+		lines->bounds[2 * lines->count + 1] = end;
+	}
+	lines->count++;
+	return lines->count == lines->limit;
+}
+
+static int compare_scan_lines(struct scan_test_lines *lines, struct scan_test_lines *expected, regex_offset_t count)
+{
+	regex_offset_t i;
+
+	if (lines->count != count)
+		return 0;
+	for (i = 0; i < count && i < SCAN_TEST_MAX_LINES; i++)
+		if (lines->offsets[i] != expected->offsets[i] || lines->bounds[2 * i] != expected->bounds[2 * i]
+				|| lines->bounds[2 * i + 1] != expected->bounds[2 * i + 1])
+			return 0;
+	return 1;
+}
+
+static int run_scan_file_test(void)
+{
+	struct regex_machine *machine;
+	struct regex_match *match;
+	struct scan_test_lines expected, lines;
+	char *buffer = (char*)malloc(SCAN_TEST_SIZE);
+	FILE *file;
+	long length = 0, line, line_end;
+	regex_offset_t count;
+	int i, mode, begin, end, id, error, result = 1;
+
+	if (!buffer)
+		return 0;
+
+	/* The last line is not terminated, and it is long enough to be split by a read. */
+	for (i = 0; length < SCAN_TEST_SIZE - 64; i++)
+		length += sprintf(buffer + length, (i % 9973 == 0) ? "id=%d code=7%d\n" : "id=%d\n", i, i % 100);
+	while (length < SCAN_TEST_SIZE - 1)
+		buffer[length++] = 'x';
+	memcpy(buffer + length - 10, "code=77 ", 8);
+
+	file = fopen(SCAN_TEST_FILE, "wb");
+	if (!file) {
+		free(buffer);
+		return 0;
+	}
+	if (fwrite(buffer, 1, (size_t)length, file) != (size_t)length)
+		result = 0;
+	fclose(file);
+
+	machine = regex_compile(S("code=7[0-9]+"), 12, 0, &error);
+	match = machine ? regex_begin_match(machine) : NULL;
+	if (!match)
+		result = 0;
+
+	expected.count = 0;
+	expected.limit = -1;
+	for (line = 0; result && line < length; line = line_end + 1) {
+		line_end = line;
+		while (line_end < length && buffer[line_end] != '\n')
+			line_end++;
+		regex_reset_match(match);
+		regex_continue_match(match, buffer + line, (int)(line_end - line));
+		begin = regex_get_result(match, &end, &id);
+		if (begin >= 0)
+			store_scan_line(&expected, line, begin, end, id);
+	}
+
+	for (mode = REGEX_SCAN_MMAP; mode <= REGEX_SCAN_READ && result; mode++) {
+		lines.count = 0;
+		lines.limit = -1;
+		if (regex_scan_file(machine, SCAN_TEST_FILE, mode, store_scan_line, &lines, &count) != REGEX_NO_ERROR
+				|| count != expected.count || !compare_scan_lines(&lines, &expected, expected.count))
+			result = 0;
+
+		/* The callback stops the scan. */
+		lines.count = 0;
+		lines.limit = 2;
+		if (regex_scan_file(machine, SCAN_TEST_FILE, mode, store_scan_line, &lines, &count) != REGEX_NO_ERROR
+				|| count != 2 || !compare_scan_lines(&lines, &expected, 2))
+			result = 0;
+	}
+
+	if (result && (expected.count < 3 || expected.offsets[expected.count - 1] < SCAN_TEST_SIZE / 2
+			|| regex_scan_file(machine, SCAN_TEST_FILE "-missing", REGEX_SCAN_READ, NULL, NULL, &count) != REGEX_FILE_ERROR))
+		result = 0;
+
+	if (match)
+		regex_free_match(match);
+	if (machine)
+		regex_free_machine(machine);
+	remove(SCAN_TEST_FILE);
+	free(buffer);
+	return result;
+}
+
+#endif /* REGEX_USE_8BIT_CHARS */
+
 static void run_tests(struct test_case* test, int verbose, int silent)
 {
 	int error;
 	const regex_char_t *ptr;
 	struct regex_machine* machine = NULL;
 	struct regex_match* match;
-	int begin, end, id, finished;
+	int begin, end, id, finished, i;
 	int success = 0, fail = 0;
 
 	if (!verbose && !silent)
@@ -209,6 +870,95 @@ static void run_tests(struct test_case* test, int verbose, int silent)
 	if (machine)
 		regex_free_machine(machine);
 
+	run_set_tests(verbose, &success, &fail);
+
+	for (i = 0; i < 2; i++) {
+		if (verbose)
+			printf("reset test%s: ", i ? " (lazy dfa)" : "");
+		if (run_reset_test(i ? REGEX_LAZY_DFA : 0)) {
+			if (verbose)
+				printf("SUCCESS\n");
+			success++;
+			continue;
+		}
+		if (!verbose)
+			printf("reset test%s: ", i ? " (lazy dfa)" : "");
+		printf("FAIL\n");
+		fail++;
+	}
+
+	if (verbose)
+		printf("match pool test: ");
+	if (run_pool_test()) {
+		if (verbose)
+			printf("SUCCESS\n");
+		success++;
+	}
+	else {
+		if (!verbose)
+			printf("match pool test: ");
+		printf("FAIL\n");
+		fail++;
+	}
+
+	if (verbose)
+		printf("serialize test: ");
+	if (run_serialize_test()) {
+		if (verbose)
+			printf("SUCCESS\n");
+		success++;
+	}
+	else {
+		if (!verbose)
+			printf("serialize test: ");
+		printf("FAIL\n");
+		fail++;
+	}
+
+	if (verbose)
+		printf("find all test: ");
+	if (run_find_all_test()) {
+		if (verbose)
+			printf("SUCCESS\n");
+		success++;
+	}
+	else {
+		if (!verbose)
+			printf("find all test: ");
+		printf("FAIL\n");
+		fail++;
+	}
+
+	if (verbose)
+		printf("capture test: ");
+	if (run_capture_test()) {
+		if (verbose)
+			printf("SUCCESS\n");
+		success++;
+	}
+	else {
+		if (!verbose)
+			printf("capture test: ");
+		printf("FAIL\n");
+		fail++;
+	}
+
+#ifdef REGEX_USE_8BIT_CHARS
+	if (verbose)
+		printf("scan file test: ");
+	if (run_scan_file_test()) {
+		if (verbose)
+			printf("SUCCESS\n");
+		success++;
+	}
+	else {
+		if (!verbose)
+			printf("scan file test: ");
+		printf("FAIL\n");
+		fail++;
+	}
+#endif
+
 	printf("REGEX tests: ");
 	if (fail == 0)
 		printf("all tests " COLOR_GREEN "PASSED" COLOR_DEFAULT " ");
@@ -310,10 +1060,126 @@ static struct test_case tests[] = {
   NULL, S("a") },
 { -1, 0, 0, -1, 0 /* REGEX_NEWLINE */,
   NULL, S("ab\nba") },
+{ 8, 8, 0, 0, REGEX_MATCH_END | REGEX_NEWLINE,
+  S("b*"), S("caaaxaaa") },
+{ 3, 7, 0, -1, REGEX_LAZY_DFA,
+  S("text"), S("is textile") },
+{ 7, 12, 0, -1, REGEX_LAZY_DFA,
+  S("ab+c"), S("abxabbxabbbc") },
+{ -1, 0, 0, 0, 0 /* =REGEX_LAZY_DFA */,
+  NULL, S("abbxabbbd") },
+{ 4, 11, 0, 0, REGEX_LAZY_DFA,
+  S("[^x-y]+[a-c_]{2,3}"), S("ssaymmaa_ccl") },
+{ 3, 6, 0, 1, REGEX_NEWLINE | REGEX_LAZY_DFA,
+  S(".a[^k]"), S("\na\nxa\ns") },
+{ 2, 3, 0, 1, REGEX_NEWLINE | REGEX_LAZY_DFA,
+  S("^a+"), S("\n\na\n") },
+{ 5, 8, 0, 0, REGEX_NEWLINE | REGEX_LAZY_DFA,
+  S("a+$"), S("b\nab\naaa") },
+{ 2, 4, 1, 1, REGEX_NEWLINE | REGEX_LAZY_DFA,
+  S("^a(a{1!})*$"), S("\n\naa\n\n") },
+{ 0, 4, 2, -1, REGEX_MATCH_END | REGEX_LAZY_DFA,
+  S("(a|b{2!})+"), S("abab") },
+{ 56, 59, 0, -1, 0,
+  S("xyz"), S("the quick brown fox jumps over the lazy dog; xa xy then xyz at the end") },
+{ 36, 38, 0, -1, 0,
+  S("[ab]c"), S("0123456789 0123456789 0123456789 bd ac 0123456789") },
+{ 62, 64, 0, -1, 0,
+  S("[0-2]k"), S("this line has no candidates at all in its first 64 characters 1k") },
+{ -1, 0, 0, -1, 0,
+  S("(foo|bar)"), S("no candidates in this long line of text which is long enough to scan") },
+{ 69, 70, 0, -1, 0,
+  S("z"), S("the last character of this line is the only one matching the pattern z") },
+{ 3, 13, 0, -1, 0,
+  S("[a-zA-Z0-9_.-]+@[^a-zA-Z0-9_. ]"), S("a@ x.Y-z_90@-") },
+{ 4, 9, 0, -1, REGEX_LAZY_DFA,
+  S("[^a-zA-Z0-9_.-]+[A-Z_a-z0-9.-]"), S("abc.#$%&x") },
+{ 4, 25, 0, -1, 0,
+  S("[ab]{16,20}c"), S("xxabababababababababababc") },
+{ 3, 19, 0, -1, 0,
+  S("[a-c]{16}"), S("abxaaaaaaaaaaaaaaaa") },
+{ 0, 16, 0, -1, REGEX_MATCH_BEGIN,
+  S("^a{16}"), S("aaaaaaaaaaaaaaaaaa") },
+{ 1, 2, 0, -1, REGEX_MATCH_NON_GREEDY,
+  S("ba{0,18}"), S("xbaaaa") },
+{ 17, 38, 0, -1, REGEX_MATCH_END,
+  S("x[^x]{16,}x"), S("xaaaaaaaaaaaaaaaaxabcdefghijklmnopqrsx") },
+{ 0, 21, 1, -1, 0,
+  S("a{20}b{1!}"), S("aaaaaaaaaaaaaaaaaaaab") },
+{ 18, 52, 0, -1, 0,
+  S("(a{16}b){2}"), S("aaaaaaaaaaaaaaaabaaaaaaaaaaaaaaaaabaaaaaaaaaaaaaaaab") },
+{ 3, 21, 0, -1, REGEX_NEWLINE,
+  S("^[a-c]{16,}$"), S("ab\naaaaaaaaaaaaaaaacc\nb") },
+#ifdef REGEX_USE_8BIT_CHARS
+{ 1, 3, 0, -1, 0,
+  S("\xc3\xa9"), S("x\xc3\xa9y") },
+{ 1, 5, 0, -1, REGEX_UTF8,
+  S("\xc3\xa9+"), S("x\xc3\xa9\xc3\xa9y") },
+{ 0, 5, 0, -1, REGEX_UTF8,
+  S("a.b"), S("a\xe6\x9d\xb1" "b") },
+{ 4, 8, 0, -1, REGEX_UTF8,
+  S("a.b"), S("a\xff" "b a\xc2\xb5" "b") },
+{ 2, 7, 0, -1, REGEX_UTF8,
+  S("[\xc3\xa0-\xc3\xbf]+x"), S("\xc3\x80\xc3\xa9\xc3\xa8x") },
+{ 2, 9, 0, -1, REGEX_UTF8 | REGEX_LAZY_DFA,
+  S("[^a]{2}"), S("aa\xe2\x82\xac\xf0\x9f\x98\x80" "a") },
+{ 4, 9, 0, -1, REGEX_UTF8 | REGEX_NEWLINE,
+  S("^.[\\]\xe2\x82\xac]"), S("\xe2\x82\xac\n\xc3\xa9\xe2\x82\xac") },
+#endif
 { -1, 0, 0, 0, 0,
   NULL, NULL }
 };
 
+static struct set_test_case set_tests[] = {
+{ 0, REGEX_NO_ERROR,
+  { S("abc"), S("b+d"), S("x[0-9]"), S("c"), NULL }, S("xabbdabcx5c"),
+  { { 5, 8 }, { 2, 5 }, { 8, 10 }, { 7, 8 } } },
+{ 0, REGEX_NO_ERROR,
+  { S("abc"), S("b+d"), S("x[0-9]"), S("c"), NULL }, S("zzzxz"),
+  { { -1, 0 }, { -1, 0 }, { -1, 0 }, { -1, 0 } } },
+{ 0, REGEX_NO_ERROR,
+  { S("ab"), S("b"), S("xab"), S("(a|x)+b"), NULL }, S("xxab"),
+  { { 2, 4 }, { 3, 4 }, { 1, 4 }, { 0, 4 } } },
+{ REGEX_MATCH_BEGIN, REGEX_NO_ERROR,
+  { S("ab"), S("b"), S("a+c"), NULL }, S("aacb"),
+  { { -1, 0 }, { -1, 0 }, { 0, 3 } } },
+{ 0, REGEX_NO_ERROR,
+  { S("abc"), S("abd"), S("abc"), S("abcd"), NULL }, S("xabdabcd"),
+  { { 4, 7 }, { 1, 4 }, { 4, 7 }, { 4, 8 } } },
+{ REGEX_NEWLINE, REGEX_NO_ERROR,
+  { S(".b"), S("a.c"), S("[\n]b"), NULL }, S("a\nb ab a\nc"),
+  { { 4, 6 }, { -1, 0 }, { 1, 3 } } },
+{ REGEX_NEWLINE | REGEX_MATCH_BEGIN, REGEX_NO_ERROR,
+  { S("ab"), S("b"), S("x"), NULL }, S("yx\nab\nb"),
+  { { 3, 5 }, { 6, 7 }, { -1, 0 } } },
+{ 0, REGEX_INVALID_REGEX,
+  { S("a"), S("^b"), NULL }, S("ab"),
+  { { -1, 0 } } },
+{ 0, REGEX_INVALID_REGEX,
+  { S("a{1!}"), NULL }, S("ab"),
+  { { -1, 0 } } },
+{ 0, REGEX_INVALID_REGEX,
+  { S("a"), S("b*"), NULL }, S("ab"),
+  { { -1, 0 } } },
+{ 0, REGEX_INVALID_REGEX,
+  { S("a)|(b"), NULL }, S("ab"),
+  { { -1, 0 } } },
+{ REGEX_MATCH_END, REGEX_INVALID_REGEX,
+  { S("a"), NULL }, S("ab"),
+  { { -1, 0 } } },
+#ifdef REGEX_USE_8BIT_CHARS
+{ REGEX_UTF8, REGEX_NO_ERROR,
+  { S("\xc3\xa9t\xc3\xa9"), S("[\xc3\xa0-\xc3\xbf]t"), S("t."), NULL }, S("x\xc3\xa9t\xc3\xa9"),
+  { { 1, 6 }, { 1, 4 }, { 3, 6 } } },
+{ REGEX_UTF8, REGEX_INVALID_REGEX,
+  { S("a"), S("\xc3"), NULL }, S("ab"),
+  { { -1, 0 } } },
+#endif
+{ 0, REGEX_NO_ERROR,
+  { NULL }, NULL,
+  { { -1, 0 } } }
+};
+
 int main(int argc, char* argv[])
 {
 	int has_arg = (argc >= 2 && argv[1][0] == '-' && argv[1][2] == '\0');
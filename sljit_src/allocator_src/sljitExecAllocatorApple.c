@@ -83,6 +83,8 @@ static SLJIT_INLINE int get_map_jit_flag(void)
 #define SLJIT_MAP_JIT	(MAP_JIT)
 #define SLJIT_UPDATE_WX_FLAGS(from, to, enable_exec) \
 		apple_update_wx_flags(enable_exec)
+/* The write protection is a property of the current thread. */
+#define SLJIT_UPDATE_WX_FLAGS_PER_THREAD 1
 
 static SLJIT_INLINE void apple_update_wx_flags(sljit_s32 enable_exec)
 {
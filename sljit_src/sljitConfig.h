@@ -126,6 +126,12 @@ extern "C" {
 #define SLJIT_VERBOSE 1
 #endif
 
+/* Compile time statistics (see sljit_compiler_stats). */
+#ifndef SLJIT_STATISTICS
+/* Disabled by default */
+#define SLJIT_STATISTICS 0
+#endif
+
 /*
   SLJIT_IS_FPU_AVAILABLE
     The availability of the FPU can be controlled by SLJIT_IS_FPU_AVAILABLE.
@@ -40,6 +40,13 @@
 
 #endif /* SLJIT_STD_MACROS_DEFINED */
 
+#if (defined SLJIT_STATISTICS && SLJIT_STATISTICS) && !defined(_WIN32)
+
+/* Needed for the monotonic clock. */
+#include <time.h>
+
+#endif /* SLJIT_STATISTICS && !_WIN32 */
+
 #define CHECK_ERROR() \
 	do { \
 		if (SLJIT_UNLIKELY(compiler->error)) \
@@ -148,6 +155,7 @@
 #define SLJIT_SIMD_GET_ELEM2_SIZE(type)		(((type) >> 24) & 0x3f)
 
 #define SLJIT_SIMD_CHECK_REG(type) (((type) & 0x3f000) >= SLJIT_SIMD_REG_64 && ((type) & 0x3f000) <= SLJIT_SIMD_REG_512)
+#define SLJIT_SIMD_CHECK_REG_SCALABLE(type) (SLJIT_SIMD_CHECK_REG(type) || ((type) & 0x3f000) == SLJIT_SIMD_REG_SCALABLE)
 #define SLJIT_SIMD_TYPE_MASK(m) ((sljit_s32)0xff000fff & ~(SLJIT_SIMD_FLOAT | SLJIT_SIMD_TEST | (m)))
 #define SLJIT_SIMD_TYPE_MASK2(m) ((sljit_s32)0xc0000fff & ~(SLJIT_SIMD_FLOAT | SLJIT_SIMD_TEST | (m)))
 
@@ -159,18 +167,22 @@
 #if (defined SLJIT_CONFIG_X86 && SLJIT_CONFIG_X86)
 #	define PATCH_MB		0x04
 #	define PATCH_MW		0x08
+	/* mov_addr which loads the address of the static data of sljit. */
+#	define MOV_ADDR_STATIC	0x40
 #if (defined SLJIT_CONFIG_X86_64 && SLJIT_CONFIG_X86_64)
 #	define PATCH_MD		0x10
 #	define MOV_ADDR_HI	0x20
+	/* Far jump which loads its absolute target by a 64 bit immediate. */
+#	define JUMP_FAR_MD	0x2000
 #	define JUMP_MAX_SIZE	((sljit_uw)(10 + 3))
 #	define CJUMP_MAX_SIZE	((sljit_uw)(2 + 10 + 3))
 #else /* !SLJIT_CONFIG_X86_64 */
 #	define JUMP_MAX_SIZE	((sljit_uw)5)
 #	define CJUMP_MAX_SIZE	((sljit_uw)6)
 #endif /* SLJIT_CONFIG_X86_64 */
-#	define TYPE_SHIFT	13
+#	define TYPE_SHIFT	14
 #if (defined SLJIT_DEBUG && SLJIT_DEBUG)
-/* Bits 7..12 is for debug jump size, SLJIT_REWRITABLE_JUMP is 0x1000 */
+/* Bits 7..11 is for debug jump size, SLJIT_REWRITABLE_JUMP is 0x1000 */
 #	define JUMP_SIZE_SHIFT	7
 #endif /* SLJIT_DEBUG */
 #endif /* SLJIT_CONFIG_X86 */
@@ -389,7 +401,7 @@
 #define CHECK_RETURN_TYPE sljit_s32
 #define CHECK_RETURN_OK return 0
 
-#define CHECK(x) \
+#define CHECK_CALL(x) \
 	do { \
 		if (SLJIT_UNLIKELY(x)) { \
 			compiler->error = SLJIT_ERR_BAD_ARGUMENT; \
@@ -397,7 +409,7 @@
 		} \
 	} while (0)
 
-#define CHECK_PTR(x) \
+#define CHECK_CALL_PTR(x) \
 	do { \
 		if (SLJIT_UNLIKELY(x)) { \
 			compiler->error = SLJIT_ERR_BAD_ARGUMENT; \
@@ -421,8 +433,8 @@
 #define CHECK_ARGUMENT(x) SLJIT_ASSERT(x)
 #define CHECK_RETURN_TYPE void
 #define CHECK_RETURN_OK return
-#define CHECK(x) x
-#define CHECK_PTR(x) x
+#define CHECK_CALL(x) x
+#define CHECK_CALL_PTR(x) x
 #define CHECK_REG_INDEX(x) x
 
 #elif (defined SLJIT_VERBOSE && SLJIT_VERBOSE)
@@ -430,19 +442,94 @@
 /* Arguments are not checked. */
 #define CHECK_RETURN_TYPE void
 #define CHECK_RETURN_OK return
-#define CHECK(x) x
-#define CHECK_PTR(x) x
+#define CHECK_CALL(x) x
+#define CHECK_CALL_PTR(x) x
 #define CHECK_REG_INDEX(x) x
 
 #else
 
 /* Arguments are not checked. */
-#define CHECK(x)
-#define CHECK_PTR(x)
+#define CHECK_CALL(x)
+#define CHECK_CALL_PTR(x)
 #define CHECK_REG_INDEX(x)
 
 #endif /* SLJIT_ARGUMENT_CHECKS */
 
+#if (defined SLJIT_STATISTICS && SLJIT_STATISTICS)
+
+/* The operations are counted by the stats_ hook of each check function
+   (see SLJIT_STATS_CHECK), which runs before the arguments are checked,
+   and does not depend on the argument checking features. */
+
+#define CHECK(x) \
+	do { \
+		SLJIT_STATS_CHECK(x); \
+		CHECK_CALL(x); \
+	} while (0)
+
+#define CHECK_PTR(x) \
+	do { \
+		SLJIT_STATS_CHECK(x); \
+		CHECK_CALL_PTR(x); \
+	} while (0)
+
+/* Internal calls of API functions (see SLJIT_SKIP_CHECKS) are not counted. */
+#define SLJIT_STATS_CHECK(x) \
+	do { \
+		if (SLJIT_UNLIKELY(compiler->stats_skip)) \
+			compiler->stats_skip = 0; \
+		else { \
+			stats_ ## x; \
+		} \
+	} while (0)
+
+#define SLJIT_STATS_ADD(name, value) \
+	do { \
+		if (SLJIT_UNLIKELY(!!compiler->stats)) \
+			compiler->stats->name += (sljit_uw)(value); \
+	} while (0)
+
+#define SLJIT_STATS_COUNT_OP(op_class) \
+	SLJIT_STATS_ADD(op_counts[op_class], 1)
+
+/* Adds the time since the start of the current phase to the
+   time member, and the next phase starts from now. */
+#define SLJIT_STATS_PHASE(name) \
+	do { \
+		if (SLJIT_UNLIKELY(!!compiler->stats)) { \
+			sljit_uw current_time = stats_get_time(); \
+			compiler->stats->name += current_time - compiler->stats_time; \
+			compiler->stats_time = current_time; \
+		} \
+	} while (0)
+
+static sljit_uw stats_get_time(void)
+{
+#ifdef _WIN32
+	LARGE_INTEGER frequency, counter;
+
+	QueryPerformanceFrequency(&frequency);
+	QueryPerformanceCounter(&counter);
+	return (sljit_uw)((double)counter.QuadPart * (1000000000.0 / (double)frequency.QuadPart));
+#else /* !_WIN32 */
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (sljit_uw)ts.tv_sec * 1000000000 + (sljit_uw)ts.tv_nsec;
+#endif /* _WIN32 */
+}
+
+#else /* !SLJIT_STATISTICS */
+
+#define CHECK(x) CHECK_CALL(x)
+#define CHECK_PTR(x) CHECK_CALL_PTR(x)
+
+#define SLJIT_STATS_ADD(name, value)
+#define SLJIT_STATS_COUNT_OP(op_class)
+#define SLJIT_STATS_PHASE(name)
+
+#endif /* SLJIT_STATISTICS */
+
 /* --------------------------------------------------------------------- */
 /*  Public functions                                                     */
 /* --------------------------------------------------------------------- */
@@ -494,8 +581,10 @@ SLJIT_API_FUNC_ATTRIBUTE struct sljit_compiler* sljit_create_compiler(void *allo
 
 	compiler->buf->next = NULL;
 	compiler->buf->used_size = 0;
+	compiler->buf->memory = (sljit_u8*)(compiler->buf + 1);
 	compiler->abuf->next = NULL;
 	compiler->abuf->used_size = 0;
+	compiler->abuf->memory = (sljit_u8*)(compiler->abuf + 1);
 
 	compiler->scratches = -1;
 	compiler->saveds = -1;
@@ -556,7 +645,10 @@ SLJIT_API_FUNC_ATTRIBUTE void sljit_free_compiler(struct sljit_compiler *compile
 	while (buf) {
 		curr = buf;
 		buf = buf->next;
-		SLJIT_FREE(curr, allocator_data);
+		/* The headers of referenced fragments (see
+		   SLJIT_DESERIALIZE_ZERO_COPY) are stored in abuf. */
+		if (curr->memory == (sljit_u8*)(curr + 1))
+			SLJIT_FREE(curr, allocator_data);
 	}
 
 	buf = compiler->abuf;
@@ -578,11 +670,34 @@ SLJIT_API_FUNC_ATTRIBUTE void sljit_set_compiler_memory_error(struct sljit_compi
 		compiler->error = SLJIT_ERR_ALLOC_FAILED;
 }
 
+/* Every executable memory block allocated by allocate_executable_memory()
+   starts with this header, which is followed by the machine code. Code
+   generated into a caller provided buffer has no header. */
+struct sljit_exec_header {
+	/* Non-NULL if the code is owned by a code cache. */
+	struct sljit_code_cache_entry *cache_entry;
+};
+
+/* Keeps the alignment provided by the executable allocator. */
+#define SLJIT_EXEC_HEADER_SIZE \
+	((sizeof(struct sljit_exec_header) + 7) & ~(sljit_uw)7)
+#define SLJIT_EXEC_HEADER(ptr) \
+	((struct sljit_exec_header*)((sljit_u8*)(ptr) - SLJIT_EXEC_HEADER_SIZE))
+
+static void code_cache_release(struct sljit_code_cache_entry *entry);
+
 SLJIT_API_FUNC_ATTRIBUTE void sljit_free_code(void* code, void *exec_allocator_data)
 {
+	struct sljit_exec_header *header = SLJIT_EXEC_HEADER(SLJIT_CODE_TO_PTR(code));
+
 	SLJIT_UNUSED_ARG(exec_allocator_data);
 
-	SLJIT_FREE_EXEC(SLJIT_CODE_TO_PTR(code), exec_allocator_data);
+	if (header->cache_entry != NULL) {
+		code_cache_release(header->cache_entry);
+		return;
+	}
+
+	SLJIT_FREE_EXEC(header, exec_allocator_data);
 }
 
 SLJIT_API_FUNC_ATTRIBUTE void sljit_set_label(struct sljit_jump *jump, struct sljit_label* label)
@@ -631,7 +746,7 @@ static void* ensure_buf(struct sljit_compiler *compiler, sljit_uw size)
 	struct sljit_memory_fragment *new_frag;
 
 	SLJIT_ASSERT(size <= 256);
-	if (compiler->buf->used_size + size <= (BUF_SIZE - (sljit_uw)SLJIT_OFFSETOF(struct sljit_memory_fragment, memory))) {
+	if (compiler->buf->used_size + size <= (BUF_SIZE - sizeof(struct sljit_memory_fragment))) {
 		ret = compiler->buf->memory + compiler->buf->used_size;
 		compiler->buf->used_size += size;
 		return ret;
@@ -640,7 +755,9 @@ static void* ensure_buf(struct sljit_compiler *compiler, sljit_uw size)
 	PTR_FAIL_IF_NULL(new_frag);
 	new_frag->next = compiler->buf;
 	compiler->buf = new_frag;
+	SLJIT_STATS_ADD(fragment_count, 1);
 	new_frag->used_size = size;
+	new_frag->memory = (sljit_u8*)(new_frag + 1);
 	return new_frag->memory;
 }
 
@@ -650,7 +767,7 @@ static void* ensure_abuf(struct sljit_compiler *compiler, sljit_uw size)
 	struct sljit_memory_fragment *new_frag;
 
 	SLJIT_ASSERT(size <= 256);
-	if (compiler->abuf->used_size + size <= (ABUF_SIZE - (sljit_uw)SLJIT_OFFSETOF(struct sljit_memory_fragment, memory))) {
+	if (compiler->abuf->used_size + size <= (ABUF_SIZE - sizeof(struct sljit_memory_fragment))) {
 		ret = compiler->abuf->memory + compiler->abuf->used_size;
 		compiler->abuf->used_size += size;
 		return ret;
@@ -659,7 +776,9 @@ static void* ensure_abuf(struct sljit_compiler *compiler, sljit_uw size)
 	PTR_FAIL_IF_NULL(new_frag);
 	new_frag->next = compiler->abuf;
 	compiler->abuf = new_frag;
+	SLJIT_STATS_ADD(fragment_count, 1);
 	new_frag->used_size = size;
+	new_frag->memory = (sljit_u8*)(new_frag + 1);
 	return new_frag->memory;
 }
 
@@ -702,9 +821,13 @@ static SLJIT_INLINE void* allocate_executable_memory(sljit_uw size, sljit_s32 op
 	struct sljit_generate_code_buffer *buffer;
 
 	if (SLJIT_LIKELY(!(options & SLJIT_GENERATE_CODE_BUFFER))) {
-		code = SLJIT_MALLOC_EXEC(size, exec_allocator_data);
+		code = SLJIT_MALLOC_EXEC(size + SLJIT_EXEC_HEADER_SIZE, exec_allocator_data);
+		if (SLJIT_UNLIKELY(code == NULL))
+			return NULL;
+
 		*executable_offset = SLJIT_EXEC_OFFSET(code);
-		return code;
+		((struct sljit_exec_header*)code)->cache_entry = NULL;
+		return (sljit_u8*)code + SLJIT_EXEC_HEADER_SIZE;
 	}
 
 	buffer = (struct sljit_generate_code_buffer*)exec_allocator_data;
@@ -1038,6 +1161,27 @@ static sljit_s32 function_fcheck(struct sljit_compiler *compiler, sljit_s32 p, s
 
 #endif /* SLJIT_ARGUMENT_CHECKS */
 
+#if (defined SLJIT_STATISTICS && SLJIT_STATISTICS)
+
+SLJIT_API_FUNC_ATTRIBUTE void sljit_compiler_stats(struct sljit_compiler *compiler, struct sljit_compiler_stats *stats)
+{
+	struct sljit_memory_fragment *buf;
+
+	compiler->stats = stats;
+	if (stats == NULL)
+		return;
+
+	/* Fragments allocated before the statistics are attached. */
+	for (buf = compiler->buf; buf != NULL; buf = buf->next)
+		stats->fragment_count++;
+	for (buf = compiler->abuf; buf != NULL; buf = buf->next)
+		stats->fragment_count++;
+
+	compiler->stats_time = stats_get_time();
+}
+
+#endif /* SLJIT_STATISTICS */
+
 #if (defined SLJIT_VERBOSE && SLJIT_VERBOSE)
 
 SLJIT_API_FUNC_ATTRIBUTE void sljit_compiler_verbose(struct sljit_compiler *compiler, FILE* verbose)
@@ -1194,9 +1338,19 @@ static const char* fop2r_names[] = {
 };
 
 static const char* simd_op2_names[] = {
-	"and", "or", "xor", "shuffle"
+	"and", "or", "xor", "shuffle", "zip_lo", "zip_hi", "unzip_lo", "unzip_hi", "cmp_eq"
+};
+
+static const char* simd_shift_names[] = {
+	"shl", "lshr", "ashr"
 };
 
+static const char* simd_reg_size_names[] = {
+	"64", "128", "256", "512", "vl"
+};
+
+#define SIMD_REG_SIZE_NAME(type) (simd_reg_size_names[SLJIT_SIMD_GET_REG_SIZE(type) - 3])
+
 static const char* jump_names[] = {
 	"equal", "not_equal",
 	"less", "greater_equal",
@@ -1233,7 +1387,11 @@ static const char* call_arg_names[] = {
 #if (defined SLJIT_ARGUMENT_CHECKS && SLJIT_ARGUMENT_CHECKS) \
 	|| (defined SLJIT_VERBOSE && SLJIT_VERBOSE)
 
+#if (defined SLJIT_STATISTICS && SLJIT_STATISTICS)
+#define SLJIT_SKIP_CHECKS(compiler) (compiler)->skip_checks = (compiler)->stats_skip = 1
+#else /* !SLJIT_STATISTICS */
 #define SLJIT_SKIP_CHECKS(compiler) (compiler)->skip_checks = 1
+#endif /* SLJIT_STATISTICS */
 
 static SLJIT_INLINE CHECK_RETURN_TYPE check_sljit_generate_code(struct sljit_compiler *compiler)
 {
@@ -2716,7 +2874,7 @@ static SLJIT_INLINE CHECK_RETURN_TYPE check_sljit_emit_simd_mov(struct sljit_com
 #if (defined SLJIT_ARGUMENT_CHECKS && SLJIT_ARGUMENT_CHECKS)
 	CHECK_ARGUMENT(sljit_has_cpu_feature(SLJIT_HAS_SIMD));
 	CHECK_ARGUMENT((type & SLJIT_SIMD_TYPE_MASK2(SLJIT_SIMD_STORE)) == 0);
-	CHECK_ARGUMENT(SLJIT_SIMD_CHECK_REG(type));
+	CHECK_ARGUMENT(SLJIT_SIMD_CHECK_REG_SCALABLE(type));
 	CHECK_ARGUMENT(SLJIT_SIMD_GET_ELEM_SIZE(type) <= SLJIT_SIMD_GET_REG_SIZE(type));
 	CHECK_ARGUMENT(SLJIT_SIMD_GET_ELEM2_SIZE(type) <= (srcdst & SLJIT_MEM) ? SLJIT_SIMD_GET_REG_SIZE(type) : 0);
 	CHECK_ARGUMENT(FUNCTION_CHECK_IS_FREG(freg, 0));
@@ -2731,9 +2889,9 @@ static SLJIT_INLINE CHECK_RETURN_TYPE check_sljit_emit_simd_mov(struct sljit_com
 			CHECK_RETURN_OK;
 		}
 
-		fprintf(compiler->verbose, "  simd_%s.%d.%s%d",
+		fprintf(compiler->verbose, "  simd_%s.%s.%s%d",
 			(type & SLJIT_SIMD_STORE) ? "store" : "load",
-			(8 << SLJIT_SIMD_GET_REG_SIZE(type)),
+			SIMD_REG_SIZE_NAME(type),
 			(type & SLJIT_SIMD_FLOAT) ? "f" : "",
 			(8 << SLJIT_SIMD_GET_ELEM_SIZE(type)));
 
@@ -2758,7 +2916,7 @@ static SLJIT_INLINE CHECK_RETURN_TYPE check_sljit_emit_simd_replicate(struct slj
 #if (defined SLJIT_ARGUMENT_CHECKS && SLJIT_ARGUMENT_CHECKS)
 	CHECK_ARGUMENT(sljit_has_cpu_feature(SLJIT_HAS_SIMD));
 	CHECK_ARGUMENT((type & SLJIT_SIMD_TYPE_MASK(0)) == 0);
-	CHECK_ARGUMENT(SLJIT_SIMD_CHECK_REG(type));
+	CHECK_ARGUMENT(SLJIT_SIMD_CHECK_REG_SCALABLE(type));
 	CHECK_ARGUMENT(SLJIT_SIMD_GET_ELEM_SIZE(type) < SLJIT_SIMD_GET_REG_SIZE(type));
 	CHECK_ARGUMENT(FUNCTION_CHECK_IS_FREG(freg, 0));
 
@@ -2781,8 +2939,8 @@ static SLJIT_INLINE CHECK_RETURN_TYPE check_sljit_emit_simd_replicate(struct slj
 			CHECK_RETURN_OK;
 		}
 
-		fprintf(compiler->verbose, "  simd_replicate.%d.%s%d ",
-			(8 << SLJIT_SIMD_GET_REG_SIZE(type)),
+		fprintf(compiler->verbose, "  simd_replicate.%s.%s%d ",
+			SIMD_REG_SIZE_NAME(type),
 			(type & SLJIT_SIMD_FLOAT) ? "f" : "",
 			(8 << SLJIT_SIMD_GET_ELEM_SIZE(type)));
 
@@ -2802,6 +2960,11 @@ static SLJIT_INLINE CHECK_RETURN_TYPE check_sljit_emit_simd_lane_mov(struct slji
 	sljit_s32 freg, sljit_s32 lane_index,
 	sljit_s32 srcdst, sljit_sw srcdstw)
 {
+	if (SLJIT_UNLIKELY(compiler->skip_checks)) {
+		compiler->skip_checks = 0;
+		CHECK_RETURN_OK;
+	}
+
 #if (defined SLJIT_ARGUMENT_CHECKS && SLJIT_ARGUMENT_CHECKS)
 	CHECK_ARGUMENT(sljit_has_cpu_feature(SLJIT_HAS_SIMD));
 	CHECK_ARGUMENT((type & SLJIT_SIMD_TYPE_MASK(SLJIT_SIMD_STORE | SLJIT_SIMD_LANE_ZERO | SLJIT_SIMD_LANE_SIGNED | SLJIT_32)) == 0);
@@ -2967,10 +3130,12 @@ static SLJIT_INLINE CHECK_RETURN_TYPE check_sljit_emit_simd_op2(struct sljit_com
 {
 #if (defined SLJIT_ARGUMENT_CHECKS && SLJIT_ARGUMENT_CHECKS)
 	CHECK_ARGUMENT(sljit_has_cpu_feature(SLJIT_HAS_SIMD));
-	CHECK_ARGUMENT((type & SLJIT_SIMD_TYPE_MASK2(0)) >= SLJIT_SIMD_OP2_AND && (type & SLJIT_SIMD_TYPE_MASK2(0)) <= SLJIT_SIMD_OP2_SHUFFLE);
-	CHECK_ARGUMENT(SLJIT_SIMD_CHECK_REG(type));
+	CHECK_ARGUMENT((type & SLJIT_SIMD_TYPE_MASK2(0)) >= SLJIT_SIMD_OP2_AND && (type & SLJIT_SIMD_TYPE_MASK2(0)) <= SLJIT_SIMD_OP2_CMP_EQ);
+	CHECK_ARGUMENT(SLJIT_SIMD_CHECK_REG_SCALABLE(type));
 	CHECK_ARGUMENT(SLJIT_SIMD_GET_ELEM_SIZE(type) <= SLJIT_SIMD_GET_REG_SIZE(type));
 	CHECK_ARGUMENT(SLJIT_SIMD_GET_OPCODE(type) != SLJIT_SIMD_OP2_SHUFFLE || (SLJIT_SIMD_GET_ELEM_SIZE(type) == 0 && !(type & SLJIT_SIMD_FLOAT)));
+	CHECK_ARGUMENT(SLJIT_SIMD_GET_OPCODE(type) < SLJIT_SIMD_OP2_ZIP_LO || SLJIT_SIMD_GET_ELEM_SIZE(type) < SLJIT_SIMD_GET_REG_SIZE(type));
+	CHECK_ARGUMENT(SLJIT_SIMD_GET_OPCODE(type) != SLJIT_SIMD_OP2_CMP_EQ || (SLJIT_SIMD_GET_ELEM_SIZE(type) <= 3 && !(type & SLJIT_SIMD_FLOAT)));
 	CHECK_ARGUMENT(SLJIT_SIMD_GET_ELEM2_SIZE(type) <= (src2 & SLJIT_MEM) ? SLJIT_SIMD_GET_REG_SIZE(type) : 0);
 	CHECK_ARGUMENT(FUNCTION_CHECK_IS_FREG(dst_freg, 0));
 	CHECK_ARGUMENT(FUNCTION_CHECK_IS_FREG(src1_freg, 0));
@@ -2985,9 +3150,9 @@ static SLJIT_INLINE CHECK_RETURN_TYPE check_sljit_emit_simd_op2(struct sljit_com
 			CHECK_RETURN_OK;
 		}
 
-		fprintf(compiler->verbose, "  simd_%s.%d.%s%d",
+		fprintf(compiler->verbose, "  simd_%s.%s.%s%d",
 			simd_op2_names[SLJIT_SIMD_GET_OPCODE(type) - 1],
-			(8 << SLJIT_SIMD_GET_REG_SIZE(type)),
+			SIMD_REG_SIZE_NAME(type),
 			(type & SLJIT_SIMD_FLOAT) ? "f" : "",
 			(8 << SLJIT_SIMD_GET_ELEM_SIZE(type)));
 
@@ -3006,6 +3171,192 @@ static SLJIT_INLINE CHECK_RETURN_TYPE check_sljit_emit_simd_op2(struct sljit_com
 	CHECK_RETURN_OK;
 }
 
+static SLJIT_INLINE CHECK_RETURN_TYPE check_sljit_emit_simd_shift(struct sljit_compiler *compiler, sljit_s32 type,
+	sljit_s32 dst_freg, sljit_s32 src1_freg, sljit_s32 src2, sljit_sw src2w)
+{
+#if (defined SLJIT_ARGUMENT_CHECKS && SLJIT_ARGUMENT_CHECKS)
+	CHECK_ARGUMENT(sljit_has_cpu_feature(SLJIT_HAS_SIMD));
+	CHECK_ARGUMENT((type & SLJIT_SIMD_TYPE_MASK(0)) >= SLJIT_SIMD_SHIFT_SHL && (type & SLJIT_SIMD_TYPE_MASK(0)) <= SLJIT_SIMD_SHIFT_ASHR);
+	CHECK_ARGUMENT(!(type & SLJIT_SIMD_FLOAT));
+	CHECK_ARGUMENT(SLJIT_SIMD_CHECK_REG(type));
+	CHECK_ARGUMENT(SLJIT_SIMD_GET_ELEM_SIZE(type) <= 3 && SLJIT_SIMD_GET_ELEM_SIZE(type) < SLJIT_SIMD_GET_REG_SIZE(type));
+	CHECK_ARGUMENT(FUNCTION_CHECK_IS_FREG(dst_freg, 0));
+	CHECK_ARGUMENT(FUNCTION_CHECK_IS_FREG(src1_freg, 0));
+	if (src2 == SLJIT_IMM)
+		CHECK_ARGUMENT(src2w >= 0 && src2w < (8 << SLJIT_SIMD_GET_ELEM_SIZE(type)));
+	else
+		CHECK_ARGUMENT(FUNCTION_CHECK_IS_FREG(src2, 0) && src2w == 0);
+#endif
+#if (defined SLJIT_VERBOSE && SLJIT_VERBOSE)
+	if (SLJIT_UNLIKELY(!!compiler->verbose)) {
+		if (type & SLJIT_SIMD_TEST)
+			CHECK_RETURN_OK;
+		if (sljit_emit_simd_shift(compiler, type | SLJIT_SIMD_TEST, dst_freg, src1_freg, src2, src2w) == SLJIT_ERR_UNSUPPORTED) {
+			fprintf(compiler->verbose, "    # simd_shift: unsupported form, no instructions are emitted\n");
+			CHECK_RETURN_OK;
+		}
+
+		fprintf(compiler->verbose, "  simd_%s.%d.%d ",
+			simd_shift_names[SLJIT_SIMD_GET_OPCODE(type) - 1],
+			(8 << SLJIT_SIMD_GET_REG_SIZE(type)),
+			(8 << SLJIT_SIMD_GET_ELEM_SIZE(type)));
+
+		sljit_verbose_freg(compiler, dst_freg);
+		fprintf(compiler->verbose, ", ");
+		sljit_verbose_freg(compiler, src1_freg);
+		fprintf(compiler->verbose, ", ");
+		if (src2 == SLJIT_IMM)
+			sljit_verbose_param(compiler, src2, src2w);
+		else
+			sljit_verbose_freg(compiler, src2);
+		fprintf(compiler->verbose, "\n");
+	}
+#endif
+	CHECK_RETURN_OK;
+}
+
+static SLJIT_INLINE CHECK_RETURN_TYPE check_sljit_emit_simd_narrow(struct sljit_compiler *compiler, sljit_s32 type,
+	sljit_s32 dst_freg, sljit_s32 src1_freg, sljit_s32 src2_freg)
+{
+#if (defined SLJIT_ARGUMENT_CHECKS && SLJIT_ARGUMENT_CHECKS)
+	CHECK_ARGUMENT(sljit_has_cpu_feature(SLJIT_HAS_SIMD));
+	CHECK_ARGUMENT((type & SLJIT_SIMD_TYPE_MASK(SLJIT_SIMD_NARROW_SIGNED_SAT | SLJIT_SIMD_NARROW_UNSIGNED_SAT)) == 0);
+	CHECK_ARGUMENT((type & (SLJIT_SIMD_NARROW_SIGNED_SAT | SLJIT_SIMD_NARROW_UNSIGNED_SAT)) != (SLJIT_SIMD_NARROW_SIGNED_SAT | SLJIT_SIMD_NARROW_UNSIGNED_SAT));
+	CHECK_ARGUMENT(!(type & SLJIT_SIMD_FLOAT));
+	CHECK_ARGUMENT(SLJIT_SIMD_CHECK_REG(type));
+	CHECK_ARGUMENT(SLJIT_SIMD_GET_ELEM_SIZE(type) >= 1 && SLJIT_SIMD_GET_ELEM_SIZE(type) <= 3);
+	CHECK_ARGUMENT(SLJIT_SIMD_GET_ELEM_SIZE(type) < SLJIT_SIMD_GET_REG_SIZE(type));
+	CHECK_ARGUMENT(FUNCTION_CHECK_IS_FREG(dst_freg, 0));
+	CHECK_ARGUMENT(FUNCTION_CHECK_IS_FREG(src1_freg, 0));
+	CHECK_ARGUMENT(FUNCTION_CHECK_IS_FREG(src2_freg, 0));
+#endif
+#if (defined SLJIT_VERBOSE && SLJIT_VERBOSE)
+	if (SLJIT_UNLIKELY(!!compiler->verbose)) {
+		if (type & SLJIT_SIMD_TEST)
+			CHECK_RETURN_OK;
+		if (sljit_emit_simd_narrow(compiler, type | SLJIT_SIMD_TEST, dst_freg, src1_freg, src2_freg) == SLJIT_ERR_UNSUPPORTED) {
+			fprintf(compiler->verbose, "    # simd_narrow: unsupported form, no instructions are emitted\n");
+			CHECK_RETURN_OK;
+		}
+
+		fprintf(compiler->verbose, "  simd_narrow%s.%d.%d.%d ",
+			(type & SLJIT_SIMD_NARROW_SIGNED_SAT) ? "_sat_s" : ((type & SLJIT_SIMD_NARROW_UNSIGNED_SAT) ? "_sat_u" : ""),
+			(8 << SLJIT_SIMD_GET_REG_SIZE(type)),
+			(4 << SLJIT_SIMD_GET_ELEM_SIZE(type)),
+			(8 << SLJIT_SIMD_GET_ELEM_SIZE(type)));
+
+		sljit_verbose_freg(compiler, dst_freg);
+		fprintf(compiler->verbose, ", ");
+		sljit_verbose_freg(compiler, src1_freg);
+		fprintf(compiler->verbose, ", ");
+		sljit_verbose_freg(compiler, src2_freg);
+		fprintf(compiler->verbose, "\n");
+	}
+#endif
+	CHECK_RETURN_OK;
+}
+
+static SLJIT_INLINE CHECK_RETURN_TYPE check_sljit_emit_simd_gather(struct sljit_compiler *compiler, sljit_s32 type,
+	sljit_s32 freg, sljit_s32 index_freg,
+	sljit_s32 mem, sljit_sw memw)
+{
+#if (defined SLJIT_ARGUMENT_CHECKS && SLJIT_ARGUMENT_CHECKS)
+	CHECK_ARGUMENT(sljit_has_cpu_feature(SLJIT_HAS_SIMD));
+	CHECK_ARGUMENT((type & SLJIT_SIMD_TYPE_MASK2(SLJIT_SIMD_STORE)) == 0);
+	CHECK_ARGUMENT(SLJIT_SIMD_CHECK_REG(type));
+	CHECK_ARGUMENT(SLJIT_SIMD_GET_ELEM_SIZE(type) >= 2 && SLJIT_SIMD_GET_ELEM_SIZE(type) <= 3);
+	CHECK_ARGUMENT(SLJIT_SIMD_GET_ELEM_SIZE(type) < SLJIT_SIMD_GET_REG_SIZE(type));
+	CHECK_ARGUMENT(SLJIT_SIMD_GET_ELEM2_SIZE(type) <= 3);
+	CHECK_ARGUMENT(FUNCTION_CHECK_IS_FREG(freg, 0));
+	CHECK_ARGUMENT(FUNCTION_CHECK_IS_FREG(index_freg, 0));
+	CHECK_ARGUMENT((mem & SLJIT_MEM) && !(mem & OFFS_REG_MASK) && (mem & REG_MASK) != SLJIT_SP);
+	FUNCTION_CHECK_SRC(mem, memw);
+#endif
+#if (defined SLJIT_VERBOSE && SLJIT_VERBOSE)
+	if (SLJIT_UNLIKELY(!!compiler->verbose)) {
+		if (type & SLJIT_SIMD_TEST)
+			CHECK_RETURN_OK;
+		if (sljit_emit_simd_gather(compiler, type | SLJIT_SIMD_TEST, freg, index_freg, mem, memw) == SLJIT_ERR_UNSUPPORTED) {
+			fprintf(compiler->verbose, "    # simd_gather: unsupported form, no instructions are emitted\n");
+			CHECK_RETURN_OK;
+		}
+
+		fprintf(compiler->verbose, "  simd_%s.%d.%s%d.x%d ",
+			(type & SLJIT_SIMD_STORE) ? "scatter" : "gather",
+			(8 << SLJIT_SIMD_GET_REG_SIZE(type)),
+			(type & SLJIT_SIMD_FLOAT) ? "f" : "",
+			(8 << SLJIT_SIMD_GET_ELEM_SIZE(type)),
+			(1 << SLJIT_SIMD_GET_ELEM2_SIZE(type)));
+
+		sljit_verbose_freg(compiler, freg);
+		fprintf(compiler->verbose, ", ");
+		sljit_verbose_param(compiler, mem, memw);
+		fprintf(compiler->verbose, "[");
+		sljit_verbose_freg(compiler, index_freg);
+		fprintf(compiler->verbose, "]\n");
+	}
+#endif
+	CHECK_RETURN_OK;
+}
+
+static SLJIT_INLINE CHECK_RETURN_TYPE check_sljit_emit_simd_while(struct sljit_compiler *compiler, sljit_s32 type,
+	sljit_s32 src1, sljit_sw src1w,
+	sljit_s32 src2, sljit_sw src2w)
+{
+#if (defined SLJIT_ARGUMENT_CHECKS && SLJIT_ARGUMENT_CHECKS)
+	CHECK_ARGUMENT(sljit_has_cpu_feature(SLJIT_HAS_SIMD));
+	CHECK_ARGUMENT((type & ~(SLJIT_SIMD_TEST | 0xfc0000)) == SLJIT_SIMD_REG_SCALABLE);
+	CHECK_ARGUMENT(SLJIT_SIMD_GET_ELEM_SIZE(type) <= 3);
+	FUNCTION_CHECK_SRC(src1, src1w);
+	FUNCTION_CHECK_SRC(src2, src2w);
+	if (!(type & SLJIT_SIMD_TEST))
+		compiler->last_flags = SLJIT_SET_Z;
+#endif
+#if (defined SLJIT_VERBOSE && SLJIT_VERBOSE)
+	if (SLJIT_UNLIKELY(!!compiler->verbose)) {
+		if (type & SLJIT_SIMD_TEST)
+			CHECK_RETURN_OK;
+		if (sljit_emit_simd_while(compiler, type | SLJIT_SIMD_TEST, src1, src1w, src2, src2w) == SLJIT_ERR_UNSUPPORTED) {
+			fprintf(compiler->verbose, "    # simd_while: unsupported form, no instructions are emitted\n");
+			CHECK_RETURN_OK;
+		}
+
+		fprintf(compiler->verbose, "  simd_while.vl.%d ", (8 << SLJIT_SIMD_GET_ELEM_SIZE(type)));
+		sljit_verbose_param(compiler, src1, src1w);
+		fprintf(compiler->verbose, ", ");
+		sljit_verbose_param(compiler, src2, src2w);
+		fprintf(compiler->verbose, "\n");
+	}
+#endif
+	CHECK_RETURN_OK;
+}
+
+static SLJIT_INLINE CHECK_RETURN_TYPE check_sljit_emit_simd_lane_count(struct sljit_compiler *compiler, sljit_s32 type,
+	sljit_s32 dst, sljit_sw dstw)
+{
+#if (defined SLJIT_ARGUMENT_CHECKS && SLJIT_ARGUMENT_CHECKS)
+	CHECK_ARGUMENT(sljit_has_cpu_feature(SLJIT_HAS_SIMD));
+	CHECK_ARGUMENT((type & ~(SLJIT_SIMD_TEST | 0xfc0000)) == SLJIT_SIMD_REG_SCALABLE);
+	CHECK_ARGUMENT(SLJIT_SIMD_GET_ELEM_SIZE(type) <= 3);
+	FUNCTION_CHECK_DST(dst, dstw);
+#endif
+#if (defined SLJIT_VERBOSE && SLJIT_VERBOSE)
+	if (SLJIT_UNLIKELY(!!compiler->verbose)) {
+		if (type & SLJIT_SIMD_TEST)
+			CHECK_RETURN_OK;
+		if (sljit_emit_simd_lane_count(compiler, type | SLJIT_SIMD_TEST, dst, dstw) == SLJIT_ERR_UNSUPPORTED) {
+			fprintf(compiler->verbose, "    # simd_lane_count: unsupported form, no instructions are emitted\n");
+			CHECK_RETURN_OK;
+		}
+
+		fprintf(compiler->verbose, "  simd_lane_count.vl.%d ", (8 << SLJIT_SIMD_GET_ELEM_SIZE(type)));
+		sljit_verbose_param(compiler, dst, dstw);
+		fprintf(compiler->verbose, "\n");
+	}
+#endif
+	CHECK_RETURN_OK;
+}
+
 static SLJIT_INLINE CHECK_RETURN_TYPE check_sljit_get_local_base(struct sljit_compiler *compiler, sljit_s32 dst, sljit_sw dstw, sljit_sw offset)
 {
 	/* Any offset is allowed. */
@@ -3058,10 +3409,127 @@ static SLJIT_INLINE CHECK_RETURN_TYPE check_sljit_emit_mov_addr(struct sljit_com
 
 #else /* !SLJIT_ARGUMENT_CHECKS && !SLJIT_VERBOSE */
 
+#if (defined SLJIT_STATISTICS && SLJIT_STATISTICS)
+#define SLJIT_SKIP_CHECKS(compiler) (compiler)->stats_skip = 1
+#else /* !SLJIT_STATISTICS */
 #define SLJIT_SKIP_CHECKS(compiler)
+#endif /* SLJIT_STATISTICS */
 
 #endif /* SLJIT_ARGUMENT_CHECKS || SLJIT_VERBOSE */
 
+#if (defined SLJIT_STATISTICS && SLJIT_STATISTICS)
+
+/* Statistics hooks of the check functions (see SLJIT_STATS_CHECK). */
+
+#define stats_check_sljit_generate_code(compiler)
+#define stats_check_sljit_emit_enter(compiler, options, arg_types, scratches, saveds, fscratches, fsaveds, local_size) \
+	SLJIT_STATS_COUNT_OP(SLJIT_STATS_ENTER)
+#define stats_check_sljit_set_context(compiler, options, arg_types, scratches, saveds, fscratches, fsaveds, local_size)
+#define stats_check_sljit_emit_return_void(compiler) \
+	SLJIT_STATS_COUNT_OP(SLJIT_STATS_ENTER)
+#define stats_check_sljit_emit_return(compiler, op, src, srcw) \
+	SLJIT_STATS_COUNT_OP(SLJIT_STATS_ENTER)
+#define stats_check_sljit_emit_return_to(compiler, src, srcw) \
+	SLJIT_STATS_COUNT_OP(SLJIT_STATS_ENTER)
+#define stats_check_sljit_emit_op0(compiler, op) \
+	SLJIT_STATS_COUNT_OP(SLJIT_STATS_OP0)
+#define stats_check_sljit_emit_op1(compiler, op, dst, dstw, src, srcw) \
+	SLJIT_STATS_COUNT_OP(SLJIT_STATS_OP1)
+#define stats_check_sljit_emit_atomic_load(compiler, op, dst_reg, mem_reg) \
+	SLJIT_STATS_COUNT_OP(SLJIT_STATS_ATOMIC)
+#define stats_check_sljit_emit_atomic_store(compiler, op, src_reg, mem_reg, temp_reg) \
+	SLJIT_STATS_COUNT_OP(SLJIT_STATS_ATOMIC)
+#define stats_check_sljit_emit_op2(compiler, op, unset, dst, dstw, src1, src1w, src2, src2w) \
+	SLJIT_STATS_COUNT_OP(SLJIT_STATS_OP2)
+#define stats_check_sljit_emit_op2r(compiler, op, dst_reg, src1, src1w, src2, src2w) \
+	SLJIT_STATS_COUNT_OP(SLJIT_STATS_OP2)
+#define stats_check_sljit_emit_shift_into(compiler, op, dst_reg, src1_reg, src2_reg, src3, src3w) \
+	SLJIT_STATS_COUNT_OP(SLJIT_STATS_OP2)
+#define stats_check_sljit_emit_op_src(compiler, op, src, srcw) \
+	SLJIT_STATS_COUNT_OP(SLJIT_STATS_OTHER)
+#define stats_check_sljit_emit_op_dst(compiler, op, dst, dstw) \
+	SLJIT_STATS_COUNT_OP(SLJIT_STATS_OTHER)
+#define stats_check_sljit_emit_op_custom(compiler, instruction, size) \
+	SLJIT_STATS_COUNT_OP(SLJIT_STATS_OTHER)
+#define stats_check_sljit_emit_fop1(compiler, op, dst, dstw, src, srcw) \
+	SLJIT_STATS_COUNT_OP(SLJIT_STATS_FOP)
+#define stats_check_sljit_emit_fop1_cmp(compiler, op, src1, src1w, src2, src2w) \
+	SLJIT_STATS_COUNT_OP(SLJIT_STATS_FOP)
+#define stats_check_sljit_emit_fop1_conv_sw_from_f64(compiler, op, dst, dstw, src, srcw) \
+	SLJIT_STATS_COUNT_OP(SLJIT_STATS_FOP)
+#define stats_check_sljit_emit_fop1_conv_f64_from_w(compiler, op, dst, dstw, src, srcw) \
+	SLJIT_STATS_COUNT_OP(SLJIT_STATS_FOP)
+#define stats_check_sljit_emit_fop2(compiler, op, dst, dstw, src1, src1w, src2, src2w) \
+	SLJIT_STATS_COUNT_OP(SLJIT_STATS_FOP)
+#define stats_check_sljit_emit_fop2r(compiler, op, dst_freg, src1, src1w, src2, src2w) \
+	SLJIT_STATS_COUNT_OP(SLJIT_STATS_FOP)
+#define stats_check_sljit_emit_fset32(compiler, freg, value) \
+	SLJIT_STATS_COUNT_OP(SLJIT_STATS_FOP)
+#define stats_check_sljit_emit_fset64(compiler, freg, value) \
+	SLJIT_STATS_COUNT_OP(SLJIT_STATS_FOP)
+#define stats_check_sljit_emit_fcopy(compiler, op, freg, reg) \
+	SLJIT_STATS_COUNT_OP(SLJIT_STATS_FOP)
+#define stats_check_sljit_emit_label(compiler) \
+	SLJIT_STATS_COUNT_OP(SLJIT_STATS_LABEL)
+#define stats_check_sljit_emit_jump(compiler, type) \
+	SLJIT_STATS_COUNT_OP(SLJIT_STATS_JUMP)
+#define stats_check_sljit_emit_call(compiler, type, arg_types) \
+	SLJIT_STATS_COUNT_OP(SLJIT_STATS_JUMP)
+#define stats_check_sljit_emit_cmp(compiler, type, src1, src1w, src2, src2w) \
+	SLJIT_STATS_COUNT_OP(SLJIT_STATS_JUMP)
+#define stats_check_sljit_emit_fcmp(compiler, type, src1, src1w, src2, src2w) \
+	SLJIT_STATS_COUNT_OP(SLJIT_STATS_JUMP)
+#define stats_check_sljit_emit_ijump(compiler, type, src, srcw) \
+	SLJIT_STATS_COUNT_OP(SLJIT_STATS_JUMP)
+#define stats_check_sljit_emit_icall(compiler, type, arg_types, src, srcw) \
+	SLJIT_STATS_COUNT_OP(SLJIT_STATS_JUMP)
+#define stats_check_sljit_emit_op_flags(compiler, op, dst, dstw, type) \
+	SLJIT_STATS_COUNT_OP(SLJIT_STATS_FLAGS)
+#define stats_check_sljit_emit_select(compiler, type, dst_reg, src1, src1w, src2_reg) \
+	SLJIT_STATS_COUNT_OP(SLJIT_STATS_FLAGS)
+#define stats_check_sljit_emit_fselect(compiler, type, dst_freg, src1, src1w, src2_freg) \
+	SLJIT_STATS_COUNT_OP(SLJIT_STATS_FLAGS)
+#define stats_check_sljit_emit_mem(compiler, type, reg, mem, memw) \
+	SLJIT_STATS_COUNT_OP(SLJIT_STATS_MEM)
+#define stats_check_sljit_emit_mem_update(compiler, type, reg, mem, memw) \
+	SLJIT_STATS_ADD(op_counts[SLJIT_STATS_MEM], !((type) & SLJIT_MEM_SUPP))
+#define stats_check_sljit_emit_fmem(compiler, type, freg, mem, memw) \
+	SLJIT_STATS_COUNT_OP(SLJIT_STATS_MEM)
+#define stats_check_sljit_emit_fmem_update(compiler, type, freg, mem, memw) \
+	SLJIT_STATS_ADD(op_counts[SLJIT_STATS_MEM], !((type) & SLJIT_MEM_SUPP))
+#define stats_check_sljit_emit_simd_mov(compiler, type, freg, srcdst, srcdstw) \
+	SLJIT_STATS_ADD(op_counts[SLJIT_STATS_SIMD], !((type) & SLJIT_SIMD_TEST))
+#define stats_check_sljit_emit_simd_replicate(compiler, type, freg, src, srcw) \
+	SLJIT_STATS_ADD(op_counts[SLJIT_STATS_SIMD], !((type) & SLJIT_SIMD_TEST))
+#define stats_check_sljit_emit_simd_lane_mov(compiler, type, freg, lane_index, srcdst, srcdstw) \
+	SLJIT_STATS_ADD(op_counts[SLJIT_STATS_SIMD], !((type) & SLJIT_SIMD_TEST))
+#define stats_check_sljit_emit_simd_lane_replicate(compiler, type, freg, src, src_lane_index) \
+	SLJIT_STATS_ADD(op_counts[SLJIT_STATS_SIMD], !((type) & SLJIT_SIMD_TEST))
+#define stats_check_sljit_emit_simd_extend(compiler, type, freg, src, srcw) \
+	SLJIT_STATS_ADD(op_counts[SLJIT_STATS_SIMD], !((type) & SLJIT_SIMD_TEST))
+#define stats_check_sljit_emit_simd_sign(compiler, type, freg, dst, dstw) \
+	SLJIT_STATS_ADD(op_counts[SLJIT_STATS_SIMD], !((type) & SLJIT_SIMD_TEST))
+#define stats_check_sljit_emit_simd_op2(compiler, type, dst_freg, src1_freg, src2, src2w) \
+	SLJIT_STATS_ADD(op_counts[SLJIT_STATS_SIMD], !((type) & SLJIT_SIMD_TEST))
+#define stats_check_sljit_emit_simd_shift(compiler, type, dst_freg, src1_freg, src2, src2w) \
+	SLJIT_STATS_ADD(op_counts[SLJIT_STATS_SIMD], !((type) & SLJIT_SIMD_TEST))
+#define stats_check_sljit_emit_simd_narrow(compiler, type, dst_freg, src1_freg, src2_freg) \
+	SLJIT_STATS_ADD(op_counts[SLJIT_STATS_SIMD], !((type) & SLJIT_SIMD_TEST))
+#define stats_check_sljit_emit_simd_gather(compiler, type, freg, index_freg, mem, memw) \
+	SLJIT_STATS_ADD(op_counts[SLJIT_STATS_SIMD], !((type) & SLJIT_SIMD_TEST))
+#define stats_check_sljit_emit_simd_while(compiler, type, src1, src1w, src2, src2w) \
+	SLJIT_STATS_ADD(op_counts[SLJIT_STATS_SIMD], !((type) & SLJIT_SIMD_TEST))
+#define stats_check_sljit_emit_simd_lane_count(compiler, type, dst, dstw) \
+	SLJIT_STATS_ADD(op_counts[SLJIT_STATS_SIMD], !((type) & SLJIT_SIMD_TEST))
+#define stats_check_sljit_get_local_base(compiler, dst, dstw, offset) \
+	SLJIT_STATS_COUNT_OP(SLJIT_STATS_OTHER)
+#define stats_check_sljit_emit_const(compiler, dst, dstw, init_value) \
+	SLJIT_STATS_COUNT_OP(SLJIT_STATS_OTHER)
+#define stats_check_sljit_emit_mov_addr(compiler, dst, dstw) \
+	SLJIT_STATS_COUNT_OP(SLJIT_STATS_JUMP)
+
+#endif /* SLJIT_STATISTICS */
+
 #define SELECT_FOP1_OPERATION_WITH_CHECKS(compiler, op, dst, dstw, src, srcw) \
 	SLJIT_COMPILE_ASSERT(!(SLJIT_CONV_SW_FROM_F64 & 0x1) && !(SLJIT_CONV_F64_FROM_SW & 0x1) && !(SLJIT_CONV_F64_FROM_UW & 0x1), \
 		invalid_float_opcodes); \
@@ -3124,6 +3592,65 @@ static sljit_s32 sljit_emit_fmem_unaligned(struct sljit_compiler *compiler, slji
 
 #endif /* (!SLJIT_CONFIG_MIPS || SLJIT_MIPS_REV >= 6) && !SLJIT_CONFIG_ARM */
 
+#if (defined SLJIT_CONFIG_X86 && SLJIT_CONFIG_X86) \
+	|| (defined SLJIT_CONFIG_ARM_64 && SLJIT_CONFIG_ARM_64)
+
+/* Gather / scatter implementation which moves one lane at a time. The
+   tmp_reg register must be a temporary register of the backend, which
+   is not used by sljit_emit_simd_lane_mov() for register operands. */
+static sljit_s32 sljit_emit_simd_mem_lanes(struct sljit_compiler *compiler, sljit_s32 type,
+	sljit_s32 freg, sljit_s32 index_freg,
+	sljit_s32 mem, sljit_sw memw, sljit_s32 tmp_reg)
+{
+	sljit_s32 elem_size = SLJIT_SIMD_GET_ELEM_SIZE(type);
+	sljit_s32 scale = SLJIT_SIMD_GET_ELEM2_SIZE(type);
+	sljit_s32 lane_count = 1 << (SLJIT_SIMD_GET_REG_SIZE(type) - elem_size);
+	sljit_s32 data_type = type & (SLJIT_SIMD_STORE | SLJIT_SIMD_FLOAT | 0xfff000);
+	sljit_s32 index_type = SLJIT_SIMD_STORE | (type & 0xfff000);
+	sljit_s32 i;
+
+	if (elem_size == 2)
+		index_type |= SLJIT_SIMD_LANE_SIGNED;
+
+	SLJIT_SKIP_CHECKS(compiler);
+	if (sljit_emit_simd_lane_mov(compiler, index_type | SLJIT_SIMD_TEST, index_freg, 0, tmp_reg, 0) == SLJIT_ERR_UNSUPPORTED)
+		return SLJIT_ERR_UNSUPPORTED;
+
+	SLJIT_SKIP_CHECKS(compiler);
+	if (sljit_emit_simd_lane_mov(compiler, data_type | SLJIT_SIMD_TEST, freg, 0, SLJIT_MEM1(tmp_reg), 0) == SLJIT_ERR_UNSUPPORTED)
+		return SLJIT_ERR_UNSUPPORTED;
+
+	if (type & SLJIT_SIMD_TEST)
+		return SLJIT_SUCCESS;
+
+	for (i = 0; i < lane_count; i++) {
+		SLJIT_SKIP_CHECKS(compiler);
+		FAIL_IF(sljit_emit_simd_lane_mov(compiler, index_type, index_freg, i, tmp_reg, 0));
+
+		if (scale != 0) {
+			SLJIT_SKIP_CHECKS(compiler);
+			FAIL_IF(sljit_emit_op2(compiler, SLJIT_SHL, tmp_reg, 0, tmp_reg, 0, SLJIT_IMM, scale));
+		}
+
+		if (mem & REG_MASK) {
+			SLJIT_SKIP_CHECKS(compiler);
+			FAIL_IF(sljit_emit_op2(compiler, SLJIT_ADD, tmp_reg, 0, tmp_reg, 0, mem & REG_MASK, 0));
+		}
+
+		if (memw != 0) {
+			SLJIT_SKIP_CHECKS(compiler);
+			FAIL_IF(sljit_emit_op2(compiler, SLJIT_ADD, tmp_reg, 0, tmp_reg, 0, SLJIT_IMM, memw));
+		}
+
+		SLJIT_SKIP_CHECKS(compiler);
+		FAIL_IF(sljit_emit_simd_lane_mov(compiler, data_type, freg, i, SLJIT_MEM1(tmp_reg), 0));
+	}
+
+	return SLJIT_SUCCESS;
+}
+
+#endif /* SLJIT_CONFIG_X86 || SLJIT_CONFIG_ARM_64 */
+
 /* CPU description section */
 
 #if (defined SLJIT_32BIT_ARCHITECTURE && SLJIT_32BIT_ARCHITECTURE)
@@ -3335,6 +3862,57 @@ SLJIT_API_FUNC_ATTRIBUTE sljit_s32 sljit_cmp_info(sljit_s32 type)
 
 #endif /* SLJIT_CONFIG_ARM */
 
+SLJIT_API_FUNC_ATTRIBUTE void sljit_get_cpu_profile(struct sljit_cpu_profile *profile)
+{
+	sljit_u32 features = 0;
+
+	if (sljit_has_cpu_feature(SLJIT_HAS_FPU))
+		features |= SLJIT_CPU_FPU;
+	if (sljit_has_cpu_feature(SLJIT_HAS_SIMD))
+		features |= SLJIT_CPU_SIMD;
+	if (sljit_has_cpu_feature(SLJIT_HAS_CLZ) == 1)
+		features |= SLJIT_CPU_CLZ;
+	if (sljit_has_cpu_feature(SLJIT_HAS_CTZ) == 1)
+		features |= SLJIT_CPU_CTZ;
+	if (sljit_has_cpu_feature(SLJIT_HAS_CMOV))
+		features |= SLJIT_CPU_CMOV;
+	if (sljit_has_cpu_feature(SLJIT_HAS_ATOMIC))
+		features |= SLJIT_CPU_ATOMIC;
+#if (defined SLJIT_CONFIG_X86 && SLJIT_CONFIG_X86)
+	if (sljit_has_cpu_feature(SLJIT_HAS_AVX))
+		features |= SLJIT_CPU_AVX;
+	if (sljit_has_cpu_feature(SLJIT_HAS_AVX2))
+		features |= SLJIT_CPU_AVX2;
+#endif /* SLJIT_CONFIG_X86 */
+#if (defined SLJIT_CONFIG_LOONGARCH && SLJIT_CONFIG_LOONGARCH)
+	if (sljit_has_cpu_feature(SLJIT_HAS_LASX))
+		features |= SLJIT_CPU_LASX;
+#endif /* SLJIT_CONFIG_LOONGARCH */
+#if (defined SLJIT_CONFIG_ARM_64 && SLJIT_CONFIG_ARM_64)
+	if (sljit_has_cpu_feature(SLJIT_HAS_SVE))
+		features |= SLJIT_CPU_SVE;
+#endif /* SLJIT_CONFIG_ARM_64 */
+
+	profile->features = features;
+}
+
+#if !(defined SLJIT_CONFIG_X86 && SLJIT_CONFIG_X86) \
+	&& !(defined SLJIT_CONFIG_ARM_64 && SLJIT_CONFIG_ARM_64)
+
+SLJIT_API_FUNC_ATTRIBUTE sljit_s32 sljit_set_cpu_profile(const struct sljit_cpu_profile *profile)
+{
+	struct sljit_cpu_profile current;
+
+	if (profile == NULL)
+		return SLJIT_SUCCESS;
+
+	/* Lowering the profile is not supported. */
+	sljit_get_cpu_profile(&current);
+	return (current.features & ~profile->features) ? SLJIT_ERR_UNSUPPORTED : SLJIT_SUCCESS;
+}
+
+#endif /* !SLJIT_CONFIG_X86 && !SLJIT_CONFIG_ARM_64 */
+
 SLJIT_API_FUNC_ATTRIBUTE struct sljit_jump* sljit_emit_fcmp(struct sljit_compiler *compiler, sljit_s32 type,
 	sljit_s32 src1, sljit_sw src1w,
 	sljit_s32 src2, sljit_sw src2w)
@@ -3515,6 +4093,95 @@ SLJIT_API_FUNC_ATTRIBUTE sljit_s32 sljit_emit_simd_op2(struct sljit_compiler *co
 
 #endif /* !SLJIT_CONFIG_X86 && !SLJIT_CONFIG_ARM */
 
+#if !(defined SLJIT_CONFIG_X86 && SLJIT_CONFIG_X86) \
+	&& !(defined SLJIT_CONFIG_ARM_64 && SLJIT_CONFIG_ARM_64) \
+	&& !(defined SLJIT_CONFIG_ARM_THUMB2 && SLJIT_CONFIG_ARM_THUMB2)
+
+SLJIT_API_FUNC_ATTRIBUTE sljit_s32 sljit_emit_simd_shift(struct sljit_compiler *compiler, sljit_s32 type,
+	sljit_s32 dst_freg, sljit_s32 src1_freg, sljit_s32 src2, sljit_sw src2w)
+{
+	CHECK_ERROR();
+	CHECK(check_sljit_emit_simd_shift(compiler, type, dst_freg, src1_freg, src2, src2w));
+	SLJIT_UNUSED_ARG(compiler);
+	SLJIT_UNUSED_ARG(type);
+	SLJIT_UNUSED_ARG(dst_freg);
+	SLJIT_UNUSED_ARG(src1_freg);
+	SLJIT_UNUSED_ARG(src2);
+	SLJIT_UNUSED_ARG(src2w);
+
+	return SLJIT_ERR_UNSUPPORTED;
+}
+
+SLJIT_API_FUNC_ATTRIBUTE sljit_s32 sljit_emit_simd_narrow(struct sljit_compiler *compiler, sljit_s32 type,
+	sljit_s32 dst_freg, sljit_s32 src1_freg, sljit_s32 src2_freg)
+{
+	CHECK_ERROR();
+	CHECK(check_sljit_emit_simd_narrow(compiler, type, dst_freg, src1_freg, src2_freg));
+	SLJIT_UNUSED_ARG(compiler);
+	SLJIT_UNUSED_ARG(type);
+	SLJIT_UNUSED_ARG(dst_freg);
+	SLJIT_UNUSED_ARG(src1_freg);
+	SLJIT_UNUSED_ARG(src2_freg);
+
+	return SLJIT_ERR_UNSUPPORTED;
+}
+
+#endif /* !SLJIT_CONFIG_X86 && !SLJIT_CONFIG_ARM_64 && !SLJIT_CONFIG_ARM_THUMB2 */
+
+#if !(defined SLJIT_CONFIG_X86 && SLJIT_CONFIG_X86) \
+	&& !(defined SLJIT_CONFIG_ARM_64 && SLJIT_CONFIG_ARM_64)
+
+SLJIT_API_FUNC_ATTRIBUTE sljit_s32 sljit_emit_simd_gather(struct sljit_compiler *compiler, sljit_s32 type,
+	sljit_s32 freg, sljit_s32 index_freg,
+	sljit_s32 mem, sljit_sw memw)
+{
+	CHECK_ERROR();
+	CHECK(check_sljit_emit_simd_gather(compiler, type, freg, index_freg, mem, memw));
+	SLJIT_UNUSED_ARG(compiler);
+	SLJIT_UNUSED_ARG(type);
+	SLJIT_UNUSED_ARG(freg);
+	SLJIT_UNUSED_ARG(index_freg);
+	SLJIT_UNUSED_ARG(mem);
+	SLJIT_UNUSED_ARG(memw);
+
+	return SLJIT_ERR_UNSUPPORTED;
+}
+
+#endif /* !SLJIT_CONFIG_X86 && !SLJIT_CONFIG_ARM_64 */
+
+#if !(defined SLJIT_CONFIG_ARM_64 && SLJIT_CONFIG_ARM_64)
+
+SLJIT_API_FUNC_ATTRIBUTE sljit_s32 sljit_emit_simd_while(struct sljit_compiler *compiler, sljit_s32 type,
+	sljit_s32 src1, sljit_sw src1w,
+	sljit_s32 src2, sljit_sw src2w)
+{
+	CHECK_ERROR();
+	CHECK(check_sljit_emit_simd_while(compiler, type, src1, src1w, src2, src2w));
+	SLJIT_UNUSED_ARG(compiler);
+	SLJIT_UNUSED_ARG(type);
+	SLJIT_UNUSED_ARG(src1);
+	SLJIT_UNUSED_ARG(src1w);
+	SLJIT_UNUSED_ARG(src2);
+	SLJIT_UNUSED_ARG(src2w);
+
+	return SLJIT_ERR_UNSUPPORTED;
+}
+
+SLJIT_API_FUNC_ATTRIBUTE sljit_s32 sljit_emit_simd_lane_count(struct sljit_compiler *compiler, sljit_s32 type,
+	sljit_s32 dst, sljit_sw dstw)
+{
+	CHECK_ERROR();
+	CHECK(check_sljit_emit_simd_lane_count(compiler, type, dst, dstw));
+	SLJIT_UNUSED_ARG(compiler);
+	SLJIT_UNUSED_ARG(type);
+	SLJIT_UNUSED_ARG(dst);
+	SLJIT_UNUSED_ARG(dstw);
+
+	return SLJIT_ERR_UNSUPPORTED;
+}
+
+#endif /* !SLJIT_CONFIG_ARM_64 */
+
 #if !(defined(SLJIT_CONFIG_X86) && SLJIT_CONFIG_X86) \
 	&& !(defined(SLJIT_CONFIG_ARM) && SLJIT_CONFIG_ARM) \
 	&& !(defined(SLJIT_CONFIG_S390X) && SLJIT_CONFIG_S390X) \
@@ -3862,4 +4529,184 @@ SLJIT_API_FUNC_ATTRIBUTE sljit_s32 sljit_emit_icall_multiarg(struct sljit_compil
 }
 #endif /* SLJIT_SUPPORT_MARG */
 
+/* --------------------------------------------------------------------- */
+/*  Code pools                                                           */
+/* --------------------------------------------------------------------- */
+
+#if (defined SLJIT_SINGLE_THREADED && SLJIT_SINGLE_THREADED)
+#define SLJIT_CODE_POOL_COUNTER sljit_uw
+#define SLJIT_CODE_POOL_CLAIM(ptr) ((*(ptr))++)
+#elif (defined _WIN32)
+#define SLJIT_CODE_POOL_COUNTER LONG volatile
+#define SLJIT_CODE_POOL_CLAIM(ptr) ((sljit_uw)InterlockedIncrement(ptr) - 1)
+#else /* !SLJIT_SINGLE_THREADED && !_WIN32 */
+#define SLJIT_CODE_POOL_COUNTER sljit_uw
+#define SLJIT_CODE_POOL_CLAIM(ptr) __atomic_fetch_add((ptr), 1, __ATOMIC_RELAXED)
+#endif /* SLJIT_SINGLE_THREADED */
+
+/* The place of each compiler is aligned to this value. */
+#define SLJIT_CODE_POOL_ALIGNMENT 16
+
+struct sljit_code_pool {
+	struct sljit_compiler **compilers;
+	sljit_uw count;
+	SLJIT_CODE_POOL_COUNTER next;
+	sljit_s32 options;
+	void *allocator_data;
+	void *exec_allocator_data;
+	sljit_u8 *code;
+	sljit_uw size;
+	sljit_sw executable_offset;
+	/* Followed by the generated code (count items), and the
+	   offsets of the compilers in the block (count + 1 items). */
+};
+
+#define SLJIT_CODE_POOL_CODES(pool) ((void**)((pool) + 1))
+#define SLJIT_CODE_POOL_OFFSETS(pool) ((sljit_uw*)(SLJIT_CODE_POOL_CODES(pool) + (pool)->count))
+
+#if (defined SLJIT_MAX_GENERATED_CODE_SIZE)
+
+SLJIT_API_FUNC_ATTRIBUTE struct sljit_code_pool* sljit_create_code_pool(struct sljit_compiler **compilers,
+	sljit_uw count, sljit_s32 options, void *allocator_data, void *exec_allocator_data)
+{
+	struct sljit_code_pool *pool;
+	sljit_uw *offsets;
+	sljit_uw i, size = 0;
+	SLJIT_UNUSED_ARG(allocator_data);
+
+	SLJIT_ASSERT(count > 0 && !(options & SLJIT_GENERATE_CODE_BUFFER));
+
+	pool = (struct sljit_code_pool*)SLJIT_MALLOC(sizeof(struct sljit_code_pool)
+		+ count * sizeof(void*) + (count + 1) * sizeof(sljit_uw), allocator_data);
+	if (pool == NULL)
+		return NULL;
+
+	pool->compilers = compilers;
+	pool->count = count;
+	pool->next = 0;
+	pool->options = options;
+	pool->allocator_data = allocator_data;
+	pool->exec_allocator_data = exec_allocator_data;
+
+	offsets = SLJIT_CODE_POOL_OFFSETS(pool);
+	for (i = 0; i < count; i++) {
+		SLJIT_CODE_POOL_CODES(pool)[i] = NULL;
+		offsets[i] = size;
+		size += (SLJIT_MAX_GENERATED_CODE_SIZE(compilers[i]) + SLJIT_CODE_POOL_ALIGNMENT - 1)
+			& ~(sljit_uw)(SLJIT_CODE_POOL_ALIGNMENT - 1);
+	}
+	offsets[count] = size;
+
+	pool->size = size;
+	pool->code = (sljit_u8*)allocate_executable_memory(size, options, exec_allocator_data, &pool->executable_offset);
+	if (pool->code == NULL) {
+		SLJIT_FREE(pool, allocator_data);
+		return NULL;
+	}
+
+	return pool;
+}
+
+SLJIT_API_FUNC_ATTRIBUTE sljit_uw sljit_generate_code_pool(struct sljit_code_pool *pool)
+{
+	struct sljit_generate_code_buffer buffer;
+	sljit_uw *offsets = SLJIT_CODE_POOL_OFFSETS(pool);
+	sljit_s32 options = pool->options | SLJIT_GENERATE_CODE_BUFFER | SLJIT_GENERATE_CODE_KEEP_WRITABLE;
+	sljit_u8 *code = (sljit_u8*)SLJIT_ADD_EXEC_OFFSET(pool->code, pool->executable_offset);
+	sljit_uw index, count = 0;
+
+	SLJIT_UNUSED_ARG(code);
+
+	/* The thread which created the pool might not be the current thread. */
+	SLJIT_UPDATE_WX_FLAGS(code, code + pool->size, 0);
+
+	buffer.executable_offset = pool->executable_offset;
+
+	while (1) {
+		index = SLJIT_CODE_POOL_CLAIM(&pool->next);
+		if (index >= pool->count)
+			break;
+
+		buffer.buffer = pool->code + offsets[index];
+		buffer.size = offsets[index + 1] - offsets[index];
+		SLJIT_CODE_POOL_CODES(pool)[index] = sljit_generate_code(pool->compilers[index], options, &buffer);
+		count++;
+	}
+
+#if (defined SLJIT_UPDATE_WX_FLAGS_PER_THREAD && SLJIT_UPDATE_WX_FLAGS_PER_THREAD)
+	/* Other threads may still write the block, but their
+	   write access does not depend on the current thread. */
+	SLJIT_UPDATE_WX_FLAGS(code, code + pool->size, 1);
+#endif /* SLJIT_UPDATE_WX_FLAGS_PER_THREAD */
+	return count;
+}
+
+SLJIT_API_FUNC_ATTRIBUTE sljit_s32 sljit_publish_code_pool(struct sljit_code_pool *pool)
+{
+	sljit_u8 *code = (sljit_u8*)SLJIT_ADD_EXEC_OFFSET(pool->code, pool->executable_offset);
+	sljit_uw i;
+
+	SLJIT_UNUSED_ARG(code);
+
+	for (i = 0; i < pool->count; i++) {
+		if (SLJIT_CODE_POOL_CODES(pool)[i] == NULL)
+			return pool->compilers[i]->error != SLJIT_SUCCESS ? pool->compilers[i]->error : SLJIT_ERR_ALLOC_FAILED;
+	}
+
+	SLJIT_UPDATE_WX_FLAGS(code, code + pool->size, 1);
+	return SLJIT_SUCCESS;
+}
+
+SLJIT_API_FUNC_ATTRIBUTE void* sljit_get_code_pool_code(struct sljit_code_pool *pool, sljit_uw index)
+{
+	SLJIT_ASSERT(index < pool->count);
+	return SLJIT_CODE_POOL_CODES(pool)[index];
+}
+
+SLJIT_API_FUNC_ATTRIBUTE void sljit_free_code_pool(struct sljit_code_pool *pool)
+{
+	SLJIT_FREE_EXEC(SLJIT_EXEC_HEADER(SLJIT_ADD_EXEC_OFFSET(pool->code, pool->executable_offset)),
+		pool->exec_allocator_data);
+	SLJIT_FREE(pool, pool->allocator_data);
+}
+
+#else /* !SLJIT_MAX_GENERATED_CODE_SIZE */
+
+SLJIT_API_FUNC_ATTRIBUTE struct sljit_code_pool* sljit_create_code_pool(struct sljit_compiler **compilers,
+	sljit_uw count, sljit_s32 options, void *allocator_data, void *exec_allocator_data)
+{
+	SLJIT_UNUSED_ARG(compilers);
+	SLJIT_UNUSED_ARG(count);
+	SLJIT_UNUSED_ARG(options);
+	SLJIT_UNUSED_ARG(allocator_data);
+	SLJIT_UNUSED_ARG(exec_allocator_data);
+	return NULL;
+}
+
+SLJIT_API_FUNC_ATTRIBUTE sljit_uw sljit_generate_code_pool(struct sljit_code_pool *pool)
+{
+	SLJIT_UNUSED_ARG(pool);
+	return 0;
+}
+
+SLJIT_API_FUNC_ATTRIBUTE sljit_s32 sljit_publish_code_pool(struct sljit_code_pool *pool)
+{
+	SLJIT_UNUSED_ARG(pool);
+	return SLJIT_ERR_UNSUPPORTED;
+}
+
+SLJIT_API_FUNC_ATTRIBUTE void* sljit_get_code_pool_code(struct sljit_code_pool *pool, sljit_uw index)
+{
+	SLJIT_UNUSED_ARG(pool);
+	SLJIT_UNUSED_ARG(index);
+	return NULL;
+}
+
+SLJIT_API_FUNC_ATTRIBUTE void sljit_free_code_pool(struct sljit_code_pool *pool)
+{
+	SLJIT_UNUSED_ARG(pool);
+}
+
+#endif /* SLJIT_MAX_GENERATED_CODE_SIZE */
+
 #endif /* !SLJIT_CONFIG_UNSUPPORTED */
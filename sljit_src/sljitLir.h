@@ -432,8 +432,10 @@ extern "C" {
 struct sljit_memory_fragment {
 	struct sljit_memory_fragment *next;
 	sljit_uw used_size;
-	/* Must be aligned to sljit_sw. */
-	sljit_u8 memory[1];
+	/* Must be aligned to sljit_sw. Points to the area after this
+	   structure, except for fragments which reference the buffer
+	   passed to sljit_deserialize_compiler (see SLJIT_DESERIALIZE_ZERO_COPY). */
+	sljit_u8 *memory;
 };
 
 struct sljit_label {
@@ -479,6 +481,53 @@ struct sljit_marg {
 	sljit_u8 args[1];
 };
 
+#if (defined SLJIT_STATISTICS && SLJIT_STATISTICS)
+
+/* Operation classes of the op_counts member of sljit_compiler_stats. */
+/* Entry and return operations. */
+#define SLJIT_STATS_ENTER	0
+#define SLJIT_STATS_OP0		1
+#define SLJIT_STATS_OP1		2
+/* Includes op2u, op2r and shift_into. */
+#define SLJIT_STATS_OP2		3
+/* Floating point operations, except memory accesses. */
+#define SLJIT_STATS_FOP		4
+/* Unaligned and update memory accesses. */
+#define SLJIT_STATS_MEM		5
+/* Jumps, calls, compares and mov_addr. */
+#define SLJIT_STATS_JUMP	6
+/* Flag to register conversions and selects. */
+#define SLJIT_STATS_FLAGS	7
+#define SLJIT_STATS_SIMD	8
+#define SLJIT_STATS_ATOMIC	9
+#define SLJIT_STATS_LABEL	10
+/* Constants and the remaining operations. */
+#define SLJIT_STATS_OTHER	11
+#define SLJIT_STATS_OP_CLASSES	12
+
+struct sljit_compiler_stats {
+	/* Number of emitted operations per class. The operations
+	   are counted before their arguments are checked. */
+	sljit_uw op_counts[SLJIT_STATS_OP_CLASSES];
+	/* Number of instruction and auxiliary memory fragments. */
+	sljit_uw fragment_count;
+	/* Number of jumps processed by the code size reduction,
+	   and the number of jumps which got a shorter encoding. */
+	sljit_uw jump_count;
+	sljit_uw shortened_jump_count;
+	/* Maximum byte size of the code before and after the size reduction. */
+	sljit_uw size_before_reduce;
+	sljit_uw size_after_reduce;
+	/* Time spent in each phase in nanoseconds. The emission is the
+	   time between attaching the statistics and sljit_generate_code(). */
+	sljit_uw emit_time;
+	sljit_uw reduce_time;
+	sljit_uw alloc_time;
+	sljit_uw encode_time;
+};
+
+#endif /* SLJIT_STATISTICS */
+
 struct sljit_compiler {
 	sljit_s32 error;
 	sljit_s32 options;
@@ -619,6 +668,15 @@ struct sljit_compiler {
 	   Used internally for calling API functions. */
 	sljit_s32 skip_checks;
 #endif /* SLJIT_ARGUMENT_CHECKS || SLJIT_DEBUG || SLJIT_VERBOSE */
+
+#if (defined SLJIT_STATISTICS && SLJIT_STATISTICS)
+	/* Attached statistics or NULL. */
+	struct sljit_compiler_stats *stats;
+	/* Start time of the current phase. */
+	sljit_uw stats_time;
+	/* The next API call is an internal call, which is not counted. */
+	sljit_s32 stats_skip;
+#endif /* SLJIT_STATISTICS */
 };
 
 /* --------------------------------------------------------------------- */
@@ -674,11 +732,27 @@ static SLJIT_INLINE void* sljit_compiler_get_user_data(struct sljit_compiler *co
 SLJIT_API_FUNC_ATTRIBUTE void sljit_compiler_verbose(struct sljit_compiler *compiler, FILE* verbose);
 #endif
 
+#if (defined SLJIT_STATISTICS && SLJIT_STATISTICS)
+/* Attach a statistics structure to the compiler, which is updated until
+   sljit_generate_code() returns, and it can be read afterwards. The
+   counters are increased, so the structure must be initialized by the
+   caller (e.g. to zero), and it can collect the statistics of several
+   compilers. Passing NULL disables the statistics. */
+SLJIT_API_FUNC_ATTRIBUTE void sljit_compiler_stats(struct sljit_compiler *compiler, struct sljit_compiler_stats *stats);
+#endif
+
 /* Option bits for sljit_generate_code. */
 
 /* The exec_allocator_data points to a pre-allocated
-   buffer which type is sljit_generate_code_buffer. */
+   buffer which type is sljit_generate_code_buffer.
+   The buffer is owned by the caller, so the generated
+   code must not be freed by sljit_free_code(). */
 #define SLJIT_GENERATE_CODE_BUFFER		0x1
+/* The code is not made executable when the executable allocator
+   separates writable and executable states (SLJIT_WX_EXECUTABLE_ALLOCATOR),
+   so the same pages can be written by other code generators. The caller
+   must make the code executable, see sljit_publish_code_pool(). */
+#define SLJIT_GENERATE_CODE_KEEP_WRITABLE	0x2
 
 /* Create executable code from the instruction stream. This is the final step
    of the code generation, and no more instructions can be emitted after this call.
@@ -689,7 +763,9 @@ SLJIT_API_FUNC_ATTRIBUTE void sljit_compiler_verbose(struct sljit_compiler *comp
 
 SLJIT_API_FUNC_ATTRIBUTE void* sljit_generate_code(struct sljit_compiler *compiler, sljit_s32 options, void *exec_allocator_data);
 
-/* Free executable code. */
+/* Free executable code. Functions returned by sljit_generate_cached_code()
+   are shared by their cache: in this case the reference count of the function
+   is decreased, and the code is freed by the cache when it reaches zero. */
 
 SLJIT_API_FUNC_ATTRIBUTE void sljit_free_code(void* code, void *exec_allocator_data);
 
@@ -746,7 +822,9 @@ static SLJIT_INLINE sljit_uw sljit_get_generated_code_size(struct sljit_compiler
    two separate 32 bit floating point registers (e.g. ARM32). The
    second 32 bit part can be accessed by SLJIT_F64_SECOND. */
 #define SLJIT_HAS_F64_AS_F32_PAIR	11
-/* [Not emulated] Some SIMD operations are supported by the compiler. */
+/* [Not emulated] Some SIMD operations are supported by the compiler.
+   Among the targets supported by the sfjit branch, SIMD is available
+   on x86 (SSE4.1 or AVX/AVX2 for 256 bit registers) and ARM (NEON). */
 #define SLJIT_HAS_SIMD			12
 /* [Not emulated] SIMD registers are mapped to a pair of double precision
    floating point registers. E.g. passing either SLJIT_FR0 or SLJIT_FR1 to
@@ -768,8 +846,68 @@ static SLJIT_INLINE sljit_uw sljit_get_generated_code_size(struct sljit_compiler
 #define SLJIT_HAS_LASX        201
 #endif
 
+#if (defined SLJIT_CONFIG_ARM_64 && SLJIT_CONFIG_ARM_64)
+/* [Not emulated] SVE support is available on ARM-64, which
+   enables the SLJIT_SIMD_REG_SCALABLE register size. */
+#define SLJIT_HAS_SVE			300
+#endif
+
 SLJIT_API_FUNC_ATTRIBUTE sljit_s32 sljit_has_cpu_feature(sljit_s32 feature_type);
 
+/* The capability profile collects the features which are relevant for
+   selecting a code variant (e.g. AVX2, SSE4.1 or baseline on x86) into
+   a single bit set, so front-ends do not need to query them one by one. */
+struct sljit_cpu_profile {
+	/* Combination of SLJIT_CPU_* flags. */
+	sljit_u32 features;
+};
+
+/* The following flags are defined on all targets, but only those
+   which are available on the current target can be set. */
+
+/* Same as sljit_has_cpu_feature(SLJIT_HAS_FPU). */
+#define SLJIT_CPU_FPU			0x0001
+/* Same as sljit_has_cpu_feature(SLJIT_HAS_SIMD). */
+#define SLJIT_CPU_SIMD			0x0002
+/* Count leading zero is fully supported (not emulated). */
+#define SLJIT_CPU_CLZ			0x0004
+/* Count trailing zero is fully supported (not emulated). */
+#define SLJIT_CPU_CTZ			0x0008
+/* Same as sljit_has_cpu_feature(SLJIT_HAS_CMOV). */
+#define SLJIT_CPU_CMOV			0x0010
+/* Same as sljit_has_cpu_feature(SLJIT_HAS_ATOMIC). */
+#define SLJIT_CPU_ATOMIC		0x0020
+/* Same as sljit_has_cpu_feature(SLJIT_HAS_AVX). */
+#define SLJIT_CPU_AVX			0x0100
+/* Same as sljit_has_cpu_feature(SLJIT_HAS_AVX2). */
+#define SLJIT_CPU_AVX2			0x0200
+/* Same as sljit_has_cpu_feature(SLJIT_HAS_LASX). */
+#define SLJIT_CPU_LASX			0x0400
+/* Same as sljit_has_cpu_feature(SLJIT_HAS_SVE). */
+#define SLJIT_CPU_SVE			0x0800
+
+/* Stores the current capability profile into the structure pointed
+   by profile. The CPU features are detected only once, so calling
+   this function is cheap. If the profile has been lowered by
+   sljit_set_cpu_profile, the lowered profile is returned. */
+SLJIT_API_FUNC_ATTRIBUTE void sljit_get_cpu_profile(struct sljit_cpu_profile *profile);
+
+/* Forces a lower capability profile: the features which are not present
+   in profile->features are disabled, and sljit_has_cpu_feature and the
+   code generator behave as if the CPU did not support them. Features
+   which are not detected on the CPU cannot be enabled, and they are
+   ignored. Disabling a feature also disables the features which depend
+   on it (e.g. disabling SLJIT_CPU_AVX disables SLJIT_CPU_AVX2 as well).
+   Passing NULL restores the detected profile.
+
+   The profile is global, therefore it must not be changed while other
+   threads are generating code. This is mainly useful for testing all
+   code variants of a multi-versioned code generator on a single machine.
+
+   Returns with SLJIT_ERR_UNSUPPORTED, and the profile is left unchanged,
+   if a feature cannot be disabled on the current target. */
+SLJIT_API_FUNC_ATTRIBUTE sljit_s32 sljit_set_cpu_profile(const struct sljit_cpu_profile *profile);
+
 /* If type is between SLJIT_ORDERED_EQUAL and SLJIT_ORDERED_LESS_EQUAL,
    sljit_cmp_info returns with:
      zero - if the cpu supports the floating point comparison type
@@ -1944,6 +2082,12 @@ SLJIT_API_FUNC_ATTRIBUTE sljit_s32 sljit_emit_fmem_update(struct sljit_compiler
 #define SLJIT_SIMD_REG_256		(5 << 12)
 /* Move data to/from a 512 bit (64 byte) long SIMD register */
 #define SLJIT_SIMD_REG_512		(6 << 12)
+/* Move data to/from a SIMD register which size is only known at
+   runtime (vector length agnostic code). Only sljit_emit_simd_mov,
+   sljit_emit_simd_replicate, sljit_emit_simd_op2, sljit_emit_simd_while
+   and sljit_emit_simd_lane_count accept this size. Memory accesses are
+   limited to the lanes enabled by the last sljit_emit_simd_while call. */
+#define SLJIT_SIMD_REG_SCALABLE		(7 << 12)
 /* Element size is 8 bit long (this is the default), usually cannot be combined with SLJIT_SIMD_FLOAT */
 #define SLJIT_SIMD_ELEM_8		(0 << 18)
 /* Element size is 16 bit long, usually cannot be combined with SLJIT_SIMD_FLOAT */
@@ -2135,8 +2279,21 @@ SLJIT_API_FUNC_ATTRIBUTE sljit_s32 sljit_emit_simd_sign(struct sljit_compiler *c
 #define SLJIT_SIMD_OP2_OR		0x000002
 /* Binary 'xor' operation */
 #define SLJIT_SIMD_OP2_XOR		0x000003
-/* Shuffle bytes of src1 using the indicies in src2 */
+/* Shuffle bytes of src1 using the indices in src2 */
 #define SLJIT_SIMD_OP2_SHUFFLE		0x000004
+/* Interleave the elements of the lower halves of src1 and src2:
+   the result is src1[0], src2[0], src1[1], src2[1], ... */
+#define SLJIT_SIMD_OP2_ZIP_LO		0x000005
+/* Interleave the elements of the upper halves of src1 and src2 */
+#define SLJIT_SIMD_OP2_ZIP_HI		0x000006
+/* Concatenate the even numbered elements of src1 and src2:
+   the result is src1[0], src1[2], ..., src2[0], src2[2], ... */
+#define SLJIT_SIMD_OP2_UNZIP_LO		0x000007
+/* Concatenate the odd numbered elements of src1 and src2 */
+#define SLJIT_SIMD_OP2_UNZIP_HI		0x000008
+/* Set all bits of the elements where src1 and src2 are equal,
+   and clear all bits of the other elements (integer only) */
+#define SLJIT_SIMD_OP2_CMP_EQ		0x000009
 
 /* Perform simd operations using simd registers.
 
@@ -2156,6 +2313,149 @@ SLJIT_API_FUNC_ATTRIBUTE sljit_s32 sljit_emit_simd_sign(struct sljit_compiler *c
 SLJIT_API_FUNC_ATTRIBUTE sljit_s32 sljit_emit_simd_op2(struct sljit_compiler *compiler, sljit_s32 type,
 	sljit_s32 dst_freg, sljit_s32 src1_freg, sljit_s32 src2, sljit_sw src2w);
 
+/* The following options are used by sljit_emit_simd_shift(). */
+
+/* Shift left */
+#define SLJIT_SIMD_SHIFT_SHL		0x000001
+/* Logical shift right */
+#define SLJIT_SIMD_SHIFT_LSHR		0x000002
+/* Arithmetic shift right */
+#define SLJIT_SIMD_SHIFT_ASHR		0x000003
+
+/* Shifts the integer elements of a simd register. The shift
+   amount is either an immediate value, which is used for all
+   elements, or a simd register, which contains a separate
+   shift amount for each element. The result is undefined
+   when the shift amount is greater or equal than the bit
+   size of the elements.
+
+   If the operation is not supported, it returns with
+   SLJIT_ERR_UNSUPPORTED. If SLJIT_SIMD_TEST is passed,
+   it does not emit any instructions.
+
+   type must be a combination of SLJIT_SIMD_* and
+     SLJIT_SIMD_SHIFT_* options except SLJIT_SIMD_LOAD,
+     SLJIT_SIMD_STORE and SLJIT_SIMD_FLOAT
+   dst_freg is the destination register of the operation
+   src1_freg is the register which is shifted
+   src2 is an immediate (SLJIT_IMM) or a simd register
+
+   Flags: - (does not modify flags) */
+
+SLJIT_API_FUNC_ATTRIBUTE sljit_s32 sljit_emit_simd_shift(struct sljit_compiler *compiler, sljit_s32 type,
+	sljit_s32 dst_freg, sljit_s32 src1_freg, sljit_s32 src2, sljit_sw src2w);
+
+/* The following options are used by sljit_emit_simd_narrow(). */
+
+/* The elements are signed values, which are
+   saturated to the range of the narrow signed type */
+#define SLJIT_SIMD_NARROW_SIGNED_SAT	0x000002
+/* The elements are signed values, which are
+   saturated to the range of the narrow unsigned type */
+#define SLJIT_SIMD_NARROW_UNSIGNED_SAT	0x000004
+
+/* Narrows the integer elements of two simd registers
+   to half of their size, and stores them in a single
+   simd register. The elements of src1_freg are stored
+   in the lower half, and the elements of src2_freg are
+   stored in the upper half of dst_freg. The operation
+   is the reverse of sljit_emit_simd_extend(). Without
+   saturation, the upper bits of the elements are dropped.
+
+   If the operation is not supported, it returns with
+   SLJIT_ERR_UNSUPPORTED. If SLJIT_SIMD_TEST is passed,
+   it does not emit any instructions.
+
+   type must be a combination of SLJIT_SIMD_* and
+     SLJIT_SIMD_NARROW_* options except SLJIT_SIMD_LOAD,
+     SLJIT_SIMD_STORE and SLJIT_SIMD_FLOAT, where the
+     element size is the size of the source elements
+   dst_freg is the destination register of the operation
+   src1_freg is the source of the lower half of the result
+   src2_freg is the source of the upper half of the result
+
+   Flags: - (does not modify flags) */
+
+SLJIT_API_FUNC_ATTRIBUTE sljit_s32 sljit_emit_simd_narrow(struct sljit_compiler *compiler, sljit_s32 type,
+	sljit_s32 dst_freg, sljit_s32 src1_freg, sljit_s32 src2_freg);
+
+/* The following options are used by sljit_emit_simd_gather(). */
+
+/* Index values are multiplied by 1 (this is the default) */
+#define SLJIT_SIMD_SCALE_1		(0 << 24)
+/* Index values are multiplied by 2 */
+#define SLJIT_SIMD_SCALE_2		(1 << 24)
+/* Index values are multiplied by 4 */
+#define SLJIT_SIMD_SCALE_4		(2 << 24)
+/* Index values are multiplied by 8 */
+#define SLJIT_SIMD_SCALE_8		(3 << 24)
+
+/* Loads (gather) or stores (scatter) each lane of a simd register
+   from / to a separate memory location. The address of lane i is
+   base + memw + (index_freg[i] << scale), where the index lanes
+   have the same size as the data lanes. 32 bit indices are sign
+   extended. Strided accesses can be expressed by an index register
+   containing an arithmetic sequence. The scatter operation stores
+   the lanes in increasing order, so the highest lane is stored
+   last when several lanes are stored to the same location.
+
+   If the operation is not supported, it returns with
+   SLJIT_ERR_UNSUPPORTED. If SLJIT_SIMD_TEST is passed,
+   it does not emit any instructions.
+
+   type must be a combination of SLJIT_SIMD_* and SLJIT_SIMD_SCALE_*
+     options, and the element size must be 32 or 64 bit
+   freg is the destination (gather) or source (scatter)
+     simd register of the operation
+   index_freg is the simd register which contains the indices
+   mem must be SLJIT_MEM1(base) or SLJIT_MEM0() memory operand,
+     where base cannot be SLJIT_SP
+
+   Flags: - (may destroy flags) */
+
+SLJIT_API_FUNC_ATTRIBUTE sljit_s32 sljit_emit_simd_gather(struct sljit_compiler *compiler, sljit_s32 type,
+	sljit_s32 freg, sljit_s32 index_freg,
+	sljit_s32 mem, sljit_sw memw);
+
+/* Enables the lanes of the scalable simd registers, which are used
+   by the memory accesses of the following scalable simd operations.
+   A lane with index i is enabled if src1 + i < src2, where the values
+   are compared as unsigned machine words. Typically src1 is the index
+   of the current element, and src2 is the number of elements, so the
+   last iteration of a loop automatically processes the remaining items.
+
+   If the operation is not supported, it returns with
+   SLJIT_ERR_UNSUPPORTED. If SLJIT_SIMD_TEST is passed,
+   it does not emit any instructions.
+
+   type must be a combination of SLJIT_SIMD_REG_SCALABLE,
+     SLJIT_SIMD_ELEM_* and SLJIT_SIMD_TEST options
+   src1 and src2 are the source operands of the operation
+
+   Flags: Z is set if no lanes are enabled
+     (the loop has no more elements to process) */
+
+SLJIT_API_FUNC_ATTRIBUTE sljit_s32 sljit_emit_simd_while(struct sljit_compiler *compiler, sljit_s32 type,
+	sljit_s32 src1, sljit_sw src1w,
+	sljit_s32 src2, sljit_sw src2w);
+
+/* Stores the number of lanes of a scalable simd register
+   into dst. The lane size is specified by SLJIT_SIMD_ELEM_*.
+   This value is the increment of a vector length agnostic loop.
+
+   If the operation is not supported, it returns with
+   SLJIT_ERR_UNSUPPORTED. If SLJIT_SIMD_TEST is passed,
+   it does not emit any instructions.
+
+   type must be a combination of SLJIT_SIMD_REG_SCALABLE,
+     SLJIT_SIMD_ELEM_* and SLJIT_SIMD_TEST options
+   dst is the destination operand
+
+   Flags: - (does not modify flags) */
+
+SLJIT_API_FUNC_ATTRIBUTE sljit_s32 sljit_emit_simd_lane_count(struct sljit_compiler *compiler, sljit_s32 type,
+	sljit_s32 dst, sljit_sw dstw);
+
 /* The sljit_emit_atomic_load and sljit_emit_atomic_store operation pair
    can perform an atomic read-modify-write operation. First, an unsigned
    value must be loaded from memory using sljit_emit_atomic_load. Then,
@@ -2347,6 +2647,63 @@ SLJIT_API_FUNC_ATTRIBUTE sljit_s32 sljit_jump_is_mov_addr(struct sljit_jump *jum
 /* When debugging is enabled, the serialized buffer contains
 debugging information unless this option is specified. */
 #define SLJIT_SERIALIZE_IGNORE_DEBUG		0x1
+/* The instruction fragments are stored without padding, and the
+label, jump and const records are stored as variable length
+integers. The buffer is usually about half of the default
+encoding, while its deserialization is slightly slower. */
+#define SLJIT_SERIALIZE_COMPACT			0x2
+/* Same as SLJIT_SERIALIZE_COMPACT, and the data is also compressed
+by a fast LZ77 style method (unless the compression does not
+reduce its size). */
+#define SLJIT_SERIALIZE_COMPRESS		0x4
+
+/* Header of the buffers created by sljit_serialize_compiler(). With
+SLJIT_SERIALIZE_COMPACT and SLJIT_SERIALIZE_COMPRESS, the header is
+followed by the byte size of the (uncompressed) payload stored in a
+word, and the payload. The layout depends on the target, and the
+buffers are only usable on the same target. */
+struct sljit_serialized_compiler {
+	sljit_u32 signature;
+	sljit_u16 version;
+	sljit_u16 cpu_type;
+
+	sljit_uw buf_segment_count;
+	sljit_uw label_count;
+	sljit_uw jump_count;
+	sljit_uw const_count;
+
+	sljit_s32 options;
+	sljit_s32 scratches;
+	sljit_s32 saveds;
+	sljit_s32 fscratches;
+	sljit_s32 fsaveds;
+	sljit_s32 local_size;
+	sljit_uw size;
+
+#if (defined SLJIT_HAS_STATUS_FLAGS_STATE && SLJIT_HAS_STATUS_FLAGS_STATE)
+	sljit_s32 status_flags_state;
+#endif /* SLJIT_HAS_STATUS_FLAGS_STATE */
+
+#if (defined SLJIT_CONFIG_X86_32 && SLJIT_CONFIG_X86_32)
+	sljit_s32 args_size;
+#endif /* SLJIT_CONFIG_X86_32 */
+
+#if ((defined SLJIT_CONFIG_ARM_32 && SLJIT_CONFIG_ARM_32) && (defined __SOFTFP__)) \
+		|| (defined SLJIT_CONFIG_MIPS_32 && SLJIT_CONFIG_MIPS_32)
+	sljit_uw args_size;
+#endif /* (SLJIT_CONFIG_ARM_32 && __SOFTFP__) || SLJIT_CONFIG_MIPS_32 */
+
+#if (defined SLJIT_CONFIG_ARM_V6 && SLJIT_CONFIG_ARM_V6)
+	sljit_uw cpool_diff;
+	sljit_uw cpool_fill;
+	sljit_uw patches;
+#endif /* SLJIT_CONFIG_ARM_V6 */
+
+#if (defined SLJIT_CONFIG_MIPS && SLJIT_CONFIG_MIPS)
+	sljit_s32 delay_slot;
+#endif /* SLJIT_CONFIG_MIPS */
+
+};
 
 /* Serialize the internal structure of the compiler into a buffer.
 If the serialization is successful, the returned value is a newly
@@ -2373,6 +2730,20 @@ Notes:
 SLJIT_API_FUNC_ATTRIBUTE sljit_uw* sljit_serialize_compiler(struct sljit_compiler *compiler,
 	sljit_s32 options, sljit_uw *size);
 
+/* Option bits for sljit_deserialize_compiler. */
+
+/* The instruction fragments of the compiler reference the buffer
+instead of copying it, except the last fragment, which is copied
+since the compiler extends it. The labels, jumps and consts are
+always copied, since their serialized form is different. Hence
+the option only helps when the instructions take most of the
+buffer (large functions with several fragments). The buffer must
+not be modified or freed until the compiler is freed, but it can be
+read-only (e.g. a file mapped into memory). This option is ignored
+when the buffer is created with SLJIT_SERIALIZE_COMPACT or
+SLJIT_SERIALIZE_COMPRESS. */
+#define SLJIT_DESERIALIZE_ZERO_COPY		0x1
+
 /* Construct a new compiler instance from a buffer produced by
 sljit_serialize_compiler(). If the operation is successful, the new
 compiler instance is returned. Otherwise the returned value is NULL.
@@ -2380,7 +2751,7 @@ compiler instance is returned. Otherwise the returned value is NULL.
   buffer points to a word aligned memory data which was
     created by sljit_serialize_compiler()
   size is the byte size of the buffer
-  options must be 0
+  options must be the combination of SLJIT_DESERIALIZE_* option bits
   allocator_data specify an allocator specific data, see
                  sljit_create_compiler() for further details
 
@@ -2396,10 +2767,207 @@ Notes:
     Even sljit_serialize_compiler() can be called again.
   - When debugging is enabled, a buffers without debug
     information cannot be deserialized.
+  - Buffers created with any SLJIT_SERIALIZE_* options can be
+    deserialized, the encoding is stored in the buffer.
 */
 SLJIT_API_FUNC_ATTRIBUTE struct sljit_compiler *sljit_deserialize_compiler(sljit_uw* buffer, sljit_uw size,
 	sljit_s32 options, void *allocator_data);
 
+/* Store the code generated by sljit_generate_code() into a buffer, which
+can be loaded later without running the code generator again, even by
+another process. Besides the machine code, the buffer contains the label
+and const offsets, and relocation records for those instructions whose
+encoding depends on the address of the code or on an absolute address
+(e.g. jumps to labels, mov_addr instructions, calls and jumps to absolute
+addresses, and references to the static data of sljit). If the operation
+is successful, the returned value is a newly allocated buffer which is
+allocated by the memory allocator assigned to the compiler. Otherwise
+the returned value is NULL.
+
+  compiler must be the compiler instance which generated the code
+  code is the value returned by sljit_generate_code()
+  targets is the list of absolute addresses used as jump or call
+    targets by the code, e.g. the addresses passed to sljit_set_target(),
+    or to sljit_emit_ijump() / sljit_emit_icall() as SLJIT_IMM.
+    The image stores the index of the target, not its address
+  target_count is the number of items in the targets list
+  options must be 0
+  size is an output argument, which is set to the byte size of
+    the result buffer if the operation is successful
+
+Notes:
+  - The compiler must not be freed before this function is called.
+  - The returned buffer must be freed later by the caller, see
+    sljit_serialize_compiler() for further details.
+  - The operation fails, when an absolute jump or call target
+    is not present in the targets list.
+  - Other absolute addresses are not relocated: immediate values
+    and SLJIT_MEM0() addresses are stored as they are.
+  - Code images are only supported on x86 (32 and 64 bit) and
+    ARM-64 at the moment, other targets always return with NULL.
+*/
+SLJIT_API_FUNC_ATTRIBUTE sljit_uw* sljit_create_code_image(struct sljit_compiler *compiler,
+	void *code, sljit_uw *targets, sljit_uw target_count, sljit_s32 options, sljit_uw *size);
+
+/* Copy the code stored in a buffer produced by sljit_create_code_image()
+into executable memory, and relocate it in one pass. If the operation
+is successful, the returned value is the same as the value returned by
+sljit_generate_code(), and it must be freed by sljit_free_code().
+Otherwise the returned value is NULL.
+
+  buffer points to a word aligned memory data which was
+    created by sljit_create_code_image()
+  size is the byte size of the buffer
+  targets is the list of absolute jump and call targets in the same
+    order as it was passed to sljit_create_code_image(). The addresses
+    may be different, e.g. when the image is loaded by another process
+  target_count is the number of items in the targets list
+  options is the combination of SLJIT_GENERATE_CODE_* bits
+  exec_allocator_data is passed to SLJIT_MALLOC_EXEC and
+    SLJIT_MALLOC_FREE functions, see sljit_generate_code()
+  executable_offset is an output argument, which is set to the
+    executable offset of the code if it is not NULL
+
+Notes:
+  - The code image can only be loaded by the same build of sljit.
+    Only the structure of the buffer is verified.
+  - The operation fails, when the cpu lacks a feature which was
+    available when the code was generated, since the generated
+    instructions depend on the detected cpu features.
+  - The operation fails, when the new address of the code or a new
+    target cannot be encoded by a relocated instruction (e.g. a 32
+    bit relative jump becomes too far from its absolute target address).
+*/
+SLJIT_API_FUNC_ATTRIBUTE void* sljit_load_code_image(sljit_uw *buffer, sljit_uw size,
+	sljit_uw *targets, sljit_uw target_count,
+	sljit_s32 options, void *exec_allocator_data, sljit_sw *executable_offset);
+
+/* Provides the address of the labels and consts of a loaded code image. The
+   index is the position of the label or const in the order of their creation,
+   and code is the value returned by sljit_load_code_image(). The returned values
+   have the same meaning as sljit_get_label_addr() and sljit_get_const_addr(). */
+SLJIT_API_FUNC_ATTRIBUTE sljit_uw sljit_get_code_image_label_addr(sljit_uw *buffer, sljit_uw index, void *code);
+SLJIT_API_FUNC_ATTRIBUTE sljit_uw sljit_get_code_image_const_addr(sljit_uw *buffer, sljit_uw index,
+	void *code, sljit_sw executable_offset);
+
+/* --------------------------------------------------------------------- */
+/*  Code cache                                                           */
+/* --------------------------------------------------------------------- */
+
+/* A code cache shares the executable code of identical functions. The
+   cache is not thread safe, its users must serialize the accesses. */
+struct sljit_code_cache;
+
+struct sljit_code_cache_stats {
+	/* Number of functions stored in the executable memory. */
+	sljit_uw function_count;
+	/* Number of references to these functions (the number of
+	   sljit_generate_cached_code() calls which are not freed yet). */
+	sljit_uw reference_count;
+	/* Total byte size of the stored functions. */
+	sljit_uw code_size;
+	/* Executable memory which would be needed without sharing
+	   minus code_size, i.e. the size of the deduplicated code. */
+	sljit_uw saved_size;
+	/* Byte size of the keys and other data used by the cache. */
+	sljit_uw metadata_size;
+};
+
+/* Create an empty code cache. Returns NULL if there is not enough memory.
+
+  allocator_data is passed to SLJIT_MALLOC and SLJIT_FREE
+  exec_allocator_data is passed to SLJIT_MALLOC_EXEC and
+    SLJIT_FREE_EXEC, see sljit_generate_code()
+*/
+SLJIT_API_FUNC_ATTRIBUTE struct sljit_code_cache* sljit_create_code_cache(void *allocator_data, void *exec_allocator_data);
+
+/* Free the cache and all code stored in it, even if it is still referenced. */
+SLJIT_API_FUNC_ATTRIBUTE void sljit_free_code_cache(struct sljit_code_cache *cache);
+
+/* Same as sljit_generate_code(), except that the code is shared with
+the previously generated functions of the cache when the instruction
+stream, the labels, the jumps and the options are all the same. The
+cache is keyed by the compact serialized form of the compiler (see
+sljit_serialize_compiler), so the functions are compared exactly,
+not only by their hash values. When a function is found, code
+generation is skipped, and only the label addresses are updated.
+
+  options is the combination of SLJIT_GENERATE_CODE_* bits,
+    except SLJIT_GENERATE_CODE_BUFFER, which is not supported
+
+Notes:
+  - Functions with consts or rewritable jumps are never shared,
+    since their code can be modified by sljit_set_const() or
+    sljit_set_jump_addr().
+  - The returned code is freed by sljit_free_code(), which decreases
+    its reference count, so each call must be paired with exactly one
+    sljit_free_code() call. Its exec_allocator_data argument is ignored,
+    the cache uses its own.
+*/
+SLJIT_API_FUNC_ATTRIBUTE void* sljit_generate_cached_code(struct sljit_code_cache *cache,
+	struct sljit_compiler *compiler, sljit_s32 options);
+
+/* Fill stats with the current state of the cache. */
+SLJIT_API_FUNC_ATTRIBUTE void sljit_get_code_cache_stats(struct sljit_code_cache *cache,
+	struct sljit_code_cache_stats *stats);
+
+/* --------------------------------------------------------------------- */
+/*  Code pools                                                           */
+/* --------------------------------------------------------------------- */
+
+/* A code pool generates the code of many independent compilers into one
+   executable memory block, and the code generation can run on multiple
+   threads. Since the maximum code size of a compiler is known before
+   the code generation, every compiler has a preassigned place in the
+   block, and the threads do not need to synchronize except for taking
+   the next compiler from the pool. The threads are created by the caller:
+
+     pool = sljit_create_code_pool(compilers, count, 0, NULL, NULL);
+     each worker thread: sljit_generate_code_pool(pool);
+     wait for the worker threads
+     sljit_publish_code_pool(pool);
+     code of compilers[i]: sljit_get_code_pool_code(pool, i)
+
+   Code pools are only supported on x86 (32 and 64 bit), ARM-64 and
+   ARM Thumb-2 at the moment, other targets always return with NULL. */
+struct sljit_code_pool;
+
+/* Create a code pool for the compilers, and allocate the executable memory
+block for their code. The compilers must not be modified until the code is
+generated, and they must be freed by the caller after the code generation.
+Returns NULL if there is not enough memory.
+
+  compilers is an array of compilers, it is referenced by the pool
+  count is the number of compilers, it must be greater than 0
+  options is the combination of SLJIT_GENERATE_CODE_* bits, except
+    SLJIT_GENERATE_CODE_BUFFER, which is not supported
+  allocator_data is passed to SLJIT_MALLOC and SLJIT_FREE
+  exec_allocator_data is passed to SLJIT_MALLOC_EXEC and
+    SLJIT_FREE_EXEC, see sljit_generate_code()
+*/
+SLJIT_API_FUNC_ATTRIBUTE struct sljit_code_pool* sljit_create_code_pool(struct sljit_compiler **compilers,
+	sljit_uw count, sljit_s32 options, void *allocator_data, void *exec_allocator_data);
+
+/* Generate the code of the compilers which are not taken by other threads.
+   This function can be called from any number of threads at the same time,
+   and it enables the write access to the block for the current thread when
+   the executable allocator requires it (e.g. MAP_JIT on Apple ARM-64).
+   Returns with the number of compilers processed by this call. */
+SLJIT_API_FUNC_ATTRIBUTE sljit_uw sljit_generate_code_pool(struct sljit_code_pool *pool);
+
+/* Make the whole block executable with one permission change after all
+   calls of sljit_generate_code_pool() are returned. Returns with
+   SLJIT_SUCCESS, or the error code of the first failed compiler. */
+SLJIT_API_FUNC_ATTRIBUTE sljit_s32 sljit_publish_code_pool(struct sljit_code_pool *pool);
+
+/* Returns with the code of the compiler at index, which has the same
+   meaning as the value returned by sljit_generate_code(), or NULL if
+   the code generation is failed. It must not be freed by sljit_free_code(). */
+SLJIT_API_FUNC_ATTRIBUTE void* sljit_get_code_pool_code(struct sljit_code_pool *pool, sljit_uw index);
+
+/* Free the pool and the code of all compilers. */
+SLJIT_API_FUNC_ATTRIBUTE void sljit_free_code_pool(struct sljit_code_pool *pool);
+
 /* --------------------------------------------------------------------- */
 /*  Miscellaneous utility functions                                      */
 /* --------------------------------------------------------------------- */
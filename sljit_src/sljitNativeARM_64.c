@@ -76,6 +76,7 @@ static const sljit_u8 freg_map[SLJIT_NUMBER_OF_FLOAT_REGISTERS + 3] = {
 #define AND		0x8a000000
 #define ANDI		0x92000000
 #define AND_v		0x0e201c00
+#define AND_z		0x04203000
 #define ASRV		0x9ac02800
 #define B		0x14000000
 #define B_CC		0x54000000
@@ -89,12 +90,18 @@ static const sljit_u8 freg_map[SLJIT_NUMBER_OF_FLOAT_REGISTERS + 3] = {
 #define CBZ		0xb4000000
 #define CCMPI		0xfa400800
 #define CLZ		0xdac01000
+#define CMEQ_v		0x2e208c00
+#define CNT_z		0x0420e3e0
 #define CSEL		0x9a800000
 #define CSINC		0x9a800400
 #define DUP_e		0x0e000400
 #define DUP_g		0x0e000c00
+#define DUP_z		0x05202000
+#define DUP_zg		0x05203800
+#define DUP_zi		0x2538c000
 #define EOR		0xca000000
 #define EOR_v		0x2e201c00
+#define EOR_z		0x04a03000
 #define EORI		0xd2000000
 #define EXTR		0x93c00000
 #define FABS		0x1e60c000
@@ -116,6 +123,8 @@ static const sljit_u8 freg_map[SLJIT_NUMBER_OF_FLOAT_REGISTERS + 3] = {
 #define LD1		0x0c407000
 #define LD1_s		0x0d400000
 #define LD1R		0x0d40c000
+#define LD1_z		0xa4004000
+#define LD1_zi		0xa400a000
 #define LDRI		0xf9400000
 #define LDRI_F64	0xfd400000
 #define LDRI_POST	0xf8400400
@@ -133,10 +142,12 @@ static const sljit_u8 freg_map[SLJIT_NUMBER_OF_FLOAT_REGISTERS + 3] = {
 #define MOVK		0xf2800000
 #define MOVN		0x92800000
 #define MOVZ		0xd2800000
+#define NEG_v		0x2e20b800
 #define NOP		0xd503201f
 #define ORN		0xaa200000
 #define ORR		0xaa000000
 #define ORR_v		0x0ea01c00
+#define ORR_z		0x04603000
 #define ORRI		0xb2000000
 #define RBIT		0xdac00000
 #define RET		0xd65f0000
@@ -147,12 +158,19 @@ static const sljit_u8 freg_map[SLJIT_NUMBER_OF_FLOAT_REGISTERS + 3] = {
 #define SBFM		0x93400000
 #define SCVTF		0x9e620000
 #define SDIV		0x9ac00c00
+#define SHL_v		0x0f005400
 #define SMADDL		0x9b200000
 #define SMOV		0x0e002c00
 #define SMULH		0x9b403c00
+#define SQXTN		0x0e214800
+#define SQXTUN		0x2e212800
 #define SSHLL		0x0f00a400
+#define SSHL_v		0x0e204400
+#define SSHR		0x0f000400
 #define ST1		0x0c007000
 #define ST1_s		0x0d000000
+#define ST1_z		0xe4004000
+#define ST1_zi		0xe400e000
 #define STP		0xa9000000
 #define STP_F64		0x6d000000
 #define STP_PRE		0xa9800000
@@ -172,15 +190,26 @@ static const sljit_u8 freg_map[SLJIT_NUMBER_OF_FLOAT_REGISTERS + 3] = {
 #define SUBS		0xeb000000
 #define TBZ		0x36000000
 #define TBL_v		0x0e000000
+#define TBL_z		0x05203000
 #define UBFM		0xd3400000
 #define UCVTF		0x9e630000
 #define UDIV		0x9ac00800
 #define UMOV		0x0e003c00
 #define UMULH		0x9bc03c00
 #define USHLL		0x2f00a400
+#define USHL_v		0x2e204400
 #define USHR		0x2f000400
 #define USRA		0x2f001400
+#define UZP1		0x0e001800
+#define UZP1_z		0x05206800
+#define UZP2		0x0e005800
+#define UZP2_z		0x05206c00
+#define WHILELO		0x25201c00
 #define XTN		0x0e212800
+#define ZIP1		0x0e003800
+#define ZIP1_z		0x05206000
+#define ZIP2		0x0e007800
+#define ZIP2_z		0x05206400
 
 #define CSET		(CSINC | RM(TMP_ZERO) | RN(TMP_ZERO))
 #define LDR		(STRI | (1 << 22))
@@ -372,6 +401,76 @@ static SLJIT_INLINE void generate_jump_or_mov_addr(struct sljit_jump *jump, slji
 		buf_ptr[3] = MOVK | ((sljit_ins)((sljit_uw)addr >> 48) << 5) | (3 << 21) | dst;
 }
 
+/* Code images (see sljit_create_code_image) can be relocated on this target. */
+#define SLJIT_HAS_CODE_IMAGE 1
+/* The code generator does not select instructions by cpu features, but
+   the code may contain SVE instructions when the extension is available. */
+#define SLJIT_CODE_IMAGE_CPU_FEATURES() ((sljit_uw)is_sve_available())
+
+/* Returns with non-zero, if the encoded value depends on the address of the code. */
+static SLJIT_INLINE sljit_s32 jump_is_position_dependent(sljit_uw flags)
+{
+	/* The adrp instruction computes the address relative to the 4K page of the code. */
+	if (flags & JUMP_ADDR)
+		return (flags & (PATCH_COND | PATCH_B | PATCH_B32)) != 0;
+	return !(flags & (PATCH_COND | PATCH_B));
+}
+
+/* Returns with non-zero, if the instructions updated by
+   relocate_jump() are inside a code of code_size bytes. */
+static SLJIT_INLINE sljit_s32 jump_reloc_is_valid(sljit_uw addr, sljit_uw flags, sljit_uw code_size)
+{
+	sljit_uw size = 2;
+
+	if (flags & (PATCH_COND | PATCH_B))
+		size = 1;
+	else if (flags & PATCH_ABS48)
+		size = 3;
+	else if (flags & PATCH_ABS64)
+		size = 4;
+
+	return (addr & (sizeof(sljit_ins) - 1)) == 0 && addr <= code_size
+		&& (code_size - addr) / sizeof(sljit_ins) >= size;
+}
+
+/* Updates a jump after the code is moved, or its target is changed. Returns
+   with zero, if the new value cannot be encoded by the instructions. */
+static sljit_s32 relocate_jump(struct sljit_jump *jump, sljit_sw executable_offset)
+{
+	sljit_uw flags = jump->flags;
+	sljit_sw addr = (sljit_sw)((flags & JUMP_ADDR) ? jump->u.target : jump->u.label->u.addr);
+	sljit_ins *buf_ptr = (sljit_ins*)jump->addr;
+	sljit_sw diff = addr - (sljit_sw)SLJIT_ADD_EXEC_OFFSET(buf_ptr, executable_offset);
+
+	if (flags & PATCH_COND) {
+		if (diff > 0xfffff || diff < -0x100000)
+			return 0;
+	} else if (flags & PATCH_B) {
+		if (flags & JUMP_MOV_ADDR) {
+			if (diff > 0xfffff || diff < -0x100000)
+				return 0;
+		} else if (diff > 0x7ffffff || diff < -0x8000000)
+			return 0;
+	} else if (flags & PATCH_B32) {
+		diff = addr - ((sljit_sw)SLJIT_ADD_EXEC_OFFSET(buf_ptr, executable_offset) & ~(sljit_sw)0xfff);
+		if (diff > 0xfffff000l || diff < -0x100000000l)
+			return 0;
+	} else if (!(flags & PATCH_ABS64)) {
+		if ((sljit_uw)addr > ((flags & PATCH_ABS48) ? (sljit_uw)0xffffffffffff : (sljit_uw)0xffffffff))
+			return 0;
+	}
+
+	/* The destination register is restored to the form
+	   expected by generate_jump_or_mov_addr(). */
+	if (flags & JUMP_MOV_ADDR)
+		buf_ptr[0] &= 0x1f;
+	else if (!(flags & (PATCH_COND | PATCH_B)))
+		buf_ptr[0] = (buf_ptr[0] & 0x1f) << 5;
+
+	generate_jump_or_mov_addr(jump, executable_offset);
+	return 1;
+}
+
 static void reduce_code_size(struct sljit_compiler *compiler)
 {
 	struct sljit_label *label;
@@ -380,6 +479,9 @@ static void reduce_code_size(struct sljit_compiler *compiler)
 	SLJIT_NEXT_DEFINE_TYPES;
 	sljit_uw total_size;
 	sljit_uw size_reduce = 0;
+#if (defined SLJIT_STATISTICS && SLJIT_STATISTICS)
+	sljit_uw prev_size_reduce;
+#endif /* SLJIT_STATISTICS */
 	sljit_sw diff;
 
 	label = compiler->labels;
@@ -410,6 +512,9 @@ static void reduce_code_size(struct sljit_compiler *compiler)
 		if (next_min_addr != next_jump_addr)
 			continue;
 
+#if (defined SLJIT_STATISTICS && SLJIT_STATISTICS)
+		prev_size_reduce = size_reduce;
+#endif /* SLJIT_STATISTICS */
 		jump->addr -= size_reduce;
 		if (!(jump->flags & JUMP_MOV_ADDR)) {
 			total_size = JUMP_MAX_SIZE;
@@ -454,6 +559,8 @@ static void reduce_code_size(struct sljit_compiler *compiler)
 		}
 
 		jump->flags |= total_size << JUMP_SIZE_SHIFT;
+		SLJIT_STATS_ADD(jump_count, 1);
+		SLJIT_STATS_ADD(shortened_jump_count, size_reduce != prev_size_reduce);
 		jump = jump->next;
 		next_jump_addr = SLJIT_GET_NEXT_ADDRESS(jump);
 	}
@@ -461,6 +568,9 @@ static void reduce_code_size(struct sljit_compiler *compiler)
 	compiler->size -= size_reduce;
 }
 
+/* Upper bound of the size of the generated code (see sljit_create_code_pool). */
+#define SLJIT_MAX_GENERATED_CODE_SIZE(compiler) ((compiler)->size * sizeof(sljit_ins))
+
 SLJIT_API_FUNC_ATTRIBUTE void* sljit_generate_code(struct sljit_compiler *compiler, sljit_s32 options, void *exec_allocator_data)
 {
 	struct sljit_memory_fragment *buf;
@@ -479,11 +589,16 @@ SLJIT_API_FUNC_ATTRIBUTE void* sljit_generate_code(struct sljit_compiler *compil
 
 	CHECK_ERROR_PTR();
 	CHECK_PTR(check_sljit_generate_code(compiler));
+	SLJIT_STATS_PHASE(emit_time);
+	SLJIT_STATS_ADD(size_before_reduce, SLJIT_MAX_GENERATED_CODE_SIZE(compiler));
 
 	reduce_code_size(compiler);
+	SLJIT_STATS_ADD(size_after_reduce, SLJIT_MAX_GENERATED_CODE_SIZE(compiler));
+	SLJIT_STATS_PHASE(reduce_time);
 
 	code = (sljit_ins*)allocate_executable_memory(compiler->size * sizeof(sljit_ins), options, exec_allocator_data, &executable_offset);
 	PTR_FAIL_WITH_EXEC_IF(code);
+	SLJIT_STATS_PHASE(alloc_time);
 
 	reverse_buf(compiler);
 	buf = compiler->buf;
@@ -569,10 +684,37 @@ SLJIT_API_FUNC_ATTRIBUTE void* sljit_generate_code(struct sljit_compiler *compil
 	code_ptr = (sljit_ins *)SLJIT_ADD_EXEC_OFFSET(code_ptr, executable_offset);
 
 	SLJIT_CACHE_FLUSH(code, code_ptr);
-	SLJIT_UPDATE_WX_FLAGS(code, code_ptr, 1);
+	SLJIT_STATS_PHASE(encode_time);
+	if (!(options & SLJIT_GENERATE_CODE_KEEP_WRITABLE)) {
+		SLJIT_UPDATE_WX_FLAGS(code, code_ptr, 1);
+	}
 	return code;
 }
 
+#if (defined __linux__)
+/* The status of the SVE extension is provided by HWCAP on Linux. */
+#include <sys/auxv.h>
+
+#define ARM64_HWCAP_SVE		(1 << 22)
+#endif /* __linux__ */
+
+static sljit_s32 sve_feature = -1;
+
+static sljit_s32 is_sve_available(void)
+{
+	if (SLJIT_UNLIKELY(sve_feature < 0)) {
+#if (defined __linux__)
+		sve_feature = (getauxval(AT_HWCAP) & ARM64_HWCAP_SVE) != 0;
+#elif (defined __ARM_FEATURE_SVE)
+		sve_feature = 1;
+#else /* !__linux__ && !__ARM_FEATURE_SVE */
+		sve_feature = 0;
+#endif /* __linux__ */
+	}
+
+	return sve_feature;
+}
+
 SLJIT_API_FUNC_ATTRIBUTE sljit_s32 sljit_has_cpu_feature(sljit_s32 feature_type)
 {
 	switch (feature_type) {
@@ -585,6 +727,9 @@ SLJIT_API_FUNC_ATTRIBUTE sljit_s32 sljit_has_cpu_feature(sljit_s32 feature_type)
 		return 1;
 #endif
 
+	case SLJIT_HAS_SVE:
+		return is_sve_available();
+
 	case SLJIT_HAS_CLZ:
 	case SLJIT_HAS_CTZ:
 	case SLJIT_HAS_REV:
@@ -601,6 +746,23 @@ SLJIT_API_FUNC_ATTRIBUTE sljit_s32 sljit_has_cpu_feature(sljit_s32 feature_type)
 	}
 }
 
+SLJIT_API_FUNC_ATTRIBUTE sljit_s32 sljit_set_cpu_profile(const struct sljit_cpu_profile *profile)
+{
+	struct sljit_cpu_profile current;
+
+	if (profile != NULL) {
+		/* Only SVE can be disabled. */
+		sljit_get_cpu_profile(&current);
+		if (current.features & ~profile->features & ~(sljit_u32)SLJIT_CPU_SVE)
+			return SLJIT_ERR_UNSUPPORTED;
+	}
+
+	sve_feature = -1;
+	if (profile != NULL && !(profile->features & SLJIT_CPU_SVE))
+		sve_feature = 0;
+	return SLJIT_SUCCESS;
+}
+
 SLJIT_API_FUNC_ATTRIBUTE sljit_s32 sljit_cmp_info(sljit_s32 type)
 {
 	switch (type) {
@@ -2777,6 +2939,51 @@ static sljit_s32 sljit_emit_simd_mem_offset(struct sljit_compiler *compiler, slj
 	return push_inst(compiler, ins | RD(TMP_REG2) | RN(mem) | ((sljit_ins)memw << 10));
 }
 
+/* Value of SLJIT_SIMD_GET_REG_SIZE for SLJIT_SIMD_REG_SCALABLE. */
+#define SVE_REG_SIZE	7
+
+/* Scalable memory accesses are governed by the p0 predicate
+   register, which is set by sljit_emit_simd_while. */
+static sljit_s32 sve_emit_mem(struct sljit_compiler *compiler, sljit_s32 store, sljit_s32 elem_size,
+	sljit_s32 freg, sljit_s32 mem, sljit_sw memw)
+{
+	sljit_ins ins = (sljit_ins)(elem_size * 5) << 21;
+
+	if ((mem & OFFS_REG_MASK) && (memw & 0x3) == elem_size)
+		return push_inst(compiler, (store ? ST1_z : LD1_z) | ins | RN(mem & REG_MASK) | RM(OFFS_REG(mem)) | VT(freg));
+
+	FAIL_IF(sljit_emit_simd_mem_offset(compiler, &mem, memw));
+	return push_inst(compiler, (store ? ST1_zi : LD1_zi) | ins | RN(mem) | VT(freg));
+}
+
+static sljit_s32 sve_emit_simd_mov(struct sljit_compiler *compiler, sljit_s32 type,
+	sljit_s32 freg,
+	sljit_s32 srcdst, sljit_sw srcdstw)
+{
+	sljit_s32 elem_size = SLJIT_SIMD_GET_ELEM_SIZE(type);
+
+	if (!is_sve_available())
+		return SLJIT_ERR_UNSUPPORTED;
+
+	if ((type & SLJIT_SIMD_FLOAT) && (elem_size < 2 || elem_size > 3))
+		return SLJIT_ERR_UNSUPPORTED;
+
+	if (type & SLJIT_SIMD_TEST)
+		return SLJIT_SUCCESS;
+
+	if (!(srcdst & SLJIT_MEM)) {
+		if (type & SLJIT_SIMD_STORE)
+			return push_inst(compiler, ORR_z | VD(srcdst) | VN(freg) | VM(freg));
+
+		return push_inst(compiler, ORR_z | VD(freg) | VN(srcdst) | VM(srcdst));
+	}
+
+	if (elem_size > 3)
+		elem_size = 3;
+
+	return sve_emit_mem(compiler, type & SLJIT_SIMD_STORE, elem_size, freg, srcdst, srcdstw);
+}
+
 SLJIT_API_FUNC_ATTRIBUTE sljit_s32 sljit_emit_simd_mov(struct sljit_compiler *compiler, sljit_s32 type,
 	sljit_s32 freg,
 	sljit_s32 srcdst, sljit_sw srcdstw)
@@ -2790,6 +2997,9 @@ SLJIT_API_FUNC_ATTRIBUTE sljit_s32 sljit_emit_simd_mov(struct sljit_compiler *co
 
 	ADJUST_LOCAL_OFFSET(srcdst, srcdstw);
 
+	if (reg_size == SVE_REG_SIZE)
+		return sve_emit_simd_mov(compiler, type, freg, srcdst, srcdstw);
+
 	if (reg_size != 3 && reg_size != 4)
 		return SLJIT_ERR_UNSUPPORTED;
 
@@ -2925,6 +3135,62 @@ static sljit_ins simd_get_imm(sljit_s32 elem_size, sljit_uw value)
 	return (((sljit_ins)value & 0x1f) << 5) | (((sljit_ins)value & 0xe0) << 11) | result;
 }
 
+static sljit_ins sve_get_imm(sljit_s32 elem_size, sljit_uw value)
+{
+	sljit_uw mask = (elem_size < 3) ? (((sljit_uw)1 << (8 << elem_size)) - 1) : ~(sljit_uw)0;
+	sljit_uw imm;
+
+	value &= mask;
+	imm = (sljit_uw)(sljit_sw)(sljit_s8)value;
+
+	if ((imm & mask) == value)
+		return ((sljit_ins)value & 0xff) << 5;
+
+	if (elem_size == 0 || (value & 0xff) != 0)
+		return ~(sljit_ins)0;
+
+	imm = (sljit_uw)(sljit_sw)(sljit_s8)(value >> 8) << 8;
+
+	if ((imm & mask) == value)
+		return (1 << 13) | (((sljit_ins)(value >> 8) & 0xff) << 5);
+
+	return ~(sljit_ins)0;
+}
+
+static sljit_s32 sve_emit_simd_replicate(struct sljit_compiler *compiler, sljit_s32 type,
+	sljit_s32 freg,
+	sljit_s32 src, sljit_sw srcw)
+{
+	sljit_s32 elem_size = SLJIT_SIMD_GET_ELEM_SIZE(type);
+	sljit_ins size = (sljit_ins)elem_size << 22;
+	sljit_ins imm;
+
+	if (!is_sve_available() || elem_size > 3)
+		return SLJIT_ERR_UNSUPPORTED;
+
+	if ((type & SLJIT_SIMD_FLOAT) && elem_size < 2)
+		return SLJIT_ERR_UNSUPPORTED;
+
+	if (type & SLJIT_SIMD_TEST)
+		return SLJIT_SUCCESS;
+
+	if (src & SLJIT_MEM) {
+		FAIL_IF(emit_op_mem(compiler, elem_size, TMP_REG2, src, srcw, TMP_REG2));
+		src = TMP_REG2;
+	} else if (src == SLJIT_IMM) {
+		imm = sve_get_imm(elem_size, (sljit_uw)srcw);
+
+		if (imm != ~(sljit_ins)0)
+			return push_inst(compiler, DUP_zi | size | imm | VD(freg));
+
+		FAIL_IF(load_immediate(compiler, TMP_REG2, srcw));
+		src = TMP_REG2;
+	} else if (type & SLJIT_SIMD_FLOAT)
+		return push_inst(compiler, DUP_z | ((sljit_ins)1 << (16 + elem_size)) | VD(freg) | VN(src));
+
+	return push_inst(compiler, DUP_zg | size | VD(freg) | RN(src));
+}
+
 SLJIT_API_FUNC_ATTRIBUTE sljit_s32 sljit_emit_simd_replicate(struct sljit_compiler *compiler, sljit_s32 type,
 	sljit_s32 freg,
 	sljit_s32 src, sljit_sw srcw)
@@ -2938,6 +3204,9 @@ SLJIT_API_FUNC_ATTRIBUTE sljit_s32 sljit_emit_simd_replicate(struct sljit_compil
 
 	ADJUST_LOCAL_OFFSET(src, srcw);
 
+	if (reg_size == SVE_REG_SIZE)
+		return sve_emit_simd_replicate(compiler, type, freg, src, srcw);
+
 	if (reg_size != 3 && reg_size != 4)
 		return SLJIT_ERR_UNSUPPORTED;
 
@@ -3226,6 +3495,66 @@ SLJIT_API_FUNC_ATTRIBUTE sljit_s32 sljit_emit_simd_sign(struct sljit_compiler *c
 	return SLJIT_SUCCESS;
 }
 
+static sljit_s32 sve_emit_simd_op2(struct sljit_compiler *compiler, sljit_s32 type,
+	sljit_s32 dst_freg, sljit_s32 src1_freg, sljit_s32 src2, sljit_sw src2w)
+{
+	sljit_s32 elem_size = SLJIT_SIMD_GET_ELEM_SIZE(type);
+	sljit_ins ins = 0;
+
+	if (!is_sve_available())
+		return SLJIT_ERR_UNSUPPORTED;
+
+	if ((type & SLJIT_SIMD_FLOAT) && (elem_size < 2 || elem_size > 3))
+		return SLJIT_ERR_UNSUPPORTED;
+
+	if (SLJIT_SIMD_GET_OPCODE(type) >= SLJIT_SIMD_OP2_ZIP_LO && elem_size > 3)
+		return SLJIT_ERR_UNSUPPORTED;
+
+	/* The SVE compare instructions produce predicates. */
+	if (SLJIT_SIMD_GET_OPCODE(type) == SLJIT_SIMD_OP2_CMP_EQ)
+		return SLJIT_ERR_UNSUPPORTED;
+
+	if (type & SLJIT_SIMD_TEST)
+		return SLJIT_SUCCESS;
+
+	switch (SLJIT_SIMD_GET_OPCODE(type)) {
+	case SLJIT_SIMD_OP2_AND:
+		ins = AND_z;
+		break;
+	case SLJIT_SIMD_OP2_OR:
+		ins = ORR_z;
+		break;
+	case SLJIT_SIMD_OP2_XOR:
+		ins = EOR_z;
+		break;
+	case SLJIT_SIMD_OP2_SHUFFLE:
+		ins = TBL_z;
+		break;
+	case SLJIT_SIMD_OP2_ZIP_LO:
+		ins = ZIP1_z | ((sljit_ins)elem_size << 22);
+		break;
+	case SLJIT_SIMD_OP2_ZIP_HI:
+		ins = ZIP2_z | ((sljit_ins)elem_size << 22);
+		break;
+	case SLJIT_SIMD_OP2_UNZIP_LO:
+		ins = UZP1_z | ((sljit_ins)elem_size << 22);
+		break;
+	case SLJIT_SIMD_OP2_UNZIP_HI:
+		ins = UZP2_z | ((sljit_ins)elem_size << 22);
+		break;
+	}
+
+	if (src2 & SLJIT_MEM) {
+		if (elem_size > 3)
+			elem_size = 3;
+
+		FAIL_IF(sve_emit_mem(compiler, 0, elem_size, TMP_FREG1, src2, src2w));
+		src2 = TMP_FREG1;
+	}
+
+	return push_inst(compiler, ins | VD(dst_freg) | VN(src1_freg) | VM(src2));
+}
+
 SLJIT_API_FUNC_ATTRIBUTE sljit_s32 sljit_emit_simd_op2(struct sljit_compiler *compiler, sljit_s32 type,
 	sljit_s32 dst_freg, sljit_s32 src1_freg, sljit_s32 src2, sljit_sw src2w)
 {
@@ -3237,6 +3566,9 @@ SLJIT_API_FUNC_ATTRIBUTE sljit_s32 sljit_emit_simd_op2(struct sljit_compiler *co
 	CHECK(check_sljit_emit_simd_op2(compiler, type, dst_freg, src1_freg, src2, src2w));
 	ADJUST_LOCAL_OFFSET(src2, src2w);
 
+	if (reg_size == SVE_REG_SIZE)
+		return sve_emit_simd_op2(compiler, type, dst_freg, src1_freg, src2, src2w);
+
 	if (reg_size != 3 && reg_size != 4)
 		return SLJIT_ERR_UNSUPPORTED;
 
@@ -3259,6 +3591,21 @@ SLJIT_API_FUNC_ATTRIBUTE sljit_s32 sljit_emit_simd_op2(struct sljit_compiler *co
 	case SLJIT_SIMD_OP2_SHUFFLE:
 		ins = TBL_v;
 		break;
+	case SLJIT_SIMD_OP2_ZIP_LO:
+		ins = ZIP1 | ((sljit_ins)elem_size << 22);
+		break;
+	case SLJIT_SIMD_OP2_ZIP_HI:
+		ins = ZIP2 | ((sljit_ins)elem_size << 22);
+		break;
+	case SLJIT_SIMD_OP2_UNZIP_LO:
+		ins = UZP1 | ((sljit_ins)elem_size << 22);
+		break;
+	case SLJIT_SIMD_OP2_UNZIP_HI:
+		ins = UZP2 | ((sljit_ins)elem_size << 22);
+		break;
+	case SLJIT_SIMD_OP2_CMP_EQ:
+		ins = CMEQ_v | ((sljit_ins)elem_size << 22);
+		break;
 	}
 
 	if (src2 & SLJIT_MEM) {
@@ -3276,6 +3623,166 @@ SLJIT_API_FUNC_ATTRIBUTE sljit_s32 sljit_emit_simd_op2(struct sljit_compiler *co
 	return push_inst(compiler, ins | VD(dst_freg) | VN(src1_freg) | VM(src2));
 }
 
+SLJIT_API_FUNC_ATTRIBUTE sljit_s32 sljit_emit_simd_shift(struct sljit_compiler *compiler, sljit_s32 type,
+	sljit_s32 dst_freg, sljit_s32 src1_freg, sljit_s32 src2, sljit_sw src2w)
+{
+	sljit_s32 reg_size = SLJIT_SIMD_GET_REG_SIZE(type);
+	sljit_s32 elem_size = SLJIT_SIMD_GET_ELEM_SIZE(type);
+	sljit_ins ins, size_ins;
+
+	CHECK_ERROR();
+	CHECK(check_sljit_emit_simd_shift(compiler, type, dst_freg, src1_freg, src2, src2w));
+
+	if (reg_size != 3 && reg_size != 4)
+		return SLJIT_ERR_UNSUPPORTED;
+
+	if (type & SLJIT_SIMD_TEST)
+		return SLJIT_SUCCESS;
+
+	size_ins = (reg_size == 4) ? ((sljit_ins)1 << 30) : 0;
+
+	if (src2 == SLJIT_IMM) {
+		if (SLJIT_SIMD_GET_OPCODE(type) == SLJIT_SIMD_SHIFT_SHL)
+			ins = SHL_v | ((sljit_ins)((8 << elem_size) + src2w) << 16);
+		else if (src2w == 0) {
+			/* Right shifts by zero cannot be encoded. */
+			if (dst_freg == src1_freg)
+				return SLJIT_SUCCESS;
+			return push_inst(compiler, ORR_v | size_ins | VD(dst_freg) | VN(src1_freg) | VM(src1_freg));
+		} else
+			ins = ((SLJIT_SIMD_GET_OPCODE(type) == SLJIT_SIMD_SHIFT_LSHR) ? USHR : SSHR) | ((sljit_ins)((16 << elem_size) - src2w) << 16);
+
+		return push_inst(compiler, ins | size_ins | VD(dst_freg) | VN(src1_freg));
+	}
+
+	size_ins |= (sljit_ins)elem_size << 22;
+
+	/* Right shifts are left shifts by negative amounts. */
+	if (SLJIT_SIMD_GET_OPCODE(type) != SLJIT_SIMD_SHIFT_SHL) {
+		FAIL_IF(push_inst(compiler, NEG_v | size_ins | VD(TMP_FREG1) | VN(src2)));
+		src2 = TMP_FREG1;
+	}
+
+	ins = (SLJIT_SIMD_GET_OPCODE(type) == SLJIT_SIMD_SHIFT_ASHR) ? SSHL_v : USHL_v;
+	return push_inst(compiler, ins | size_ins | VD(dst_freg) | VN(src1_freg) | VM(src2));
+}
+
+SLJIT_API_FUNC_ATTRIBUTE sljit_s32 sljit_emit_simd_narrow(struct sljit_compiler *compiler, sljit_s32 type,
+	sljit_s32 dst_freg, sljit_s32 src1_freg, sljit_s32 src2_freg)
+{
+	sljit_s32 reg_size = SLJIT_SIMD_GET_REG_SIZE(type);
+	sljit_s32 elem_size = SLJIT_SIMD_GET_ELEM_SIZE(type);
+	sljit_ins ins;
+
+	CHECK_ERROR();
+	CHECK(check_sljit_emit_simd_narrow(compiler, type, dst_freg, src1_freg, src2_freg));
+
+	if (reg_size != 3 && reg_size != 4)
+		return SLJIT_ERR_UNSUPPORTED;
+
+	if (type & SLJIT_SIMD_TEST)
+		return SLJIT_SUCCESS;
+
+	if (type & SLJIT_SIMD_NARROW_SIGNED_SAT)
+		ins = SQXTN;
+	else if (type & SLJIT_SIMD_NARROW_UNSIGNED_SAT)
+		ins = SQXTUN;
+	else
+		ins = XTN;
+
+	ins |= (sljit_ins)(elem_size - 1) << 22;
+
+	if (reg_size == 3) {
+		/* Both sources are moved into a single 128 bit register. */
+		FAIL_IF(push_inst(compiler, ZIP1 | (1 << 30) | (0x3 << 22) | VD(TMP_FREG1) | VN(src1_freg) | VM(src2_freg)));
+		return push_inst(compiler, ins | VD(dst_freg) | VN(TMP_FREG1));
+	}
+
+	if (dst_freg == src2_freg) {
+		FAIL_IF(push_inst(compiler, ins | VD(TMP_FREG1) | VN(src1_freg)));
+		FAIL_IF(push_inst(compiler, ins | (1 << 30) | VD(TMP_FREG1) | VN(src2_freg)));
+		return push_inst(compiler, ORR_v | (1 << 30) | VD(dst_freg) | VN(TMP_FREG1) | VM(TMP_FREG1));
+	}
+
+	FAIL_IF(push_inst(compiler, ins | VD(dst_freg) | VN(src1_freg)));
+	return push_inst(compiler, ins | (1 << 30) | VD(dst_freg) | VN(src2_freg));
+}
+
+SLJIT_API_FUNC_ATTRIBUTE sljit_s32 sljit_emit_simd_gather(struct sljit_compiler *compiler, sljit_s32 type,
+	sljit_s32 freg, sljit_s32 index_freg,
+	sljit_s32 mem, sljit_sw memw)
+{
+	sljit_s32 reg_size = SLJIT_SIMD_GET_REG_SIZE(type);
+
+	CHECK_ERROR();
+	CHECK(check_sljit_emit_simd_gather(compiler, type, freg, index_freg, mem, memw));
+
+	if (reg_size != 3 && reg_size != 4)
+		return SLJIT_ERR_UNSUPPORTED;
+
+	/* Neon has no gather / scatter instructions. */
+	return sljit_emit_simd_mem_lanes(compiler, type, freg, index_freg, mem, memw, TMP_REG1);
+}
+
+SLJIT_API_FUNC_ATTRIBUTE sljit_s32 sljit_emit_simd_while(struct sljit_compiler *compiler, sljit_s32 type,
+	sljit_s32 src1, sljit_sw src1w,
+	sljit_s32 src2, sljit_sw src2w)
+{
+	CHECK_ERROR();
+	CHECK(check_sljit_emit_simd_while(compiler, type, src1, src1w, src2, src2w));
+	ADJUST_LOCAL_OFFSET(src1, src1w);
+	ADJUST_LOCAL_OFFSET(src2, src2w);
+
+	if (!is_sve_available())
+		return SLJIT_ERR_UNSUPPORTED;
+
+	if (type & SLJIT_SIMD_TEST)
+		return SLJIT_SUCCESS;
+
+	if (src1 == SLJIT_IMM) {
+		FAIL_IF(load_immediate(compiler, TMP_REG1, src1w));
+		src1 = TMP_REG1;
+	} else if (src1 & SLJIT_MEM) {
+		FAIL_IF(emit_op_mem(compiler, WORD_SIZE, TMP_REG1, src1, src1w, TMP_REG1));
+		src1 = TMP_REG1;
+	}
+
+	if (src2 == SLJIT_IMM) {
+		FAIL_IF(load_immediate(compiler, TMP_REG2, src2w));
+		src2 = TMP_REG2;
+	} else if (src2 & SLJIT_MEM) {
+		FAIL_IF(emit_op_mem(compiler, WORD_SIZE, TMP_REG2, src2, src2w, TMP_REG2));
+		src2 = TMP_REG2;
+	}
+
+	/* The Z flag is set when no lanes are active. */
+	return push_inst(compiler, WHILELO | ((sljit_ins)SLJIT_SIMD_GET_ELEM_SIZE(type) << 22) | RN(src1) | RM(src2));
+}
+
+SLJIT_API_FUNC_ATTRIBUTE sljit_s32 sljit_emit_simd_lane_count(struct sljit_compiler *compiler, sljit_s32 type,
+	sljit_s32 dst, sljit_sw dstw)
+{
+	sljit_s32 dst_r;
+
+	CHECK_ERROR();
+	CHECK(check_sljit_emit_simd_lane_count(compiler, type, dst, dstw));
+	ADJUST_LOCAL_OFFSET(dst, dstw);
+
+	if (!is_sve_available())
+		return SLJIT_ERR_UNSUPPORTED;
+
+	if (type & SLJIT_SIMD_TEST)
+		return SLJIT_SUCCESS;
+
+	dst_r = FAST_IS_REG(dst) ? dst : TMP_REG1;
+	FAIL_IF(push_inst(compiler, CNT_z | ((sljit_ins)SLJIT_SIMD_GET_ELEM_SIZE(type) << 22) | RD(dst_r)));
+
+	if (dst & SLJIT_MEM)
+		return emit_op_mem(compiler, WORD_SIZE | STORE, TMP_REG1, dst, dstw, TMP_REG2);
+
+	return SLJIT_SUCCESS;
+}
+
 SLJIT_API_FUNC_ATTRIBUTE sljit_s32 sljit_emit_atomic_load(struct sljit_compiler *compiler, sljit_s32 op,
 	sljit_s32 dst_reg,
 	sljit_s32 mem_reg)
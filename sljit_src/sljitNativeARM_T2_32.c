@@ -246,10 +246,15 @@ static const sljit_u8 farg_regs[SLJIT_NUMBER_OF_FLOAT_ARG_REGISTERS] = {
 #define VMOVN		0xffb20200
 #define VMRS		0xeef1fa10
 #define VMUL_F32	0xee200a00
+#define VNEG		0xffb10380
 #define VNEG_F32	0xeeb10a40
 #define VORR		0xef200110
 #define VPOP		0xecbd0b00
 #define VPUSH		0xed2d0b00
+#define VQMOVN		0xffb20280
+#define VQMOVUN		0xffb20240
+#define VSHL		0xef000400
+#define VSHL_i		0xef800510
 #define VSHLL		0xef800a10
 #define VSHR		0xef800010
 #define VSRA		0xef800110
@@ -258,6 +263,9 @@ static const sljit_u8 farg_regs[SLJIT_NUMBER_OF_FLOAT_ARG_REGISTERS] = {
 #define VSTR_F32	0xed000a00
 #define VSUB_F32	0xee300a40
 #define VTBL		0xffb00800
+#define VTRN		0xffb20080
+#define VUZP		0xffb20100
+#define VZIP		0xffb20180
 
 #if (defined SLJIT_ARGUMENT_CHECKS && SLJIT_ARGUMENT_CHECKS)
 
@@ -485,6 +493,9 @@ static void reduce_code_size(struct sljit_compiler *compiler)
 	SLJIT_NEXT_DEFINE_TYPES;
 	sljit_uw total_size;
 	sljit_uw size_reduce = 0;
+#if (defined SLJIT_STATISTICS && SLJIT_STATISTICS)
+	sljit_uw prev_size_reduce;
+#endif /* SLJIT_STATISTICS */
 	sljit_sw diff;
 
 	label = compiler->labels;
@@ -515,6 +526,9 @@ static void reduce_code_size(struct sljit_compiler *compiler)
 		if (next_min_addr != next_jump_addr)
 			continue;
 
+#if (defined SLJIT_STATISTICS && SLJIT_STATISTICS)
+		prev_size_reduce = size_reduce;
+#endif /* SLJIT_STATISTICS */
 		jump->addr -= size_reduce;
 		if (!(jump->flags & JUMP_MOV_ADDR)) {
 			total_size = JUMP_MAX_SIZE;
@@ -554,6 +568,8 @@ static void reduce_code_size(struct sljit_compiler *compiler)
 		}
 
 		jump->flags |= total_size << JUMP_SIZE_SHIFT;
+		SLJIT_STATS_ADD(jump_count, 1);
+		SLJIT_STATS_ADD(shortened_jump_count, size_reduce != prev_size_reduce);
 		jump = jump->next;
 		next_jump_addr = SLJIT_GET_NEXT_ADDRESS(jump);
 	}
@@ -561,6 +577,9 @@ static void reduce_code_size(struct sljit_compiler *compiler)
 	compiler->size -= size_reduce;
 }
 
+/* Upper bound of the size of the generated code (see sljit_create_code_pool). */
+#define SLJIT_MAX_GENERATED_CODE_SIZE(compiler) ((compiler)->size * sizeof(sljit_u16))
+
 SLJIT_API_FUNC_ATTRIBUTE void* sljit_generate_code(struct sljit_compiler *compiler, sljit_s32 options, void *exec_allocator_data)
 {
 	struct sljit_memory_fragment *buf;
@@ -579,11 +598,16 @@ SLJIT_API_FUNC_ATTRIBUTE void* sljit_generate_code(struct sljit_compiler *compil
 
 	CHECK_ERROR_PTR();
 	CHECK_PTR(check_sljit_generate_code(compiler));
+	SLJIT_STATS_PHASE(emit_time);
+	SLJIT_STATS_ADD(size_before_reduce, SLJIT_MAX_GENERATED_CODE_SIZE(compiler));
 
 	reduce_code_size(compiler);
+	SLJIT_STATS_ADD(size_after_reduce, SLJIT_MAX_GENERATED_CODE_SIZE(compiler));
+	SLJIT_STATS_PHASE(reduce_time);
 
 	code = (sljit_u16*)allocate_executable_memory(compiler->size * sizeof(sljit_u16), options, exec_allocator_data, &executable_offset);
 	PTR_FAIL_WITH_EXEC_IF(code);
+	SLJIT_STATS_PHASE(alloc_time);
 
 	reverse_buf(compiler);
 	buf = compiler->buf;
@@ -670,7 +694,10 @@ SLJIT_API_FUNC_ATTRIBUTE void* sljit_generate_code(struct sljit_compiler *compil
 	code_ptr = (sljit_u16 *)SLJIT_ADD_EXEC_OFFSET(code_ptr, executable_offset);
 
 	SLJIT_CACHE_FLUSH(code, code_ptr);
-	SLJIT_UPDATE_WX_FLAGS(code, code_ptr, 1);
+	SLJIT_STATS_PHASE(encode_time);
+	if (!(options & SLJIT_GENERATE_CODE_KEEP_WRITABLE)) {
+		SLJIT_UPDATE_WX_FLAGS(code, code_ptr, 1);
+	}
 
 	/* Set thumb mode flag. */
 	return (void*)((sljit_uw)code | 0x1);
@@ -4164,6 +4191,70 @@ SLJIT_API_FUNC_ATTRIBUTE sljit_s32 sljit_emit_simd_sign(struct sljit_compiler *c
 	return SLJIT_SUCCESS;
 }
 
+/* VZIP and VUZP store the lower half of the result into
+   the first, and the upper half into the second operand. */
+static sljit_s32 simd_emit_zip(struct sljit_compiler *compiler, sljit_s32 type, sljit_ins ins,
+	sljit_s32 dst_freg, sljit_s32 src1_freg, sljit_s32 src2_freg)
+{
+	sljit_s32 elem_size = SLJIT_SIMD_GET_ELEM_SIZE(type);
+	sljit_s32 is_hi = SLJIT_SIMD_GET_OPCODE(type) == SLJIT_SIMD_OP2_ZIP_HI || SLJIT_SIMD_GET_OPCODE(type) == SLJIT_SIMD_OP2_UNZIP_HI;
+	sljit_ins mov = VORR | (ins & ((sljit_ins)1 << 6));
+
+	if (elem_size == 3) {
+		/* The elements are the halves of the quad registers, and the
+		   zip and unzip operations produce the same result. */
+		SLJIT_ASSERT(SLJIT_SIMD_GET_REG_SIZE(type) == 4);
+
+		if (!is_hi) {
+			FAIL_IF(push_inst32(compiler, VORR | VD4(dst_freg + SLJIT_QUAD_OTHER_HALF(dst_freg)) | VN4(src2_freg) | VM4(src2_freg)));
+			if (dst_freg == src1_freg)
+				return SLJIT_SUCCESS;
+			return push_inst32(compiler, VORR | VD4(dst_freg) | VN4(src1_freg) | VM4(src1_freg));
+		}
+
+		src1_freg += SLJIT_QUAD_OTHER_HALF(src1_freg);
+		src2_freg += SLJIT_QUAD_OTHER_HALF(src2_freg);
+		FAIL_IF(push_inst32(compiler, VORR | VD4(dst_freg) | VN4(src1_freg) | VM4(src1_freg)));
+		dst_freg += SLJIT_QUAD_OTHER_HALF(dst_freg);
+		if (dst_freg == src2_freg)
+			return SLJIT_SUCCESS;
+		return push_inst32(compiler, VORR | VD4(dst_freg) | VN4(src2_freg) | VM4(src2_freg));
+	}
+
+	/* VZIP.32 and VUZP.32 are undefined for double registers,
+	   but VTRN.32 produces the same result. */
+	if (elem_size == 2 && !(ins & ((sljit_ins)1 << 6)))
+		ins = VTRN;
+
+	ins |= (sljit_ins)elem_size << 18;
+
+	if (!is_hi) {
+		if (dst_freg != src2_freg || dst_freg == src1_freg) {
+			if (dst_freg != src1_freg)
+				FAIL_IF(push_inst32(compiler, mov | VD4(dst_freg) | VN4(src1_freg) | VM4(src1_freg)));
+			if (src2_freg != TMP_FREG2)
+				FAIL_IF(push_inst32(compiler, mov | VD4(TMP_FREG2) | VN4(src2_freg) | VM4(src2_freg)));
+			return push_inst32(compiler, ins | VD4(dst_freg) | VM4(TMP_FREG2));
+		}
+
+		FAIL_IF(push_inst32(compiler, mov | VD4(TMP_FREG2) | VN4(src1_freg) | VM4(src1_freg)));
+		FAIL_IF(push_inst32(compiler, ins | VD4(TMP_FREG2) | VM4(dst_freg)));
+		return push_inst32(compiler, mov | VD4(dst_freg) | VN4(TMP_FREG2) | VM4(TMP_FREG2));
+	}
+
+	if (dst_freg != src1_freg || dst_freg == src2_freg) {
+		if (dst_freg != src2_freg)
+			FAIL_IF(push_inst32(compiler, mov | VD4(dst_freg) | VN4(src2_freg) | VM4(src2_freg)));
+		FAIL_IF(push_inst32(compiler, mov | VD4(TMP_FREG2) | VN4(src1_freg) | VM4(src1_freg)));
+		return push_inst32(compiler, ins | VD4(TMP_FREG2) | VM4(dst_freg));
+	}
+
+	if (src2_freg != TMP_FREG2)
+		FAIL_IF(push_inst32(compiler, mov | VD4(TMP_FREG2) | VN4(src2_freg) | VM4(src2_freg)));
+	FAIL_IF(push_inst32(compiler, ins | VD4(dst_freg) | VM4(TMP_FREG2)));
+	return push_inst32(compiler, mov | VD4(dst_freg) | VN4(TMP_FREG2) | VM4(TMP_FREG2));
+}
+
 SLJIT_API_FUNC_ATTRIBUTE sljit_s32 sljit_emit_simd_op2(struct sljit_compiler *compiler, sljit_s32 type,
 	sljit_s32 dst_freg, sljit_s32 src1_freg, sljit_s32 src2, sljit_sw src2w)
 {
@@ -4182,6 +4273,10 @@ SLJIT_API_FUNC_ATTRIBUTE sljit_s32 sljit_emit_simd_op2(struct sljit_compiler *co
 	if ((type & SLJIT_SIMD_FLOAT) && (elem_size < 2 || elem_size > 3))
 		return SLJIT_ERR_UNSUPPORTED;
 
+	/* The compare operation is not implemented. */
+	if (SLJIT_SIMD_GET_OPCODE(type) == SLJIT_SIMD_OP2_CMP_EQ)
+		return SLJIT_ERR_UNSUPPORTED;
+
 	if (type & SLJIT_SIMD_TEST)
 		return SLJIT_SUCCESS;
 
@@ -4198,6 +4293,14 @@ SLJIT_API_FUNC_ATTRIBUTE sljit_s32 sljit_emit_simd_op2(struct sljit_compiler *co
 	case SLJIT_SIMD_OP2_SHUFFLE:
 		ins = VTBL;
 		break;
+	case SLJIT_SIMD_OP2_ZIP_LO:
+	case SLJIT_SIMD_OP2_ZIP_HI:
+		ins = VZIP;
+		break;
+	case SLJIT_SIMD_OP2_UNZIP_LO:
+	case SLJIT_SIMD_OP2_UNZIP_HI:
+		ins = VUZP;
+		break;
 	}
 
 	if (src2 & SLJIT_MEM) {
@@ -4239,9 +4342,115 @@ SLJIT_API_FUNC_ATTRIBUTE sljit_s32 sljit_emit_simd_op2(struct sljit_compiler *co
 		ins |= (sljit_ins)1 << 6;
 	}
 
+	if (SLJIT_SIMD_GET_OPCODE(type) >= SLJIT_SIMD_OP2_ZIP_LO)
+		return simd_emit_zip(compiler, type, ins, dst_freg, src1_freg, src2);
+
 	return push_inst32(compiler, ins | VD4(dst_freg) | VN4(src1_freg) | VM4(src2));
 }
 
+SLJIT_API_FUNC_ATTRIBUTE sljit_s32 sljit_emit_simd_shift(struct sljit_compiler *compiler, sljit_s32 type,
+	sljit_s32 dst_freg, sljit_s32 src1_freg, sljit_s32 src2, sljit_sw src2w)
+{
+	sljit_s32 reg_size = SLJIT_SIMD_GET_REG_SIZE(type);
+	sljit_s32 elem_size = SLJIT_SIMD_GET_ELEM_SIZE(type);
+	sljit_ins ins = 0, imm;
+
+	CHECK_ERROR();
+	CHECK(check_sljit_emit_simd_shift(compiler, type, dst_freg, src1_freg, src2, src2w));
+
+	if (reg_size != 3 && reg_size != 4)
+		return SLJIT_ERR_UNSUPPORTED;
+
+	if (type & SLJIT_SIMD_TEST)
+		return SLJIT_SUCCESS;
+
+	if (reg_size == 4) {
+		dst_freg = simd_get_quad_reg_index(dst_freg);
+		src1_freg = simd_get_quad_reg_index(src1_freg);
+		if (src2 != SLJIT_IMM)
+			src2 = simd_get_quad_reg_index(src2);
+		ins = (sljit_ins)1 << 6;
+	}
+
+	if (src2 == SLJIT_IMM) {
+		if (SLJIT_SIMD_GET_OPCODE(type) == SLJIT_SIMD_SHIFT_SHL) {
+			ins |= VSHL_i;
+			imm = (sljit_ins)((8 << elem_size) + src2w);
+		} else if (src2w == 0) {
+			/* Right shifts by zero cannot be encoded. */
+			if (dst_freg == src1_freg)
+				return SLJIT_SUCCESS;
+			return push_inst32(compiler, VORR | ins | VD4(dst_freg) | VN4(src1_freg) | VM4(src1_freg));
+		} else {
+			ins |= VSHR | ((SLJIT_SIMD_GET_OPCODE(type) == SLJIT_SIMD_SHIFT_LSHR) ? (1 << 28) : 0);
+			imm = (sljit_ins)((16 << elem_size) - src2w);
+		}
+
+		/* The highest bit of the immediate is the L bit. */
+		return push_inst32(compiler, ins | ((imm & 0x3f) << 16) | ((imm & 0x40) << 1) | VD4(dst_freg) | VM4(src1_freg));
+	}
+
+	/* Right shifts are left shifts by negative amounts. Since
+	   only the lowest byte of each element is used as shift
+	   amount, the bytes are negated for all element sizes. */
+	if (SLJIT_SIMD_GET_OPCODE(type) != SLJIT_SIMD_SHIFT_SHL) {
+		FAIL_IF(push_inst32(compiler, VNEG | ins | VD4(TMP_FREG2) | VM4(src2)));
+		src2 = TMP_FREG2;
+	}
+
+	ins |= VSHL | ((sljit_ins)elem_size << 20) | ((SLJIT_SIMD_GET_OPCODE(type) == SLJIT_SIMD_SHIFT_ASHR) ? 0 : (1 << 28));
+	return push_inst32(compiler, ins | VD4(dst_freg) | VM4(src1_freg) | VN4(src2));
+}
+
+SLJIT_API_FUNC_ATTRIBUTE sljit_s32 sljit_emit_simd_narrow(struct sljit_compiler *compiler, sljit_s32 type,
+	sljit_s32 dst_freg, sljit_s32 src1_freg, sljit_s32 src2_freg)
+{
+	sljit_s32 reg_size = SLJIT_SIMD_GET_REG_SIZE(type);
+	sljit_s32 elem_size = SLJIT_SIMD_GET_ELEM_SIZE(type);
+	sljit_ins ins;
+
+	CHECK_ERROR();
+	CHECK(check_sljit_emit_simd_narrow(compiler, type, dst_freg, src1_freg, src2_freg));
+
+	if (reg_size != 3 && reg_size != 4)
+		return SLJIT_ERR_UNSUPPORTED;
+
+	if (type & SLJIT_SIMD_TEST)
+		return SLJIT_SUCCESS;
+
+	if (type & SLJIT_SIMD_NARROW_SIGNED_SAT)
+		ins = VQMOVN;
+	else if (type & SLJIT_SIMD_NARROW_UNSIGNED_SAT)
+		ins = VQMOVUN;
+	else
+		ins = VMOVN;
+
+	ins |= (sljit_ins)(elem_size - 1) << 18;
+
+	if (reg_size == 3) {
+		/* Both sources are moved into a single quad register. */
+		SLJIT_ASSERT((freg_map[TMP_FREG2] & 0x1) == 0 && freg_map[TMP_FREG2] + 1 == freg_map[TMP_FREG1]);
+		FAIL_IF(push_inst32(compiler, VORR | VD4(TMP_FREG2) | VN4(src1_freg) | VM4(src1_freg)));
+		FAIL_IF(push_inst32(compiler, VORR | VD4(TMP_FREG1) | VN4(src2_freg) | VM4(src2_freg)));
+		return push_inst32(compiler, ins | VD4(dst_freg) | VM4(TMP_FREG2));
+	}
+
+	dst_freg = simd_get_quad_reg_index(dst_freg);
+	src1_freg = simd_get_quad_reg_index(src1_freg);
+	src2_freg = simd_get_quad_reg_index(src2_freg);
+
+	if (dst_freg == src2_freg) {
+		FAIL_IF(push_inst32(compiler, ins | VD4(TMP_FREG2) | VM4(src2_freg)));
+		FAIL_IF(push_inst32(compiler, ins | VD4(dst_freg) | VM4(src1_freg)));
+		dst_freg += SLJIT_QUAD_OTHER_HALF(dst_freg);
+		return push_inst32(compiler, VORR | VD4(dst_freg) | VN4(TMP_FREG2) | VM4(TMP_FREG2));
+	}
+
+	FAIL_IF(push_inst32(compiler, ins | VD4(dst_freg) | VM4(src1_freg)));
+	dst_freg += SLJIT_QUAD_OTHER_HALF(dst_freg);
+	return push_inst32(compiler, ins | VD4(dst_freg) | VM4(src2_freg));
+}
+
 #undef FPU_LOAD
 
 SLJIT_API_FUNC_ATTRIBUTE sljit_s32 sljit_emit_atomic_load(struct sljit_compiler *compiler, sljit_s32 op,
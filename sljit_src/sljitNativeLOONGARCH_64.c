@@ -782,7 +782,9 @@ SLJIT_API_FUNC_ATTRIBUTE void* sljit_generate_code(struct sljit_compiler *compil
 	code_ptr = (sljit_ins *)SLJIT_ADD_EXEC_OFFSET(code_ptr, executable_offset);
 
 	SLJIT_CACHE_FLUSH(code, code_ptr);
-	SLJIT_UPDATE_WX_FLAGS(code, code_ptr, 1);
+	if (!(options & SLJIT_GENERATE_CODE_KEEP_WRITABLE)) {
+		SLJIT_UPDATE_WX_FLAGS(code, code_ptr, 1);
+	}
 	return code;
 }
 
@@ -3574,6 +3576,10 @@ SLJIT_API_FUNC_ATTRIBUTE sljit_s32 sljit_emit_simd_op2(struct sljit_compiler *co
 	if ((type & SLJIT_SIMD_FLOAT) && (elem_size < 2 || elem_size > 3))
 		return SLJIT_ERR_UNSUPPORTED;
 
+	/* Only the bitwise operations are implemented. */
+	if (SLJIT_SIMD_GET_OPCODE(type) > SLJIT_SIMD_OP2_XOR)
+		return SLJIT_ERR_UNSUPPORTED;
+
 	if (type & SLJIT_SIMD_TEST)
 		return SLJIT_SUCCESS;
 
@@ -383,8 +383,10 @@ static sljit_u8* detect_far_jump_type(struct sljit_jump *jump, sljit_u8 *code_pt
 		jump->flags |= PATCH_MD;
 	else if (short_addr)
 		sljit_unaligned_store_s32(code_ptr, (sljit_s32)jump->u.target);
-	else
+	else {
+		jump->flags |= JUMP_FAR_MD;
 		sljit_unaligned_store_sw(code_ptr, (sljit_sw)jump->u.target);
+	}
 
 	code_ptr += short_addr ? sizeof(sljit_s32) : sizeof(sljit_sw);
 
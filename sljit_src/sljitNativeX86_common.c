@@ -297,9 +297,14 @@ static const sljit_u8 freg_lmap[SLJIT_NUMBER_OF_FLOAT_REGISTERS + 2] = {
 #define OR_rm_r			0x09
 #define OR_rm8_r8		0x08
 #define ORPD_x_xm		0x56
+#define PACKSSDW_x_xm		(/* GROUP_0F */ 0x6b)
 #define PACKSSWB_x_xm		(/* GROUP_0F */ 0x63)
+#define PACKUSDW_x_xm		0x2b
+#define PACKUSWB_x_xm		(/* GROUP_0F */ 0x67)
 #define PAND_x_xm		0xdb
+#define PCMPEQB_x_xm		0x74
 #define PCMPEQD_x_xm		0x76
+#define PCMPEQQ_x_xm		0x29
 #define PINSRB_x_rm_i8		0x20
 #define PINSRW_x_rm_i8		0xc4
 #define PINSRD_x_rm_i8		0x22
@@ -330,6 +335,11 @@ static const sljit_u8 freg_lmap[SLJIT_NUMBER_OF_FLOAT_REGISTERS + 2] = {
 #define PSRLDQ_x		0x73
 #define PSLLD_x_i8		0x72
 #define PSLLQ_x_i8		0x73
+#define PSLLW_x_i8		0x71
+#define PUNPCKHBW_x_xm		0x68
+#define PUNPCKHQDQ_x_xm		0x6d
+#define PUNPCKLBW_x_xm		0x60
+#define PUNPCKLQDQ_x_xm		0x6c
 #define PUSH_i32		0x68
 #define PUSH_r			0x50
 #define PUSH_rm			(/* GROUP_FF */ 6 << 3)
@@ -372,6 +382,9 @@ static const sljit_u8 freg_lmap[SLJIT_NUMBER_OF_FLOAT_REGISTERS + 2] = {
 #define VPBROADCASTW_x_xm	0x79
 #define VPERMPD_y_ym		0x01
 #define VPERMQ_y_ym		0x00
+#define VPSLLVD_x_xm		0x47
+#define VPSRAVD_x_xm		0x46
+#define VPSRLVD_x_xm		0x45
 #define XCHG_EAX_r		0x90
 #define XCHG_r_rm		0x87
 #define XOR			(/* BINARY */ 6 << 3)
@@ -409,7 +422,8 @@ static const sljit_u8 freg_lmap[SLJIT_NUMBER_OF_FLOAT_REGISTERS + 2] = {
 
 /* Multithreading does not affect these static variables, since they store
    built-in CPU features. Therefore they can be overwritten by different threads
-   if they detect the CPU features in the same time. */
+   if they detect the CPU features in the same time. The only exception is
+   cpu_feature_disabled, which is changed by sljit_set_cpu_profile. */
 #define CPU_FEATURE_DETECTED		0x001
 #if (defined SLJIT_DETECT_SSE2 && SLJIT_DETECT_SSE2)
 #define CPU_FEATURE_SSE2		0x002
@@ -423,6 +437,7 @@ static const sljit_u8 freg_lmap[SLJIT_NUMBER_OF_FLOAT_REGISTERS + 2] = {
 #define CPU_FEATURE_OSXSAVE		0x100
 
 static sljit_u32 cpu_feature_list = 0;
+static sljit_u32 cpu_feature_disabled = 0;
 
 #ifdef _WIN32_WCE
 #include <cmnintrin.h>
@@ -604,7 +619,7 @@ static void get_cpu_features(void)
 	if ((feature_list & CPU_FEATURE_OSXSAVE) && (execute_get_xcr0_low() & 0x4) == 0)
 		feature_list &= ~(sljit_u32)(CPU_FEATURE_AVX | CPU_FEATURE_AVX2);
 
-	cpu_feature_list = feature_list;
+	cpu_feature_list = feature_list & ~cpu_feature_disabled;
 }
 
 static sljit_u8 get_jump_code(sljit_uw type)
@@ -784,6 +799,92 @@ static void generate_jump_or_mov_addr(struct sljit_jump *jump, sljit_sw executab
 	}
 }
 
+/* Code images (see sljit_create_code_image) can be relocated on this target. */
+#define SLJIT_HAS_CODE_IMAGE 1
+/* The instructions selected by the code generator depend on these features. */
+#define SLJIT_CODE_IMAGE_CPU_FEATURES() ((sljit_uw)cpu_feature_list)
+
+/* Returns with non-zero, if the encoded value depends on the address of the code. */
+static SLJIT_INLINE sljit_s32 jump_is_position_dependent(sljit_uw flags)
+{
+#if (defined SLJIT_CONFIG_X86_32 && SLJIT_CONFIG_X86_32)
+	if (flags & JUMP_MOV_ADDR)
+		return !(flags & JUMP_ADDR);
+	return (flags & JUMP_ADDR) != 0;
+#else /* !SLJIT_CONFIG_X86_32 */
+	if (flags & JUMP_MOV_ADDR)
+		return !(flags & PATCH_MW) || (flags & JUMP_ADDR);
+	if (flags & JUMP_ADDR)
+		return (flags & (PATCH_MB | PATCH_MW)) != 0;
+	return (flags & PATCH_MD) != 0;
+#endif /* SLJIT_CONFIG_X86_32 */
+}
+
+/* Returns with non-zero, if the bytes updated by
+   relocate_jump() are inside a code of code_size bytes. */
+static SLJIT_INLINE sljit_s32 jump_reloc_is_valid(sljit_uw addr, sljit_uw flags, sljit_uw code_size)
+{
+	SLJIT_UNUSED_ARG(flags);
+	return addr >= sizeof(sljit_sw) && addr <= code_size;
+}
+
+/* Updates a jump after the code is moved, or its target is changed. Returns
+   with zero, if the new value cannot be encoded by the instruction. */
+static sljit_s32 relocate_jump(struct sljit_jump *jump, sljit_sw executable_offset)
+{
+	sljit_uw flags = jump->flags;
+	sljit_uw addr = (flags & JUMP_ADDR) ? jump->u.target : jump->u.label->u.addr;
+	sljit_sw diff;
+
+#if (defined SLJIT_CONFIG_X86_32 && SLJIT_CONFIG_X86_32)
+	if (!(flags & (JUMP_MOV_ADDR | PATCH_MB | PATCH_MW))) {
+		/* Far jumps to absolute addresses are encoded without patch flags. */
+		jump->flags |= PATCH_MW;
+	}
+#else /* !SLJIT_CONFIG_X86_32 */
+	if (flags & PATCH_MD) {
+		/* Any address can be stored in a 64 bit immediate. */
+		sljit_unaligned_store_sw((void*)(jump->addr - ((flags & JUMP_MOV_ADDR) ? sizeof(sljit_sw) : 0)), (sljit_sw)addr);
+		return 1;
+	}
+
+	if (!(flags & (JUMP_MOV_ADDR | PATCH_MB | PATCH_MW))) {
+		/* Far jumps to absolute addresses load the target into TMP_REG2
+		   with a 64 bit, or a zero extended 32 bit immediate. */
+		SLJIT_ASSERT(flags & JUMP_ADDR);
+		if (flags & JUMP_FAR_MD) {
+			sljit_unaligned_store_sw((void*)jump->addr, (sljit_sw)addr);
+			return 1;
+		}
+
+		if (addr > 0xffffffff)
+			return 0;
+		sljit_unaligned_store_s32((void*)jump->addr, (sljit_s32)addr);
+		return 1;
+	}
+
+	if ((flags & JUMP_MOV_ADDR) && !(flags & PATCH_MW)) {
+		if (addr > HALFWORD_MAX)
+			return 0;
+	} else if (!(flags & PATCH_MB)) {
+		diff = (sljit_sw)(addr - (sljit_uw)SLJIT_ADD_EXEC_OFFSET((sljit_u8*)jump->addr, executable_offset));
+		if (!(flags & JUMP_MOV_ADDR))
+			diff -= (sljit_sw)sizeof(sljit_s32);
+		if (diff > HALFWORD_MAX || diff < HALFWORD_MIN)
+			return 0;
+	}
+#endif /* SLJIT_CONFIG_X86_32 */
+
+	if (flags & PATCH_MB) {
+		diff = (sljit_sw)(addr - (sljit_uw)SLJIT_ADD_EXEC_OFFSET((sljit_u8*)jump->addr, executable_offset)) - (sljit_sw)sizeof(sljit_s8);
+		if (diff > 0x7f || diff < -0x80)
+			return 0;
+	}
+
+	generate_jump_or_mov_addr(jump, executable_offset);
+	return 1;
+}
+
 static void reduce_code_size(struct sljit_compiler *compiler)
 {
 	struct sljit_label *label;
@@ -792,6 +893,9 @@ static void reduce_code_size(struct sljit_compiler *compiler)
 	sljit_uw next_jump_addr;
 	sljit_uw next_min_addr;
 	sljit_uw size_reduce = 0;
+#if (defined SLJIT_STATISTICS && SLJIT_STATISTICS)
+	sljit_uw prev_size_reduce;
+#endif /* SLJIT_STATISTICS */
 	sljit_sw diff;
 	sljit_uw type;
 #if (defined SLJIT_DEBUG && SLJIT_DEBUG)
@@ -822,6 +926,9 @@ static void reduce_code_size(struct sljit_compiler *compiler)
 		if (next_min_addr != next_jump_addr)
 			continue;
 
+#if (defined SLJIT_STATISTICS && SLJIT_STATISTICS)
+		prev_size_reduce = size_reduce;
+#endif /* SLJIT_STATISTICS */
 		if (!(jump->flags & JUMP_MOV_ADDR)) {
 #if (defined SLJIT_DEBUG && SLJIT_DEBUG)
 			size_reduce_max = size_reduce + (((jump->flags >> TYPE_SHIFT) < SLJIT_JUMP) ? CJUMP_MAX_SIZE : JUMP_MAX_SIZE);
@@ -888,6 +995,8 @@ static void reduce_code_size(struct sljit_compiler *compiler)
 #endif /* SLJIT_CONFIG_X86_64 */
 		}
 
+		SLJIT_STATS_ADD(jump_count, 1);
+		SLJIT_STATS_ADD(shortened_jump_count, size_reduce != prev_size_reduce);
 		jump = jump->next;
 		next_jump_addr = SLJIT_GET_NEXT_ADDRESS(jump);
 	}
@@ -895,6 +1004,9 @@ static void reduce_code_size(struct sljit_compiler *compiler)
 	compiler->size -= size_reduce;
 }
 
+/* Upper bound of the size of the generated code (see sljit_create_code_pool). */
+#define SLJIT_MAX_GENERATED_CODE_SIZE(compiler) ((compiler)->size)
+
 SLJIT_API_FUNC_ATTRIBUTE void* sljit_generate_code(struct sljit_compiler *compiler, sljit_s32 options, void *exec_allocator_data)
 {
 	struct sljit_memory_fragment *buf;
@@ -914,12 +1026,17 @@ SLJIT_API_FUNC_ATTRIBUTE void* sljit_generate_code(struct sljit_compiler *compil
 
 	CHECK_ERROR_PTR();
 	CHECK_PTR(check_sljit_generate_code(compiler));
+	SLJIT_STATS_PHASE(emit_time);
+	SLJIT_STATS_ADD(size_before_reduce, SLJIT_MAX_GENERATED_CODE_SIZE(compiler));
 
 	reduce_code_size(compiler);
+	SLJIT_STATS_ADD(size_after_reduce, SLJIT_MAX_GENERATED_CODE_SIZE(compiler));
+	SLJIT_STATS_PHASE(reduce_time);
 
 	/* Second code generation pass. */
 	code = (sljit_u8*)allocate_executable_memory(compiler->size, options, exec_allocator_data, &executable_offset);
 	PTR_FAIL_WITH_EXEC_IF(code);
+	SLJIT_STATS_PHASE(alloc_time);
 
 	reverse_buf(compiler);
 	buf = compiler->buf;
@@ -1001,7 +1118,10 @@ SLJIT_API_FUNC_ATTRIBUTE void* sljit_generate_code(struct sljit_compiler *compil
 
 	code = (sljit_u8*)SLJIT_ADD_EXEC_OFFSET(code, executable_offset);
 
-	SLJIT_UPDATE_WX_FLAGS(code, (sljit_u8*)SLJIT_ADD_EXEC_OFFSET(code_ptr, executable_offset), 1);
+	SLJIT_STATS_PHASE(encode_time);
+	if (!(options & SLJIT_GENERATE_CODE_KEEP_WRITABLE)) {
+		SLJIT_UPDATE_WX_FLAGS(code, (sljit_u8*)SLJIT_ADD_EXEC_OFFSET(code_ptr, executable_offset), 1);
+	}
 	return (void*)code;
 }
 
@@ -1068,6 +1188,39 @@ SLJIT_API_FUNC_ATTRIBUTE sljit_s32 sljit_has_cpu_feature(sljit_s32 feature_type)
 	}
 }
 
+SLJIT_API_FUNC_ATTRIBUTE sljit_s32 sljit_set_cpu_profile(const struct sljit_cpu_profile *profile)
+{
+	struct sljit_cpu_profile current;
+	sljit_u32 features;
+	sljit_u32 disabled = 0;
+
+	if (profile != NULL) {
+		sljit_get_cpu_profile(&current);
+		features = ~profile->features;
+
+		if (current.features & features & ~(sljit_u32)(SLJIT_CPU_SIMD | SLJIT_CPU_CLZ | SLJIT_CPU_CTZ
+				| SLJIT_CPU_CMOV | SLJIT_CPU_AVX | SLJIT_CPU_AVX2))
+			return SLJIT_ERR_UNSUPPORTED;
+
+		if (features & SLJIT_CPU_SIMD)
+			disabled |= CPU_FEATURE_SSE41 | CPU_FEATURE_AVX | CPU_FEATURE_AVX2;
+		if (features & SLJIT_CPU_AVX)
+			disabled |= CPU_FEATURE_AVX | CPU_FEATURE_AVX2;
+		if (features & SLJIT_CPU_AVX2)
+			disabled |= CPU_FEATURE_AVX2;
+		if (features & SLJIT_CPU_CLZ)
+			disabled |= CPU_FEATURE_LZCNT;
+		if (features & SLJIT_CPU_CTZ)
+			disabled |= CPU_FEATURE_TZCNT;
+		if (features & SLJIT_CPU_CMOV)
+			disabled |= CPU_FEATURE_CMOV;
+	}
+
+	cpu_feature_disabled = disabled;
+	get_cpu_features();
+	return SLJIT_SUCCESS;
+}
+
 SLJIT_API_FUNC_ATTRIBUTE sljit_s32 sljit_cmp_info(sljit_s32 type)
 {
 	switch (type) {
@@ -1158,6 +1311,8 @@ static sljit_s32 emit_cmov_generic(struct sljit_compiler *compiler, sljit_s32 ty
 	sljit_s32 dst_reg,
 	sljit_s32 src, sljit_sw srcw);
 
+static sljit_s32 emit_static_addr(struct sljit_compiler *compiler, sljit_s32 reg, const void *addr);
+
 static SLJIT_INLINE sljit_s32 emit_endbranch(struct sljit_compiler *compiler)
 {
 #if (defined SLJIT_CONFIG_X86_CET && SLJIT_CONFIG_X86_CET)
@@ -1364,6 +1519,36 @@ static sljit_s32 emit_mov(struct sljit_compiler *compiler,
 	return SLJIT_SUCCESS;
 }
 
+/* Loads the address of a static data of sljit into a register. The
+   address is emitted as a mov_addr instruction, so code images can
+   relocate it (see sljit_create_code_image). Flags are preserved. */
+static sljit_s32 emit_static_addr(struct sljit_compiler *compiler, sljit_s32 reg, const void *addr)
+{
+	struct sljit_jump *jump;
+	sljit_u8 *inst;
+
+	jump = (struct sljit_jump*)ensure_abuf(compiler, sizeof(struct sljit_jump));
+	FAIL_IF(!jump);
+	set_mov_addr(jump, compiler, 0);
+	jump->flags |= JUMP_ADDR | MOV_ADDR_STATIC;
+	jump->u.target = (sljit_uw)addr;
+
+#if (defined SLJIT_CONFIG_X86_64 && SLJIT_CONFIG_X86_64)
+	FAIL_IF(emit_load_imm64(compiler, reg, 0));
+	jump->addr = compiler->size;
+
+	if (reg_map[reg] >= 8)
+		jump->flags |= MOV_ADDR_HI;
+#else /* !SLJIT_CONFIG_X86_64 */
+	FAIL_IF(emit_do_imm(compiler, MOV_r_i32 | reg_map[reg], 0));
+#endif /* SLJIT_CONFIG_X86_64 */
+
+	inst = (sljit_u8*)ensure_buf(compiler, 1);
+	FAIL_IF(!inst);
+	inst[0] = SLJIT_INST_MOV_ADDR;
+	return SLJIT_SUCCESS;
+}
+
 static sljit_s32 emit_cmov_generic(struct sljit_compiler *compiler, sljit_s32 type,
 	sljit_s32 dst_reg,
 	sljit_s32 src, sljit_sw srcw)
@@ -1729,11 +1914,6 @@ static sljit_s32 emit_unary(struct sljit_compiler *compiler, sljit_u8 opcode,
 	return SLJIT_SUCCESS;
 }
 
-#if (defined SLJIT_CONFIG_X86_32 && SLJIT_CONFIG_X86_32)
-static const sljit_sw emit_clz_arg = 32 + 31;
-static const sljit_sw emit_ctz_arg = 32;
-#endif
-
 static sljit_s32 emit_clz_ctz(struct sljit_compiler *compiler, sljit_s32 is_clz,
 	sljit_s32 dst, sljit_sw dstw,
 	sljit_s32 src, sljit_sw srcw)
@@ -1759,14 +1939,10 @@ static sljit_s32 emit_clz_ctz(struct sljit_compiler *compiler, sljit_s32 is_clz,
 #if (defined SLJIT_CONFIG_X86_32 && SLJIT_CONFIG_X86_32)
 	max = is_clz ? (32 + 31) : 32;
 
-	if (cpu_feature_list & CPU_FEATURE_CMOV) {
-		if (dst_r != TMP_REG1) {
-			EMIT_MOV(compiler, TMP_REG1, 0, SLJIT_IMM, max);
-			inst = emit_x86_instruction(compiler, 2, dst_r, 0, TMP_REG1, 0);
-		}
-		else
-			inst = emit_x86_instruction(compiler, 2, dst_r, 0, SLJIT_MEM0(), is_clz ? (sljit_sw)&emit_clz_arg : (sljit_sw)&emit_ctz_arg);
-
+	/* No free register is left for the constant when dst_r is TMP_REG1. */
+	if ((cpu_feature_list & CPU_FEATURE_CMOV) && dst_r != TMP_REG1) {
+		EMIT_MOV(compiler, TMP_REG1, 0, SLJIT_IMM, max);
+		inst = emit_x86_instruction(compiler, 2, dst_r, 0, TMP_REG1, 0);
 		FAIL_IF(!inst);
 		inst[0] = GROUP_0F;
 		inst[1] = CMOVE_r_rm;
@@ -3334,11 +3510,13 @@ SLJIT_API_FUNC_ATTRIBUTE sljit_s32 sljit_emit_fop1(struct sljit_compiler *compil
 
 	switch (GET_OPCODE(op)) {
 	case SLJIT_NEG_F64:
-		FAIL_IF(emit_groupf(compiler, XORPD_x_xm | EX86_SELECT_66(op) | EX86_SSE2, TMP_FREG, SLJIT_MEM0(), (sljit_sw)((op & SLJIT_32) ? sse2_buffer : sse2_buffer + 8)));
+		FAIL_IF(emit_static_addr(compiler, TMP_REG1, (op & SLJIT_32) ? sse2_buffer : sse2_buffer + 8));
+		FAIL_IF(emit_groupf(compiler, XORPD_x_xm | EX86_SELECT_66(op) | EX86_SSE2, TMP_FREG, SLJIT_MEM1(TMP_REG1), 0));
 		break;
 
 	case SLJIT_ABS_F64:
-		FAIL_IF(emit_groupf(compiler, ANDPD_x_xm | EX86_SELECT_66(op) | EX86_SSE2, TMP_FREG, SLJIT_MEM0(), (sljit_sw)((op & SLJIT_32) ? sse2_buffer + 4 : sse2_buffer + 12)));
+		FAIL_IF(emit_static_addr(compiler, TMP_REG1, (op & SLJIT_32) ? sse2_buffer + 4 : sse2_buffer + 12));
+		FAIL_IF(emit_groupf(compiler, ANDPD_x_xm | EX86_SELECT_66(op) | EX86_SSE2, TMP_FREG, SLJIT_MEM1(TMP_REG1), 0));
 		break;
 	}
 
@@ -3424,7 +3602,8 @@ SLJIT_API_FUNC_ATTRIBUTE sljit_s32 sljit_emit_fop2r(struct sljit_compiler *compi
 		FAIL_IF(emit_sse2_load(compiler, op & SLJIT_32, TMP_FREG, src2, src2w));
 		pref = EX86_SELECT_66(op) | EX86_SSE2;
 		FAIL_IF(emit_groupf(compiler, XORPD_x_xm | pref, TMP_FREG, src1, src1w));
-		FAIL_IF(emit_groupf(compiler, ANDPD_x_xm | pref, TMP_FREG, SLJIT_MEM0(), (sljit_sw)((op & SLJIT_32) ? sse2_buffer : sse2_buffer + 8)));
+		FAIL_IF(emit_static_addr(compiler, TMP_REG1, (op & SLJIT_32) ? sse2_buffer : sse2_buffer + 8));
+		FAIL_IF(emit_groupf(compiler, ANDPD_x_xm | pref, TMP_FREG, SLJIT_MEM1(TMP_REG1), 0));
 		return emit_groupf(compiler, XORPD_x_xm | pref, dst_freg, TMP_FREG, 0);
 	}
 
@@ -3439,7 +3618,8 @@ SLJIT_API_FUNC_ATTRIBUTE sljit_s32 sljit_emit_fop2r(struct sljit_compiler *compi
 
 	pref = EX86_SELECT_66(op) | EX86_SSE2;
 	FAIL_IF(emit_groupf(compiler, XORPD_x_xm | pref, dst_freg, src1, src1w));
-	FAIL_IF(emit_groupf(compiler, ANDPD_x_xm | pref, dst_freg, SLJIT_MEM0(), (sljit_sw)((op & SLJIT_32) ? sse2_buffer : sse2_buffer + 8)));
+	FAIL_IF(emit_static_addr(compiler, TMP_REG1, (op & SLJIT_32) ? sse2_buffer : sse2_buffer + 8));
+	FAIL_IF(emit_groupf(compiler, ANDPD_x_xm | pref, dst_freg, SLJIT_MEM1(TMP_REG1), 0));
 	return emit_groupf(compiler, XORPD_x_xm | pref, dst_freg, src1, src1w);
 }
 
@@ -4759,6 +4939,123 @@ static sljit_s32 emit_simd_mov(struct sljit_compiler *compiler, sljit_s32 type,
 	return emit_groupf(compiler, op, dst_freg, src_freg, 0);
 }
 
+/* Computes dst_freg = src1_freg op src2_freg. The src1_freg cannot be TMP_FREG. */
+static sljit_s32 emit_simd_op2_regs(struct sljit_compiler *compiler, sljit_uw op,
+	sljit_s32 dst_freg, sljit_s32 src1_freg, sljit_s32 src2_freg, sljit_s32 use_vex)
+{
+	SLJIT_ASSERT(src1_freg != TMP_FREG);
+
+	if (use_vex)
+		return emit_vex_instruction(compiler, op | EX86_SSE2 | VEX_SSE2_OPV, dst_freg, src1_freg, src2_freg, 0);
+
+	if (dst_freg != src1_freg) {
+		if (dst_freg == src2_freg) {
+			FAIL_IF(emit_simd_mov(compiler, SLJIT_SIMD_REG_128, TMP_FREG, src2_freg));
+			src2_freg = TMP_FREG;
+		}
+
+		FAIL_IF(emit_simd_mov(compiler, SLJIT_SIMD_REG_128, dst_freg, src1_freg));
+	}
+
+	if (op & (VEX_OP_0F38 | VEX_OP_0F3A))
+		return emit_groupf_ext(compiler, op | EX86_SSE2, dst_freg, src2_freg, 0);
+	return emit_groupf(compiler, op | EX86_SSE2, dst_freg, src2_freg, 0);
+}
+
+/* The opcode_ext is 2 for logical right, 4 for arithmetic right, and 6 for left shift. */
+static sljit_s32 emit_simd_shift_imm(struct sljit_compiler *compiler, sljit_s32 reg_size, sljit_s32 elem_size,
+	sljit_u8 opcode_ext, sljit_s32 dst_freg, sljit_s32 src_freg, sljit_sw imm, sljit_s32 use_vex)
+{
+	sljit_u8 *inst;
+	/* Same as PSLLD_x_i8 / PSLLQ_x_i8 */
+	sljit_u8 op = U8(PSLLW_x_i8 + elem_size - 1);
+
+	SLJIT_ASSERT(elem_size >= 1 && elem_size <= 3);
+
+	if (reg_size == 5 || use_vex) {
+		/* The emit_vex_instruction does not support opcode extensions. */
+		inst = (sljit_u8*)ensure_buf(compiler, 1 + 6);
+		FAIL_IF(!inst);
+		INC_SIZE(6);
+
+		inst[0] = 0xc4;
+		inst[1] = (freg_map[src_freg] >= 8) ? 0xc1 : 0xe1;
+		inst[2] = U8(((freg_map[dst_freg] ^ 0xf) << 3) | (reg_size == 5 ? 0x4 : 0) | 0x1);
+		inst[3] = op;
+		inst[4] = U8(MOD_REG | (opcode_ext << 3) | (freg_map[src_freg] & 0x7));
+		inst[5] = U8(imm);
+		return SLJIT_SUCCESS;
+	}
+
+	if (dst_freg != src_freg)
+		FAIL_IF(emit_simd_mov(compiler, SLJIT_SIMD_REG_128, dst_freg, src_freg));
+
+	inst = emit_x86_instruction(compiler, 2 | EX86_PREF_66 | EX86_SSE2_OP2, 0, 0, dst_freg, 0);
+	FAIL_IF(!inst);
+	inst[0] = GROUP_0F;
+	inst[1] = op;
+	inst[2] |= U8(opcode_ext << 3);
+	return emit_byte(compiler, U8(imm));
+}
+
+/* Concatenates the even (is_hi == 0) or odd (is_hi != 0)
+   numbered elements of src1_freg and src2_freg. */
+static sljit_s32 emit_simd_unzip(struct sljit_compiler *compiler, sljit_s32 elem_size, sljit_s32 is_hi,
+	sljit_s32 dst_freg, sljit_s32 src1_freg, sljit_s32 src2_freg, sljit_s32 use_vex)
+{
+	sljit_sw shift = 8 << elem_size;
+
+	if (elem_size == 3)
+		return emit_simd_op2_regs(compiler, (is_hi ? PUNPCKHQDQ_x_xm : PUNPCKLQDQ_x_xm) | EX86_PREF_66, dst_freg, src1_freg, src2_freg, use_vex);
+
+	if (elem_size == 2) {
+		FAIL_IF(emit_simd_op2_regs(compiler, SHUFPS_x_xm, dst_freg, src1_freg, src2_freg, use_vex));
+		return emit_byte(compiler, is_hi ? 0xdd : 0x88);
+	}
+
+	/* The selected elements are sign extended to double size, so
+	   the signed saturation of the pack does not change them. */
+	if (!is_hi) {
+		FAIL_IF(emit_simd_shift_imm(compiler, 4, elem_size + 1, 6, TMP_FREG, src2_freg, shift, use_vex));
+		FAIL_IF(emit_simd_shift_imm(compiler, 4, elem_size + 1, 4, TMP_FREG, TMP_FREG, shift, use_vex));
+		FAIL_IF(emit_simd_shift_imm(compiler, 4, elem_size + 1, 6, dst_freg, src1_freg, shift, use_vex));
+		src1_freg = dst_freg;
+	} else
+		FAIL_IF(emit_simd_shift_imm(compiler, 4, elem_size + 1, 4, TMP_FREG, src2_freg, shift, use_vex));
+
+	FAIL_IF(emit_simd_shift_imm(compiler, 4, elem_size + 1, 4, dst_freg, src1_freg, shift, use_vex));
+	return emit_simd_op2_regs(compiler, (elem_size == 0 ? PACKSSWB_x_xm : PACKSSDW_x_xm) | EX86_PREF_66, dst_freg, dst_freg, TMP_FREG, use_vex);
+}
+
+static sljit_s32 emit_simd_permute(struct sljit_compiler *compiler, sljit_s32 type,
+	sljit_s32 dst_freg, sljit_s32 src1_freg, sljit_s32 src2, sljit_sw src2w, sljit_s32 use_vex)
+{
+	sljit_s32 elem_size = SLJIT_SIMD_GET_ELEM_SIZE(type);
+	sljit_uw op;
+
+	if (src2 & SLJIT_MEM) {
+		op = MOVDQU_x_xm | EX86_PREF_F3 | EX86_SSE2;
+		if (use_vex)
+			FAIL_IF(emit_vex_instruction(compiler, op, TMP_FREG, 0, src2, src2w));
+		else
+			FAIL_IF(emit_groupf(compiler, op, TMP_FREG, src2, src2w));
+
+		src2 = TMP_FREG;
+	}
+
+	switch (SLJIT_SIMD_GET_OPCODE(type)) {
+	case SLJIT_SIMD_OP2_ZIP_LO:
+		op = (elem_size == 3) ? PUNPCKLQDQ_x_xm : (sljit_uw)(PUNPCKLBW_x_xm + elem_size);
+		return emit_simd_op2_regs(compiler, op | EX86_PREF_66, dst_freg, src1_freg, src2, use_vex);
+	case SLJIT_SIMD_OP2_ZIP_HI:
+		op = (elem_size == 3) ? PUNPCKHQDQ_x_xm : (sljit_uw)(PUNPCKHBW_x_xm + elem_size);
+		return emit_simd_op2_regs(compiler, op | EX86_PREF_66, dst_freg, src1_freg, src2, use_vex);
+	}
+
+	return emit_simd_unzip(compiler, elem_size, SLJIT_SIMD_GET_OPCODE(type) == SLJIT_SIMD_OP2_UNZIP_HI,
+		dst_freg, src1_freg, src2, use_vex);
+}
+
 SLJIT_API_FUNC_ATTRIBUTE sljit_s32 sljit_emit_simd_op2(struct sljit_compiler *compiler, sljit_s32 type,
 	sljit_s32 dst_freg, sljit_s32 src1_freg, sljit_s32 src2, sljit_sw src2w)
 {
@@ -4811,6 +5108,26 @@ SLJIT_API_FUNC_ATTRIBUTE sljit_s32 sljit_emit_simd_op2(struct sljit_compiler *co
 
 		op = PSHUFB_x_xm | EX86_PREF_66 | VEX_OP_0F38;
 		break;
+	case SLJIT_SIMD_OP2_CMP_EQ:
+		if (elem_size == 3) {
+			if (!(cpu_feature_list & CPU_FEATURE_SSE41))
+				return SLJIT_ERR_UNSUPPORTED;
+
+			op = PCMPEQQ_x_xm | EX86_PREF_66 | VEX_OP_0F38;
+			break;
+		}
+
+		op = (sljit_uw)(PCMPEQB_x_xm + elem_size) | EX86_PREF_66;
+		break;
+	default:
+		/* The 256 bit forms operate on 128 bit lanes. */
+		if (reg_size != 4)
+			return SLJIT_ERR_UNSUPPORTED;
+
+		if (type & SLJIT_SIMD_TEST)
+			return SLJIT_SUCCESS;
+
+		return emit_simd_permute(compiler, type, dst_freg, src1_freg, src2, src2w, use_vex);
 	}
 
 	if (type & SLJIT_SIMD_TEST)
@@ -4852,6 +5169,238 @@ SLJIT_API_FUNC_ATTRIBUTE sljit_s32 sljit_emit_simd_op2(struct sljit_compiler *co
 	return emit_groupf(compiler, op | EX86_SSE2, dst_freg, src2, src2w);
 }
 
+SLJIT_API_FUNC_ATTRIBUTE sljit_s32 sljit_emit_simd_shift(struct sljit_compiler *compiler, sljit_s32 type,
+	sljit_s32 dst_freg, sljit_s32 src1_freg, sljit_s32 src2, sljit_sw src2w)
+{
+	sljit_s32 reg_size = SLJIT_SIMD_GET_REG_SIZE(type);
+	sljit_s32 elem_size = SLJIT_SIMD_GET_ELEM_SIZE(type);
+	sljit_s32 use_vex = (cpu_feature_list & CPU_FEATURE_AVX) && (compiler->options & SLJIT_ENTER_USE_VEX);
+	sljit_uw op;
+	sljit_u8 opcode_ext;
+
+	CHECK_ERROR();
+	CHECK(check_sljit_emit_simd_shift(compiler, type, dst_freg, src1_freg, src2, src2w));
+
+#if (defined SLJIT_CONFIG_X86_64 && SLJIT_CONFIG_X86_64)
+	compiler->mode32 = 1;
+#endif /* SLJIT_CONFIG_X86_64 */
+
+	if (reg_size == 5) {
+		if (!(cpu_feature_list & CPU_FEATURE_AVX2))
+			return SLJIT_ERR_UNSUPPORTED;
+	} else if (reg_size != 4)
+		return SLJIT_ERR_UNSUPPORTED;
+
+	/* There are no 8 bit shifts, and 64 bit arithmetic shifts need AVX-512. */
+	if (elem_size == 0 || (elem_size == 3 && SLJIT_SIMD_GET_OPCODE(type) == SLJIT_SIMD_SHIFT_ASHR))
+		return SLJIT_ERR_UNSUPPORTED;
+
+	if (src2 != SLJIT_IMM) {
+		if (elem_size < 2 || !(cpu_feature_list & CPU_FEATURE_AVX2))
+			return SLJIT_ERR_UNSUPPORTED;
+
+		if (type & SLJIT_SIMD_TEST)
+			return SLJIT_SUCCESS;
+
+		switch (SLJIT_SIMD_GET_OPCODE(type)) {
+		case SLJIT_SIMD_SHIFT_SHL:
+			op = VPSLLVD_x_xm;
+			break;
+		case SLJIT_SIMD_SHIFT_LSHR:
+			op = VPSRLVD_x_xm;
+			break;
+		default:
+			op = VPSRAVD_x_xm;
+			break;
+		}
+
+		op |= EX86_PREF_66 | VEX_OP_0F38 | EX86_SSE2 | VEX_SSE2_OPV;
+
+		if (elem_size == 3)
+			op |= VEX_W;
+		if (reg_size == 5)
+			op |= VEX_256;
+
+		return emit_vex_instruction(compiler, op, dst_freg, src1_freg, src2, 0);
+	}
+
+	if (type & SLJIT_SIMD_TEST)
+		return SLJIT_SUCCESS;
+
+	switch (SLJIT_SIMD_GET_OPCODE(type)) {
+	case SLJIT_SIMD_SHIFT_SHL:
+		opcode_ext = 6;
+		break;
+	case SLJIT_SIMD_SHIFT_LSHR:
+		opcode_ext = 2;
+		break;
+	default:
+		opcode_ext = 4;
+		break;
+	}
+
+	return emit_simd_shift_imm(compiler, reg_size, elem_size, opcode_ext, dst_freg, src1_freg, src2w, use_vex);
+}
+
+SLJIT_API_FUNC_ATTRIBUTE sljit_s32 sljit_emit_simd_narrow(struct sljit_compiler *compiler, sljit_s32 type,
+	sljit_s32 dst_freg, sljit_s32 src1_freg, sljit_s32 src2_freg)
+{
+	sljit_s32 reg_size = SLJIT_SIMD_GET_REG_SIZE(type);
+	sljit_s32 elem_size = SLJIT_SIMD_GET_ELEM_SIZE(type);
+	sljit_s32 use_vex = (cpu_feature_list & CPU_FEATURE_AVX) && (compiler->options & SLJIT_ENTER_USE_VEX);
+	sljit_uw op;
+
+	CHECK_ERROR();
+	CHECK(check_sljit_emit_simd_narrow(compiler, type, dst_freg, src1_freg, src2_freg));
+
+#if (defined SLJIT_CONFIG_X86_64 && SLJIT_CONFIG_X86_64)
+	compiler->mode32 = 1;
+#endif /* SLJIT_CONFIG_X86_64 */
+
+	/* The 256 bit forms operate on 128 bit lanes. */
+	if (reg_size != 4)
+		return SLJIT_ERR_UNSUPPORTED;
+
+	if (!(type & (SLJIT_SIMD_NARROW_SIGNED_SAT | SLJIT_SIMD_NARROW_UNSIGNED_SAT))) {
+		if (type & SLJIT_SIMD_TEST)
+			return SLJIT_SUCCESS;
+
+		/* Little endian: the lower half of each element is the even numbered element. */
+		return emit_simd_unzip(compiler, elem_size - 1, 0, dst_freg, src1_freg, src2_freg, use_vex);
+	}
+
+	if (elem_size == 3)
+		return SLJIT_ERR_UNSUPPORTED;
+
+	if (type & SLJIT_SIMD_NARROW_SIGNED_SAT)
+		op = (elem_size == 1) ? PACKSSWB_x_xm : PACKSSDW_x_xm;
+	else if (elem_size == 1)
+		op = PACKUSWB_x_xm;
+	else {
+		if (!(cpu_feature_list & CPU_FEATURE_SSE41))
+			return SLJIT_ERR_UNSUPPORTED;
+
+		op = PACKUSDW_x_xm | VEX_OP_0F38;
+	}
+
+	if (type & SLJIT_SIMD_TEST)
+		return SLJIT_SUCCESS;
+
+	return emit_simd_op2_regs(compiler, op | EX86_PREF_66, dst_freg, src1_freg, src2_freg, use_vex);
+}
+
+/* The VSIB addressing form is not supported by emit_x86_instruction. */
+static sljit_s32 emit_vgather(struct sljit_compiler *compiler, sljit_s32 type,
+	sljit_s32 freg, sljit_s32 index_freg,
+	sljit_s32 base, sljit_sw disp)
+{
+	sljit_s32 reg_size = SLJIT_SIMD_GET_REG_SIZE(type);
+	sljit_s32 elem_size = SLJIT_SIMD_GET_ELEM_SIZE(type);
+	sljit_u8 *inst;
+	sljit_u8 base_bits = 0x5;
+	sljit_u8 mod = 0;
+	sljit_uw size = 6;
+	/* Inverted R, X, B bits and the 0F38 opcode map. */
+	sljit_u8 vex = 0xe2;
+
+#if (defined SLJIT_CONFIG_X86_64 && SLJIT_CONFIG_X86_64)
+	if (freg_map[freg] >= 8)
+		vex &= (sljit_u8)~0x80;
+	if (freg_map[index_freg] >= 8)
+		vex &= (sljit_u8)~0x40;
+	if (base != 0) {
+		if (reg_map[base] >= 8)
+			vex &= (sljit_u8)~0x20;
+		base_bits = reg_lmap[base];
+	}
+#else /* !SLJIT_CONFIG_X86_64 */
+	if (base != 0)
+		base_bits = reg_map[base];
+#endif /* SLJIT_CONFIG_X86_64 */
+
+	if (base == 0)
+		size += 4;
+	else if (disp != 0 || base_bits == 0x5) {
+		if (disp <= 127 && disp >= -128) {
+			mod = MOD_DISP8;
+			size += 1;
+		} else {
+			mod = 0x80;
+			size += 4;
+		}
+	}
+
+	/* All mask bits are set. */
+	FAIL_IF(emit_vex_instruction(compiler, PCMPEQD_x_xm | (reg_size == 5 ? VEX_256 : 0) | EX86_PREF_66 | EX86_SSE2 | VEX_SSE2_OPV, TMP_FREG, TMP_FREG, TMP_FREG, 0));
+
+	inst = (sljit_u8*)ensure_buf(compiler, 1 + size);
+	FAIL_IF(!inst);
+	INC_SIZE(size);
+
+	inst[0] = 0xc4;
+	inst[1] = vex;
+	inst[2] = U8(((elem_size == 3) ? 0x80 : 0) | ((freg_map[TMP_FREG] ^ 0xf) << 3) | (reg_size == 5 ? 0x4 : 0) | 0x1);
+	/* VPGATHERDD / VPGATHERQQ / VGATHERDPS / VGATHERQPD */
+	inst[3] = U8(((elem_size == 3) ? 0x91 : 0x90) | ((type & SLJIT_SIMD_FLOAT) ? 0x2 : 0));
+	inst[4] = U8(mod | ((freg_map[freg] & 0x7) << 3) | 0x4);
+	inst[5] = U8((SLJIT_SIMD_GET_ELEM2_SIZE(type) << 6) | ((freg_map[index_freg] & 0x7) << 3) | base_bits);
+
+	if (size == 7)
+		inst[6] = U8(disp);
+	else if (size == 10)
+		sljit_unaligned_store_s32(inst + 6, (sljit_s32)disp);
+	return SLJIT_SUCCESS;
+}
+
+SLJIT_API_FUNC_ATTRIBUTE sljit_s32 sljit_emit_simd_gather(struct sljit_compiler *compiler, sljit_s32 type,
+	sljit_s32 freg, sljit_s32 index_freg,
+	sljit_s32 mem, sljit_sw memw)
+{
+	sljit_s32 reg_size = SLJIT_SIMD_GET_REG_SIZE(type);
+	sljit_s32 base = mem & REG_MASK;
+#if (defined SLJIT_CONFIG_X86_32 && SLJIT_CONFIG_X86_32)
+	sljit_sw basew = 0;
+#endif /* SLJIT_CONFIG_X86_32 */
+
+	CHECK_ERROR();
+	CHECK(check_sljit_emit_simd_gather(compiler, type, freg, index_freg, mem, memw));
+
+#if (defined SLJIT_CONFIG_X86_64 && SLJIT_CONFIG_X86_64)
+	compiler->mode32 = 1;
+#endif /* SLJIT_CONFIG_X86_64 */
+
+	if (reg_size == 5) {
+		if (!(cpu_feature_list & CPU_FEATURE_AVX2))
+			return SLJIT_ERR_UNSUPPORTED;
+	} else if (reg_size != 4)
+		return SLJIT_ERR_UNSUPPORTED;
+
+	/* AVX2 has no scatter instructions, and the destination
+	   register of a gather must differ from its index register. */
+	if ((type & SLJIT_SIMD_STORE) || !(cpu_feature_list & CPU_FEATURE_AVX2) || freg == index_freg
+#if (defined SLJIT_CONFIG_X86_64 && SLJIT_CONFIG_X86_64)
+			|| !IS_HALFWORD(memw)
+#endif /* SLJIT_CONFIG_X86_64 */
+			)
+		return sljit_emit_simd_mem_lanes(compiler, type, freg, index_freg, mem, memw, TMP_REG1);
+
+	if (type & SLJIT_SIMD_TEST)
+		return SLJIT_SUCCESS;
+
+#if (defined SLJIT_CONFIG_X86_32 && SLJIT_CONFIG_X86_32)
+	if (base != 0) {
+		CHECK_EXTRA_REGS(base, basew, (void)0);
+
+		if (base & SLJIT_MEM) {
+			EMIT_MOV(compiler, TMP_REG1, 0, base, basew);
+			base = TMP_REG1;
+		}
+	}
+#endif /* SLJIT_CONFIG_X86_32 */
+
+	return emit_vgather(compiler, type, freg, index_freg, base, memw);
+}
+
 SLJIT_API_FUNC_ATTRIBUTE sljit_s32 sljit_emit_atomic_load(struct sljit_compiler *compiler, sljit_s32 op,
 	sljit_s32 dst_reg,
 	sljit_s32 mem_reg)
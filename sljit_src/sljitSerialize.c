@@ -41,49 +41,6 @@ SLJIT_API_FUNC_ATTRIBUTE sljit_s32 sljit_jump_is_mov_addr(struct sljit_jump *jum
 
 #define SLJIT_SERIALIZE_DEBUG ((sljit_u16)0x1)
 
-struct sljit_serialized_compiler {
-	sljit_u32 signature;
-	sljit_u16 version;
-	sljit_u16 cpu_type;
-
-	sljit_uw buf_segment_count;
-	sljit_uw label_count;
-	sljit_uw jump_count;
-	sljit_uw const_count;
-
-	sljit_s32 options;
-	sljit_s32 scratches;
-	sljit_s32 saveds;
-	sljit_s32 fscratches;
-	sljit_s32 fsaveds;
-	sljit_s32 local_size;
-	sljit_uw size;
-
-#if (defined SLJIT_HAS_STATUS_FLAGS_STATE && SLJIT_HAS_STATUS_FLAGS_STATE)
-	sljit_s32 status_flags_state;
-#endif /* SLJIT_HAS_STATUS_FLAGS_STATE */
-
-#if (defined SLJIT_CONFIG_X86_32 && SLJIT_CONFIG_X86_32)
-	sljit_s32 args_size;
-#endif /* SLJIT_CONFIG_X86_32 */
-
-#if ((defined SLJIT_CONFIG_ARM_32 && SLJIT_CONFIG_ARM_32) && (defined __SOFTFP__)) \
-		|| (defined SLJIT_CONFIG_MIPS_32 && SLJIT_CONFIG_MIPS_32)
-	sljit_uw args_size;
-#endif /* (SLJIT_CONFIG_ARM_32 && __SOFTFP__) || SLJIT_CONFIG_MIPS_32 */
-
-#if (defined SLJIT_CONFIG_ARM_V6 && SLJIT_CONFIG_ARM_V6)
-	sljit_uw cpool_diff;
-	sljit_uw cpool_fill;
-	sljit_uw patches;
-#endif /* SLJIT_CONFIG_ARM_V6 */
-
-#if (defined SLJIT_CONFIG_MIPS && SLJIT_CONFIG_MIPS)
-	sljit_s32 delay_slot;
-#endif /* SLJIT_CONFIG_MIPS */
-
-};
-
 struct sljit_serialized_debug_info {
 	sljit_sw last_flags;
 	sljit_s32 last_return;
@@ -112,6 +69,418 @@ struct sljit_serialized_const {
 #endif /* SLJIT_LITTLE_ENDIAN */
 #define SLJIT_SERIALIZE_VERSION 1
 
+/* Compact encoding
+     The header is followed by the byte size of the payload (a word), and
+     the payload, which is optionally compressed. The payload contains the
+     same data as the default encoding in the same order, except:
+       - fragments: used_size (varint), followed by the unpadded data
+       - labels: size (delta varint)
+       - jumps: addr (delta varint), flags (varint), and the value,
+           which is a target (varint) or a label index + 1 (varint, 0: no label)
+       - consts: addr (delta varint)
+     The remaining bytes (debug info) are copied unchanged. Delta values
+     are differences from the previous record stored as signed varints. */
+#define SLJIT_SERIALIZE_COMPACT_VERSION 2
+/* The payload is compressed (stored in cpu_type). */
+#define SLJIT_SERIALIZE_COMPRESSED ((sljit_u16)0x2)
+
+#define SLJIT_SERIALIZE_MAX_VARINT ((sizeof(sljit_uw) * 8 + 6) / 7)
+
+/* Compression: sequences of a literal count (varint), the literals, a match
+   length (varint) and a match offset (varint). The last sequence has no match. */
+#define SLJIT_COMPRESS_HASH_BITS 12
+#define SLJIT_COMPRESS_MIN_MATCH 4
+/* Limits the size of the decompressed data (see serialize_expand). */
+#define SLJIT_COMPRESS_MAX_MATCH 0x3fff
+#define SLJIT_COMPRESS_HASH(ptr) \
+	((((sljit_u32)(ptr)[0] | ((sljit_u32)(ptr)[1] << 8) | ((sljit_u32)(ptr)[2] << 16) | ((sljit_u32)(ptr)[3] << 24)) \
+		* 2654435761u) >> (32 - SLJIT_COMPRESS_HASH_BITS))
+
+/* When dst is NULL, only the size is computed. */
+static sljit_uw serialize_put_varint(sljit_u8 *dst, sljit_uw value)
+{
+	sljit_uw size = 1;
+
+	while (value >= 0x80) {
+		if (dst != NULL)
+			*dst++ = (sljit_u8)(value | 0x80);
+		value >>= 7;
+		size++;
+	}
+
+	if (dst != NULL)
+		*dst = (sljit_u8)value;
+	return size;
+}
+
+/* Returns with 0 if the data is truncated or the value is too large. */
+static sljit_uw serialize_get_varint(sljit_u8 **ptr, sljit_u8 *end, sljit_uw *value)
+{
+	sljit_u8 *src = *ptr;
+	sljit_uw shift = 0;
+	sljit_uw result = 0;
+
+	do {
+		if (src >= end || shift >= sizeof(sljit_uw) * 8)
+			return 0;
+		result |= (sljit_uw)(*src & 0x7f) << shift;
+		shift += 7;
+	} while (*src++ & 0x80);
+
+	*value = result;
+	*ptr = src;
+	return 1;
+}
+
+/* Signed differences are stored as ((diff << 1) ^ sign). */
+#define SLJIT_SERIALIZE_DELTA(value, prev) \
+	((value) >= (prev) ? ((value) - (prev)) << 1 : (((prev) - (value)) << 1) - 1)
+#define SLJIT_SERIALIZE_UNDELTA(delta, prev) \
+	(((delta) & 0x1) ? (prev) - (((delta) >> 1) + 1) : (prev) + ((delta) >> 1))
+
+/* Converts a buffer of the default encoding (which is already checked) to
+   the compact payload. When dst is NULL, only the size is computed. */
+static sljit_uw serialize_compact_payload(sljit_u8 *src, sljit_u8 *src_end, sljit_u8 *dst)
+{
+	struct sljit_serialized_compiler *serialized_compiler = (struct sljit_serialized_compiler*)src;
+	struct sljit_serialized_label *serialized_label;
+	struct sljit_serialized_jump *serialized_jump;
+	struct sljit_serialized_const *serialized_const;
+	sljit_uw i, used_size, prev, value, size = 0;
+
+	src += sizeof(struct sljit_serialized_compiler);
+
+#if (defined SLJIT_CONFIG_ARM_V6 && SLJIT_CONFIG_ARM_V6)
+	used_size = serialized_compiler->cpool_fill * (sizeof(sljit_uw) + 1);
+	if (dst != NULL)
+		SLJIT_MEMCPY(dst, src, used_size);
+	size += used_size;
+	src += SLJIT_SERIALIZE_ALIGN(used_size);
+#endif /* SLJIT_CONFIG_ARM_V6 */
+
+	for (i = serialized_compiler->buf_segment_count; i > 0; i--) {
+		used_size = *(sljit_uw*)src;
+		size += serialize_put_varint(dst ? dst + size : NULL, used_size);
+		if (dst != NULL)
+			SLJIT_MEMCPY(dst + size, src + sizeof(sljit_uw), used_size);
+		size += used_size;
+		src += sizeof(sljit_uw) + SLJIT_SERIALIZE_ALIGN(used_size);
+	}
+
+	prev = 0;
+	for (i = serialized_compiler->label_count; i > 0; i--) {
+		serialized_label = (struct sljit_serialized_label*)src;
+		size += serialize_put_varint(dst ? dst + size : NULL, SLJIT_SERIALIZE_DELTA(serialized_label->size, prev));
+		prev = serialized_label->size;
+		src += sizeof(struct sljit_serialized_label);
+	}
+
+	prev = 0;
+	for (i = serialized_compiler->jump_count; i > 0; i--) {
+		serialized_jump = (struct sljit_serialized_jump*)src;
+		size += serialize_put_varint(dst ? dst + size : NULL, SLJIT_SERIALIZE_DELTA(serialized_jump->addr, prev));
+		size += serialize_put_varint(dst ? dst + size : NULL, serialized_jump->flags);
+		prev = serialized_jump->addr;
+
+		value = serialized_jump->value;
+		if (!(serialized_jump->flags & JUMP_ADDR))
+			value = (value == SLJIT_MAX_ADDRESS) ? 0 : value + 1;
+		size += serialize_put_varint(dst ? dst + size : NULL, value);
+		src += sizeof(struct sljit_serialized_jump);
+	}
+
+	prev = 0;
+	for (i = serialized_compiler->const_count; i > 0; i--) {
+		serialized_const = (struct sljit_serialized_const*)src;
+		size += serialize_put_varint(dst ? dst + size : NULL, SLJIT_SERIALIZE_DELTA(serialized_const->addr, prev));
+		prev = serialized_const->addr;
+		src += sizeof(struct sljit_serialized_const);
+	}
+
+	used_size = (sljit_uw)(src_end - src);
+	if (dst != NULL)
+		SLJIT_MEMCPY(dst + size, src, used_size);
+	return size + used_size;
+}
+
+/* Inverse of serialize_compact_payload. Returns with the size of the
+   default encoding, or 0 if the payload is invalid. When dst is NULL,
+   only the size is computed (and the payload is checked). */
+static sljit_uw serialize_expand_payload(struct sljit_serialized_compiler *serialized_compiler,
+	sljit_u8 *src, sljit_u8 *src_end, sljit_u8 *dst)
+{
+	struct sljit_serialized_label *serialized_label;
+	struct sljit_serialized_jump *serialized_jump;
+	struct sljit_serialized_const *serialized_const;
+	sljit_uw i, used_size, prev, value, flags;
+	sljit_uw size = sizeof(struct sljit_serialized_compiler);
+
+	if (dst != NULL)
+		SLJIT_MEMCPY(dst, serialized_compiler, sizeof(struct sljit_serialized_compiler));
+
+#if (defined SLJIT_CONFIG_ARM_V6 && SLJIT_CONFIG_ARM_V6)
+	used_size = serialized_compiler->cpool_fill * (sizeof(sljit_uw) + 1);
+	if ((sljit_uw)(src_end - src) < used_size)
+		return 0;
+	if (dst != NULL)
+		SLJIT_MEMCPY(dst + size, src, used_size);
+	src += used_size;
+	size += SLJIT_SERIALIZE_ALIGN(used_size);
+#endif /* SLJIT_CONFIG_ARM_V6 */
+
+	for (i = serialized_compiler->buf_segment_count; i > 0; i--) {
+		if (!serialize_get_varint(&src, src_end, &used_size) || used_size > BUF_SIZE
+				|| (sljit_uw)(src_end - src) < used_size)
+			return 0;
+		if (dst != NULL) {
+			*(sljit_uw*)(dst + size) = used_size;
+			SLJIT_MEMCPY(dst + size + sizeof(sljit_uw), src, used_size);
+		}
+		src += used_size;
+		size += sizeof(sljit_uw) + SLJIT_SERIALIZE_ALIGN(used_size);
+	}
+
+	prev = 0;
+	for (i = serialized_compiler->label_count; i > 0; i--) {
+		if (!serialize_get_varint(&src, src_end, &value))
+			return 0;
+		prev = SLJIT_SERIALIZE_UNDELTA(value, prev);
+		if (dst != NULL) {
+			serialized_label = (struct sljit_serialized_label*)(dst + size);
+			serialized_label->size = prev;
+		}
+		size += sizeof(struct sljit_serialized_label);
+	}
+
+	prev = 0;
+	for (i = serialized_compiler->jump_count; i > 0; i--) {
+		if (!serialize_get_varint(&src, src_end, &value) || !serialize_get_varint(&src, src_end, &flags))
+			return 0;
+		prev = SLJIT_SERIALIZE_UNDELTA(value, prev);
+		if (!serialize_get_varint(&src, src_end, &value))
+			return 0;
+		if (!(flags & JUMP_ADDR))
+			value = (value == 0) ? SLJIT_MAX_ADDRESS : value - 1;
+
+		if (dst != NULL) {
+			serialized_jump = (struct sljit_serialized_jump*)(dst + size);
+			serialized_jump->addr = prev;
+			serialized_jump->flags = flags;
+			serialized_jump->value = value;
+		}
+		size += sizeof(struct sljit_serialized_jump);
+	}
+
+	prev = 0;
+	for (i = serialized_compiler->const_count; i > 0; i--) {
+		if (!serialize_get_varint(&src, src_end, &value))
+			return 0;
+		prev = SLJIT_SERIALIZE_UNDELTA(value, prev);
+		if (dst != NULL) {
+			serialized_const = (struct sljit_serialized_const*)(dst + size);
+			serialized_const->addr = prev;
+		}
+		size += sizeof(struct sljit_serialized_const);
+	}
+
+	used_size = (sljit_uw)(src_end - src);
+	if (used_size != SLJIT_SERIALIZE_ALIGN(used_size))
+		return 0;
+	if (dst != NULL)
+		SLJIT_MEMCPY(dst + size, src, used_size);
+	return size + used_size;
+}
+
+/* Returns with the compressed size, or 0 if the data cannot be compressed into dst_size bytes. */
+static sljit_uw serialize_compress(sljit_u8 *src, sljit_uw size, sljit_u8 *dst, sljit_uw dst_size, sljit_uw *hash_table)
+{
+	sljit_u8 *dst_end = dst + dst_size;
+	sljit_u8 *dst_start = dst;
+	sljit_uw literal_start = 0, pos = 0;
+	sljit_uw i, hash, match, length;
+
+	for (i = 0; i < ((sljit_uw)1 << SLJIT_COMPRESS_HASH_BITS); i++)
+		hash_table[i] = SLJIT_MAX_ADDRESS;
+
+	while (pos + SLJIT_COMPRESS_MIN_MATCH <= size) {
+		hash = SLJIT_COMPRESS_HASH(src + pos);
+		match = hash_table[hash];
+		hash_table[hash] = pos;
+
+		if (match == SLJIT_MAX_ADDRESS || src[match] != src[pos] || src[match + 1] != src[pos + 1]
+				|| src[match + 2] != src[pos + 2] || src[match + 3] != src[pos + 3]) {
+			pos++;
+			continue;
+		}
+
+		length = SLJIT_COMPRESS_MIN_MATCH;
+		while (pos + length < size && length < SLJIT_COMPRESS_MAX_MATCH && src[match + length] == src[pos + length])
+			length++;
+
+		if ((sljit_uw)(dst_end - dst) < 3 * SLJIT_SERIALIZE_MAX_VARINT + (pos - literal_start))
+			return 0;
+
+		dst += serialize_put_varint(dst, pos - literal_start);
+		SLJIT_MEMCPY(dst, src + literal_start, pos - literal_start);
+		dst += pos - literal_start;
+		dst += serialize_put_varint(dst, length);
+		dst += serialize_put_varint(dst, pos - match);
+
+		pos += length;
+		literal_start = pos;
+	}
+
+	if ((sljit_uw)(dst_end - dst) < SLJIT_SERIALIZE_MAX_VARINT + (size - literal_start))
+		return 0;
+
+	dst += serialize_put_varint(dst, size - literal_start);
+	SLJIT_MEMCPY(dst, src + literal_start, size - literal_start);
+	dst += size - literal_start;
+	return (sljit_uw)(dst - dst_start);
+}
+
+/* Returns with 0 if the data is invalid. */
+static sljit_uw serialize_decompress(sljit_u8 *src, sljit_u8 *src_end, sljit_u8 *dst, sljit_uw size)
+{
+	sljit_u8 *dst_start = dst;
+	sljit_u8 *dst_end = dst + size;
+	sljit_uw length, offset;
+
+	while (dst < dst_end) {
+		if (!serialize_get_varint(&src, src_end, &length) || length > (sljit_uw)(dst_end - dst)
+				|| length > (sljit_uw)(src_end - src))
+			return 0;
+
+		SLJIT_MEMCPY(dst, src, length);
+		src += length;
+		dst += length;
+
+		if (dst >= dst_end)
+			break;
+
+		if (!serialize_get_varint(&src, src_end, &length) || !serialize_get_varint(&src, src_end, &offset)
+				|| length > (sljit_uw)(dst_end - dst) || length > SLJIT_COMPRESS_MAX_MATCH
+				|| offset == 0 || offset > (sljit_uw)(dst - dst_start))
+			return 0;
+
+		/* The source and destination can overlap. */
+		for (; length > 0; length--, dst++)
+			*dst = *(dst - offset);
+	}
+	return 1;
+}
+
+/* Converts a buffer of the default encoding to the compact encoding. */
+static sljit_uw* serialize_compact(sljit_uw *buffer, sljit_uw buffer_size, sljit_s32 options, sljit_uw *size, void *allocator_data)
+{
+	sljit_u8 *src = (sljit_u8*)buffer;
+	sljit_uw payload_size = serialize_compact_payload(src, src + buffer_size, NULL);
+	sljit_uw header_size = sizeof(struct sljit_serialized_compiler) + sizeof(sljit_uw);
+	sljit_uw compressed_size = 0;
+	struct sljit_serialized_compiler *serialized_compiler;
+	sljit_u8 *result;
+	sljit_u8 *payload;
+	sljit_uw *hash_table;
+	SLJIT_UNUSED_ARG(allocator_data);
+
+	result = (sljit_u8*)SLJIT_MALLOC(header_size + SLJIT_SERIALIZE_ALIGN(payload_size), allocator_data);
+	if (result == NULL)
+		return NULL;
+
+	SLJIT_MEMCPY(result, src, sizeof(struct sljit_serialized_compiler));
+	serialized_compiler = (struct sljit_serialized_compiler*)result;
+	serialized_compiler->version = SLJIT_SERIALIZE_COMPACT_VERSION;
+	*(sljit_uw*)(result + sizeof(struct sljit_serialized_compiler)) = payload_size;
+
+	payload = result + header_size;
+
+	if (options & SLJIT_SERIALIZE_COMPRESS) {
+		/* The uncompressed payload is kept when the compression does not reduce its size. */
+		payload = (sljit_u8*)SLJIT_MALLOC(payload_size + ((sljit_uw)sizeof(sljit_uw) << SLJIT_COMPRESS_HASH_BITS), allocator_data);
+		if (payload == NULL) {
+			SLJIT_FREE(result, allocator_data);
+			return NULL;
+		}
+
+		hash_table = (sljit_uw*)payload;
+		payload += (sljit_uw)sizeof(sljit_uw) << SLJIT_COMPRESS_HASH_BITS;
+		serialize_compact_payload(src, src + buffer_size, payload);
+
+		compressed_size = serialize_compress(payload, payload_size, result + header_size, payload_size, hash_table);
+		if (compressed_size == 0)
+			SLJIT_MEMCPY(result + header_size, payload, payload_size);
+		else
+			serialized_compiler->cpu_type |= SLJIT_SERIALIZE_COMPRESSED;
+
+		SLJIT_FREE(hash_table, allocator_data);
+	} else
+		serialize_compact_payload(src, src + buffer_size, payload);
+
+	if (compressed_size != 0)
+		payload_size = compressed_size;
+
+	/* The padding is cleared, so the result does not depend on uninitialized memory. */
+	memset(result + header_size + payload_size, 0, SLJIT_SERIALIZE_ALIGN(payload_size) - payload_size);
+	*size = header_size + SLJIT_SERIALIZE_ALIGN(payload_size);
+	return (sljit_uw*)result;
+}
+
+/* Converts a buffer of the compact encoding to the default encoding. */
+static sljit_uw* serialize_expand(sljit_uw *buffer, sljit_uw buffer_size, sljit_uw *size, void *allocator_data)
+{
+	struct sljit_serialized_compiler *serialized_compiler = (struct sljit_serialized_compiler*)buffer;
+	sljit_uw header_size = sizeof(struct sljit_serialized_compiler) + sizeof(sljit_uw);
+	sljit_u8 *payload = (sljit_u8*)buffer + header_size;
+	sljit_u8 *payload_end;
+	sljit_u8 *decompressed = NULL;
+	sljit_u8 *result = NULL;
+	sljit_uw payload_size, result_size;
+	SLJIT_UNUSED_ARG(allocator_data);
+
+	if (buffer_size < header_size)
+		return NULL;
+
+	payload_size = *(sljit_uw*)((sljit_u8*)buffer + sizeof(struct sljit_serialized_compiler));
+
+	if (serialized_compiler->cpu_type & SLJIT_SERIALIZE_COMPRESSED) {
+		/* Each match is encoded in at least three bytes and produces at most
+		   SLJIT_COMPRESS_MAX_MATCH bytes, and each literal produces one byte.
+		   Larger sizes are rejected before the memory is allocated. */
+		if (payload_size > buffer_size - header_size
+				&& (payload_size - (buffer_size - header_size)) / SLJIT_COMPRESS_MAX_MATCH > (buffer_size - header_size) / 3)
+			return NULL;
+
+		decompressed = (sljit_u8*)SLJIT_MALLOC(payload_size, allocator_data);
+		if (decompressed == NULL)
+			return NULL;
+		if (!serialize_decompress(payload, (sljit_u8*)buffer + buffer_size, decompressed, payload_size)) {
+			SLJIT_FREE(decompressed, allocator_data);
+			return NULL;
+		}
+		payload = decompressed;
+	} else if (payload_size > buffer_size - header_size) {
+		return NULL;
+	}
+
+	payload_end = payload + payload_size;
+	result_size = serialize_expand_payload(serialized_compiler, payload, payload_end, NULL);
+
+	if (result_size != 0)
+		result = (sljit_u8*)SLJIT_MALLOC(result_size, allocator_data);
+
+	if (result != NULL) {
+		serialize_expand_payload(serialized_compiler, payload, payload_end, result);
+		serialized_compiler = (struct sljit_serialized_compiler*)result;
+		serialized_compiler->version = SLJIT_SERIALIZE_VERSION;
+		serialized_compiler->cpu_type &= (sljit_u16)~SLJIT_SERIALIZE_COMPRESSED;
+		*size = result_size;
+	}
+
+	if (decompressed != NULL)
+		SLJIT_FREE(decompressed, allocator_data);
+	return (sljit_uw*)result;
+}
+
 SLJIT_API_FUNC_ATTRIBUTE sljit_uw* sljit_serialize_compiler(struct sljit_compiler *compiler,
 	sljit_s32 options, sljit_uw *size)
 {
@@ -131,6 +500,7 @@ SLJIT_API_FUNC_ATTRIBUTE sljit_uw* sljit_serialize_compiler(struct sljit_compile
 	sljit_uw counter, used_size;
 	sljit_u8 *result;
 	sljit_u8 *ptr;
+	sljit_uw *compact;
 	SLJIT_UNUSED_ARG(options);
 
 	if (size != NULL)
@@ -138,6 +508,21 @@ SLJIT_API_FUNC_ATTRIBUTE sljit_uw* sljit_serialize_compiler(struct sljit_compile
 
 	PTR_FAIL_IF(compiler->error);
 
+	/* The compact encoding is converted from the default encoding. */
+	if (options & (SLJIT_SERIALIZE_COMPACT | SLJIT_SERIALIZE_COMPRESS)) {
+		result = (sljit_u8*)sljit_serialize_compiler(compiler, options & ~(SLJIT_SERIALIZE_COMPACT | SLJIT_SERIALIZE_COMPRESS), &serialized_size);
+		if (result == NULL)
+			return NULL;
+
+		compact = serialize_compact((sljit_uw*)result, serialized_size, options, &serialized_size, compiler->allocator_data);
+		SLJIT_FREE(result, compiler->allocator_data);
+		PTR_FAIL_IF_NULL(compact);
+
+		if (size != NULL)
+			*size = serialized_size;
+		return compact;
+	}
+
 #if (defined SLJIT_ARGUMENT_CHECKS && SLJIT_ARGUMENT_CHECKS) \
 		|| (defined SLJIT_DEBUG && SLJIT_DEBUG)
 	if (!(options & SLJIT_SERIALIZE_IGNORE_DEBUG))
@@ -179,6 +564,8 @@ SLJIT_API_FUNC_ATTRIBUTE sljit_uw* sljit_serialize_compiler(struct sljit_compile
 	serialized_compiler = (struct sljit_serialized_compiler*)ptr;
 	ptr += sizeof(struct sljit_serialized_compiler);
 
+	/* Clears the structure padding, since the compact encoding keeps the header. */
+	memset(serialized_compiler, 0, sizeof(struct sljit_serialized_compiler));
 	serialized_compiler->signature = SLJIT_SERIALIZE_SIGNATURE;
 	serialized_compiler->version = SLJIT_SERIALIZE_VERSION;
 	serialized_compiler->cpu_type = 0;
@@ -309,6 +696,7 @@ SLJIT_API_FUNC_ATTRIBUTE struct sljit_compiler *sljit_deserialize_compiler(sljit
 	sljit_u8 *ptr = (sljit_u8*)buffer;
 	sljit_u8 *end = ptr + size;
 	sljit_uw i, used_size, aligned_size, label_count;
+	sljit_uw *expanded;
 	SLJIT_UNUSED_ARG(options);
 
 	if (size < sizeof(struct sljit_serialized_compiler) || (size & (sizeof(sljit_uw) - 1)) != 0)
@@ -316,7 +704,21 @@ SLJIT_API_FUNC_ATTRIBUTE struct sljit_compiler *sljit_deserialize_compiler(sljit
 
 	serialized_compiler = (struct sljit_serialized_compiler*)ptr;
 
-	if (serialized_compiler->signature != SLJIT_SERIALIZE_SIGNATURE || serialized_compiler->version != SLJIT_SERIALIZE_VERSION)
+	if (serialized_compiler->signature != SLJIT_SERIALIZE_SIGNATURE)
+		return NULL;
+
+	if (serialized_compiler->version == SLJIT_SERIALIZE_COMPACT_VERSION) {
+		expanded = serialize_expand(buffer, size, &used_size, allocator_data);
+		if (expanded == NULL)
+			return NULL;
+
+		/* The expanded buffer is released, so it cannot be referenced. */
+		compiler = sljit_deserialize_compiler(expanded, used_size, options & ~SLJIT_DESERIALIZE_ZERO_COPY, allocator_data);
+		SLJIT_FREE(expanded, allocator_data);
+		return compiler;
+	}
+
+	if (serialized_compiler->version != SLJIT_SERIALIZE_VERSION)
 		return NULL;
 
 	compiler = sljit_create_compiler(allocator_data);
@@ -377,21 +779,32 @@ SLJIT_API_FUNC_ATTRIBUTE struct sljit_compiler *sljit_deserialize_compiler(sljit
 		aligned_size = SLJIT_SERIALIZE_ALIGN(used_size);
 		ptr += sizeof(sljit_uw);
 
-		if ((sljit_uw)(end - ptr) < aligned_size)
+		if (used_size > BUF_SIZE - sizeof(struct sljit_memory_fragment) || (sljit_uw)(end - ptr) < aligned_size)
 			goto error;
 
 		if (last_buf == NULL) {
 			SLJIT_ASSERT(compiler->buf != NULL && compiler->buf->next == NULL);
 			buf = compiler->buf;
+			SLJIT_MEMCPY(buf->memory, ptr, used_size);
+		} else if (options & SLJIT_DESERIALIZE_ZERO_COPY) {
+			/* Only the first fragment is extended by the compiler,
+			   the others are never modified after they are filled.
+			   The headers are freed with the auxiliary fragments. */
+			buf = (struct sljit_memory_fragment*)ensure_abuf(compiler, sizeof(struct sljit_memory_fragment));
+			if (!buf)
+				goto error;
+			buf->next = NULL;
+			buf->memory = ptr;
 		} else {
 			buf = (struct sljit_memory_fragment*)SLJIT_MALLOC(BUF_SIZE, allocator_data);
 			if (!buf)
 				goto error;
 			buf->next = NULL;
+			buf->memory = (sljit_u8*)(buf + 1);
+			SLJIT_MEMCPY(buf->memory, ptr, used_size);
 		}
 
 		buf->used_size = used_size;
-		SLJIT_MEMCPY(buf->memory, ptr, used_size);
 
 		if (last_buf != NULL)
 			last_buf->next = buf;
@@ -514,3 +927,666 @@ error:
 		SLJIT_FREE(label_list, allocator_data);
 	return NULL;
 }
+
+/* --------------------------------------------------------------------- */
+/*  Code images                                                          */
+/* --------------------------------------------------------------------- */
+
+/* Layout of a code image:
+     header, generated code (word aligned), label offsets,
+     relocations (serialized jumps), const offsets
+   All offsets are relative to the start of the code. The value of
+   a relocation is the offset of its label, the index of its target
+   in the target list, or the offset of the static data of sljit
+   from code_image_base for MOV_ADDR_STATIC instructions. */
+
+struct sljit_code_image {
+	sljit_u32 signature;
+	sljit_u16 version;
+	sljit_u16 cpu_type;
+
+	sljit_uw cpu_features;
+	sljit_uw code_size;
+	sljit_uw label_count;
+	sljit_uw reloc_count;
+	sljit_uw const_count;
+};
+
+#define SLJIT_CODE_IMAGE_VERSION 3
+
+#if (defined SLJIT_LITTLE_ENDIAN && SLJIT_LITTLE_ENDIAN)
+#define SLJIT_CODE_IMAGE_SIGNATURE 0x534c4a49
+#else /* !SLJIT_LITTLE_ENDIAN */
+#define SLJIT_CODE_IMAGE_SIGNATURE 0x494a4c53
+#endif /* SLJIT_LITTLE_ENDIAN */
+
+#define SLJIT_CODE_IMAGE_LABELS(image) \
+	((sljit_uw*)((sljit_u8*)(image) + sizeof(struct sljit_code_image) + SLJIT_SERIALIZE_ALIGN((image)->code_size)))
+#define SLJIT_CODE_IMAGE_CONSTS(image) \
+	((sljit_uw*)(SLJIT_CODE_IMAGE_LABELS(image) + (image)->label_count) \
+		+ (image)->reloc_count * (sizeof(struct sljit_serialized_jump) / sizeof(sljit_uw)))
+
+#if (defined SLJIT_HAS_CODE_IMAGE && SLJIT_HAS_CODE_IMAGE)
+
+#ifndef MOV_ADDR_STATIC
+/* The static data of sljit is not loaded by mov_addr instructions. */
+#define MOV_ADDR_STATIC 0
+#endif /* !MOV_ADDR_STATIC */
+
+/* The static data of sljit is stored relative to this object, since
+   their distance does not change when the library is loaded to
+   another address. */
+static const sljit_u8 code_image_base = 0;
+
+/* Returns with non-zero, if the jump must be relocated when the code is loaded. */
+static SLJIT_INLINE sljit_s32 jump_needs_relocation(sljit_uw flags)
+{
+	return (flags & JUMP_ADDR) || jump_is_position_dependent(flags);
+}
+
+SLJIT_API_FUNC_ATTRIBUTE sljit_uw* sljit_create_code_image(struct sljit_compiler *compiler,
+	void *code, sljit_uw *targets, sljit_uw target_count, sljit_s32 options, sljit_uw *size)
+{
+	struct sljit_code_image *image;
+	struct sljit_serialized_jump *serialized_jump;
+	struct sljit_label *label;
+	struct sljit_jump *jump;
+	struct sljit_const *const_;
+	sljit_uw exec_code = (sljit_uw)code;
+	sljit_uw write_code = exec_code - (sljit_uw)compiler->executable_offset;
+	sljit_uw reloc_count = 0;
+	sljit_uw const_count = 0;
+	sljit_uw image_size;
+	sljit_uw *ptr;
+	sljit_uw i;
+	SLJIT_UNUSED_ARG(options);
+
+	if (size != NULL)
+		*size = 0;
+
+	if (compiler->error != SLJIT_ERR_COMPILED || code == NULL)
+		return NULL;
+
+	jump = compiler->jumps;
+	while (jump != NULL) {
+		if (jump_needs_relocation(jump->flags))
+			reloc_count++;
+		jump = jump->next;
+	}
+
+	const_ = compiler->consts;
+	while (const_ != NULL) {
+		const_count++;
+		const_ = const_->next;
+	}
+
+	image_size = sizeof(struct sljit_code_image) + SLJIT_SERIALIZE_ALIGN(compiler->executable_size)
+		+ (compiler->label_count + const_count) * sizeof(sljit_uw)
+		+ reloc_count * sizeof(struct sljit_serialized_jump);
+
+	image = (struct sljit_code_image*)SLJIT_MALLOC(image_size, compiler->allocator_data);
+	if (image == NULL)
+		return NULL;
+
+	image->signature = SLJIT_CODE_IMAGE_SIGNATURE;
+	image->version = SLJIT_CODE_IMAGE_VERSION;
+	image->cpu_type = 0;
+	image->cpu_features = SLJIT_CODE_IMAGE_CPU_FEATURES();
+	image->code_size = compiler->executable_size;
+	image->label_count = compiler->label_count;
+	image->reloc_count = reloc_count;
+	image->const_count = const_count;
+
+	SLJIT_MEMCPY(image + 1, (void*)write_code, compiler->executable_size);
+	memset((sljit_u8*)(image + 1) + compiler->executable_size, 0,
+		SLJIT_SERIALIZE_ALIGN(compiler->executable_size) - compiler->executable_size);
+
+	ptr = SLJIT_CODE_IMAGE_LABELS(image);
+	label = compiler->labels;
+	while (label != NULL) {
+		*ptr++ = label->u.addr - exec_code;
+		label = label->next;
+	}
+
+	jump = compiler->jumps;
+	while (jump != NULL) {
+		if (jump_needs_relocation(jump->flags)) {
+			serialized_jump = (struct sljit_serialized_jump*)ptr;
+			serialized_jump->addr = jump->addr - write_code;
+			serialized_jump->flags = jump->flags;
+
+			if (!(jump->flags & JUMP_ADDR))
+				serialized_jump->value = jump->u.label->u.addr - exec_code;
+			else if (jump->flags & MOV_ADDR_STATIC)
+				serialized_jump->value = jump->u.target - (sljit_uw)&code_image_base;
+			else {
+				/* Absolute targets must be present in the target list. */
+				for (i = 0; i < target_count; i++)
+					if (targets[i] == jump->u.target)
+						break;
+
+				if (i >= target_count) {
+					SLJIT_FREE(image, compiler->allocator_data);
+					return NULL;
+				}
+				serialized_jump->value = i;
+			}
+			ptr += sizeof(struct sljit_serialized_jump) / sizeof(sljit_uw);
+		}
+		jump = jump->next;
+	}
+
+	const_ = compiler->consts;
+	while (const_ != NULL) {
+		*ptr++ = const_->addr - write_code;
+		const_ = const_->next;
+	}
+
+	SLJIT_ASSERT((sljit_uw)((sljit_u8*)ptr - (sljit_u8*)image) == image_size);
+
+	if (size != NULL)
+		*size = image_size;
+	return (sljit_uw*)image;
+}
+
+/* Checks the structure of the image. The instructions are not checked. */
+static sljit_s32 check_code_image(struct sljit_code_image *image, sljit_uw size, sljit_uw target_count)
+{
+	struct sljit_serialized_jump *serialized_jump;
+	sljit_uw *ptr;
+	sljit_uw i, count;
+
+	if (size < sizeof(struct sljit_code_image) || (size & (sizeof(sljit_uw) - 1)) != 0)
+		return 0;
+
+	if (image->signature != SLJIT_CODE_IMAGE_SIGNATURE || image->version != SLJIT_CODE_IMAGE_VERSION
+			|| image->cpu_type != 0 || image->code_size == 0)
+		return 0;
+
+	/* The code may use any cpu feature which was available when it was generated. */
+	if (image->cpu_features & ~SLJIT_CODE_IMAGE_CPU_FEATURES())
+		return 0;
+
+	size = (size - sizeof(struct sljit_code_image)) / sizeof(sljit_uw);
+
+	/* The counts are checked one by one to avoid overflows. */
+	if (image->code_size > size * sizeof(sljit_uw))
+		return 0;
+	size -= SLJIT_SERIALIZE_ALIGN(image->code_size) / sizeof(sljit_uw);
+
+	if (image->label_count > size)
+		return 0;
+	size -= image->label_count;
+
+	count = sizeof(struct sljit_serialized_jump) / sizeof(sljit_uw);
+	if (image->reloc_count > size / count)
+		return 0;
+	size -= image->reloc_count * count;
+
+	if (image->const_count != size)
+		return 0;
+
+	ptr = SLJIT_CODE_IMAGE_LABELS(image);
+	for (i = image->label_count; i > 0; i--)
+		if (*ptr++ > image->code_size)
+			return 0;
+
+	for (i = image->reloc_count; i > 0; i--) {
+		serialized_jump = (struct sljit_serialized_jump*)ptr;
+		if (!jump_reloc_is_valid(serialized_jump->addr, serialized_jump->flags, image->code_size)
+				|| !jump_needs_relocation(serialized_jump->flags))
+			return 0;
+
+		if (!(serialized_jump->flags & JUMP_ADDR)) {
+			if (serialized_jump->value > image->code_size)
+				return 0;
+		} else if (!(serialized_jump->flags & MOV_ADDR_STATIC) && serialized_jump->value >= target_count)
+			return 0;
+		ptr += count;
+	}
+
+	for (i = image->const_count; i > 0; i--, ptr++)
+		if (*ptr > image->code_size || image->code_size - *ptr < sizeof(sljit_sw))
+			return 0;
+
+	return 1;
+}
+
+SLJIT_API_FUNC_ATTRIBUTE void* sljit_load_code_image(sljit_uw *buffer, sljit_uw size,
+	sljit_uw *targets, sljit_uw target_count,
+	sljit_s32 options, void *exec_allocator_data, sljit_sw *executable_offset)
+{
+	struct sljit_code_image *image = (struct sljit_code_image*)buffer;
+	struct sljit_serialized_jump *serialized_jump;
+	struct sljit_jump jump;
+	struct sljit_label label;
+	sljit_sw exec_offset;
+	sljit_u8 *code;
+	sljit_u8 *exec_code;
+	sljit_uw i;
+
+#if (defined SLJIT_NEEDS_COMPILER_INIT && SLJIT_NEEDS_COMPILER_INIT)
+	/* The static data and the cpu features are initialized here. */
+	if (!compiler_initialized) {
+		init_compiler();
+		compiler_initialized = 1;
+	}
+#endif /* SLJIT_NEEDS_COMPILER_INIT */
+
+	if (!check_code_image(image, size, target_count))
+		return NULL;
+
+	code = (sljit_u8*)allocate_executable_memory(image->code_size, options, exec_allocator_data, &exec_offset);
+	if (code == NULL)
+		return NULL;
+
+	exec_code = SLJIT_ADD_EXEC_OFFSET(code, exec_offset);
+	SLJIT_MEMCPY(code, image + 1, image->code_size);
+
+	serialized_jump = (struct sljit_serialized_jump*)(SLJIT_CODE_IMAGE_LABELS(image) + image->label_count);
+	for (i = image->reloc_count; i > 0; i--, serialized_jump++) {
+		jump.flags = serialized_jump->flags;
+		jump.addr = (sljit_uw)code + serialized_jump->addr;
+
+		if (!(jump.flags & JUMP_ADDR)) {
+			label.u.addr = (sljit_uw)exec_code + serialized_jump->value;
+			jump.u.label = &label;
+		} else if (jump.flags & MOV_ADDR_STATIC)
+			jump.u.target = (sljit_uw)&code_image_base + serialized_jump->value;
+		else
+			jump.u.target = targets[serialized_jump->value];
+
+		if (!relocate_jump(&jump, exec_offset))
+			break;
+	}
+
+	if (i > 0) {
+		if (!(options & SLJIT_GENERATE_CODE_BUFFER))
+			SLJIT_FREE_EXEC(SLJIT_EXEC_HEADER(exec_code), exec_allocator_data);
+		return NULL;
+	}
+
+	if (executable_offset != NULL)
+		*executable_offset = exec_offset;
+
+	SLJIT_CACHE_FLUSH(exec_code, exec_code + image->code_size);
+	SLJIT_UPDATE_WX_FLAGS(exec_code, exec_code + image->code_size, 1);
+	return exec_code;
+}
+
+#else /* !SLJIT_HAS_CODE_IMAGE */
+
+SLJIT_API_FUNC_ATTRIBUTE sljit_uw* sljit_create_code_image(struct sljit_compiler *compiler,
+	void *code, sljit_uw *targets, sljit_uw target_count, sljit_s32 options, sljit_uw *size)
+{
+	SLJIT_UNUSED_ARG(compiler);
+	SLJIT_UNUSED_ARG(code);
+	SLJIT_UNUSED_ARG(targets);
+	SLJIT_UNUSED_ARG(target_count);
+	SLJIT_UNUSED_ARG(options);
+
+	if (size != NULL)
+		*size = 0;
+	return NULL;
+}
+
+SLJIT_API_FUNC_ATTRIBUTE void* sljit_load_code_image(sljit_uw *buffer, sljit_uw size,
+	sljit_uw *targets, sljit_uw target_count,
+	sljit_s32 options, void *exec_allocator_data, sljit_sw *executable_offset)
+{
+	SLJIT_UNUSED_ARG(buffer);
+	SLJIT_UNUSED_ARG(size);
+	SLJIT_UNUSED_ARG(targets);
+	SLJIT_UNUSED_ARG(target_count);
+	SLJIT_UNUSED_ARG(options);
+	SLJIT_UNUSED_ARG(exec_allocator_data);
+	SLJIT_UNUSED_ARG(executable_offset);
+	return NULL;
+}
+
+#endif /* SLJIT_HAS_CODE_IMAGE */
+
+SLJIT_API_FUNC_ATTRIBUTE sljit_uw sljit_get_code_image_label_addr(sljit_uw *buffer, sljit_uw index, void *code)
+{
+	struct sljit_code_image *image = (struct sljit_code_image*)buffer;
+
+	SLJIT_ASSERT(index < image->label_count);
+	return (sljit_uw)code + SLJIT_CODE_IMAGE_LABELS(image)[index];
+}
+
+SLJIT_API_FUNC_ATTRIBUTE sljit_uw sljit_get_code_image_const_addr(sljit_uw *buffer, sljit_uw index,
+	void *code, sljit_sw executable_offset)
+{
+	struct sljit_code_image *image = (struct sljit_code_image*)buffer;
+
+	SLJIT_ASSERT(index < image->const_count);
+	return (sljit_uw)code - (sljit_uw)executable_offset + SLJIT_CODE_IMAGE_CONSTS(image)[index];
+}
+
+/* --------------------------------------------------------------------- */
+/*  Code cache                                                           */
+/* --------------------------------------------------------------------- */
+
+/* Every function is stored in the code chain of the bucket selected by its
+   address. Shared functions are also stored in the key chain of the bucket
+   selected by the hash of their key. Private functions have no key. */
+
+struct sljit_code_cache_entry {
+	struct sljit_code_cache_entry *next;
+	struct sljit_code_cache_entry *code_next;
+	struct sljit_code_cache *cache;
+	void *code;
+	sljit_sw executable_offset;
+	sljit_uw executable_size;
+	sljit_uw ref_count;
+	sljit_uw hash;
+	sljit_s32 options;
+	sljit_uw *key;
+	sljit_uw key_size;
+	sljit_uw label_count;
+	/* Followed by the label offsets. */
+};
+
+struct sljit_code_cache {
+	void *allocator_data;
+	void *exec_allocator_data;
+	/* Key buckets followed by code buckets. */
+	struct sljit_code_cache_entry **buckets;
+	sljit_uw bucket_count;
+	sljit_uw entry_count;
+	struct sljit_code_cache_stats stats;
+};
+
+#define SLJIT_CODE_CACHE_INITIAL_BUCKETS 64
+#define SLJIT_CODE_CACHE_LABELS(entry) ((sljit_uw*)((entry) + 1))
+#define SLJIT_CODE_CACHE_CODE_HASH(code) ((sljit_uw)(code) >> 4)
+
+static sljit_uw code_cache_hash(sljit_uw *key, sljit_uw size, sljit_s32 options)
+{
+#if (defined SLJIT_64BIT_ARCHITECTURE && SLJIT_64BIT_ARCHITECTURE)
+	sljit_uw hash = (sljit_uw)0xcbf29ce484222325 ^ (sljit_uw)options;
+	const sljit_uw prime = (sljit_uw)0x100000001b3;
+#else /* !SLJIT_64BIT_ARCHITECTURE */
+	sljit_uw hash = (sljit_uw)0x811c9dc5 ^ (sljit_uw)options;
+	const sljit_uw prime = (sljit_uw)0x01000193;
+#endif /* SLJIT_64BIT_ARCHITECTURE */
+	sljit_uw *end = key + size / sizeof(sljit_uw);
+
+	/* The key is word aligned, and its padding is cleared. */
+	while (key < end)
+		hash = (hash ^ *key++) * prime;
+
+	return hash ^ (hash >> 15);
+}
+
+static sljit_s32 code_cache_is_shareable(struct sljit_compiler *compiler)
+{
+	struct sljit_jump *jump;
+
+	if (compiler->consts != NULL)
+		return 0;
+
+	jump = compiler->jumps;
+	while (jump != NULL) {
+		if (jump->flags & SLJIT_REWRITABLE_JUMP)
+			return 0;
+		jump = jump->next;
+	}
+	return 1;
+}
+
+static void code_cache_insert(struct sljit_code_cache *cache, struct sljit_code_cache_entry *entry)
+{
+	struct sljit_code_cache_entry **bucket;
+	sljit_uw mask = cache->bucket_count - 1;
+
+	if (entry->key != NULL) {
+		bucket = cache->buckets + (entry->hash & mask);
+		entry->next = *bucket;
+		*bucket = entry;
+	}
+
+	bucket = cache->buckets + cache->bucket_count + (SLJIT_CODE_CACHE_CODE_HASH(entry->code) & mask);
+	entry->code_next = *bucket;
+	*bucket = entry;
+}
+
+/* The cache remains usable (with longer chains) if the allocation fails. */
+static void code_cache_grow(struct sljit_code_cache *cache)
+{
+	struct sljit_code_cache_entry **old_buckets = cache->buckets;
+	struct sljit_code_cache_entry *entry;
+	struct sljit_code_cache_entry *next;
+	sljit_uw i, old_count = cache->bucket_count;
+	sljit_uw size = 4 * old_count * sizeof(struct sljit_code_cache_entry*);
+
+	cache->buckets = (struct sljit_code_cache_entry**)SLJIT_MALLOC(size, cache->allocator_data);
+	if (cache->buckets == NULL) {
+		cache->buckets = old_buckets;
+		return;
+	}
+
+	memset(cache->buckets, 0, size);
+	cache->bucket_count = 2 * old_count;
+	cache->stats.metadata_size += size / 2;
+
+	/* Every entry is in the code chains. */
+	for (i = 0; i < old_count; i++) {
+		entry = old_buckets[old_count + i];
+		while (entry != NULL) {
+			next = entry->code_next;
+			code_cache_insert(cache, entry);
+			entry = next;
+		}
+	}
+
+	SLJIT_FREE(old_buckets, cache->allocator_data);
+}
+
+static void code_cache_free_entry(struct sljit_code_cache *cache, struct sljit_code_cache_entry *entry)
+{
+	cache->stats.function_count--;
+	cache->stats.code_size -= entry->executable_size;
+	cache->stats.metadata_size -= sizeof(struct sljit_code_cache_entry)
+		+ entry->label_count * sizeof(sljit_uw) + entry->key_size;
+	cache->entry_count--;
+
+	/* The header still refers to the entry, so sljit_free_code cannot be used. */
+	SLJIT_FREE_EXEC(SLJIT_EXEC_HEADER(SLJIT_CODE_TO_PTR(entry->code)), cache->exec_allocator_data);
+	if (entry->key != NULL)
+		SLJIT_FREE(entry->key, cache->allocator_data);
+	SLJIT_FREE(entry, cache->allocator_data);
+}
+
+SLJIT_API_FUNC_ATTRIBUTE struct sljit_code_cache* sljit_create_code_cache(void *allocator_data, void *exec_allocator_data)
+{
+	sljit_uw size = 2 * SLJIT_CODE_CACHE_INITIAL_BUCKETS * sizeof(struct sljit_code_cache_entry*);
+	struct sljit_code_cache *cache;
+	SLJIT_UNUSED_ARG(allocator_data);
+
+	cache = (struct sljit_code_cache*)SLJIT_MALLOC(sizeof(struct sljit_code_cache), allocator_data);
+	if (cache == NULL)
+		return NULL;
+
+	cache->buckets = (struct sljit_code_cache_entry**)SLJIT_MALLOC(size, allocator_data);
+	if (cache->buckets == NULL) {
+		SLJIT_FREE(cache, allocator_data);
+		return NULL;
+	}
+
+	memset(cache->buckets, 0, size);
+	cache->allocator_data = allocator_data;
+	cache->exec_allocator_data = exec_allocator_data;
+	cache->bucket_count = SLJIT_CODE_CACHE_INITIAL_BUCKETS;
+	cache->entry_count = 0;
+	memset(&cache->stats, 0, sizeof(struct sljit_code_cache_stats));
+	cache->stats.metadata_size = sizeof(struct sljit_code_cache) + size;
+	return cache;
+}
+
+SLJIT_API_FUNC_ATTRIBUTE void sljit_free_code_cache(struct sljit_code_cache *cache)
+{
+	struct sljit_code_cache_entry *entry;
+	struct sljit_code_cache_entry *next;
+	sljit_uw i;
+
+	for (i = 0; i < cache->bucket_count; i++) {
+		entry = cache->buckets[cache->bucket_count + i];
+		while (entry != NULL) {
+			next = entry->code_next;
+			code_cache_free_entry(cache, entry);
+			entry = next;
+		}
+	}
+
+	SLJIT_FREE(cache->buckets, cache->allocator_data);
+	SLJIT_FREE(cache, cache->allocator_data);
+}
+
+SLJIT_API_FUNC_ATTRIBUTE void* sljit_generate_cached_code(struct sljit_code_cache *cache,
+	struct sljit_compiler *compiler, sljit_s32 options)
+{
+	struct sljit_code_cache_entry *entry;
+	struct sljit_label *label;
+	sljit_uw *key = NULL;
+	sljit_uw *label_offsets;
+	sljit_uw key_size = 0;
+	sljit_uw hash = 0;
+	sljit_uw code;
+	void *result;
+	struct sljit_exec_header *header;
+
+	CHECK_ERROR_PTR();
+	SLJIT_ASSERT(!(options & SLJIT_GENERATE_CODE_BUFFER));
+
+	if (code_cache_is_shareable(compiler)) {
+		key = sljit_serialize_compiler(compiler, SLJIT_SERIALIZE_COMPACT | SLJIT_SERIALIZE_IGNORE_DEBUG, &key_size);
+		if (key == NULL)
+			return NULL;
+
+		hash = code_cache_hash(key, key_size, options);
+		entry = cache->buckets[hash & (cache->bucket_count - 1)];
+
+		while (entry != NULL) {
+			if (entry->hash == hash && entry->options == options && entry->key_size == key_size
+					&& memcmp(entry->key, key, key_size) == 0)
+				break;
+			entry = entry->next;
+		}
+
+		if (entry != NULL) {
+			SLJIT_FREE(key, cache->allocator_data);
+			SLJIT_ASSERT(entry->label_count == compiler->label_count);
+
+			code = (sljit_uw)entry->code;
+			label_offsets = SLJIT_CODE_CACHE_LABELS(entry);
+			label = compiler->labels;
+			while (label != NULL) {
+				label->u.addr = code + *label_offsets++;
+				label = label->next;
+			}
+
+			entry->ref_count++;
+			cache->stats.reference_count++;
+			cache->stats.saved_size += entry->executable_size;
+
+			compiler->error = SLJIT_ERR_COMPILED;
+			compiler->executable_offset = entry->executable_offset;
+			compiler->executable_size = entry->executable_size;
+			return entry->code;
+		}
+	}
+
+	/* The header is updated after the code is generated. */
+	result = sljit_generate_code(compiler, options | SLJIT_GENERATE_CODE_KEEP_WRITABLE, cache->exec_allocator_data);
+	if (result == NULL) {
+		if (key != NULL)
+			SLJIT_FREE(key, cache->allocator_data);
+		return NULL;
+	}
+
+	entry = (struct sljit_code_cache_entry*)SLJIT_MALLOC(sizeof(struct sljit_code_cache_entry)
+		+ compiler->label_count * sizeof(sljit_uw), cache->allocator_data);
+	if (entry == NULL) {
+		sljit_free_code(result, cache->exec_allocator_data);
+		if (key != NULL)
+			SLJIT_FREE(key, cache->allocator_data);
+		compiler->error = SLJIT_ERR_ALLOC_FAILED;
+		return NULL;
+	}
+
+	entry->cache = cache;
+	entry->code = result;
+	entry->executable_offset = compiler->executable_offset;
+	entry->executable_size = compiler->executable_size;
+	entry->ref_count = 1;
+	entry->hash = hash;
+	entry->options = options;
+	entry->key = key;
+	entry->key_size = key_size;
+	entry->label_count = compiler->label_count;
+
+	code = (sljit_uw)result;
+	label_offsets = SLJIT_CODE_CACHE_LABELS(entry);
+	label = compiler->labels;
+	while (label != NULL) {
+		*label_offsets++ = label->u.addr - code;
+		label = label->next;
+	}
+
+	cache->stats.function_count++;
+	cache->stats.reference_count++;
+	cache->stats.code_size += entry->executable_size;
+	cache->stats.metadata_size += sizeof(struct sljit_code_cache_entry)
+		+ entry->label_count * sizeof(sljit_uw) + key_size;
+
+	if (cache->entry_count >= cache->bucket_count)
+		code_cache_grow(cache);
+
+	cache->entry_count++;
+	code_cache_insert(cache, entry);
+
+	/* Allows sljit_free_code to find the entry. */
+	header = SLJIT_EXEC_HEADER(SLJIT_CODE_TO_PTR(result));
+	SLJIT_UPDATE_WX_FLAGS(header, (sljit_u8*)header + SLJIT_EXEC_HEADER_SIZE, 0);
+	((struct sljit_exec_header*)SLJIT_ADD_EXEC_OFFSET(header, -entry->executable_offset))->cache_entry = entry;
+	SLJIT_UPDATE_WX_FLAGS(header, (sljit_u8*)result + entry->executable_size,
+		!(options & SLJIT_GENERATE_CODE_KEEP_WRITABLE));
+	return result;
+}
+
+/* Called by sljit_free_code. */
+static void code_cache_release(struct sljit_code_cache_entry *entry)
+{
+	struct sljit_code_cache *cache = entry->cache;
+	struct sljit_code_cache_entry **entry_ptr;
+	sljit_uw mask = cache->bucket_count - 1;
+
+	SLJIT_ASSERT(entry->ref_count > 0);
+	cache->stats.reference_count--;
+
+	if (--entry->ref_count > 0) {
+		cache->stats.saved_size -= entry->executable_size;
+		return;
+	}
+
+	entry_ptr = cache->buckets + cache->bucket_count + (SLJIT_CODE_CACHE_CODE_HASH(entry->code) & mask);
+	while (*entry_ptr != entry)
+		entry_ptr = &(*entry_ptr)->code_next;
+	*entry_ptr = entry->code_next;
+
+	if (entry->key != NULL) {
+		entry_ptr = cache->buckets + (entry->hash & mask);
+		while (*entry_ptr != entry)
+			entry_ptr = &(*entry_ptr)->next;
+		*entry_ptr = entry->next;
+	}
+
+	code_cache_free_entry(cache, entry);
+}
+
+SLJIT_API_FUNC_ATTRIBUTE void sljit_get_code_cache_stats(struct sljit_code_cache *cache,
+	struct sljit_code_cache_stats *stats)
+{
+	*stats = cache->stats;
+}
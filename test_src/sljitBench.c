@@ -0,0 +1,712 @@
+/*
+ *    Stack-less Just-In-Time compiler
+ *
+ *    Copyright 2009-2010 Zoltan Herczeg (hzmester@freemail.hu). All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are
+ * permitted provided that the following conditions are met:
+ *
+ *   1. Redistributions of source code must retain the above copyright notice, this list of
+ *      conditions and the following disclaimer.
+ *
+ *   2. Redistributions in binary form must reproduce the above copyright notice, this list
+ *      of conditions and the following disclaimer in the documentation and/or other materials
+ *      provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDER(S) AND CONTRIBUTORS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDER(S) OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ * TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/* Micro benchmarks for code generated by sljit.
+   Usage: sljit_bench [repeat] */
+
+#include "sljitLir.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+
+#define DICT_SIZE 4096
+#define CODE_COUNT (64 * 1024)
+#define SERIALIZE_COUNT 256
+#define IMAGE_COUNT 4096
+#define CACHE_COUNT 4096
+#define CACHE_DISTINCT 64
+#define POOL_COUNT 10000
+#define POOL_MAX_THREADS 8
+
+typedef void (SLJIT_FUNC *decode_func)(sljit_u32 *dict, sljit_u32 *codes, sljit_u32 *out, sljit_sw length);
+
+/* Dictionary decode: out[i] = dict[codes[i]] */
+static void *compile_decode(sljit_s32 simd_type, sljit_s32 step)
+{
+	struct sljit_compiler *compiler = sljit_create_compiler(NULL);
+	struct sljit_label *loop;
+	void *code;
+
+	if (!compiler)
+		return NULL;
+
+	sljit_emit_enter(compiler, 0, SLJIT_ARGS4V(P, P, P, W), 2, 4, 2, 0, 0);
+
+	if (simd_type != 0) {
+		if (sljit_emit_simd_gather(compiler, simd_type | SLJIT_SIMD_SCALE_4 | SLJIT_SIMD_TEST,
+				SLJIT_FR0, SLJIT_FR1, SLJIT_MEM1(SLJIT_S0), 0) != SLJIT_SUCCESS) {
+			sljit_free_compiler(compiler);
+			return NULL;
+		}
+	}
+
+	/* The length is converted to bytes. */
+	sljit_emit_op2(compiler, SLJIT_SHL, SLJIT_S3, 0, SLJIT_S3, 0, SLJIT_IMM, 2);
+	sljit_emit_op1(compiler, SLJIT_MOV, SLJIT_R0, 0, SLJIT_IMM, 0);
+
+	loop = sljit_emit_label(compiler);
+
+	if (simd_type != 0) {
+		sljit_emit_simd_mov(compiler, SLJIT_SIMD_LOAD | simd_type, SLJIT_FR1, SLJIT_MEM2(SLJIT_S1, SLJIT_R0), 0);
+		sljit_emit_simd_gather(compiler, simd_type | SLJIT_SIMD_SCALE_4, SLJIT_FR0, SLJIT_FR1, SLJIT_MEM1(SLJIT_S0), 0);
+		sljit_emit_simd_mov(compiler, SLJIT_SIMD_STORE | simd_type, SLJIT_FR0, SLJIT_MEM2(SLJIT_S2, SLJIT_R0), 0);
+	} else {
+		sljit_emit_op1(compiler, SLJIT_MOV_U32, SLJIT_R1, 0, SLJIT_MEM2(SLJIT_S1, SLJIT_R0), 0);
+		sljit_emit_op1(compiler, SLJIT_MOV_U32, SLJIT_R1, 0, SLJIT_MEM2(SLJIT_S0, SLJIT_R1), 2);
+		sljit_emit_op1(compiler, SLJIT_MOV32, SLJIT_MEM2(SLJIT_S2, SLJIT_R0), 0, SLJIT_R1, 0);
+	}
+
+	/* The step is the number of bytes processed by one iteration. */
+	sljit_emit_op2(compiler, SLJIT_ADD, SLJIT_R0, 0, SLJIT_R0, 0, SLJIT_IMM, step);
+	sljit_set_label(sljit_emit_cmp(compiler, SLJIT_LESS, SLJIT_R0, 0, SLJIT_S3, 0), loop);
+	sljit_emit_return_void(compiler);
+
+	code = sljit_generate_code(compiler, 0, NULL);
+	sljit_free_compiler(compiler);
+	return code;
+}
+
+static void bench_decode(const char *name, sljit_s32 simd_type, sljit_s32 step, long repeat,
+	sljit_u32 *dict, sljit_u32 *codes, sljit_u32 *out)
+{
+	void *code = compile_decode(simd_type, step);
+	decode_func func;
+	clock_t start;
+	double seconds;
+	long i;
+
+	if (code == NULL) {
+		printf("  %-24s not supported\n", name);
+		return;
+	}
+
+	func = (decode_func)SLJIT_FUNC_ADDR(code);
+
+	for (i = 0; i < CODE_COUNT; i++)
+		out[i] = 0;
+
+	start = clock();
+	for (i = 0; i < repeat; i++)
+		func(dict, codes, out, CODE_COUNT);
+	seconds = (double)(clock() - start) / CLOCKS_PER_SEC;
+
+	for (i = 0; i < CODE_COUNT; i++) {
+		if (out[i] != dict[codes[i]]) {
+			printf("  %-24s wrong result at %ld\n", name, i);
+			sljit_free_code(code, NULL);
+			return;
+		}
+	}
+
+	printf("  %-24s %8.3f s %10.1f Mvalues/s\n", name, seconds,
+		seconds > 0 ? ((double)CODE_COUNT * (double)repeat) / seconds / 1e6 : 0.0);
+	sljit_free_code(code, NULL);
+}
+
+static sljit_sw SLJIT_FUNC serialize_function_helper(sljit_sw value)
+{
+	return value ^ (value >> 7);
+}
+
+/* A function with a mix of jumps, labels, calls and constants. */
+static struct sljit_compiler *create_serialize_function(sljit_s32 index)
+{
+	struct sljit_compiler *compiler = sljit_create_compiler(NULL);
+	struct sljit_label *loop;
+	struct sljit_jump *jump;
+	struct sljit_jump *mov_addr;
+	sljit_s32 i;
+
+	if (!compiler)
+		return NULL;
+
+	sljit_emit_enter(compiler, 0, SLJIT_ARGS2(W, P, W), 3, 3, 0, 0, 0);
+	sljit_emit_op1(compiler, SLJIT_MOV, SLJIT_R0, 0, SLJIT_IMM, 0);
+	mov_addr = sljit_emit_mov_addr(compiler, SLJIT_S2, 0);
+	loop = sljit_emit_label(compiler);
+	sljit_set_label(mov_addr, loop);
+
+	for (i = 0; i < 64 + (index & 0x3f); i++) {
+		jump = sljit_emit_cmp(compiler, SLJIT_EQUAL, SLJIT_S1, 0, SLJIT_IMM, i * 7 + index);
+		sljit_emit_op2(compiler, SLJIT_XOR, SLJIT_R0, 0, SLJIT_R0, 0, SLJIT_MEM1(SLJIT_S0), (i & 0xf) * (sljit_sw)sizeof(sljit_sw));
+		sljit_emit_op2(compiler, SLJIT_ADD, SLJIT_R0, 0, SLJIT_R0, 0, SLJIT_IMM, i + index);
+		if ((i & 0xf) == 0)
+			sljit_emit_const(compiler, SLJIT_R1, 0, i);
+		sljit_set_label(jump, sljit_emit_label(compiler));
+	}
+
+	sljit_emit_op2(compiler, SLJIT_SUB | SLJIT_SET_Z, SLJIT_S1, 0, SLJIT_S1, 0, SLJIT_IMM, 1);
+	sljit_set_label(sljit_emit_jump(compiler, SLJIT_NOT_ZERO), loop);
+	sljit_emit_icall(compiler, SLJIT_CALL, SLJIT_ARGS1(W, W), SLJIT_IMM, SLJIT_FUNC_ADDR(serialize_function_helper));
+	sljit_emit_return(compiler, SLJIT_MOV, SLJIT_R0, 0);
+	return compiler;
+}
+
+/* A function whose instructions take several fragments, with few labels and jumps. */
+static struct sljit_compiler *create_large_serialize_function(sljit_s32 index)
+{
+	struct sljit_compiler *compiler = sljit_create_compiler(NULL);
+	struct sljit_jump *jump;
+	sljit_s32 i;
+
+	if (!compiler)
+		return NULL;
+
+	sljit_emit_enter(compiler, 0, SLJIT_ARGS2(W, P, W), 3, 3, 0, 0, 0);
+	sljit_emit_op1(compiler, SLJIT_MOV, SLJIT_R0, 0, SLJIT_IMM, 0);
+
+	for (i = 0; i < 4096; i++) {
+		sljit_emit_op2(compiler, SLJIT_XOR, SLJIT_R0, 0, SLJIT_R0, 0, SLJIT_MEM1(SLJIT_S0), (i & 0xf) * (sljit_sw)sizeof(sljit_sw));
+		sljit_emit_op2(compiler, SLJIT_ADD, SLJIT_R0, 0, SLJIT_R0, 0, SLJIT_IMM, i + index);
+		if ((i & 0x3ff) == 0) {
+			jump = sljit_emit_cmp(compiler, SLJIT_EQUAL, SLJIT_S1, 0, SLJIT_IMM, i);
+			sljit_set_label(jump, sljit_emit_label(compiler));
+		}
+	}
+
+	sljit_emit_return(compiler, SLJIT_MOV, SLJIT_R0, 0);
+	return compiler;
+}
+
+static void bench_serialize_mode(const char *name, sljit_s32 options, sljit_s32 deserialize_options,
+	long repeat, struct sljit_compiler **compilers)
+{
+	sljit_uw *buffers[SERIALIZE_COUNT];
+	sljit_uw sizes[SERIALIZE_COUNT];
+	struct sljit_compiler *compiler;
+	sljit_uw total_size = 0;
+	clock_t start;
+	double serialize_seconds, deserialize_seconds;
+	long i, j;
+
+	start = clock();
+	for (i = 0; i < SERIALIZE_COUNT; i++) {
+		buffers[i] = sljit_serialize_compiler(compilers[i], options, &sizes[i]);
+		if (buffers[i] == NULL) {
+			printf("  %-24s cannot serialize\n", name);
+			while (--i >= 0)
+				SLJIT_FREE(buffers[i], NULL);
+			return;
+		}
+		total_size += sizes[i];
+	}
+	serialize_seconds = (double)(clock() - start) / CLOCKS_PER_SEC;
+
+	start = clock();
+	for (j = 0; j < repeat; j++) {
+		for (i = 0; i < SERIALIZE_COUNT; i++) {
+			compiler = sljit_deserialize_compiler(buffers[i], sizes[i], deserialize_options, NULL);
+			if (compiler == NULL) {
+				printf("  %-24s cannot deserialize\n", name);
+				j = repeat;
+				break;
+			}
+			sljit_free_compiler(compiler);
+		}
+	}
+	deserialize_seconds = (double)(clock() - start) / CLOCKS_PER_SEC;
+
+	for (i = 0; i < SERIALIZE_COUNT; i++)
+		SLJIT_FREE(buffers[i], NULL);
+
+	printf("  %-24s %10lu bytes %8.1f us/serialize %8.1f us/deserialize %8.1f MB/s\n", name,
+		(unsigned long)total_size, serialize_seconds * 1e6 / SERIALIZE_COUNT,
+		deserialize_seconds * 1e6 / ((double)SERIALIZE_COUNT * (double)repeat),
+		deserialize_seconds > 0 ? (double)total_size * (double)repeat / deserialize_seconds / 1e6 : 0.0);
+}
+
+static void bench_serialize(const char *name, struct sljit_compiler *(*create_function)(sljit_s32), long repeat)
+{
+	struct sljit_compiler *compilers[SERIALIZE_COUNT];
+	sljit_s32 i;
+
+	for (i = 0; i < SERIALIZE_COUNT; i++) {
+		compilers[i] = create_function(i);
+		if (compilers[i] == NULL) {
+			printf("Not enough memory\n");
+			while (--i >= 0)
+				sljit_free_compiler(compilers[i]);
+			return;
+		}
+	}
+
+	printf("Serialization of %d %s functions, %ld deserializations each\n", SERIALIZE_COUNT, name, repeat);
+
+	bench_serialize_mode("default", 0, 0, repeat, compilers);
+	bench_serialize_mode("default, zero-copy", 0, SLJIT_DESERIALIZE_ZERO_COPY, repeat, compilers);
+	bench_serialize_mode("compact", SLJIT_SERIALIZE_COMPACT, 0, repeat, compilers);
+	bench_serialize_mode("compressed", SLJIT_SERIALIZE_COMPRESS, 0, repeat, compilers);
+
+	for (i = 0; i < SERIALIZE_COUNT; i++)
+		sljit_free_compiler(compilers[i]);
+}
+
+typedef sljit_sw (SLJIT_FUNC *image_func)(sljit_sw *data, sljit_sw count);
+
+/* The sizes and codes arrays have two parts: the first half is used
+   by the serialized compilers, and the second half by the images. */
+static void run_code_image_bench(sljit_uw **serialized, sljit_uw **images, sljit_uw *sizes, void **codes)
+{
+	struct sljit_compiler *compiler;
+	sljit_uw serialized_size = 0, image_size = 0;
+	sljit_sw data[16];
+	clock_t start;
+	double compile_seconds, deserialize_seconds, load_seconds;
+	sljit_uw targets[1];
+	sljit_s32 i;
+
+	targets[0] = SLJIT_FUNC_UADDR(serialize_function_helper);
+
+	for (i = 0; i < 16; i++)
+		data[i] = i * 0x1234567;
+
+	start = clock();
+	for (i = 0; i < IMAGE_COUNT; i++) {
+		compiler = create_serialize_function(i);
+		if (compiler == NULL)
+			break;
+
+		serialized[i] = sljit_serialize_compiler(compiler, 0, &sizes[i]);
+		codes[i] = sljit_generate_code(compiler, 0, NULL);
+		if (codes[i] != NULL)
+			images[i] = sljit_create_code_image(compiler, codes[i], targets, 1, 0, &sizes[IMAGE_COUNT + i]);
+		sljit_free_compiler(compiler);
+
+		if (serialized[i] == NULL || images[i] == NULL)
+			break;
+		serialized_size += sizes[i];
+		image_size += sizes[IMAGE_COUNT + i];
+	}
+	compile_seconds = (double)(clock() - start) / CLOCKS_PER_SEC;
+
+	if (i < IMAGE_COUNT) {
+		printf("Code images are not supported\n");
+		return;
+	}
+
+	for (i = 0; i < IMAGE_COUNT; i++) {
+		sljit_free_code(codes[i], NULL);
+		codes[i] = NULL;
+	}
+
+	/* The serialized compilers still need code generation. */
+	start = clock();
+	for (i = 0; i < IMAGE_COUNT; i++) {
+		compiler = sljit_deserialize_compiler(serialized[i], sizes[i], 0, NULL);
+		if (compiler == NULL)
+			break;
+		codes[i] = sljit_generate_code(compiler, 0, NULL);
+		sljit_free_compiler(compiler);
+		if (codes[i] == NULL)
+			break;
+	}
+	deserialize_seconds = (double)(clock() - start) / CLOCKS_PER_SEC;
+
+	start = clock();
+	for (i = 0; i < IMAGE_COUNT; i++) {
+		codes[IMAGE_COUNT + i] = sljit_load_code_image(images[i], sizes[IMAGE_COUNT + i], targets, 1, 0, NULL, NULL);
+		if (codes[IMAGE_COUNT + i] == NULL)
+			break;
+	}
+	load_seconds = (double)(clock() - start) / CLOCKS_PER_SEC;
+
+	for (i = 0; i < IMAGE_COUNT; i++) {
+		if (codes[i] == NULL || codes[IMAGE_COUNT + i] == NULL
+				|| ((image_func)SLJIT_FUNC_ADDR(codes[i]))(data, 3) != ((image_func)SLJIT_FUNC_ADDR(codes[IMAGE_COUNT + i]))(data, 3)) {
+			printf("Code image %d is wrong\n", i);
+			return;
+		}
+	}
+
+	printf("Startup time of %d functions\n", IMAGE_COUNT);
+	printf("  %-24s %8.1f ms\n", "compile + store", compile_seconds * 1e3);
+	printf("  %-24s %8.1f ms %10lu bytes\n", "deserialize + generate", deserialize_seconds * 1e3, (unsigned long)serialized_size);
+	printf("  %-24s %8.1f ms %10lu bytes\n", "load code image", load_seconds * 1e3, (unsigned long)image_size);
+}
+
+/* Compares the startup cost of compiling, deserializing and loading code images. */
+static void bench_code_image(void)
+{
+	sljit_uw **serialized = (sljit_uw**)calloc(IMAGE_COUNT, sizeof(sljit_uw*));
+	sljit_uw **images = (sljit_uw**)calloc(IMAGE_COUNT, sizeof(sljit_uw*));
+	sljit_uw *sizes = (sljit_uw*)calloc(2 * IMAGE_COUNT, sizeof(sljit_uw));
+	void **codes = (void**)calloc(2 * IMAGE_COUNT, sizeof(void*));
+	sljit_s32 i;
+
+	if (serialized && images && sizes && codes) {
+		run_code_image_bench(serialized, images, sizes, codes);
+
+		for (i = 0; i < IMAGE_COUNT; i++) {
+			if (serialized[i] != NULL)
+				SLJIT_FREE(serialized[i], NULL);
+			if (images[i] != NULL)
+				SLJIT_FREE(images[i], NULL);
+			if (codes[i] != NULL)
+				sljit_free_code(codes[i], NULL);
+			if (codes[IMAGE_COUNT + i] != NULL)
+				sljit_free_code(codes[IMAGE_COUNT + i], NULL);
+		}
+	} else
+		printf("Not enough memory\n");
+
+	free(serialized);
+	free(images);
+	free(sizes);
+	free(codes);
+}
+
+/* A filter expression: checks the fields of a record against limits. */
+static void emit_filter_function(struct sljit_compiler *compiler, sljit_s32 index)
+{
+	struct sljit_jump *jumps[16];
+	struct sljit_label *label;
+	sljit_s32 i;
+
+	sljit_emit_enter(compiler, 0, SLJIT_ARGS1(W, P), 2, 1, 0, 0, 0);
+	sljit_emit_op1(compiler, SLJIT_MOV, SLJIT_R0, 0, SLJIT_IMM, 0);
+
+	for (i = 0; i < 16; i++) {
+		sljit_emit_op1(compiler, SLJIT_MOV, SLJIT_R1, 0, SLJIT_MEM1(SLJIT_S0), (i & 0x7) * (sljit_sw)sizeof(sljit_sw));
+		jumps[i] = sljit_emit_cmp(compiler, SLJIT_LESS, SLJIT_R1, 0, SLJIT_IMM, (index * 31 + i * 7) & 0xff);
+	}
+
+	sljit_emit_op1(compiler, SLJIT_MOV, SLJIT_R0, 0, SLJIT_IMM, 1);
+	label = sljit_emit_label(compiler);
+	for (i = 0; i < 16; i++)
+		sljit_set_label(jumps[i], label);
+
+	sljit_emit_return(compiler, SLJIT_MOV, SLJIT_R0, 0);
+}
+
+static struct sljit_compiler *create_filter_function(sljit_s32 index)
+{
+	struct sljit_compiler *compiler = sljit_create_compiler(NULL);
+
+	if (compiler)
+		emit_filter_function(compiler, index);
+	return compiler;
+}
+
+typedef sljit_sw (SLJIT_FUNC *filter_func)(sljit_sw *record);
+
+/* The first half of codes is generated without, the second half with the cache. */
+static void run_code_cache_bench(struct sljit_code_cache *cache, void **codes)
+{
+	struct sljit_compiler *compiler;
+	struct sljit_code_cache_stats stats;
+	sljit_uw code_size = 0;
+	sljit_sw record[8];
+	clock_t start;
+	double generate_seconds, cached_seconds;
+	sljit_s32 i;
+
+	for (i = 0; i < 8; i++)
+		record[i] = 0x40 + i * 0x10;
+
+	start = clock();
+	for (i = 0; i < CACHE_COUNT; i++) {
+		compiler = create_filter_function(i % CACHE_DISTINCT);
+		if (compiler == NULL)
+			return;
+		codes[i] = sljit_generate_code(compiler, 0, NULL);
+		code_size += sljit_get_generated_code_size(compiler);
+		sljit_free_compiler(compiler);
+		if (codes[i] == NULL)
+			return;
+	}
+	generate_seconds = (double)(clock() - start) / CLOCKS_PER_SEC;
+
+	start = clock();
+	for (i = 0; i < CACHE_COUNT; i++) {
+		compiler = create_filter_function(i % CACHE_DISTINCT);
+		if (compiler == NULL)
+			return;
+		codes[CACHE_COUNT + i] = sljit_generate_cached_code(cache, compiler, 0);
+		sljit_free_compiler(compiler);
+		if (codes[CACHE_COUNT + i] == NULL)
+			return;
+	}
+	cached_seconds = (double)(clock() - start) / CLOCKS_PER_SEC;
+
+	for (i = 0; i < CACHE_COUNT; i++) {
+		if (((filter_func)SLJIT_FUNC_ADDR(codes[i]))(record) != ((filter_func)SLJIT_FUNC_ADDR(codes[CACHE_COUNT + i]))(record)) {
+			printf("Cached function %d is wrong\n", i);
+			return;
+		}
+	}
+
+	sljit_get_code_cache_stats(cache, &stats);
+
+	printf("Code cache of %d functions (%d distinct)\n", CACHE_COUNT, CACHE_DISTINCT);
+	printf("  %-24s %8.1f ms %10lu bytes\n", "generate", generate_seconds * 1e3, (unsigned long)code_size);
+	printf("  %-24s %8.1f ms %10lu bytes %8lu bytes metadata %8lu bytes saved\n", "generate cached",
+		cached_seconds * 1e3, (unsigned long)stats.code_size, (unsigned long)stats.metadata_size,
+		(unsigned long)stats.saved_size);
+}
+
+/* Measures the memory saved by sharing the code of identical functions. */
+static void bench_code_cache(void)
+{
+	struct sljit_code_cache *cache = sljit_create_code_cache(NULL, NULL);
+	void **codes = (void**)calloc(2 * CACHE_COUNT, sizeof(void*));
+	sljit_s32 i;
+
+	if (cache && codes) {
+		run_code_cache_bench(cache, codes);
+
+		for (i = 0; i < CACHE_COUNT; i++) {
+			if (codes[i] != NULL)
+				sljit_free_code(codes[i], NULL);
+			if (codes[CACHE_COUNT + i] != NULL)
+				sljit_free_code(codes[CACHE_COUNT + i], NULL);
+		}
+	} else
+		printf("Not enough memory\n");
+
+	if (cache)
+		sljit_free_code_cache(cache);
+	free(codes);
+}
+
+static double wall_clock(void)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (double)now.tv_sec + (double)now.tv_nsec / 1e9;
+}
+
+static void *generate_code_pool_thread(void *pool)
+{
+	sljit_generate_code_pool((struct sljit_code_pool*)pool);
+	return NULL;
+}
+
+static int create_pool_compilers(struct sljit_compiler **compilers)
+{
+	int i;
+
+	for (i = 0; i < POOL_COUNT; i++) {
+		compilers[i] = create_filter_function(i);
+		if (compilers[i] == NULL) {
+			while (--i >= 0)
+				sljit_free_compiler(compilers[i]);
+			return 0;
+		}
+	}
+	return 1;
+}
+
+static void free_pool_compilers(struct sljit_compiler **compilers)
+{
+	int i;
+
+	for (i = 0; i < POOL_COUNT; i++)
+		sljit_free_compiler(compilers[i]);
+}
+
+/* Only the code generation is measured, the compilers are created before. */
+static void run_code_pool_bench(struct sljit_compiler **compilers, sljit_sw *results)
+{
+	pthread_t threads[POOL_MAX_THREADS];
+	struct sljit_code_pool *pool;
+	void *code;
+	sljit_sw record[8];
+	double start, seconds;
+	int i, thread_count;
+
+	for (i = 0; i < 8; i++)
+		record[i] = 0x40 + i * 0x10;
+
+	if (!create_pool_compilers(compilers))
+		return;
+
+	start = wall_clock();
+	for (i = 0; i < POOL_COUNT; i++)
+		results[i] = (sljit_sw)sljit_generate_code(compilers[i], 0, NULL);
+	seconds = wall_clock() - start;
+	free_pool_compilers(compilers);
+
+	for (i = 0; i < POOL_COUNT; i++) {
+		if (results[i] == 0) {
+			printf("Cannot generate code\n");
+			return;
+		}
+		code = (void*)results[i];
+		results[i] = ((filter_func)SLJIT_FUNC_ADDR(code))(record);
+		sljit_free_code(code, NULL);
+	}
+
+	printf("Code generation of %d functions\n", POOL_COUNT);
+	printf("  %-24s %8.1f ms\n", "generate one by one", seconds * 1e3);
+
+	for (thread_count = 1; thread_count <= POOL_MAX_THREADS; thread_count *= 2) {
+		if (!create_pool_compilers(compilers))
+			return;
+
+		start = wall_clock();
+		pool = sljit_create_code_pool(compilers, POOL_COUNT, 0, NULL, NULL);
+		if (pool != NULL) {
+			for (i = 0; i < thread_count; i++)
+				pthread_create(threads + i, NULL, generate_code_pool_thread, pool);
+			for (i = 0; i < thread_count; i++)
+				pthread_join(threads[i], NULL);
+			if (sljit_publish_code_pool(pool) != SLJIT_SUCCESS) {
+				sljit_free_code_pool(pool);
+				pool = NULL;
+			}
+		}
+		seconds = wall_clock() - start;
+		free_pool_compilers(compilers);
+
+		if (pool == NULL) {
+			printf("Code pools are not supported\n");
+			return;
+		}
+
+		for (i = 0; i < POOL_COUNT; i++) {
+			code = sljit_get_code_pool_code(pool, (sljit_uw)i);
+			if (((filter_func)SLJIT_FUNC_ADDR(code))(record) != results[i]) {
+				printf("Pooled function %d is wrong\n", i);
+				break;
+			}
+		}
+		sljit_free_code_pool(pool);
+
+		printf("  code pool, %d thread%s      %8.1f ms\n", thread_count, thread_count == 1 ? " " : "s", seconds * 1e3);
+	}
+}
+
+/* Compares generating the code of many compilers one by one and in parallel. */
+static void bench_code_pool(void)
+{
+	struct sljit_compiler **compilers = (struct sljit_compiler**)calloc(POOL_COUNT, sizeof(struct sljit_compiler*));
+	sljit_sw *results = (sljit_sw*)calloc(POOL_COUNT, sizeof(sljit_sw));
+
+	if (compilers && results)
+		run_code_pool_bench(compilers, results);
+	else
+		printf("Not enough memory\n");
+
+	free(compilers);
+	free(results);
+}
+
+#if (defined SLJIT_STATISTICS && SLJIT_STATISTICS)
+
+#define STATS_COUNT 4096
+
+/* Shows where the compile time goes (requires -DSLJIT_STATISTICS=1). */
+static void bench_compile_stats(void)
+{
+	static const char *op_class_names[SLJIT_STATS_OP_CLASSES] = {
+		"enter", "op0", "op1", "op2", "fop", "mem", "jump", "flags", "simd", "atomic", "label", "other"
+	};
+	struct sljit_compiler *compiler;
+	struct sljit_compiler_stats stats;
+	void *code;
+	sljit_s32 i;
+
+	memset(&stats, 0, sizeof(stats));
+
+	for (i = 0; i < STATS_COUNT; i++) {
+		compiler = sljit_create_compiler(NULL);
+		if (compiler == NULL)
+			return;
+		sljit_compiler_stats(compiler, &stats);
+		emit_filter_function(compiler, i);
+		code = sljit_generate_code(compiler, 0, NULL);
+		sljit_free_compiler(compiler);
+		if (code == NULL)
+			return;
+		sljit_free_code(code, NULL);
+	}
+
+	printf("Compile statistics of %d functions\n", STATS_COUNT);
+	printf("  %-24s %8lu ns %8lu ns %8lu ns %8lu ns\n", "emit / reduce / alloc / encode",
+		(unsigned long)(stats.emit_time / STATS_COUNT), (unsigned long)(stats.reduce_time / STATS_COUNT),
+		(unsigned long)(stats.alloc_time / STATS_COUNT), (unsigned long)(stats.encode_time / STATS_COUNT));
+	printf("  %-24s %8lu bytes -> %lu bytes\n", "size reduction",
+		(unsigned long)stats.size_before_reduce, (unsigned long)stats.size_after_reduce);
+	printf("  %-24s %8lu of %lu\n", "shortened jumps",
+		(unsigned long)stats.shortened_jump_count, (unsigned long)stats.jump_count);
+	printf("  %-24s %8lu\n", "fragments", (unsigned long)stats.fragment_count);
+
+	for (i = 0; i < SLJIT_STATS_OP_CLASSES; i++)
+		if (stats.op_counts[i] != 0)
+			printf("  %-24s %8lu\n", op_class_names[i], (unsigned long)stats.op_counts[i]);
+}
+
+#endif /* SLJIT_STATISTICS */
+
+int main(int argc, char* argv[])
+{
+	long repeat = (argc > 1) ? atol(argv[1]) : 2000;
+	sljit_u32 *dict = (sljit_u32*)malloc(DICT_SIZE * sizeof(sljit_u32));
+	sljit_u32 *codes = (sljit_u32*)malloc(CODE_COUNT * sizeof(sljit_u32));
+	sljit_u32 *out = (sljit_u32*)malloc(CODE_COUNT * sizeof(sljit_u32));
+	sljit_u32 seed = 12345;
+	long i;
+
+	if (!dict || !codes || !out) {
+		printf("Not enough memory\n");
+		return 1;
+	}
+
+	for (i = 0; i < DICT_SIZE; i++)
+		dict[i] = (sljit_u32)(i * 2654435761u);
+
+	for (i = 0; i < CODE_COUNT; i++) {
+		seed = seed * 1103515245u + 12345u;
+		codes[i] = (seed >> 8) % DICT_SIZE;
+	}
+
+	printf("Dictionary decode of %d values (%d entries), %ld iterations on %s\n",
+		CODE_COUNT, DICT_SIZE, repeat, sljit_get_platform_name());
+
+	bench_decode("scalar", 0, 4, repeat, dict, codes, out);
+	if (sljit_has_cpu_feature(SLJIT_HAS_SIMD)) {
+		bench_decode("gather.128.32", SLJIT_SIMD_REG_128 | SLJIT_SIMD_ELEM_32, 16, repeat, dict, codes, out);
+		bench_decode("gather.256.32", SLJIT_SIMD_REG_256 | SLJIT_SIMD_ELEM_32, 32, repeat, dict, codes, out);
+	}
+
+	bench_serialize("mixed", create_serialize_function, repeat / 100 + 1);
+	bench_serialize("large", create_large_serialize_function, repeat / 1000 + 1);
+	bench_code_image();
+	bench_code_cache();
+	bench_code_pool();
+#if (defined SLJIT_STATISTICS && SLJIT_STATISTICS)
+	bench_compile_stats();
+#endif /* SLJIT_STATISTICS */
+
+	free(dict);
+	free(codes);
+	free(out);
+	return 0;
+}
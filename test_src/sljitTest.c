@@ -31,6 +31,14 @@
 #include <stdlib.h>
 #include <string.h>
 
+#if !(defined SLJIT_SINGLE_THREADED && SLJIT_SINGLE_THREADED)
+#if defined _WIN32 || defined _WIN64
+#include <windows.h>
+#else
+#include <pthread.h>
+#endif
+#endif
+
 #ifdef _MSC_VER
 #pragma warning(push)
 #pragma warning(disable: 4127) /* conditional expression is constant */
@@ -5408,7 +5416,7 @@ static void test51(void)
 	FAILED(buf[7] != offs4, "test51 case 9 failed\n");
 	FAILED(buf[8] != offs5, "test51 case 10 failed\n");
 
-	sljit_free_code(code.code, NULL);
+	FREE_EXEC(code_buffer.buffer);
 
 	successful_tests++;
 }
@@ -8702,6 +8710,254 @@ static void test74(void)
 #include "sljitTestMarg.h"
 #endif
 
+static void test75(void)
+{
+	/* Test cpu capability profiles. */
+	executable_code code;
+	struct sljit_compiler* compiler;
+	struct sljit_cpu_profile detected, lowered, current;
+	sljit_sw buf[4];
+	sljit_s32 result;
+
+	if (verbose)
+		printf("Run test75\n");
+
+	sljit_get_cpu_profile(&detected);
+
+	FAILED(!(detected.features & SLJIT_CPU_SIMD) != !sljit_has_cpu_feature(SLJIT_HAS_SIMD), "test75 case 1 failed\n");
+	FAILED(!(detected.features & SLJIT_CPU_CMOV) != !sljit_has_cpu_feature(SLJIT_HAS_CMOV), "test75 case 2 failed\n");
+	FAILED(!(detected.features & SLJIT_CPU_CLZ) != (sljit_has_cpu_feature(SLJIT_HAS_CLZ) != 1), "test75 case 3 failed\n");
+
+	/* Force the lowest tier. */
+	lowered.features = detected.features & ~(sljit_u32)(SLJIT_CPU_SIMD | SLJIT_CPU_CLZ | SLJIT_CPU_CTZ | SLJIT_CPU_CMOV
+		| SLJIT_CPU_AVX | SLJIT_CPU_AVX2 | SLJIT_CPU_LASX | SLJIT_CPU_SVE);
+	result = sljit_set_cpu_profile(&lowered);
+	FAILED(result != SLJIT_SUCCESS && result != SLJIT_ERR_UNSUPPORTED, "test75 case 4 failed\n");
+
+	sljit_get_cpu_profile(&current);
+	if (result == SLJIT_SUCCESS) {
+		FAILED(current.features != lowered.features, "test75 case 5 failed\n");
+		FAILED(sljit_has_cpu_feature(SLJIT_HAS_SIMD) != 0, "test75 case 6 failed\n");
+	} else
+		FAILED(current.features != detected.features, "test75 case 7 failed\n");
+
+	/* Code generated with the lowered profile must work as well. */
+	compiler = sljit_create_compiler(NULL);
+	FAILED(!compiler, "cannot create compiler\n");
+
+	buf[0] = -1;
+	buf[1] = -1;
+	buf[2] = -1;
+	buf[3] = -1;
+
+	sljit_emit_enter(compiler, 0, SLJIT_ARGS1V(P), 3, 1, 0, 0, 0);
+	sljit_emit_op1(compiler, SLJIT_MOV, SLJIT_R0, 0, SLJIT_IMM, 0x1000);
+	sljit_emit_op1(compiler, SLJIT_CLZ32, SLJIT_R1, 0, SLJIT_R0, 0);
+	/* buf[0] */
+	sljit_emit_op1(compiler, SLJIT_MOV, SLJIT_MEM1(SLJIT_S0), 0, SLJIT_R1, 0);
+	sljit_emit_op1(compiler, SLJIT_CTZ32, SLJIT_R1, 0, SLJIT_R0, 0);
+	/* buf[1] */
+	sljit_emit_op1(compiler, SLJIT_MOV, SLJIT_MEM1(SLJIT_S0), sizeof(sljit_sw), SLJIT_R1, 0);
+	sljit_emit_op1(compiler, SLJIT_MOV, SLJIT_R1, 0, SLJIT_IMM, 77);
+	sljit_emit_op2u(compiler, SLJIT_SUB | SLJIT_SET_SIG_LESS, SLJIT_R0, 0, SLJIT_IMM, 0x2000);
+	sljit_emit_select(compiler, SLJIT_SIG_LESS, SLJIT_R0, SLJIT_R1, 0, SLJIT_R0);
+	/* buf[2] */
+	sljit_emit_op1(compiler, SLJIT_MOV, SLJIT_MEM1(SLJIT_S0), 2 * sizeof(sljit_sw), SLJIT_R0, 0);
+	sljit_emit_return_void(compiler);
+
+	code.code = sljit_generate_code(compiler, 0, NULL);
+	CHECK(compiler);
+	sljit_free_compiler(compiler);
+
+	code.func1((sljit_sw)&buf);
+	sljit_free_code(code.code, NULL);
+
+	FAILED(buf[0] != 19, "test75 case 8 failed\n");
+	FAILED(buf[1] != 12, "test75 case 9 failed\n");
+	FAILED(buf[2] != 77, "test75 case 10 failed\n");
+	FAILED(buf[3] != -1, "test75 case 11 failed\n");
+
+	FAILED(sljit_set_cpu_profile(NULL) != SLJIT_SUCCESS, "test75 case 12 failed\n");
+	sljit_get_cpu_profile(&current);
+	FAILED(current.features != detected.features, "test75 case 13 failed\n");
+
+	successful_tests++;
+}
+
+#if !(defined SLJIT_SINGLE_THREADED && SLJIT_SINGLE_THREADED)
+
+#if defined _WIN32 || defined _WIN64
+
+static DWORD WINAPI test76_thread(LPVOID pool)
+{
+	return (DWORD)sljit_generate_code_pool((struct sljit_code_pool*)pool);
+}
+
+/* Returns with the number of compilers processed by a second thread. */
+static sljit_uw test76_generate_in_thread(struct sljit_code_pool *pool)
+{
+	HANDLE thread = CreateThread(NULL, 0, test76_thread, pool, 0, NULL);
+	DWORD result = 0;
+
+	if (thread == NULL)
+		return ~(sljit_uw)0;
+
+	WaitForSingleObject(thread, INFINITE);
+	GetExitCodeThread(thread, &result);
+	CloseHandle(thread);
+	return (sljit_uw)result;
+}
+
+#else /* !_WIN32 */
+
+static void* test76_thread(void *pool)
+{
+	return (void*)sljit_generate_code_pool((struct sljit_code_pool*)pool);
+}
+
+/* Returns with the number of compilers processed by a second thread. */
+static sljit_uw test76_generate_in_thread(struct sljit_code_pool *pool)
+{
+	pthread_t thread;
+	void *result = NULL;
+
+	if (pthread_create(&thread, NULL, test76_thread, pool) != 0)
+		return ~(sljit_uw)0;
+
+	pthread_join(thread, &result);
+	return (sljit_uw)result;
+}
+
+#endif /* _WIN32 */
+
+#endif /* !SLJIT_SINGLE_THREADED */
+
+static void test76(void)
+{
+	/* Test code pools. */
+	executable_code code;
+	struct sljit_compiler* compilers[8];
+	struct sljit_code_pool *pool;
+	struct sljit_jump *jump;
+	sljit_uw prev_addr;
+	sljit_s32 i, round;
+
+	if (verbose)
+		printf("Run test76\n");
+
+	/* The second round generates the code in another thread than
+	   the one which allocates, publishes and runs the code. */
+	for (round = 0; round < 2; round++) {
+#if (defined SLJIT_SINGLE_THREADED && SLJIT_SINGLE_THREADED)
+		if (round == 1)
+			break;
+#endif /* SLJIT_SINGLE_THREADED */
+
+		for (i = 0; i < 8; i++) {
+			compilers[i] = sljit_create_compiler(NULL);
+			FAILED(!compilers[i], "cannot create compiler\n");
+
+			sljit_emit_enter(compilers[i], 0, SLJIT_ARGS1(W, W), 1, 1, 0, 0, 0);
+			jump = sljit_emit_cmp(compilers[i], SLJIT_SIG_LESS, SLJIT_S0, 0, SLJIT_IMM, 0);
+			sljit_emit_op2(compilers[i], SLJIT_MUL, SLJIT_S0, 0, SLJIT_S0, 0, SLJIT_IMM, i + 1);
+			sljit_set_label(jump, sljit_emit_label(compilers[i]));
+			sljit_emit_op2(compilers[i], SLJIT_ADD, SLJIT_R0, 0, SLJIT_S0, 0, SLJIT_IMM, i * 100 + round);
+			sljit_emit_return(compilers[i], SLJIT_MOV, SLJIT_R0, 0);
+		}
+
+		pool = sljit_create_code_pool(compilers, 8, 0, NULL, NULL);
+		FAILED(!pool, "cannot create code pool\n");
+
+		/* Normally called by several threads. */
+		if (round == 0) {
+			FAILED(sljit_generate_code_pool(pool) != 8, "test76 case 1 failed\n");
+		}
+#if !(defined SLJIT_SINGLE_THREADED && SLJIT_SINGLE_THREADED)
+		else {
+			FAILED(test76_generate_in_thread(pool) != 8, "test76 case 1 failed\n");
+		}
+#endif /* !SLJIT_SINGLE_THREADED */
+		FAILED(sljit_generate_code_pool(pool) != 0, "test76 case 2 failed\n");
+		FAILED(sljit_publish_code_pool(pool) != SLJIT_SUCCESS, "test76 case 3 failed\n");
+
+		for (i = 0; i < 8; i++) {
+			FAILED(compilers[i]->error != SLJIT_ERR_COMPILED, "test76 case 4 failed\n");
+			sljit_free_compiler(compilers[i]);
+		}
+
+		prev_addr = 0;
+		for (i = 0; i < 8; i++) {
+			code.code = sljit_get_code_pool_code(pool, (sljit_uw)i);
+			FAILED(!code.code || (sljit_uw)code.code <= prev_addr, "test76 case 5 failed\n");
+			prev_addr = (sljit_uw)code.code;
+
+			FAILED(code.func1(5) != 5 * (i + 1) + i * 100 + round, "test76 case 6 failed\n");
+			FAILED(code.func1(-5) != -5 + i * 100 + round, "test76 case 7 failed\n");
+		}
+
+		sljit_free_code_pool(pool);
+	}
+
+	successful_tests++;
+}
+
+static void test77(void)
+{
+	/* Test compile time statistics. */
+#if (defined SLJIT_STATISTICS && SLJIT_STATISTICS)
+	executable_code code;
+	struct sljit_compiler* compiler;
+	struct sljit_compiler_stats stats;
+	struct sljit_jump *jump;
+	sljit_s32 i;
+
+	if (verbose)
+		printf("Run test77\n");
+
+	SLJIT_ZEROMEM(&stats, sizeof(stats));
+
+	/* The statistics of both compilers are collected. */
+	for (i = 0; i < 2; i++) {
+		compiler = sljit_create_compiler(NULL);
+		FAILED(!compiler, "cannot create compiler\n");
+		sljit_compiler_stats(compiler, &stats);
+
+		sljit_emit_enter(compiler, 0, SLJIT_ARGS1(W, W), 1, 1, 0, 0, 0);
+		jump = sljit_emit_cmp(compiler, SLJIT_SIG_LESS, SLJIT_S0, 0, SLJIT_IMM, 0);
+		sljit_emit_op2(compiler, SLJIT_ADD, SLJIT_S0, 0, SLJIT_S0, 0, SLJIT_IMM, 10);
+		sljit_set_label(jump, sljit_emit_label(compiler));
+		sljit_emit_op1(compiler, SLJIT_MOV, SLJIT_R0, 0, SLJIT_S0, 0);
+		sljit_emit_return(compiler, SLJIT_MOV, SLJIT_R0, 0);
+
+		code.code = sljit_generate_code(compiler, 0, NULL);
+		CHECK(compiler);
+		FAILED(stats.size_after_reduce < sljit_get_generated_code_size(compiler), "test77 case 1 failed\n");
+		sljit_free_compiler(compiler);
+
+		FAILED(code.func1(5) != 15, "test77 case 2 failed\n");
+		FAILED(code.func1(-5) != -5, "test77 case 3 failed\n");
+		sljit_free_code(code.code, NULL);
+	}
+
+	FAILED(stats.op_counts[SLJIT_STATS_ENTER] != 4, "test77 case 4 failed\n");
+	FAILED(stats.op_counts[SLJIT_STATS_OP1] != 2, "test77 case 5 failed\n");
+	FAILED(stats.op_counts[SLJIT_STATS_OP2] != 2, "test77 case 6 failed\n");
+	FAILED(stats.op_counts[SLJIT_STATS_JUMP] != 2, "test77 case 7 failed\n");
+	FAILED(stats.op_counts[SLJIT_STATS_LABEL] != 2, "test77 case 8 failed\n");
+	FAILED(stats.op_counts[SLJIT_STATS_FOP] != 0, "test77 case 9 failed\n");
+	FAILED(stats.fragment_count < 4, "test77 case 10 failed\n");
+	FAILED(stats.jump_count != 2, "test77 case 11 failed\n");
+	/* The forward jump is short. */
+	FAILED(stats.shortened_jump_count != 2, "test77 case 12 failed\n");
+	FAILED(stats.size_after_reduce >= stats.size_before_reduce, "test77 case 13 failed\n");
+#else /* !SLJIT_STATISTICS */
+	if (verbose)
+		printf("statistics are disabled, test77 is skipped\n");
+#endif /* SLJIT_STATISTICS */
+
+	successful_tests++;
+}
+
 int sljit_test(int argc, char* argv[])
 {
 	sljit_s32 has_arg = (argc >= 2 && argv[1][0] == '-' && argv[1][2] == '\0');
@@ -8789,6 +9045,9 @@ int sljit_test(int argc, char* argv[])
 	test72();
 	test73();
 	test74();
+	test75();
+	test76();
+	test77();
 
 	if (verbose)
 		printf("---- Call tests ----\n");
@@ -8851,10 +9110,14 @@ int sljit_test(int argc, char* argv[])
 		test_simd8();
 		test_simd9();
 		test_simd10();
+		test_simd11();
+		test_simd12();
+		test_simd13();
+		test_simd14();
 	} else {
 		if (verbose)
 			printf("no simd available, simd tests are skipped\n");
-		successful_tests += 10;
+		successful_tests += 14;
 	}
 
 	if (verbose)
@@ -8863,6 +9126,10 @@ int sljit_test(int argc, char* argv[])
 	test_serialize1();
 	test_serialize2();
 	test_serialize3();
+	test_serialize4();
+	test_serialize5();
+	test_serialize6();
+	test_serialize7();
 
 #if (defined SLJIT_SUPPORT_ALLOCA && SLJIT_SUPPORT_ALLOCA)
 	if (verbose)
@@ -8886,7 +9153,7 @@ int sljit_test(int argc, char* argv[])
 	sljit_free_unused_memory_exec();
 #endif
 
-#	define TEST_COUNT (122 + EXTRA_TESTS_ALLOCA + EXTRA_TESTS_MARG)
+#	define TEST_COUNT (133 + EXTRA_TESTS_ALLOCA + EXTRA_TESTS_MARG)
 
 	printf("SLJIT tests: ");
 	if (successful_tests == TEST_COUNT)
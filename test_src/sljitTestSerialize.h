@@ -363,3 +363,415 @@ static void test_serialize3(void)
 	sljit_free_code(code.code, NULL);
 	successful_tests++;
 }
+
+static void test_serialize4(void)
+{
+	/* Test compact and compressed serialization. */
+	executable_code code;
+	struct sljit_compiler* compiler = sljit_create_compiler(NULL);
+	struct sljit_compiler* loaded;
+	struct sljit_label *loop;
+	struct sljit_jump *jump;
+	sljit_sw executable_offset;
+	sljit_uw* serialized_buffer;
+	sljit_uw* compact_buffer;
+	sljit_uw* reserialized_buffer;
+	sljit_uw serialized_size;
+	sljit_uw compact_size;
+	sljit_uw reserialized_size;
+	sljit_uw size_index;
+	sljit_uw size_word;
+	sljit_sw buf[2];
+	sljit_s32 i, j;
+	static const sljit_s32 options[2] = { SLJIT_SERIALIZE_COMPACT, SLJIT_SERIALIZE_COMPRESS };
+
+	if (verbose)
+		printf("Run test_serialize4\n");
+
+	FAILED(!compiler, "cannot create compiler\n");
+	buf[0] = 0;
+	buf[1] = 0;
+
+	sljit_emit_enter(compiler, 0, SLJIT_ARGS1V(P), 3, 1, 0, 0, 0);
+	sljit_emit_op1(compiler, SLJIT_MOV, SLJIT_R0, 0, SLJIT_IMM, 0);
+	sljit_emit_op1(compiler, SLJIT_MOV, SLJIT_R1, 0, SLJIT_IMM, 100);
+
+	loop = sljit_emit_label(compiler);
+	for (i = 0; i < 256; i++) {
+		jump = sljit_emit_cmp(compiler, SLJIT_EQUAL, SLJIT_R1, 0, SLJIT_IMM, i + 1000);
+		sljit_emit_op2(compiler, SLJIT_ADD, SLJIT_R0, 0, SLJIT_R0, 0, SLJIT_IMM, i & 0x7);
+		sljit_set_label(jump, sljit_emit_label(compiler));
+	}
+	/* An unset jump. */
+	sljit_emit_cmp(compiler, SLJIT_EQUAL, SLJIT_R1, 0, SLJIT_IMM, -1);
+	sljit_emit_op2(compiler, SLJIT_SUB | SLJIT_SET_Z, SLJIT_R1, 0, SLJIT_R1, 0, SLJIT_IMM, 1);
+	jump = sljit_emit_jump(compiler, SLJIT_NOT_ZERO);
+	sljit_set_label(jump, loop);
+
+	/* buf[0] */
+	sljit_emit_op1(compiler, SLJIT_MOV, SLJIT_MEM1(SLJIT_S0), 0, SLJIT_R0, 0);
+	/* buf[1] */
+	sljit_emit_const(compiler, SLJIT_MEM1(SLJIT_S0), sizeof(sljit_sw), 0);
+
+	serialized_buffer = sljit_serialize_compiler(compiler, 0, &serialized_size);
+	FAILED(!serialized_buffer, "cannot serialize compiler\n");
+	sljit_free_compiler(compiler);
+
+	/* The deserialized compiler must produce the same buffer. */
+	compiler = sljit_deserialize_compiler(serialized_buffer, serialized_size, 0, NULL);
+	FAILED(!compiler, "cannot deserialize compiler\n");
+
+	for (i = 0; i < 2; i++) {
+		compact_buffer = sljit_serialize_compiler(compiler, options[i], &compact_size);
+		FAILED(!compact_buffer, "cannot serialize compiler\n");
+		FAILED(compact_size >= serialized_size, "test_serialize4 case 1 failed\n");
+		FAILED((compact_size & (sizeof(sljit_uw) - 1)) != 0, "test_serialize4 case 2 failed\n");
+
+		/* Truncated buffers are rejected. */
+		loaded = sljit_deserialize_compiler(compact_buffer, compact_size - sizeof(sljit_uw), 0, NULL);
+		FAILED(loaded != NULL, "test_serialize4 case 3 failed\n");
+
+		/* The payload size is stored after the header. */
+		size_index = sizeof(struct sljit_serialized_compiler) / sizeof(sljit_uw);
+
+		if (i == 0) {
+			/* The uncompressed payload fills the rest of the buffer. */
+			size_word = (compact_buffer[size_index] + sizeof(sljit_uw) - 1) & ~(sljit_uw)(sizeof(sljit_uw) - 1);
+			FAILED((size_index + 1) * sizeof(sljit_uw) + size_word != compact_size, "test_serialize4 case 5 failed\n");
+		}
+
+		/* Corrupted payload sizes are rejected without allocating them. */
+		size_word = compact_buffer[size_index];
+		compact_buffer[size_index] = compact_size * 0x10000;
+		loaded = sljit_deserialize_compiler(compact_buffer, compact_size, 0, NULL);
+		FAILED(loaded != NULL, "test_serialize4 case 6 failed\n");
+		compact_buffer[size_index] = ~(sljit_uw)0;
+		loaded = sljit_deserialize_compiler(compact_buffer, compact_size, 0, NULL);
+		FAILED(loaded != NULL, "test_serialize4 case 7 failed\n");
+		compact_buffer[size_index] = size_word;
+
+		loaded = sljit_deserialize_compiler(compact_buffer, compact_size, 0, NULL);
+		FAILED(!loaded, "cannot deserialize compiler\n");
+
+		/* Unlike the default encoding, the compact encoding has no uninitialized padding. */
+		reserialized_buffer = sljit_serialize_compiler(loaded, options[i], &reserialized_size);
+		sljit_free_compiler(loaded);
+		FAILED(!reserialized_buffer, "cannot serialize compiler\n");
+
+		j = reserialized_size == compact_size;
+		if (j)
+			j = memcmp(reserialized_buffer, compact_buffer, compact_size) == 0;
+		SLJIT_FREE(reserialized_buffer, NULL);
+		SLJIT_FREE(compact_buffer, NULL);
+		FAILED(!j, "test_serialize4 case 4 failed\n");
+	}
+
+	SLJIT_FREE(serialized_buffer, NULL);
+
+	compact_buffer = sljit_serialize_compiler(compiler, SLJIT_SERIALIZE_COMPRESS, &compact_size);
+	FAILED(!compact_buffer, "cannot serialize compiler\n");
+	sljit_free_compiler(compiler);
+
+	compiler = sljit_deserialize_compiler(compact_buffer, compact_size, 0, NULL);
+	SLJIT_FREE(compact_buffer, NULL);
+	FAILED(!compiler, "cannot deserialize compiler\n");
+
+	jump = sljit_get_first_jump(compiler);
+	while (sljit_jump_has_label(jump))
+		jump = sljit_get_next_jump(jump);
+	SLJIT_ASSERT(!sljit_jump_has_target(jump));
+	sljit_set_label(jump, sljit_emit_label(compiler));
+	sljit_emit_return_void(compiler);
+
+	code.code = sljit_generate_code(compiler, 0, NULL);
+	CHECK(compiler);
+	executable_offset = sljit_get_executable_offset(compiler);
+	sljit_set_const(sljit_get_const_addr(sljit_get_first_const(compiler)), 4321, executable_offset);
+	sljit_free_compiler(compiler);
+
+	code.func1((sljit_sw)&buf);
+	/* The sum of (i & 0x7) for 256 values is 32 * 28. */
+	FAILED(buf[0] != 100 * 32 * 28, "test_serialize4 case 5 failed\n");
+	FAILED(buf[1] != 4321, "test_serialize4 case 6 failed\n");
+
+	sljit_free_code(code.code, NULL);
+	successful_tests++;
+}
+
+static sljit_sw SLJIT_FUNC test_serialize5_f1(sljit_sw a, sljit_sw b)
+{
+	return a * 10 + b;
+}
+
+static sljit_sw SLJIT_FUNC test_serialize5_f2(sljit_sw a, sljit_sw b)
+{
+	return a * 100 + b;
+}
+
+static void test_serialize5(void)
+{
+	/* Test code images. */
+	executable_code code;
+	struct sljit_compiler* compiler = sljit_create_compiler(NULL);
+	struct sljit_label *label;
+	struct sljit_jump *jump;
+	sljit_sw executable_offset;
+	sljit_uw* image;
+	sljit_uw image_size;
+	sljit_uw targets[2];
+	sljit_sw buf[5];
+	sljit_f64 fbuf[3];
+	void *codes[2];
+	sljit_s32 i;
+
+	if (verbose)
+		printf("Run test_serialize5\n");
+
+	FAILED(!compiler, "cannot create compiler\n");
+
+	sljit_emit_enter(compiler, 0, SLJIT_ARGS2V(P, P), 3, 2, 1, 0, 0);
+	/* buf[0] */
+	jump = sljit_emit_mov_addr(compiler, SLJIT_MEM1(SLJIT_S0), 0);
+	sljit_emit_op1(compiler, SLJIT_MOV, SLJIT_R0, 0, SLJIT_IMM, 7);
+	sljit_emit_op1(compiler, SLJIT_MOV, SLJIT_R1, 0, SLJIT_IMM, 3);
+	/* buf[1] */
+	sljit_emit_icall(compiler, SLJIT_CALL, SLJIT_ARGS2(W, W, W), SLJIT_IMM, SLJIT_FUNC_ADDR(test_serialize5_f1));
+	sljit_emit_op1(compiler, SLJIT_MOV, SLJIT_MEM1(SLJIT_S0), sizeof(sljit_sw), SLJIT_RETURN_REG, 0);
+	/* buf[2] */
+	sljit_emit_const(compiler, SLJIT_MEM1(SLJIT_S0), 2 * sizeof(sljit_sw), -1);
+	sljit_set_label(jump, sljit_emit_label(compiler));
+
+	/* buf[3] */
+	sljit_emit_op1(compiler, SLJIT_MOV, SLJIT_MEM1(SLJIT_S0), 3 * sizeof(sljit_sw), SLJIT_IMM, 0);
+	jump = sljit_emit_jump(compiler, SLJIT_JUMP | SLJIT_REWRITABLE_JUMP);
+	sljit_emit_op1(compiler, SLJIT_MOV, SLJIT_MEM1(SLJIT_S0), 3 * sizeof(sljit_sw), SLJIT_IMM, -1);
+	label = sljit_emit_label(compiler);
+	sljit_set_label(jump, label);
+	sljit_emit_op2(compiler, SLJIT_ADD, SLJIT_MEM1(SLJIT_S0), 3 * sizeof(sljit_sw), SLJIT_MEM1(SLJIT_S0), 3 * sizeof(sljit_sw), SLJIT_IMM, 5);
+
+	/* buf[4] */
+	jump = sljit_emit_mov_addr(compiler, SLJIT_R0, 0);
+	sljit_set_label(jump, label);
+	sljit_emit_op1(compiler, SLJIT_MOV, SLJIT_MEM1(SLJIT_S0), 4 * sizeof(sljit_sw), SLJIT_R0, 0);
+
+	if (sljit_has_cpu_feature(SLJIT_HAS_FPU)) {
+		/* fbuf[1], fbuf[2]: uses the static data of sljit on some targets. */
+		sljit_emit_fop1(compiler, SLJIT_NEG_F64, SLJIT_MEM1(SLJIT_S1), sizeof(sljit_f64), SLJIT_MEM1(SLJIT_S1), 0);
+		sljit_emit_fop1(compiler, SLJIT_ABS_F64, SLJIT_MEM1(SLJIT_S1), 2 * sizeof(sljit_f64), SLJIT_MEM1(SLJIT_S1), sizeof(sljit_f64));
+	}
+	sljit_emit_return_void(compiler);
+
+	code.code = sljit_generate_code(compiler, 0, NULL);
+	CHECK(compiler);
+
+	/* The call target is missing from the list. */
+	targets[0] = SLJIT_FUNC_UADDR(test_serialize5_f2);
+	image = sljit_create_code_image(compiler, code.code, targets, 1, 0, &image_size);
+	FAILED(image != NULL, "test_serialize5 case 1 failed\n");
+
+	targets[1] = SLJIT_FUNC_UADDR(test_serialize5_f1);
+	image = sljit_create_code_image(compiler, code.code, targets, 2, 0, &image_size);
+	sljit_free_compiler(compiler);
+	sljit_free_code(code.code, NULL);
+
+#if (defined SLJIT_CONFIG_X86 && SLJIT_CONFIG_X86)
+	FAILED(!image, "cannot create code image\n");
+#else /* !SLJIT_CONFIG_X86 */
+	if (image == NULL) {
+		if (verbose)
+			printf("code images are not supported\n");
+		successful_tests++;
+		return;
+	}
+#endif /* SLJIT_CONFIG_X86 */
+
+	/* Load the image twice to get two different code addresses. The
+	   second image calls test_serialize5_f2 instead of test_serialize5_f1. */
+	for (i = 0; i < 2; i++) {
+		if (i == 1) {
+			targets[0] = SLJIT_FUNC_UADDR(test_serialize5_f1);
+			targets[1] = SLJIT_FUNC_UADDR(test_serialize5_f2);
+		}
+
+		codes[i] = sljit_load_code_image(image, image_size, targets, 2, 0, NULL, &executable_offset);
+		FAILED(!codes[i], "cannot load code image\n");
+
+		sljit_set_const(sljit_get_code_image_const_addr(image, 0, codes[i], executable_offset), 1234 + i, executable_offset);
+	}
+
+	for (i = 0; i < 2; i++) {
+		buf[0] = 0;
+		buf[1] = 0;
+		buf[2] = 0;
+		buf[3] = 0;
+		buf[4] = 0;
+		fbuf[0] = 4.5;
+		fbuf[1] = 0.0;
+		fbuf[2] = 0.0;
+
+		code.code = codes[i];
+		code.func2((sljit_sw)&buf, (sljit_sw)&fbuf);
+		FAILED(buf[0] != (sljit_sw)sljit_get_code_image_label_addr(image, 0, codes[i]), "test_serialize5 case 2 failed\n");
+		FAILED(buf[1] != (i == 0 ? 73 : 703), "test_serialize5 case 3 failed\n");
+		FAILED(buf[2] != 1234 + i, "test_serialize5 case 4 failed\n");
+		FAILED(buf[3] != 5, "test_serialize5 case 5 failed\n");
+		FAILED(buf[4] != (sljit_sw)sljit_get_code_image_label_addr(image, 1, codes[i]), "test_serialize5 case 6 failed\n");
+
+		if (sljit_has_cpu_feature(SLJIT_HAS_FPU)) {
+			FAILED(fbuf[1] != -4.5, "test_serialize5 case 7 failed\n");
+			FAILED(fbuf[2] != 4.5, "test_serialize5 case 8 failed\n");
+		}
+	}
+
+	/* Damaged images are rejected. */
+	FAILED(sljit_load_code_image(image, image_size - sizeof(sljit_uw), targets, 2, 0, NULL, NULL) != NULL, "test_serialize5 case 9 failed\n");
+	/* Missing targets are rejected. */
+	FAILED(sljit_load_code_image(image, image_size, targets, 1, 0, NULL, NULL) != NULL, "test_serialize5 case 10 failed\n");
+
+	SLJIT_FREE(image, NULL);
+	sljit_free_code(codes[0], NULL);
+	sljit_free_code(codes[1], NULL);
+	successful_tests++;
+}
+
+static void test_serialize6(void)
+{
+	/* Test zero-copy deserialization. */
+	executable_code code;
+	struct sljit_compiler* compiler = sljit_create_compiler(NULL);
+	sljit_uw* serialized_buffer;
+	sljit_uw* copy;
+	sljit_uw serialized_size;
+	sljit_sw buf[2];
+	sljit_s32 i;
+
+	if (verbose)
+		printf("Run test_serialize6\n");
+
+	FAILED(!compiler, "cannot create compiler\n");
+	buf[0] = 0;
+	buf[1] = 0;
+
+	sljit_emit_enter(compiler, 0, SLJIT_ARGS1V(P), 2, 1, 0, 0, 0);
+	sljit_emit_op1(compiler, SLJIT_MOV, SLJIT_R0, 0, SLJIT_IMM, 11);
+
+	/* Several instruction fragments are needed. */
+	for (i = 0; i < 4096; i++)
+		sljit_emit_op2(compiler, SLJIT_ADD, SLJIT_R0, 0, SLJIT_R0, 0, SLJIT_IMM, i & 0xff);
+
+	serialized_buffer = sljit_serialize_compiler(compiler, 0, &serialized_size);
+	FAILED(!serialized_buffer, "cannot serialize compiler\n");
+	sljit_free_compiler(compiler);
+
+	copy = (sljit_uw*)SLJIT_MALLOC(serialized_size, NULL);
+	FAILED(!copy, "cannot allocate memory\n");
+	memcpy(copy, serialized_buffer, serialized_size);
+
+	compiler = sljit_deserialize_compiler(serialized_buffer, serialized_size, SLJIT_DESERIALIZE_ZERO_COPY, NULL);
+	FAILED(!compiler, "cannot deserialize compiler\n");
+
+	/* buf[0] */
+	sljit_emit_op1(compiler, SLJIT_MOV, SLJIT_MEM1(SLJIT_S0), 0, SLJIT_R0, 0);
+	for (i = 0; i < 1024; i++)
+		sljit_emit_op2(compiler, SLJIT_SUB, SLJIT_R0, 0, SLJIT_R0, 0, SLJIT_IMM, 1);
+	/* buf[1] */
+	sljit_emit_op1(compiler, SLJIT_MOV, SLJIT_MEM1(SLJIT_S0), sizeof(sljit_sw), SLJIT_R0, 0);
+	sljit_emit_return_void(compiler);
+
+	code.code = sljit_generate_code(compiler, 0, NULL);
+	CHECK(compiler);
+	sljit_free_compiler(compiler);
+
+	/* The referenced buffer must not be modified. */
+	i = memcmp(copy, serialized_buffer, serialized_size) == 0;
+	SLJIT_FREE(serialized_buffer, NULL);
+	SLJIT_FREE(copy, NULL);
+	FAILED(!i, "test_serialize6 case 1 failed\n");
+
+	code.func1((sljit_sw)&buf);
+	FAILED(buf[0] != 11 + 16 * (255 * 256 / 2), "test_serialize6 case 2 failed\n");
+	FAILED(buf[1] != 11 + 16 * (255 * 256 / 2) - 1024, "test_serialize6 case 3 failed\n");
+
+	sljit_free_code(code.code, NULL);
+	successful_tests++;
+}
+
+static struct sljit_compiler* test_serialize7_create(sljit_sw value, sljit_s32 use_const, struct sljit_label **label)
+{
+	struct sljit_compiler* compiler = sljit_create_compiler(NULL);
+	struct sljit_jump *jump;
+
+	if (compiler == NULL)
+		return NULL;
+
+	sljit_emit_enter(compiler, 0, SLJIT_ARGS1(W, W), 2, 1, 0, 0, 0);
+	jump = sljit_emit_jump(compiler, SLJIT_JUMP);
+	sljit_emit_op1(compiler, SLJIT_MOV, SLJIT_S0, 0, SLJIT_IMM, -1);
+	*label = sljit_emit_label(compiler);
+	sljit_set_label(jump, *label);
+	if (use_const)
+		sljit_emit_const(compiler, SLJIT_R1, 0, 0);
+	sljit_emit_op2(compiler, SLJIT_ADD, SLJIT_R0, 0, SLJIT_S0, 0, SLJIT_IMM, value);
+	sljit_emit_return(compiler, SLJIT_MOV, SLJIT_R0, 0);
+	return compiler;
+}
+
+static void test_serialize7(void)
+{
+	/* Test the code cache. */
+	executable_code code[5];
+	struct sljit_code_cache *cache = sljit_create_code_cache(NULL, NULL);
+	struct sljit_code_cache_stats stats;
+	struct sljit_compiler* compiler;
+	struct sljit_label *label;
+	sljit_uw label_addr[2];
+	sljit_s32 i;
+
+	if (verbose)
+		printf("Run test_serialize7\n");
+
+	FAILED(!cache, "cannot create code cache\n");
+
+	for (i = 0; i < 5; i++) {
+		/* Functions 0, 1, 3 are the same, and 4 is
+		   similar to 0, but it has a const. */
+		compiler = test_serialize7_create(i == 2 ? 20 : 10, i == 4, &label);
+		FAILED(!compiler, "cannot create compiler\n");
+
+		code[i].code = sljit_generate_cached_code(cache, compiler, 0);
+		CHECK(compiler);
+		if (i <= 1)
+			label_addr[i] = sljit_get_label_addr(label);
+		sljit_free_compiler(compiler);
+		FAILED(!code[i].code, "cannot generate code\n");
+	}
+
+	FAILED(code[0].code != code[1].code || code[0].code != code[3].code, "test_serialize7 case 1 failed\n");
+	FAILED(code[0].code == code[2].code || code[0].code == code[4].code, "test_serialize7 case 2 failed\n");
+	FAILED(label_addr[0] != label_addr[1] || label_addr[0] <= (sljit_uw)code[0].code, "test_serialize7 case 3 failed\n");
+
+	FAILED(code[1].func1(5) != 15, "test_serialize7 case 4 failed\n");
+	FAILED(code[2].func1(5) != 25, "test_serialize7 case 5 failed\n");
+	FAILED(code[4].func1(6) != 16, "test_serialize7 case 6 failed\n");
+
+	sljit_get_code_cache_stats(cache, &stats);
+	FAILED(stats.function_count != 3 || stats.reference_count != 5, "test_serialize7 case 7 failed\n");
+	FAILED(stats.saved_size == 0 || stats.code_size == 0 || stats.metadata_size == 0, "test_serialize7 case 8 failed\n");
+
+	/* The shared code is kept until its last reference is freed. */
+	sljit_free_code(code[0].code, NULL);
+	sljit_free_code(code[1].code, NULL);
+	FAILED(code[3].func1(7) != 17, "test_serialize7 case 9 failed\n");
+	sljit_free_code(code[2].code, NULL);
+
+	sljit_get_code_cache_stats(cache, &stats);
+	FAILED(stats.function_count != 2 || stats.reference_count != 2 || stats.saved_size != 0, "test_serialize7 case 10 failed\n");
+
+	sljit_free_code(code[3].code, NULL);
+	sljit_get_code_cache_stats(cache, &stats);
+	FAILED(stats.function_count != 1 || stats.reference_count != 1, "test_serialize7 case 11 failed\n");
+
+	/* The remaining code is freed with the cache. */
+	sljit_free_code_cache(cache);
+	successful_tests++;
+}
@@ -2621,5 +2621,787 @@ static void test_simd10(void)
 	successful_tests++;
 }
 
+static void test_simd11(void)
+{
+	/* Test vector length agnostic loops. */
+	executable_code code;
+	struct sljit_compiler* compiler = sljit_create_compiler(NULL);
+	struct sljit_label *label;
+	struct sljit_jump *jump;
+	sljit_s32 i, type;
+	sljit_u32 src[37];
+	sljit_u32 dst[38];
+	sljit_u8 bytes[19];
+	sljit_sw lanes[2];
+
+	if (verbose)
+		printf("Run test_simd11\n");
+
+	FAILED(!compiler, "cannot create compiler\n");
+
+	sljit_emit_enter(compiler, 0, SLJIT_ARGS3V(P, P, P), 2, 3, 3, 0, 0);
+
+	type = SLJIT_SIMD_REG_SCALABLE | SLJIT_SIMD_ELEM_32;
+
+	if (sljit_emit_simd_while(compiler, type | SLJIT_SIMD_TEST, SLJIT_R0, 0, SLJIT_IMM, 37) == SLJIT_ERR_UNSUPPORTED) {
+		if (verbose)
+			printf("scalable simd registers are not available, test_simd11 skipped\n");
+		sljit_free_compiler(compiler);
+		successful_tests++;
+		return;
+	}
+
+	for (i = 0; i < 37; i++)
+		src[i] = (sljit_u32)(i * 0x1111);
+	for (i = 0; i < 38; i++)
+		dst[i] = 0xaaaaaaaa;
+	for (i = 0; i < 19; i++)
+		bytes[i] = (sljit_u8)(i + 1);
+	lanes[0] = 0;
+	lanes[1] = 0;
+
+	/* dst[i] = (src[i] ^ 0x500) & 0xffff0fff */
+	sljit_emit_simd_replicate(compiler, type, SLJIT_FR1, SLJIT_IMM, 0x500);
+	sljit_emit_simd_replicate(compiler, type, SLJIT_FR2, SLJIT_IMM, 0xffff0fff);
+	sljit_emit_op1(compiler, SLJIT_MOV, SLJIT_R0, 0, SLJIT_IMM, 0);
+
+	label = sljit_emit_label(compiler);
+	sljit_emit_simd_while(compiler, type, SLJIT_R0, 0, SLJIT_IMM, 37);
+	jump = sljit_emit_jump(compiler, SLJIT_ZERO);
+	sljit_emit_simd_mov(compiler, SLJIT_SIMD_LOAD | type, SLJIT_FR0, SLJIT_MEM2(SLJIT_S0, SLJIT_R0), 2);
+	sljit_emit_simd_op2(compiler, SLJIT_SIMD_OP2_XOR | type, SLJIT_FR0, SLJIT_FR0, SLJIT_FR1, 0);
+	sljit_emit_simd_op2(compiler, SLJIT_SIMD_OP2_AND | type, SLJIT_FR0, SLJIT_FR0, SLJIT_FR2, 0);
+	sljit_emit_simd_mov(compiler, SLJIT_SIMD_STORE | type, SLJIT_FR0, SLJIT_MEM2(SLJIT_S1, SLJIT_R0), 2);
+	sljit_emit_simd_lane_count(compiler, type, SLJIT_R1, 0);
+	sljit_emit_op2(compiler, SLJIT_ADD, SLJIT_R0, 0, SLJIT_R0, 0, SLJIT_R1, 0);
+	sljit_set_label(sljit_emit_jump(compiler, SLJIT_JUMP), label);
+	sljit_set_label(jump, sljit_emit_label(compiler));
+
+	/* bytes[i] = bytes[i] | 0x80, the base address is not a multiple of the lane size. */
+	type = SLJIT_SIMD_REG_SCALABLE | SLJIT_SIMD_ELEM_8;
+	sljit_emit_simd_replicate(compiler, type, SLJIT_FR1, SLJIT_IMM, 0x80);
+	sljit_emit_op2(compiler, SLJIT_ADD, SLJIT_R1, 0, SLJIT_S2, 0, SLJIT_IMM, 1);
+	sljit_emit_op1(compiler, SLJIT_MOV, SLJIT_R0, 0, SLJIT_IMM, 0);
+
+	label = sljit_emit_label(compiler);
+	sljit_emit_simd_while(compiler, type, SLJIT_R0, 0, SLJIT_IMM, 17);
+	jump = sljit_emit_jump(compiler, SLJIT_ZERO);
+	sljit_emit_simd_op2(compiler, SLJIT_SIMD_OP2_OR | type, SLJIT_FR0, SLJIT_FR1, SLJIT_MEM2(SLJIT_R1, SLJIT_R0), 0);
+	sljit_emit_simd_mov(compiler, SLJIT_SIMD_STORE | type, SLJIT_FR0, SLJIT_MEM2(SLJIT_R1, SLJIT_R0), 0);
+	sljit_emit_simd_lane_count(compiler, type, SLJIT_MEM0(), (sljit_sw)&lanes[0]);
+	sljit_emit_op2(compiler, SLJIT_ADD, SLJIT_R0, 0, SLJIT_R0, 0, SLJIT_MEM0(), (sljit_sw)&lanes[0]);
+	sljit_set_label(sljit_emit_jump(compiler, SLJIT_JUMP), label);
+	sljit_set_label(jump, sljit_emit_label(compiler));
+
+	sljit_emit_simd_lane_count(compiler, SLJIT_SIMD_REG_SCALABLE | SLJIT_SIMD_ELEM_64, SLJIT_MEM0(), (sljit_sw)&lanes[1]);
+
+	sljit_emit_return_void(compiler);
+
+	code.code = sljit_generate_code(compiler, 0, NULL);
+	CHECK(compiler);
+	sljit_free_compiler(compiler);
+
+	code.func3((sljit_sw)src, (sljit_sw)dst, (sljit_sw)bytes);
+	sljit_free_code(code.code, NULL);
+
+	for (i = 0; i < 37; i++)
+		FAILED(dst[i] != (((sljit_u32)(i * 0x1111) ^ 0x500) & 0xffff0fff), "test_simd11 case 1 failed\n");
+	FAILED(dst[37] != 0xaaaaaaaa, "test_simd11 case 2 failed\n");
+
+	FAILED(bytes[0] != 1 || bytes[18] != 19, "test_simd11 case 3 failed\n");
+	for (i = 1; i < 18; i++)
+		FAILED(bytes[i] != (sljit_u8)((i + 1) | 0x80), "test_simd11 case 4 failed\n");
+
+	FAILED(lanes[0] < 16 || (lanes[0] & 0xf) != 0, "test_simd11 case 5 failed\n");
+	FAILED(lanes[1] != (lanes[0] >> 3), "test_simd11 case 6 failed\n");
+
+	successful_tests++;
+}
+
+static void test_simd12(void)
+{
+	/* Test simd gather and scatter operations. */
+	executable_code code;
+	struct sljit_compiler* compiler;
+	sljit_s32 options = 0;
+	sljit_s32 i, type, scale;
+	sljit_s32 supported[6];
+	sljit_u32 ibuf[40];
+	sljit_u32 obuf[36];
+	sljit_f64 dbuf[6];
+	sljit_sw wbuf[2];
+
+	if (verbose)
+		printf("Run test_simd12\n");
+
+	SIMD_RUN_START
+
+	for (i = 0; i < 16; i++)
+		ibuf[i] = (sljit_u32)(0x1000 + i * 0x11);
+	ibuf[16] = 5;
+	ibuf[17] = (sljit_u32)-2;
+	ibuf[18] = 0;
+	ibuf[19] = 7;
+	ibuf[20] = 3;
+	ibuf[21] = 0;
+	ibuf[22] = 2;
+	ibuf[23] = 1;
+	for (i = 24; i < 40; i++)
+		ibuf[i] = 0xaaaaaaaa;
+	for (i = 0; i < 36; i++)
+		obuf[i] = 0xaaaaaaaa;
+	for (i = 0; i < 4; i++)
+		dbuf[i] = (sljit_f64)i + 1.5;
+	dbuf[4] = -1.0;
+	dbuf[5] = -1.0;
+	wbuf[0] = 3;
+	wbuf[1] = 1;
+
+	compiler = sljit_create_compiler(NULL);
+	FAILED(!compiler, "cannot create compiler\n");
+
+	sljit_emit_enter(compiler, options, SLJIT_ARGS3V(P, P, P), 4, 4, 6, 0, 0);
+
+	type = SLJIT_SIMD_REG_128 | SLJIT_SIMD_ELEM_32;
+	scale = SLJIT_SIMD_SCALE_4;
+	supported[0] = sljit_emit_simd_gather(compiler, type | scale | SLJIT_SIMD_TEST, SLJIT_FR0, SLJIT_FR1, SLJIT_MEM1(SLJIT_S0), 0) != SLJIT_ERR_UNSUPPORTED;
+	if (supported[0]) {
+		sljit_emit_simd_mov(compiler, SLJIT_SIMD_LOAD | type, SLJIT_FR1, SLJIT_MEM1(SLJIT_S0), 16 * sizeof(sljit_u32));
+		/* The base address points to ibuf[4], so negative indices are valid. */
+		sljit_emit_simd_gather(compiler, type | scale, SLJIT_FR0, SLJIT_FR1, SLJIT_MEM1(SLJIT_S0), 4 * sizeof(sljit_u32));
+		/* obuf[0] */
+		sljit_emit_simd_mov(compiler, SLJIT_SIMD_STORE | type, SLJIT_FR0, SLJIT_MEM1(SLJIT_S2), 0);
+
+		/* The destination is the index register. */
+		sljit_emit_simd_mov(compiler, SLJIT_SIMD_LOAD | type, SLJIT_FR3, SLJIT_MEM1(SLJIT_S0), 20 * sizeof(sljit_u32));
+		sljit_emit_op2(compiler, SLJIT_ADD, SLJIT_R1, 0, SLJIT_S0, 0, SLJIT_IMM, 8 * sizeof(sljit_u32));
+		sljit_emit_simd_gather(compiler, type | scale, SLJIT_FR3, SLJIT_FR3, SLJIT_MEM1(SLJIT_R1), 0);
+		/* obuf[4] */
+		sljit_emit_simd_mov(compiler, SLJIT_SIMD_STORE | type, SLJIT_FR3, SLJIT_MEM1(SLJIT_S2), 4 * sizeof(sljit_u32));
+
+		/* Absolute address. */
+		sljit_emit_simd_gather(compiler, type | scale, SLJIT_FR2, SLJIT_FR1, SLJIT_MEM0(), (sljit_sw)(ibuf + 8));
+		/* obuf[8] */
+		sljit_emit_simd_mov(compiler, SLJIT_SIMD_STORE | type, SLJIT_FR2, SLJIT_MEM1(SLJIT_S2), 8 * sizeof(sljit_u32));
+	}
+
+	type = SLJIT_SIMD_REG_128 | SLJIT_SIMD_ELEM_32;
+	scale = SLJIT_SIMD_SCALE_4;
+	supported[1] = sljit_emit_simd_gather(compiler, SLJIT_SIMD_STORE | type | scale | SLJIT_SIMD_TEST, SLJIT_FR0, SLJIT_FR1, SLJIT_MEM1(SLJIT_S0), 0) != SLJIT_ERR_UNSUPPORTED;
+	if (supported[1]) {
+		sljit_emit_simd_mov(compiler, SLJIT_SIMD_LOAD | type, SLJIT_FR1, SLJIT_MEM1(SLJIT_S0), 20 * sizeof(sljit_u32));
+		sljit_emit_simd_mov(compiler, SLJIT_SIMD_LOAD | type, SLJIT_FR4, SLJIT_MEM1(SLJIT_S0), 0);
+		/* ibuf[24] */
+		sljit_emit_simd_gather(compiler, SLJIT_SIMD_STORE | type | scale, SLJIT_FR4, SLJIT_FR1, SLJIT_MEM1(SLJIT_S0), 24 * sizeof(sljit_u32));
+	}
+
+	type = SLJIT_SIMD_REG_128 | SLJIT_SIMD_FLOAT | SLJIT_SIMD_ELEM_32;
+	scale = SLJIT_SIMD_SCALE_4;
+	supported[2] = sljit_emit_simd_gather(compiler, type | scale | SLJIT_SIMD_TEST, SLJIT_FR0, SLJIT_FR1, SLJIT_MEM1(SLJIT_S0), 0) != SLJIT_ERR_UNSUPPORTED;
+	if (supported[2]) {
+		sljit_emit_simd_mov(compiler, SLJIT_SIMD_LOAD | SLJIT_SIMD_REG_128 | SLJIT_SIMD_ELEM_32, SLJIT_FR1, SLJIT_MEM1(SLJIT_S0), 16 * sizeof(sljit_u32));
+		sljit_emit_simd_gather(compiler, type | scale, SLJIT_FR0, SLJIT_FR1, SLJIT_MEM1(SLJIT_S0), 4 * sizeof(sljit_u32));
+		/* obuf[12] */
+		sljit_emit_simd_mov(compiler, SLJIT_SIMD_STORE | type, SLJIT_FR0, SLJIT_MEM1(SLJIT_S2), 12 * sizeof(sljit_u32));
+	}
+
+#if IS_64BIT
+	type = SLJIT_SIMD_REG_128 | SLJIT_SIMD_FLOAT | SLJIT_SIMD_ELEM_64;
+	scale = SLJIT_SIMD_SCALE_8;
+	supported[3] = sljit_emit_simd_gather(compiler, type | scale | SLJIT_SIMD_TEST, SLJIT_FR0, SLJIT_FR1, SLJIT_MEM1(SLJIT_S1), 0) != SLJIT_ERR_UNSUPPORTED;
+	if (supported[3]) {
+		sljit_emit_op1(compiler, SLJIT_MOV, SLJIT_R0, 0, SLJIT_IMM, (sljit_sw)wbuf);
+		sljit_emit_simd_mov(compiler, SLJIT_SIMD_LOAD | SLJIT_SIMD_REG_128 | SLJIT_SIMD_ELEM_64, SLJIT_FR1, SLJIT_MEM1(SLJIT_R0), 0);
+		sljit_emit_simd_gather(compiler, type | scale, SLJIT_FR0, SLJIT_FR1, SLJIT_MEM1(SLJIT_S1), 0);
+		sljit_emit_simd_gather(compiler, SLJIT_SIMD_STORE | type | scale, SLJIT_FR0, SLJIT_FR1, SLJIT_MEM1(SLJIT_S1), 2 * sizeof(sljit_f64));
+		/* obuf[16] */
+		sljit_emit_simd_mov(compiler, SLJIT_SIMD_STORE | type, SLJIT_FR0, SLJIT_MEM1(SLJIT_S2), 16 * sizeof(sljit_u32));
+	}
+#else /* !IS_64BIT */
+	supported[3] = 0;
+#endif /* IS_64BIT */
+
+	type = SLJIT_SIMD_REG_256 | SLJIT_SIMD_ELEM_32;
+	scale = SLJIT_SIMD_SCALE_4;
+	supported[4] = sljit_emit_simd_gather(compiler, type | scale | SLJIT_SIMD_TEST, SLJIT_FR0, SLJIT_FR1, SLJIT_MEM1(SLJIT_S0), 0) != SLJIT_ERR_UNSUPPORTED;
+	if (supported[4]) {
+		sljit_emit_simd_mov(compiler, SLJIT_SIMD_LOAD | type, SLJIT_FR1, SLJIT_MEM1(SLJIT_S0), 16 * sizeof(sljit_u32));
+		sljit_emit_simd_gather(compiler, type | scale, SLJIT_FR0, SLJIT_FR1, SLJIT_MEM1(SLJIT_S0), 4 * sizeof(sljit_u32));
+		/* obuf[20] */
+		sljit_emit_simd_mov(compiler, SLJIT_SIMD_STORE | type, SLJIT_FR0, SLJIT_MEM1(SLJIT_S2), 20 * sizeof(sljit_u32));
+	}
+
+	sljit_emit_return_void(compiler);
+
+	code.code = sljit_generate_code(compiler, 0, NULL);
+	CHECK(compiler);
+	sljit_free_compiler(compiler);
+
+	code.func3((sljit_sw)ibuf, (sljit_sw)dbuf, (sljit_sw)obuf);
+	sljit_free_code(code.code, NULL);
+
+	if (supported[0]) {
+		FAILED(obuf[0] != 0x1099 || obuf[1] != 0x1022 || obuf[2] != 0x1044 || obuf[3] != 0x10bb, "test_simd12 case 1 failed\n");
+		FAILED(obuf[4] != 0x10bb || obuf[5] != 0x1088 || obuf[6] != 0x10aa || obuf[7] != 0x1099, "test_simd12 case 2 failed\n");
+		FAILED(obuf[8] != 0x10dd || obuf[9] != 0x1066 || obuf[10] != 0x1088 || obuf[11] != 0x10ff, "test_simd12 case 3 failed\n");
+	}
+
+	if (supported[1]) {
+		FAILED(ibuf[24] != 0x1011 || ibuf[25] != 0x1033 || ibuf[26] != 0x1022 || ibuf[27] != 0x1000, "test_simd12 case 4 failed\n");
+		FAILED(ibuf[23] != 1 || ibuf[28] != 0xaaaaaaaa, "test_simd12 case 5 failed\n");
+	}
+
+	if (supported[2])
+		FAILED(obuf[12] != 0x1099 || obuf[13] != 0x1022 || obuf[14] != 0x1044 || obuf[15] != 0x10bb, "test_simd12 case 6 failed\n");
+
+	if (supported[3]) {
+		FAILED(dbuf[0] != 1.5 || dbuf[2] != 3.5, "test_simd12 case 7 failed\n");
+		FAILED(dbuf[3] != 2.5 || dbuf[4] != -1.0 || dbuf[5] != 4.5, "test_simd12 case 8 failed\n");
+		FAILED(*(sljit_f64*)(obuf + 16) != 4.5 || *(sljit_f64*)(obuf + 18) != 2.5, "test_simd12 case 9 failed\n");
+	}
+
+	if (supported[4]) {
+		FAILED(obuf[20] != 0x1099 || obuf[21] != 0x1022 || obuf[22] != 0x1044 || obuf[23] != 0x10bb, "test_simd12 case 10 failed\n");
+		FAILED(obuf[24] != 0x1077 || obuf[25] != 0x1044 || obuf[26] != 0x1066 || obuf[27] != 0x1055, "test_simd12 case 11 failed\n");
+		FAILED(obuf[28] != 0xaaaaaaaa, "test_simd12 case 12 failed\n");
+	}
+
+	SIMD_RUN_END
+
+	successful_tests++;
+}
+
+static void test_simd13(void)
+{
+	/* Test simd shift, narrow and permute operations. */
+	executable_code code;
+	struct sljit_compiler* compiler;
+	sljit_s32 options = 0;
+	sljit_s32 i, k, e, half, type;
+	sljit_s32 supported[21];
+	sljit_u16 hbuf[16];
+	sljit_u32 ibuf[8];
+	sljit_u8 bbuf[32];
+	sljit_u32 obuf[88];
+	sljit_u8 *bout = (sljit_u8*)obuf;
+	sljit_u16 *hout = (sljit_u16*)obuf;
+
+	if (verbose)
+		printf("Run test_simd13\n");
+
+	SIMD_RUN_START
+
+	hbuf[0] = 0x8001;
+	hbuf[1] = 0x1234;
+	hbuf[2] = 0x00ff;
+	hbuf[3] = 0xff00;
+	hbuf[4] = 0x7fff;
+	hbuf[5] = 0x0100;
+	hbuf[6] = 0xfff0;
+	hbuf[7] = 0x0003;
+	hbuf[8] = 0x0080;
+	hbuf[9] = 0xff7f;
+	hbuf[10] = 0x0100;
+	hbuf[11] = 0xffff;
+	hbuf[12] = 0x007f;
+	hbuf[13] = 0xff80;
+	hbuf[14] = 0x1234;
+	hbuf[15] = 0xfedc;
+	ibuf[0] = 0x80000000;
+	ibuf[1] = 0x7fffffff;
+	ibuf[2] = 0xffffffff;
+	ibuf[3] = 1;
+	ibuf[4] = 1;
+	ibuf[5] = 4;
+	ibuf[6] = 31;
+	ibuf[7] = 0;
+	for (i = 0; i < 32; i++)
+		bbuf[i] = (sljit_u8)i;
+	for (i = 0; i < 88; i++)
+		obuf[i] = 0xaaaaaaaa;
+
+	compiler = sljit_create_compiler(NULL);
+	FAILED(!compiler, "cannot create compiler\n");
+
+	sljit_emit_enter(compiler, options, SLJIT_ARGS3V(P, P, P), 4, 4, 6, 0, 0);
+
+	type = SLJIT_SIMD_REG_128 | SLJIT_SIMD_ELEM_16;
+	sljit_emit_simd_mov(compiler, SLJIT_SIMD_LOAD | type, SLJIT_FR1, SLJIT_MEM1(SLJIT_S0), 0);
+	sljit_emit_simd_mov(compiler, SLJIT_SIMD_LOAD | type, SLJIT_FR2, SLJIT_MEM1(SLJIT_S0), 8 * sizeof(sljit_u16));
+
+	supported[0] = sljit_emit_simd_shift(compiler, SLJIT_SIMD_SHIFT_SHL | type | SLJIT_SIMD_TEST, SLJIT_FR0, SLJIT_FR1, SLJIT_IMM, 3) != SLJIT_ERR_UNSUPPORTED;
+	if (supported[0]) {
+		sljit_emit_simd_shift(compiler, SLJIT_SIMD_SHIFT_SHL | type, SLJIT_FR0, SLJIT_FR1, SLJIT_IMM, 3);
+		/* obuf[0] */
+		sljit_emit_simd_mov(compiler, SLJIT_SIMD_STORE | type, SLJIT_FR0, SLJIT_MEM1(SLJIT_S2), 0);
+	}
+
+	supported[1] = sljit_emit_simd_shift(compiler, SLJIT_SIMD_SHIFT_LSHR | type | SLJIT_SIMD_TEST, SLJIT_FR0, SLJIT_FR1, SLJIT_IMM, 4) != SLJIT_ERR_UNSUPPORTED;
+	if (supported[1]) {
+		sljit_emit_simd_shift(compiler, SLJIT_SIMD_SHIFT_LSHR | type, SLJIT_FR0, SLJIT_FR1, SLJIT_IMM, 4);
+		/* obuf[4] */
+		sljit_emit_simd_mov(compiler, SLJIT_SIMD_STORE | type, SLJIT_FR0, SLJIT_MEM1(SLJIT_S2), 4 * sizeof(sljit_u32));
+	}
+
+	supported[2] = sljit_emit_simd_shift(compiler, SLJIT_SIMD_SHIFT_ASHR | type | SLJIT_SIMD_TEST, SLJIT_FR0, SLJIT_FR1, SLJIT_IMM, 4) != SLJIT_ERR_UNSUPPORTED;
+	if (supported[2]) {
+		sljit_emit_simd_shift(compiler, SLJIT_SIMD_SHIFT_ASHR | type, SLJIT_FR0, SLJIT_FR1, SLJIT_IMM, 4);
+		/* obuf[8] */
+		sljit_emit_simd_mov(compiler, SLJIT_SIMD_STORE | type, SLJIT_FR0, SLJIT_MEM1(SLJIT_S2), 8 * sizeof(sljit_u32));
+	}
+
+	type = SLJIT_SIMD_REG_128 | SLJIT_SIMD_ELEM_32;
+	sljit_emit_simd_mov(compiler, SLJIT_SIMD_LOAD | type, SLJIT_FR3, SLJIT_MEM1(SLJIT_S1), 0);
+	sljit_emit_simd_mov(compiler, SLJIT_SIMD_LOAD | type, SLJIT_FR4, SLJIT_MEM1(SLJIT_S1), 4 * sizeof(sljit_u32));
+
+	supported[3] = sljit_emit_simd_shift(compiler, SLJIT_SIMD_SHIFT_ASHR | type | SLJIT_SIMD_TEST, SLJIT_FR5, SLJIT_FR5, SLJIT_IMM, 31) != SLJIT_ERR_UNSUPPORTED;
+	if (supported[3]) {
+		sljit_emit_simd_mov(compiler, SLJIT_SIMD_LOAD | type, SLJIT_FR5, SLJIT_FR3, 0);
+		sljit_emit_simd_shift(compiler, SLJIT_SIMD_SHIFT_ASHR | type, SLJIT_FR5, SLJIT_FR5, SLJIT_IMM, 31);
+		/* obuf[12] */
+		sljit_emit_simd_mov(compiler, SLJIT_SIMD_STORE | type, SLJIT_FR5, SLJIT_MEM1(SLJIT_S2), 12 * sizeof(sljit_u32));
+	}
+
+	supported[4] = sljit_emit_simd_shift(compiler, SLJIT_SIMD_SHIFT_SHL | type | SLJIT_SIMD_TEST, SLJIT_FR0, SLJIT_FR3, SLJIT_FR4, 0) != SLJIT_ERR_UNSUPPORTED;
+	if (supported[4]) {
+		sljit_emit_simd_shift(compiler, SLJIT_SIMD_SHIFT_SHL | type, SLJIT_FR0, SLJIT_FR3, SLJIT_FR4, 0);
+		/* obuf[16] */
+		sljit_emit_simd_mov(compiler, SLJIT_SIMD_STORE | type, SLJIT_FR0, SLJIT_MEM1(SLJIT_S2), 16 * sizeof(sljit_u32));
+	}
+
+	supported[5] = sljit_emit_simd_shift(compiler, SLJIT_SIMD_SHIFT_LSHR | type | SLJIT_SIMD_TEST, SLJIT_FR0, SLJIT_FR3, SLJIT_FR4, 0) != SLJIT_ERR_UNSUPPORTED;
+	if (supported[5]) {
+		sljit_emit_simd_shift(compiler, SLJIT_SIMD_SHIFT_LSHR | type, SLJIT_FR0, SLJIT_FR3, SLJIT_FR4, 0);
+		/* obuf[20] */
+		sljit_emit_simd_mov(compiler, SLJIT_SIMD_STORE | type, SLJIT_FR0, SLJIT_MEM1(SLJIT_S2), 20 * sizeof(sljit_u32));
+	}
+
+	supported[6] = sljit_emit_simd_shift(compiler, SLJIT_SIMD_SHIFT_ASHR | type | SLJIT_SIMD_TEST, SLJIT_FR0, SLJIT_FR3, SLJIT_FR4, 0) != SLJIT_ERR_UNSUPPORTED;
+	if (supported[6]) {
+		sljit_emit_simd_shift(compiler, SLJIT_SIMD_SHIFT_ASHR | type, SLJIT_FR0, SLJIT_FR3, SLJIT_FR4, 0);
+		/* obuf[24] */
+		sljit_emit_simd_mov(compiler, SLJIT_SIMD_STORE | type, SLJIT_FR0, SLJIT_MEM1(SLJIT_S2), 24 * sizeof(sljit_u32));
+	}
+
+	type = SLJIT_SIMD_REG_128 | SLJIT_SIMD_ELEM_16;
+	supported[7] = sljit_emit_simd_narrow(compiler, type | SLJIT_SIMD_TEST, SLJIT_FR0, SLJIT_FR1, SLJIT_FR2) != SLJIT_ERR_UNSUPPORTED;
+	if (supported[7]) {
+		sljit_emit_simd_narrow(compiler, type, SLJIT_FR0, SLJIT_FR1, SLJIT_FR2);
+		/* obuf[28] */
+		sljit_emit_simd_mov(compiler, SLJIT_SIMD_STORE | type, SLJIT_FR0, SLJIT_MEM1(SLJIT_S2), 28 * sizeof(sljit_u32));
+	}
+
+	supported[8] = sljit_emit_simd_narrow(compiler, type | SLJIT_SIMD_NARROW_SIGNED_SAT | SLJIT_SIMD_TEST, SLJIT_FR0, SLJIT_FR1, SLJIT_FR2) != SLJIT_ERR_UNSUPPORTED;
+	if (supported[8]) {
+		sljit_emit_simd_narrow(compiler, type | SLJIT_SIMD_NARROW_SIGNED_SAT, SLJIT_FR0, SLJIT_FR1, SLJIT_FR2);
+		/* obuf[32] */
+		sljit_emit_simd_mov(compiler, SLJIT_SIMD_STORE | type, SLJIT_FR0, SLJIT_MEM1(SLJIT_S2), 32 * sizeof(sljit_u32));
+	}
+
+	supported[9] = sljit_emit_simd_narrow(compiler, type | SLJIT_SIMD_NARROW_UNSIGNED_SAT | SLJIT_SIMD_TEST, SLJIT_FR2, SLJIT_FR1, SLJIT_FR2) != SLJIT_ERR_UNSUPPORTED;
+	if (supported[9]) {
+		/* The destination is the second source register. */
+		sljit_emit_simd_mov(compiler, SLJIT_SIMD_LOAD | type, SLJIT_FR5, SLJIT_FR2, 0);
+		sljit_emit_simd_narrow(compiler, type | SLJIT_SIMD_NARROW_UNSIGNED_SAT, SLJIT_FR5, SLJIT_FR1, SLJIT_FR5);
+		/* obuf[36] */
+		sljit_emit_simd_mov(compiler, SLJIT_SIMD_STORE | type, SLJIT_FR5, SLJIT_MEM1(SLJIT_S2), 36 * sizeof(sljit_u32));
+	}
+
+	type = SLJIT_SIMD_REG_128 | SLJIT_SIMD_ELEM_32;
+	supported[10] = sljit_emit_simd_narrow(compiler, type | SLJIT_SIMD_TEST, SLJIT_FR0, SLJIT_FR3, SLJIT_FR4) != SLJIT_ERR_UNSUPPORTED;
+	if (supported[10]) {
+		sljit_emit_simd_narrow(compiler, type, SLJIT_FR0, SLJIT_FR3, SLJIT_FR4);
+		/* obuf[40] */
+		sljit_emit_simd_mov(compiler, SLJIT_SIMD_STORE | type, SLJIT_FR0, SLJIT_MEM1(SLJIT_S2), 40 * sizeof(sljit_u32));
+	}
+
+	supported[11] = sljit_emit_simd_narrow(compiler, type | SLJIT_SIMD_NARROW_SIGNED_SAT | SLJIT_SIMD_TEST, SLJIT_FR0, SLJIT_FR3, SLJIT_FR4) != SLJIT_ERR_UNSUPPORTED;
+	if (supported[11]) {
+		sljit_emit_simd_narrow(compiler, type | SLJIT_SIMD_NARROW_SIGNED_SAT, SLJIT_FR0, SLJIT_FR3, SLJIT_FR4);
+		/* obuf[44] */
+		sljit_emit_simd_mov(compiler, SLJIT_SIMD_STORE | type, SLJIT_FR0, SLJIT_MEM1(SLJIT_S2), 44 * sizeof(sljit_u32));
+	}
+
+	type = SLJIT_SIMD_REG_128 | SLJIT_SIMD_ELEM_64;
+	supported[12] = sljit_emit_simd_narrow(compiler, type | SLJIT_SIMD_TEST, SLJIT_FR0, SLJIT_FR3, SLJIT_FR4) != SLJIT_ERR_UNSUPPORTED;
+	if (supported[12]) {
+		sljit_emit_simd_narrow(compiler, type, SLJIT_FR0, SLJIT_FR3, SLJIT_FR4);
+		/* obuf[48] */
+		sljit_emit_simd_mov(compiler, SLJIT_SIMD_STORE | type, SLJIT_FR0, SLJIT_MEM1(SLJIT_S2), 48 * sizeof(sljit_u32));
+	}
+
+	type = SLJIT_SIMD_REG_128 | SLJIT_SIMD_ELEM_8;
+	sljit_emit_op1(compiler, SLJIT_MOV, SLJIT_R0, 0, SLJIT_IMM, (sljit_sw)bbuf);
+	sljit_emit_simd_mov(compiler, SLJIT_SIMD_LOAD | type, SLJIT_FR1, SLJIT_MEM1(SLJIT_R0), 0);
+	sljit_emit_simd_mov(compiler, SLJIT_SIMD_LOAD | type, SLJIT_FR2, SLJIT_MEM1(SLJIT_R0), 16);
+
+	supported[13] = sljit_emit_simd_op2(compiler, SLJIT_SIMD_OP2_ZIP_LO | type | SLJIT_SIMD_TEST, SLJIT_FR0, SLJIT_FR1, SLJIT_FR2, 0) != SLJIT_ERR_UNSUPPORTED;
+	if (supported[13]) {
+		sljit_emit_simd_op2(compiler, SLJIT_SIMD_OP2_ZIP_LO | type, SLJIT_FR0, SLJIT_FR1, SLJIT_FR2, 0);
+		/* obuf[52] */
+		sljit_emit_simd_mov(compiler, SLJIT_SIMD_STORE | type, SLJIT_FR0, SLJIT_MEM1(SLJIT_S2), 52 * sizeof(sljit_u32));
+	}
+
+	type = SLJIT_SIMD_REG_128 | SLJIT_SIMD_ELEM_16;
+	supported[14] = sljit_emit_simd_op2(compiler, SLJIT_SIMD_OP2_ZIP_HI | type | SLJIT_SIMD_TEST, SLJIT_FR0, SLJIT_FR1, SLJIT_FR2, 0) != SLJIT_ERR_UNSUPPORTED;
+	if (supported[14]) {
+		sljit_emit_simd_op2(compiler, SLJIT_SIMD_OP2_ZIP_HI | type, SLJIT_FR0, SLJIT_FR1, SLJIT_FR2, 0);
+		/* obuf[56] */
+		sljit_emit_simd_mov(compiler, SLJIT_SIMD_STORE | type, SLJIT_FR0, SLJIT_MEM1(SLJIT_S2), 56 * sizeof(sljit_u32));
+	}
+
+	type = SLJIT_SIMD_REG_128 | SLJIT_SIMD_ELEM_8;
+	supported[15] = sljit_emit_simd_op2(compiler, SLJIT_SIMD_OP2_UNZIP_LO | type | SLJIT_SIMD_TEST, SLJIT_FR0, SLJIT_FR1, SLJIT_FR2, 0) != SLJIT_ERR_UNSUPPORTED;
+	if (supported[15]) {
+		sljit_emit_simd_op2(compiler, SLJIT_SIMD_OP2_UNZIP_LO | type, SLJIT_FR0, SLJIT_FR1, SLJIT_FR2, 0);
+		/* obuf[60] */
+		sljit_emit_simd_mov(compiler, SLJIT_SIMD_STORE | type, SLJIT_FR0, SLJIT_MEM1(SLJIT_S2), 60 * sizeof(sljit_u32));
+	}
+
+	type = SLJIT_SIMD_REG_128 | SLJIT_SIMD_ELEM_16;
+	supported[16] = sljit_emit_simd_op2(compiler, SLJIT_SIMD_OP2_UNZIP_HI | type | SLJIT_SIMD_TEST, SLJIT_FR5, SLJIT_FR1, SLJIT_FR5, 0) != SLJIT_ERR_UNSUPPORTED;
+	if (supported[16]) {
+		/* The destination is the second source register. */
+		sljit_emit_simd_mov(compiler, SLJIT_SIMD_LOAD | type, SLJIT_FR5, SLJIT_FR2, 0);
+		sljit_emit_simd_op2(compiler, SLJIT_SIMD_OP2_UNZIP_HI | type, SLJIT_FR5, SLJIT_FR1, SLJIT_FR5, 0);
+		/* obuf[64] */
+		sljit_emit_simd_mov(compiler, SLJIT_SIMD_STORE | type, SLJIT_FR5, SLJIT_MEM1(SLJIT_S2), 64 * sizeof(sljit_u32));
+	}
+
+	type = SLJIT_SIMD_REG_128 | SLJIT_SIMD_ELEM_32;
+	supported[17] = sljit_emit_simd_op2(compiler, SLJIT_SIMD_OP2_UNZIP_LO | type | SLJIT_SIMD_TEST, SLJIT_FR0, SLJIT_FR1, SLJIT_MEM1(SLJIT_R0), 16) != SLJIT_ERR_UNSUPPORTED;
+	if (supported[17]) {
+		/* The second source is loaded from memory. */
+		sljit_emit_simd_op2(compiler, SLJIT_SIMD_OP2_UNZIP_LO | type, SLJIT_FR0, SLJIT_FR1, SLJIT_MEM1(SLJIT_R0), 16);
+		/* obuf[68] */
+		sljit_emit_simd_mov(compiler, SLJIT_SIMD_STORE | type, SLJIT_FR0, SLJIT_MEM1(SLJIT_S2), 68 * sizeof(sljit_u32));
+	}
+
+	type = SLJIT_SIMD_REG_128 | SLJIT_SIMD_ELEM_64;
+	supported[18] = sljit_emit_simd_op2(compiler, SLJIT_SIMD_OP2_ZIP_HI | type | SLJIT_SIMD_TEST, SLJIT_FR5, SLJIT_FR1, SLJIT_FR5, 0) != SLJIT_ERR_UNSUPPORTED;
+	if (supported[18]) {
+		/* The destination is the second source register. */
+		sljit_emit_simd_mov(compiler, SLJIT_SIMD_LOAD | type, SLJIT_FR5, SLJIT_FR2, 0);
+		sljit_emit_simd_op2(compiler, SLJIT_SIMD_OP2_ZIP_HI | type, SLJIT_FR5, SLJIT_FR1, SLJIT_FR5, 0);
+		/* obuf[72] */
+		sljit_emit_simd_mov(compiler, SLJIT_SIMD_STORE | type, SLJIT_FR5, SLJIT_MEM1(SLJIT_S2), 72 * sizeof(sljit_u32));
+	}
+
+	type = SLJIT_SIMD_REG_128 | SLJIT_SIMD_ELEM_8;
+	supported[19] = sljit_emit_simd_op2(compiler, SLJIT_SIMD_OP2_UNZIP_HI | type | SLJIT_SIMD_TEST, SLJIT_FR1, SLJIT_FR1, SLJIT_FR2, 0) != SLJIT_ERR_UNSUPPORTED;
+	if (supported[19]) {
+		/* The destination is the first source register. */
+		sljit_emit_simd_op2(compiler, SLJIT_SIMD_OP2_UNZIP_HI | type, SLJIT_FR1, SLJIT_FR1, SLJIT_FR2, 0);
+		/* obuf[76] */
+		sljit_emit_simd_mov(compiler, SLJIT_SIMD_STORE | type, SLJIT_FR1, SLJIT_MEM1(SLJIT_S2), 76 * sizeof(sljit_u32));
+	}
+
+	type = SLJIT_SIMD_REG_64 | SLJIT_SIMD_ELEM_8;
+	supported[20] = sljit_emit_simd_op2(compiler, SLJIT_SIMD_OP2_ZIP_LO | type | SLJIT_SIMD_TEST, SLJIT_FR0, SLJIT_FR1, SLJIT_FR2, 0) != SLJIT_ERR_UNSUPPORTED;
+	if (supported[20]) {
+		sljit_emit_simd_mov(compiler, SLJIT_SIMD_LOAD | type, SLJIT_FR1, SLJIT_MEM1(SLJIT_R0), 0);
+		sljit_emit_simd_mov(compiler, SLJIT_SIMD_LOAD | type, SLJIT_FR2, SLJIT_MEM1(SLJIT_R0), 16);
+		sljit_emit_simd_op2(compiler, SLJIT_SIMD_OP2_ZIP_LO | type, SLJIT_FR0, SLJIT_FR1, SLJIT_FR2, 0);
+		/* obuf[80] */
+		sljit_emit_simd_mov(compiler, SLJIT_SIMD_STORE | type, SLJIT_FR0, SLJIT_MEM1(SLJIT_S2), 80 * sizeof(sljit_u32));
+	}
+
+	sljit_emit_return_void(compiler);
+
+	code.code = sljit_generate_code(compiler, 0, NULL);
+	CHECK(compiler);
+	sljit_free_compiler(compiler);
+
+	code.func3((sljit_sw)hbuf, (sljit_sw)ibuf, (sljit_sw)obuf);
+	sljit_free_code(code.code, NULL);
+
+#if (defined SLJIT_CONFIG_ARM_64 && SLJIT_CONFIG_ARM_64) \
+		|| (defined SLJIT_CONFIG_ARM_THUMB2 && SLJIT_CONFIG_ARM_THUMB2)
+	/* All forms are supported by NEON. */
+	for (i = 0; i < 21; i++)
+		FAILED(!supported[i], "test_simd13 case 37 failed\n");
+#endif /* SLJIT_CONFIG_ARM_64 || SLJIT_CONFIG_ARM_THUMB2 */
+
+	if (supported[0]) {
+		FAILED(hout[0] != 0x0008 || hout[1] != 0x91a0 || hout[2] != 0x07f8 || hout[3] != 0xf800, "test_simd13 case 1 failed\n");
+		FAILED(hout[4] != 0xfff8 || hout[5] != 0x0800 || hout[6] != 0xff80 || hout[7] != 0x0018, "test_simd13 case 2 failed\n");
+	}
+
+	if (supported[1]) {
+		FAILED(hout[8] != 0x0800 || hout[9] != 0x0123 || hout[10] != 0x000f || hout[11] != 0x0ff0, "test_simd13 case 3 failed\n");
+		FAILED(hout[12] != 0x07ff || hout[13] != 0x0010 || hout[14] != 0x0fff || hout[15] != 0x0000, "test_simd13 case 4 failed\n");
+	}
+
+	if (supported[2]) {
+		FAILED(hout[16] != 0xf800 || hout[17] != 0x0123 || hout[18] != 0x000f || hout[19] != 0xfff0, "test_simd13 case 5 failed\n");
+		FAILED(hout[20] != 0x07ff || hout[21] != 0x0010 || hout[22] != 0xffff || hout[23] != 0x0000, "test_simd13 case 6 failed\n");
+	}
+
+	if (supported[3])
+		FAILED(obuf[12] != 0xffffffff || obuf[13] != 0 || obuf[14] != 0xffffffff || obuf[15] != 0, "test_simd13 case 7 failed\n");
+
+	if (supported[4])
+		FAILED(obuf[16] != 0 || obuf[17] != 0xfffffff0 || obuf[18] != 0x80000000 || obuf[19] != 1, "test_simd13 case 8 failed\n");
+
+	if (supported[5])
+		FAILED(obuf[20] != 0x40000000 || obuf[21] != 0x07ffffff || obuf[22] != 1 || obuf[23] != 1, "test_simd13 case 9 failed\n");
+
+	if (supported[6])
+		FAILED(obuf[24] != 0xc0000000 || obuf[25] != 0x07ffffff || obuf[26] != 0xffffffff || obuf[27] != 1, "test_simd13 case 10 failed\n");
+
+	if (supported[7]) {
+		FAILED(bout[112] != 0x01 || bout[113] != 0x34 || bout[114] != 0xff || bout[115] != 0x00, "test_simd13 case 11 failed\n");
+		FAILED(bout[116] != 0xff || bout[117] != 0x00 || bout[118] != 0xf0 || bout[119] != 0x03, "test_simd13 case 12 failed\n");
+		FAILED(bout[120] != 0x80 || bout[121] != 0x7f || bout[122] != 0x00 || bout[123] != 0xff, "test_simd13 case 13 failed\n");
+		FAILED(bout[124] != 0x7f || bout[125] != 0x80 || bout[126] != 0x34 || bout[127] != 0xdc, "test_simd13 case 14 failed\n");
+	}
+
+	if (supported[8]) {
+		FAILED(bout[128] != 0x80 || bout[129] != 0x7f || bout[130] != 0x7f || bout[131] != 0x80, "test_simd13 case 15 failed\n");
+		FAILED(bout[132] != 0x7f || bout[133] != 0x7f || bout[134] != 0xf0 || bout[135] != 0x03, "test_simd13 case 16 failed\n");
+		FAILED(bout[136] != 0x7f || bout[137] != 0x80 || bout[138] != 0x7f || bout[139] != 0xff, "test_simd13 case 17 failed\n");
+		FAILED(bout[140] != 0x7f || bout[141] != 0x80 || bout[142] != 0x7f || bout[143] != 0x80, "test_simd13 case 18 failed\n");
+	}
+
+	if (supported[9]) {
+		FAILED(bout[144] != 0x00 || bout[145] != 0xff || bout[146] != 0xff || bout[147] != 0x00, "test_simd13 case 19 failed\n");
+		FAILED(bout[148] != 0xff || bout[149] != 0xff || bout[150] != 0x00 || bout[151] != 0x03, "test_simd13 case 20 failed\n");
+		FAILED(bout[152] != 0x80 || bout[153] != 0x00 || bout[154] != 0xff || bout[155] != 0x00, "test_simd13 case 21 failed\n");
+		FAILED(bout[156] != 0x7f || bout[157] != 0x00 || bout[158] != 0xff || bout[159] != 0x00, "test_simd13 case 22 failed\n");
+	}
+
+	if (supported[10]) {
+		FAILED(hout[80] != 0x0000 || hout[81] != 0xffff || hout[82] != 0xffff || hout[83] != 0x0001, "test_simd13 case 23 failed\n");
+		FAILED(hout[84] != 0x0001 || hout[85] != 0x0004 || hout[86] != 0x001f || hout[87] != 0x0000, "test_simd13 case 24 failed\n");
+	}
+
+	if (supported[11]) {
+		FAILED(hout[88] != 0x8000 || hout[89] != 0x7fff || hout[90] != 0xffff || hout[91] != 0x0001, "test_simd13 case 25 failed\n");
+		FAILED(hout[92] != 0x0001 || hout[93] != 0x0004 || hout[94] != 0x001f || hout[95] != 0x0000, "test_simd13 case 26 failed\n");
+	}
+
+	if (supported[12])
+		FAILED(obuf[48] != 0x80000000 || obuf[49] != 0xffffffff || obuf[50] != 1 || obuf[51] != 31, "test_simd13 case 27 failed\n");
+
+	if (supported[13]) {
+		for (i = 0; i < 16; i++)
+			FAILED(bout[208 + i] != ((i & 1) ? 16 : 0) + (i >> 1), "test_simd13 case 28 failed\n");
+	}
+
+	if (supported[14]) {
+		/* Element size is 2 bytes. */
+		e = 2;
+		for (i = 0; i < 16; i++) {
+			k = i / e;
+			FAILED(bout[224 + i] != ((k & 1) ? 16 : 0) + ((k >> 1) + 8 / e) * e + (i % e), "test_simd13 case 29 failed\n");
+		}
+	}
+
+	if (supported[15]) {
+		for (i = 0; i < 16; i++)
+			FAILED(bout[240 + i] != 2 * i, "test_simd13 case 30 failed\n");
+	}
+
+	if (supported[16]) {
+		e = 2;
+		half = 8 / e;
+		for (i = 0; i < 16; i++) {
+			k = i / e;
+			FAILED(bout[256 + i] != (k < half ? 0 : 16) + 2 * (k % half) * e + e + (i % e), "test_simd13 case 31 failed\n");
+		}
+	}
+
+	if (supported[17]) {
+		e = 4;
+		half = 8 / e;
+		for (i = 0; i < 16; i++) {
+			k = i / e;
+			FAILED(bout[272 + i] != (k < half ? 0 : 16) + 2 * (k % half) * e + (i % e), "test_simd13 case 32 failed\n");
+		}
+	}
+
+	if (supported[18]) {
+		for (i = 0; i < 16; i++)
+			FAILED(bout[288 + i] != (i < 8 ? 8 : 16) + i, "test_simd13 case 33 failed\n");
+	}
+
+	if (supported[19]) {
+		for (i = 0; i < 16; i++)
+			FAILED(bout[304 + i] != 2 * i + 1, "test_simd13 case 34 failed\n");
+	}
+
+	if (supported[20]) {
+		for (i = 0; i < 8; i++)
+			FAILED(bout[320 + i] != ((i & 1) ? 16 : 0) + (i >> 1), "test_simd13 case 35 failed\n");
+		FAILED(obuf[82] != 0xaaaaaaaa, "test_simd13 case 36 failed\n");
+	}
+
+	SIMD_RUN_END
+
+	successful_tests++;
+}
+
+static void test_simd14(void)
+{
+	/* Test simd compare operations. */
+	executable_code code;
+	struct sljit_compiler* compiler;
+	sljit_s32 options = 0;
+	sljit_s32 i, type;
+	sljit_s32 supported[6];
+	sljit_u8 bbuf[32];
+	sljit_u8 cbuf[32];
+	sljit_uw resw[4];
+	sljit_u32 obuf[40];
+	sljit_u8 *bout = (sljit_u8*)obuf;
+	sljit_u16 *hout = (sljit_u16*)obuf;
+
+	if (verbose)
+		printf("Run test_simd14\n");
+
+	SIMD_RUN_START
+
+	for (i = 0; i < 32; i++) {
+		bbuf[i] = (sljit_u8)(i * 7);
+		cbuf[i] = (sljit_u8)((i % 3 == 0) ? i * 7 : 0xff - i);
+	}
+	bbuf[13] = 'x';
+	bbuf[20] = 'x';
+	for (i = 0; i < 40; i++)
+		obuf[i] = 0xaaaaaaaa;
+	for (i = 0; i < 4; i++)
+		resw[i] = 0;
+
+	compiler = sljit_create_compiler(NULL);
+	FAILED(!compiler, "cannot create compiler\n");
+
+	sljit_emit_enter(compiler, options, SLJIT_ARGS3V(P, P, P), 4, 4, 6, 0, 0);
+
+	type = SLJIT_SIMD_REG_128 | SLJIT_SIMD_ELEM_8;
+	sljit_emit_simd_mov(compiler, SLJIT_SIMD_LOAD | type, SLJIT_FR1, SLJIT_MEM1(SLJIT_S0), 0);
+	sljit_emit_simd_mov(compiler, SLJIT_SIMD_LOAD | type, SLJIT_FR2, SLJIT_MEM1(SLJIT_S1), 0);
+
+	supported[0] = sljit_emit_simd_op2(compiler, SLJIT_SIMD_OP2_CMP_EQ | type | SLJIT_SIMD_TEST, SLJIT_FR0, SLJIT_FR1, SLJIT_FR2, 0) != SLJIT_ERR_UNSUPPORTED;
+	if (supported[0]) {
+		sljit_emit_simd_op2(compiler, SLJIT_SIMD_OP2_CMP_EQ | type, SLJIT_FR0, SLJIT_FR1, SLJIT_FR2, 0);
+		/* obuf[0] */
+		sljit_emit_simd_mov(compiler, SLJIT_SIMD_STORE | type, SLJIT_FR0, SLJIT_MEM1(SLJIT_S2), 0);
+
+		/* Search a character (memchr). */
+		sljit_emit_simd_replicate(compiler, type, SLJIT_FR3, SLJIT_IMM, 'x');
+		sljit_emit_simd_op2(compiler, SLJIT_SIMD_OP2_CMP_EQ | type, SLJIT_FR4, SLJIT_FR3, SLJIT_MEM1(SLJIT_S0), 0);
+		sljit_emit_simd_sign(compiler, SLJIT_SIMD_STORE | type, SLJIT_FR4, SLJIT_R0, 0);
+		sljit_emit_op1(compiler, SLJIT_MOV, SLJIT_R1, 0, SLJIT_IMM, (sljit_sw)resw);
+		/* resw[0] */
+		sljit_emit_op1(compiler, SLJIT_MOV, SLJIT_MEM1(SLJIT_R1), 0, SLJIT_R0, 0);
+		sljit_emit_op1(compiler, SLJIT_CTZ, SLJIT_R0, 0, SLJIT_R0, 0);
+		/* resw[1] */
+		sljit_emit_op1(compiler, SLJIT_MOV, SLJIT_MEM1(SLJIT_R1), sizeof(sljit_uw), SLJIT_R0, 0);
+	}
+
+	type = SLJIT_SIMD_REG_128 | SLJIT_SIMD_ELEM_16;
+	supported[1] = sljit_emit_simd_op2(compiler, SLJIT_SIMD_OP2_CMP_EQ | type | SLJIT_SIMD_TEST, SLJIT_FR2, SLJIT_FR1, SLJIT_FR2, 0) != SLJIT_ERR_UNSUPPORTED;
+	if (supported[1]) {
+		/* The destination is the second source register. */
+		sljit_emit_simd_mov(compiler, SLJIT_SIMD_LOAD | type, SLJIT_FR5, SLJIT_FR2, 0);
+		sljit_emit_simd_op2(compiler, SLJIT_SIMD_OP2_CMP_EQ | type, SLJIT_FR5, SLJIT_FR1, SLJIT_FR5, 0);
+		/* obuf[4] */
+		sljit_emit_simd_mov(compiler, SLJIT_SIMD_STORE | type, SLJIT_FR5, SLJIT_MEM1(SLJIT_S2), 4 * sizeof(sljit_u32));
+	}
+
+	type = SLJIT_SIMD_REG_128 | SLJIT_SIMD_ELEM_32;
+	supported[2] = sljit_emit_simd_op2(compiler, SLJIT_SIMD_OP2_CMP_EQ | type | SLJIT_SIMD_TEST, SLJIT_FR0, SLJIT_FR1, SLJIT_FR1, 0) != SLJIT_ERR_UNSUPPORTED;
+	if (supported[2]) {
+		sljit_emit_simd_op2(compiler, SLJIT_SIMD_OP2_CMP_EQ | type, SLJIT_FR0, SLJIT_FR1, SLJIT_FR1, 0);
+		/* obuf[8] */
+		sljit_emit_simd_mov(compiler, SLJIT_SIMD_STORE | type, SLJIT_FR0, SLJIT_MEM1(SLJIT_S2), 8 * sizeof(sljit_u32));
+	}
+
+	type = SLJIT_SIMD_REG_128 | SLJIT_SIMD_ELEM_64;
+	supported[3] = sljit_emit_simd_op2(compiler, SLJIT_SIMD_OP2_CMP_EQ | type | SLJIT_SIMD_TEST, SLJIT_FR1, SLJIT_FR1, SLJIT_FR2, 0) != SLJIT_ERR_UNSUPPORTED;
+	if (supported[3]) {
+		/* The destination is the first source register. */
+		sljit_emit_simd_op2(compiler, SLJIT_SIMD_OP2_CMP_EQ | type, SLJIT_FR1, SLJIT_FR1, SLJIT_MEM1(SLJIT_S0), 0);
+		/* obuf[12] */
+		sljit_emit_simd_mov(compiler, SLJIT_SIMD_STORE | type, SLJIT_FR1, SLJIT_MEM1(SLJIT_S2), 12 * sizeof(sljit_u32));
+	}
+
+	type = SLJIT_SIMD_REG_256 | SLJIT_SIMD_ELEM_8;
+	supported[4] = sljit_emit_simd_op2(compiler, SLJIT_SIMD_OP2_CMP_EQ | type | SLJIT_SIMD_TEST, SLJIT_FR0, SLJIT_FR1, SLJIT_FR2, 0) != SLJIT_ERR_UNSUPPORTED
+		&& sljit_emit_simd_sign(compiler, SLJIT_SIMD_STORE | type | SLJIT_SIMD_TEST, SLJIT_FR0, SLJIT_R0, 0) != SLJIT_ERR_UNSUPPORTED;
+	if (supported[4]) {
+		sljit_emit_simd_mov(compiler, SLJIT_SIMD_LOAD | type, SLJIT_FR1, SLJIT_MEM1(SLJIT_S0), 0);
+		sljit_emit_simd_mov(compiler, SLJIT_SIMD_LOAD | type, SLJIT_FR2, SLJIT_MEM1(SLJIT_S1), 0);
+		sljit_emit_simd_op2(compiler, SLJIT_SIMD_OP2_CMP_EQ | type, SLJIT_FR0, SLJIT_FR1, SLJIT_FR2, 0);
+		/* obuf[16] */
+		sljit_emit_simd_mov(compiler, SLJIT_SIMD_STORE | type, SLJIT_FR0, SLJIT_MEM1(SLJIT_S2), 16 * sizeof(sljit_u32));
+
+		sljit_emit_simd_replicate(compiler, type, SLJIT_FR3, SLJIT_IMM, 'x');
+		sljit_emit_simd_op2(compiler, SLJIT_SIMD_OP2_CMP_EQ | type, SLJIT_FR4, SLJIT_FR3, SLJIT_FR1, 0);
+		sljit_emit_simd_sign(compiler, SLJIT_SIMD_STORE | type | SLJIT_32, SLJIT_FR4, SLJIT_R0, 0);
+		sljit_emit_op1(compiler, SLJIT_MOV, SLJIT_R1, 0, SLJIT_IMM, (sljit_sw)resw);
+		/* resw[2] */
+		sljit_emit_op1(compiler, SLJIT_MOV_U32, SLJIT_MEM1(SLJIT_R1), 2 * sizeof(sljit_uw), SLJIT_R0, 0);
+	}
+
+	type = SLJIT_SIMD_REG_64 | SLJIT_SIMD_ELEM_8;
+	supported[5] = sljit_emit_simd_op2(compiler, SLJIT_SIMD_OP2_CMP_EQ | type | SLJIT_SIMD_TEST, SLJIT_FR0, SLJIT_FR1, SLJIT_FR2, 0) != SLJIT_ERR_UNSUPPORTED;
+	if (supported[5]) {
+		sljit_emit_simd_mov(compiler, SLJIT_SIMD_LOAD | type, SLJIT_FR1, SLJIT_MEM1(SLJIT_S0), 0);
+		sljit_emit_simd_mov(compiler, SLJIT_SIMD_LOAD | type, SLJIT_FR2, SLJIT_MEM1(SLJIT_S1), 0);
+		sljit_emit_simd_op2(compiler, SLJIT_SIMD_OP2_CMP_EQ | type, SLJIT_FR0, SLJIT_FR1, SLJIT_FR2, 0);
+		/* obuf[24] */
+		sljit_emit_simd_mov(compiler, SLJIT_SIMD_STORE | type, SLJIT_FR0, SLJIT_MEM1(SLJIT_S2), 24 * sizeof(sljit_u32));
+	}
+
+	sljit_emit_return_void(compiler);
+
+	code.code = sljit_generate_code(compiler, 0, NULL);
+	CHECK(compiler);
+	sljit_free_compiler(compiler);
+
+	code.func3((sljit_sw)bbuf, (sljit_sw)cbuf, (sljit_sw)obuf);
+	sljit_free_code(code.code, NULL);
+
+	if (supported[0]) {
+		for (i = 0; i < 16; i++)
+			FAILED(bout[i] != ((i % 3 == 0) ? 0xff : 0), "test_simd14 case 1 failed\n");
+		FAILED(resw[0] != (1 << 13), "test_simd14 case 2 failed\n");
+		FAILED(resw[1] != 13, "test_simd14 case 3 failed\n");
+	}
+
+	if (supported[1]) {
+		/* Both bytes must be equal. */
+		for (i = 0; i < 8; i++)
+			FAILED(hout[8 + i] != 0, "test_simd14 case 4 failed\n");
+	}
+
+	if (supported[2]) {
+		for (i = 0; i < 4; i++)
+			FAILED(obuf[8 + i] != 0xffffffff, "test_simd14 case 5 failed\n");
+	}
+
+	if (supported[3]) {
+		for (i = 0; i < 4; i++)
+			FAILED(obuf[12 + i] != 0xffffffff, "test_simd14 case 6 failed\n");
+	}
+
+	if (supported[4]) {
+		for (i = 0; i < 32; i++)
+			FAILED(bout[64 + i] != ((i % 3 == 0) ? 0xff : 0), "test_simd14 case 7 failed\n");
+		FAILED(resw[2] != ((1 << 13) | (1 << 20)), "test_simd14 case 8 failed\n");
+	}
+
+	if (supported[5]) {
+		for (i = 0; i < 8; i++)
+			FAILED(bout[96 + i] != ((i % 3 == 0) ? 0xff : 0), "test_simd14 case 9 failed\n");
+		FAILED(obuf[26] != 0xaaaaaaaa, "test_simd14 case 10 failed\n");
+	}
+
+	SIMD_RUN_END
+
+	successful_tests++;
+}
+
 #undef SIMD_RUN_START
 #undef SIMD_RUN_END